@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator backing everything built for one translated file. Objects are
+// never destroyed individually: the whole arena is released (or reset and reused)
+// in one shot, so only trivially destructible types may be placed in it.
+class Arena {
+private:
+    struct Chunk {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    static constexpr size_t kMaxChunkSize = 4 * 1024 * 1024;
+
+    std::vector<Chunk> chunks;
+    size_t currentChunk = 0;
+    char* cursor = nullptr;
+    char* limit = nullptr;
+    size_t nextChunkSize;
+    size_t bytesUsed = 0;
+    size_t allocationCount = 0;
+
+    void addChunk(size_t minSize) {
+        // Reuse chunks kept by a previous reset() before asking the heap for more
+        while (currentChunk + 1 < chunks.size()) {
+            ++currentChunk;
+            if (chunks[currentChunk].size >= minSize) {
+                cursor = chunks[currentChunk].data.get();
+                limit = cursor + chunks[currentChunk].size;
+                return;
+            }
+        }
+        size_t size = std::max(nextChunkSize, minSize);
+        nextChunkSize = std::min(nextChunkSize * 2, kMaxChunkSize);
+        chunks.push_back({std::unique_ptr<char[]>(new char[size]), size});
+        currentChunk = chunks.size() - 1;
+        cursor = chunks.back().data.get();
+        limit = cursor + size;
+    }
+
+public:
+    explicit Arena(size_t initialChunkSize = 64 * 1024) : nextChunkSize(initialChunkSize) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        uintptr_t p = reinterpret_cast<uintptr_t>(cursor);
+        uintptr_t aligned = (p + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+        if (cursor == nullptr || aligned + size > reinterpret_cast<uintptr_t>(limit)) {
+            addChunk(size + align);
+            p = reinterpret_cast<uintptr_t>(cursor);
+            aligned = (p + align - 1) & ~(static_cast<uintptr_t>(align) - 1);
+        }
+        cursor = reinterpret_cast<char*>(aligned + size);
+        bytesUsed += size;
+        ++allocationCount;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "Arena objects are never destroyed individually");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    T* copyArray(const T* items, size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "Arena arrays are copied bytewise");
+        if (count == 0) {
+            return nullptr;
+        }
+        T* data = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        std::memcpy(data, items, sizeof(T) * count);
+        return data;
+    }
+
+    std::string_view copyString(std::string_view text) {
+        char* data = static_cast<char*>(allocate(text.size(), 1));
+        std::memcpy(data, text.data(), text.size());
+        return std::string_view(data, text.size());
+    }
+
+    // Drops every object at once but keeps the chunks for the next file
+    void reset() {
+        currentChunk = 0;
+        cursor = chunks.empty() ? nullptr : chunks.front().data.get();
+        limit = chunks.empty() ? nullptr : cursor + chunks.front().size;
+        bytesUsed = 0;
+        allocationCount = 0;
+    }
+
+    size_t used() const {
+        return bytesUsed;
+    }
+
+    size_t allocations() const {
+        return allocationCount;
+    }
+
+    size_t reserved() const {
+        size_t total = 0;
+        for (const Chunk& chunk : chunks) {
+            total += chunk.size;
+        }
+        return total;
+    }
+};
+
+// Deduplicates identifiers into arena storage so that equal names share one
+// pointer and can be compared with a single pointer check.
+class StringInterner {
+private:
+    Arena& arena;
+    std::vector<std::string_view> slots;
+    size_t count = 0;
+
+    static uint64_t hash(std::string_view text) {
+        // FNV-1a
+        uint64_t h = 1469598103934665603ull;
+        for (char c : text) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    void grow() {
+        std::vector<std::string_view> old(slots.size() * 2);
+        old.swap(slots);
+        for (std::string_view entry : old) {
+            if (entry.data() != nullptr) {
+                size_t mask = slots.size() - 1;
+                size_t i = hash(entry) & mask;
+                while (slots[i].data() != nullptr) {
+                    i = (i + 1) & mask;
+                }
+                slots[i] = entry;
+            }
+        }
+    }
+
+public:
+    explicit StringInterner(Arena& storage) : arena(storage), slots(1024) {}
+
+    std::string_view intern(std::string_view text) {
+        if ((count + 1) * 4 > slots.size() * 3) {
+            grow();
+        }
+        size_t mask = slots.size() - 1;
+        size_t i = hash(text) & mask;
+        while (slots[i].data() != nullptr) {
+            if (slots[i] == text) {
+                return slots[i];
+            }
+            i = (i + 1) & mask;
+        }
+        slots[i] = arena.copyString(text);
+        ++count;
+        return slots[i];
+    }
+
+    void clear() {
+        std::fill(slots.begin(), slots.end(), std::string_view());
+        count = 0;
+    }
+
+    size_t size() const {
+        return count;
+    }
+};
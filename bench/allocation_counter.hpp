@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new and delete to count heap allocations and
+// the bytes currently live, which covers the standard containers, strings and
+// runtime containers a benchmark builds. Include it from exactly one
+// translation unit of a benchmark executable.
+//
+// Every block carries a header with its size, so live bytes can be read off
+// before and after a container is built. The counters are atomic for
+// benchmarks that translate on worker threads.
+namespace allocation_counter {
+
+inline std::atomic<size_t> allocations{0};
+inline std::atomic<size_t> liveBytes{0};
+
+constexpr size_t kHeader = alignof(std::max_align_t);
+
+#if defined(__GNUC__)
+#define PY2CPP_BENCH_NOINLINE __attribute__((noinline))
+#else
+#define PY2CPP_BENCH_NOINLINE
+#endif
+
+// Out of line, so the compiler never sees malloc() paired with a delete
+// expression or free() with a new expression
+PY2CPP_BENCH_NOINLINE inline void* acquire(std::size_t size) {
+    void* block = std::malloc(size + kHeader);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *static_cast<size_t*>(block) = size;
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    liveBytes.fetch_add(size, std::memory_order_relaxed);
+    return static_cast<char*>(block) + kHeader;
+}
+
+PY2CPP_BENCH_NOINLINE inline void release(void* p) noexcept {
+    if (p != nullptr) {
+        void* block = static_cast<char*>(p) - kHeader;
+        liveBytes.fetch_sub(*static_cast<size_t*>(block), std::memory_order_relaxed);
+        std::free(block);
+    }
+}
+
+#undef PY2CPP_BENCH_NOINLINE
+
+}  // namespace allocation_counter
+
+void* operator new(std::size_t size) {
+    return allocation_counter::acquire(size);
+}
+
+void* operator new[](std::size_t size) {
+    return allocation_counter::acquire(size);
+}
+
+void operator delete(void* p) noexcept {
+    allocation_counter::release(p);
+}
+
+void operator delete[](void* p) noexcept {
+    allocation_counter::release(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    allocation_counter::release(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    allocation_counter::release(p);
+}
@@ -0,0 +1,276 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "allocation_counter.hpp"
+#include "py2cpp_runtime.hpp"
+
+// Insert and lookup throughput and memory of the runtime's Dict, Set and List
+// against the std containers py2cpp used to emit, on the patterns translated
+// code produces: counting dicts, membership sets and many short lists.
+
+using allocation_counter::allocations;
+using allocation_counter::liveBytes;
+
+struct ContainerResult {
+    std::string workload;
+    std::string container;
+    size_t elements = 0;
+    double insertNs = 0;  // Per element
+    double lookupNs = 0;  // Per lookup, half of them misses
+    double bytesPerElement = 0;        // Requested bytes, without the allocator's own overhead
+    double allocationsPerElement = 0;  // While building
+};
+
+static double nanosecondsSince(std::chrono::steady_clock::time_point start, size_t operations) {
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns / static_cast<double>(operations ? operations : 1);
+}
+
+// Spreads 0..n-1 over 64 bits the way ids and hashes arrive in practice
+static int64_t keyAt(size_t i) {
+    return static_cast<int64_t>(i * 0x9e3779b97f4a7c15ULL >> 1);
+}
+
+static std::vector<std::string> makeWords(size_t n) {
+    std::vector<std::string> words;
+    words.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        words.push_back("word_" + std::to_string(keyAt(i) % 1000000007));
+    }
+    return words;
+}
+
+// counts[key] += 1 over n keys, then n lookups of which every other one misses
+template <typename Map, typename Key>
+static ContainerResult runCounting(const std::string& workload, const std::string& name, const std::vector<Key>& keys,
+                                   const std::vector<Key>& misses) {
+    ContainerResult result;
+    result.workload = workload;
+    result.container = name;
+    result.elements = keys.size();
+    size_t before = liveBytes;
+    size_t allocationsBefore = allocations;
+    {
+        Map counts;
+        auto start = std::chrono::steady_clock::now();
+        for (const Key& key : keys) {
+            counts[key] += 1;
+        }
+        result.insertNs = nanosecondsSince(start, keys.size());
+        result.bytesPerElement = static_cast<double>(liveBytes - before) / static_cast<double>(keys.size());
+        result.allocationsPerElement =
+            static_cast<double>(allocations - allocationsBefore) / static_cast<double>(keys.size());
+
+        size_t found = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < keys.size(); ++i) {
+            found += counts.count(i % 2 == 0 ? keys[i] : misses[i]);
+        }
+        result.lookupNs = nanosecondsSince(start, keys.size());
+        if (found != (keys.size() + 1) / 2) {
+            std::cerr << "Error: " << name << " found " << found << " keys" << std::endl;
+        }
+    }
+    return result;
+}
+
+// seen.insert(key) then `key in seen`
+template <typename SetType>
+static ContainerResult runMembership(const std::string& name, const std::vector<int64_t>& keys,
+                                     const std::vector<int64_t>& misses) {
+    ContainerResult result;
+    result.workload = "set_int";
+    result.container = name;
+    result.elements = keys.size();
+    size_t before = liveBytes;
+    size_t allocationsBefore = allocations;
+    {
+        SetType seen;
+        auto start = std::chrono::steady_clock::now();
+        for (int64_t key : keys) {
+            seen.insert(key);
+        }
+        result.insertNs = nanosecondsSince(start, keys.size());
+        result.bytesPerElement = static_cast<double>(liveBytes - before) / static_cast<double>(keys.size());
+        result.allocationsPerElement =
+            static_cast<double>(allocations - allocationsBefore) / static_cast<double>(keys.size());
+
+        size_t found = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < keys.size(); ++i) {
+            found += py2cpp::contains(seen, i % 2 == 0 ? keys[i] : misses[i]) ? 1 : 0;
+        }
+        result.lookupNs = nanosecondsSince(start, keys.size());
+        if (found != (keys.size() + 1) / 2) {
+            std::cerr << "Error: " << name << " found " << found << " keys" << std::endl;
+        }
+    }
+    return result;
+}
+
+// rows.append([x, y, z]) n times, then a pass reading every row
+template <typename Row, typename Rows>
+static ContainerResult runSmallLists(const std::string& name, size_t n) {
+    ContainerResult result;
+    result.workload = "list_of_triples";
+    result.container = name;
+    result.elements = n;
+    size_t before = liveBytes;
+    size_t allocationsBefore = allocations;
+    {
+        Rows rows;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < n; ++i) {
+            int64_t x = static_cast<int64_t>(i);
+            rows.push_back(Row{x, x + 1, x + 2});
+        }
+        result.insertNs = nanosecondsSince(start, n);
+        result.bytesPerElement = static_cast<double>(liveBytes - before) / static_cast<double>(n);
+        result.allocationsPerElement =
+            static_cast<double>(allocations - allocationsBefore) / static_cast<double>(n);
+
+        int64_t total = 0;
+        start = std::chrono::steady_clock::now();
+        for (const Row& row : rows) {
+            total += row[0] + row[2];
+        }
+        result.lookupNs = nanosecondsSince(start, n);
+        if (total == 42) {
+            std::cerr << total << std::endl;
+        }
+    }
+    return result;
+}
+
+// Best of a few runs, so each container gets a heap already warmed up by the others
+static ContainerResult best(const std::function<ContainerResult()>& run) {
+    ContainerResult result = run();
+    for (int i = 1; i < 3; ++i) {
+        ContainerResult again = run();
+        result.insertNs = std::min(result.insertNs, again.insertNs);
+        result.lookupNs = std::min(result.lookupNs, again.lookupNs);
+    }
+    return result;
+}
+
+static std::vector<ContainerResult> runAll(size_t n, const std::string& only) {
+    std::vector<ContainerResult> results;
+    auto wanted = [&only](const char* workload) { return only.empty() || only == workload; };
+
+    std::vector<int64_t> keys(n);
+    std::vector<int64_t> misses(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = keyAt(i);
+        misses[i] = keyAt(i + n);
+    }
+    if (wanted("dict_int")) {
+        using Dict = py2cpp::Dict<int64_t, int64_t>;
+        using Map = std::map<int64_t, int64_t>;
+        using Hashed = std::unordered_map<int64_t, int64_t>;
+        results.push_back(best([&] { return runCounting<Dict>("dict_int", "py2cpp::Dict", keys, misses); }));
+        results.push_back(best([&] { return runCounting<Map>("dict_int", "std::map", keys, misses); }));
+        results.push_back(best([&] { return runCounting<Hashed>("dict_int", "std::unordered_map", keys, misses); }));
+    }
+    if (wanted("dict_str")) {
+        using Dict = py2cpp::Dict<std::string, int64_t>;
+        using Map = std::map<std::string, int64_t>;
+        using Hashed = std::unordered_map<std::string, int64_t>;
+        std::vector<std::string> words = makeWords(2 * n);
+        std::vector<std::string> present(words.begin(), words.begin() + static_cast<std::ptrdiff_t>(n));
+        std::vector<std::string> absent(words.begin() + static_cast<std::ptrdiff_t>(n), words.end());
+        results.push_back(best([&] { return runCounting<Dict>("dict_str", "py2cpp::Dict", present, absent); }));
+        results.push_back(best([&] { return runCounting<Map>("dict_str", "std::map", present, absent); }));
+        results.push_back(best([&] { return runCounting<Hashed>("dict_str", "std::unordered_map", present, absent); }));
+    }
+    if (wanted("set_int")) {
+        results.push_back(best([&] { return runMembership<py2cpp::Set<int64_t>>("py2cpp::Set", keys, misses); }));
+        results.push_back(best([&] { return runMembership<std::set<int64_t>>("std::set", keys, misses); }));
+        results.push_back(
+            best([&] { return runMembership<std::unordered_set<int64_t>>("std::unordered_set", keys, misses); }));
+    }
+    if (wanted("list_of_triples")) {
+        using List = py2cpp::List<int64_t>;
+        using Vector = std::vector<int64_t>;
+        results.push_back(best([&] { return runSmallLists<List, py2cpp::List<List>>("py2cpp::List", n); }));
+        results.push_back(best([&] { return runSmallLists<Vector, std::vector<Vector>>("std::vector", n); }));
+    }
+    return results;
+}
+
+static void writeJson(std::ostream& out, const std::vector<ContainerResult>& results) {
+    out << "{\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const ContainerResult& r = results[i];
+        char buffer[384];
+        std::snprintf(buffer, sizeof(buffer),
+                      "    {\"workload\": \"%s\", \"container\": \"%s\", \"elements\": %zu, \"insert_ns\": %.1f, "
+                      "\"lookup_ns\": %.1f, \"bytes_per_element\": %.1f, \"allocations_per_element\": %.2f}",
+                      r.workload.c_str(), r.container.c_str(), r.elements, r.insertNs, r.lookupNs,
+                      r.bytesPerElement, r.allocationsPerElement);
+        out << buffer << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]" << std::endl;
+    std::cerr << "  --size N             Elements per container (default 1000000)" << std::endl;
+    std::cerr << "  --only NAME          Run one of dict_int, dict_str, set_int, list_of_triples" << std::endl;
+    std::cerr << "  --json FILE          Write results to FILE instead of stdout" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    size_t size = 1000000;
+    std::string only;
+    std::string jsonOut;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--size") {
+            size = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--only") {
+            only = value;
+        } else if (arg == "--json") {
+            jsonOut = value;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (size == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<ContainerResult> results = runAll(size, only);
+    if (jsonOut.empty()) {
+        writeJson(std::cout, results);
+        return 0;
+    }
+    std::ofstream file(jsonOut);
+    writeJson(file, results);
+    if (!file) {
+        std::cerr << "Error: Could not write results file " << jsonOut << std::endl;
+        return 1;
+    }
+    return 0;
+}
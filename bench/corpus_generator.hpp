@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Deterministic generator of synthetic Python modules for benchmarking. The same
+// options always produce byte-identical output, so runs can be compared.
+struct CorpusOptions {
+    size_t lines = 20000;
+    uint64_t seed = 1;
+    // Relative weights of the construct families
+    unsigned classes = 1;         // Deep class hierarchies with methods
+    unsigned comprehensions = 1;  // Long list/dict/set comprehension lines
+    unsigned fstrings = 1;        // f-string heavy printing
+    unsigned loops = 1;           // Nested for/while loops
+    unsigned exceptions = 1;      // try/except/finally blocks
+};
+
+class CorpusGenerator {
+private:
+    CorpusOptions options;
+    uint64_t state;
+    std::string out;
+    size_t lineCount = 0;
+    size_t blockCounter = 0;
+
+    // splitmix64
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    size_t pick(size_t bound) {
+        return static_cast<size_t>(next() % bound);
+    }
+
+    const char* name() {
+        static const char* const names[] = {"value", "count", "total", "item", "index", "result",
+                                            "data", "score", "weight", "offset", "limit", "ratio"};
+        return names[pick(sizeof(names) / sizeof(names[0]))];
+    }
+
+    void line(int indent, const std::string& text) {
+        out.append(indent * 4, ' ');
+        out += text;
+        out += '\n';
+        ++lineCount;
+    }
+
+    std::string id(const char* prefix) {
+        return prefix + std::to_string(blockCounter);
+    }
+
+    void emitClassHierarchy() {
+        size_t depth = 3 + pick(5);
+        std::string base;
+        for (size_t level = 0; level < depth; ++level) {
+            std::string cls = id("Node") + "_" + std::to_string(level);
+            line(0, "class " + cls + (base.empty() ? "" : "(" + base + ")") + ":");
+            line(1, "kind = \"" + cls + "\"");
+            line(0, "");
+            std::string param = name();
+            if (param == "weight") {
+                param = "value";  // Already the keyword parameter; Python rejects the duplicate
+            }
+            line(1, "def __init__(self, " + param + ", weight=" + std::to_string(pick(10)) + "):");
+            if (!base.empty()) {
+                line(2, "super().__init__(weight, weight)");
+            }
+            line(2, "self.level = " + std::to_string(level));
+            line(2, "self.weight = weight");
+            line(0, "");
+            line(1, "def describe(self):");
+            line(2, "return f\"" + cls + "(level={self.level}, weight={self.weight:.2f})\"");
+            line(0, "");
+            line(1, "@staticmethod");
+            line(1, "def scale(x, factor=2):");
+            line(2, "return x * factor + " + std::to_string(pick(100)));
+            line(0, "");
+            base = cls;
+        }
+    }
+
+    void emitComprehensions() {
+        std::string fn = id("transform");
+        line(0, "def " + fn + "(values, threshold):");
+        line(1, "squares = [v * v + " + std::to_string(pick(9)) + " for v in values if v > threshold and v % " +
+                    std::to_string(2 + pick(5)) + " != 0 or v < -threshold]");
+        line(1, "lookup = {str(k): k * " + std::to_string(1 + pick(7)) +
+                    " for k in values if k not in squares and k // 2 > threshold}");
+        line(1, "unique = {abs(x) for x in squares if x != threshold}");
+        line(1, "pairs = [(a, b) for a in range(len(values)) for b in range(a) if a + b < threshold * 3]");
+        line(1, "return squares, lookup, unique, pairs");
+        line(0, "");
+    }
+
+    void emitFStrings() {
+        std::string fn = id("report");
+        line(0, "def " + fn + "(name, amount, ratio, items):");
+        line(1, "print(f\"Report for {name}: amount={amount}, ratio={ratio:.3f}\")");
+        line(1, "print(f\"{name!r} has {len(items)} items, first={items[0] if items else None}\")");
+        line(1, "header = f\"== {name.upper()} == {amount * ratio:>10.2f} ==\"");
+        line(1, "print(header, f\"total={sum(items)}\", sep=\" | \")");
+        line(1, "return f\"{header}:{amount}:{ratio}\"");
+        line(0, "");
+    }
+
+    void emitLoops() {
+        std::string fn = id("accumulate");
+        line(0, "def " + fn + "(matrix, limit):");
+        line(1, "total = 0");
+        line(1, "for i in range(len(matrix)):");
+        line(2, "for j in range(" + std::to_string(1 + pick(4)) + ", len(matrix[i])):");
+        line(3, "if matrix[i][j] > limit:");
+        line(4, "total += matrix[i][j] * " + std::to_string(1 + pick(9)));
+        line(3, "elif matrix[i][j] < 0:");
+        line(4, "continue");
+        line(3, "else:");
+        line(4, "total -= 1");
+        line(1, "n = limit");
+        line(1, "while n > 0:");
+        line(2, "n //= 2");
+        line(2, "total += n");
+        line(1, "for key, " + std::string(name()) + " in matrix_index.items():");
+        line(2, "total += len(key)");
+        line(1, "return total");
+        line(0, "");
+    }
+
+    void emitExceptions() {
+        std::string fn = id("safe_divide");
+        line(0, "def " + fn + "(a, b):");
+        line(1, "try:");
+        line(2, "if b == 0:");
+        line(3, "raise ValueError(\"division by zero\")");
+        line(2, "result = a / b");
+        line(1, "except ValueError as e:");
+        line(2, "print(f\"Error: {e}\")");
+        line(2, "result = 0");
+        line(1, "except (TypeError, KeyError):");
+        line(2, "result = -1");
+        line(1, "finally:");
+        line(2, "print(\"done\")");
+        line(1, "return result");
+        line(0, "");
+    }
+
+public:
+    explicit CorpusGenerator(const CorpusOptions& opts) : options(opts), state(opts.seed) {}
+
+    std::string generate() {
+        out.clear();
+        lineCount = 0;
+        blockCounter = 0;
+        line(0, "# Synthetic benchmark corpus, seed " + std::to_string(options.seed));
+        line(0, "matrix_index = {}");
+        line(0, "");
+
+        unsigned weights[] = {options.classes, options.comprehensions, options.fstrings, options.loops,
+                              options.exceptions};
+        unsigned totalWeight = 0;
+        for (unsigned w : weights) {
+            totalWeight += w;
+        }
+        if (totalWeight == 0) {
+            return out;
+        }
+        std::vector<std::string> calls;
+        while (lineCount < options.lines) {
+            ++blockCounter;
+            size_t roll = pick(totalWeight);
+            size_t family = 0;
+            while (roll >= weights[family]) {
+                roll -= weights[family];
+                ++family;
+            }
+            switch (family) {
+                case 0: emitClassHierarchy(); break;
+                case 1: emitComprehensions(); calls.push_back(id("transform") + "([1, 2, 3], 1)"); break;
+                case 2: emitFStrings(); calls.push_back(id("report") + "(\"x\", 3, 0.5, [1, 2])"); break;
+                case 3: emitLoops(); calls.push_back(id("accumulate") + "([[1, 2], [3, 4]], 2)"); break;
+                default: emitExceptions(); calls.push_back(id("safe_divide") + "(6, 3)"); break;
+            }
+        }
+
+        line(0, "if __name__ == \"__main__\":");
+        if (calls.empty()) {
+            line(1, "pass");
+        }
+        for (const std::string& call : calls) {
+            line(1, call);
+        }
+        return out;
+    }
+
+    size_t lines() const {
+        return lineCount;
+    }
+};
@@ -0,0 +1,143 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "py2cpp_runtime.hpp"
+
+// Prints the same lines through the old std::cout << std::endl lowering and
+// through the runtime's buffered print, the way translated print-heavy loops do.
+// The printed text goes to stdout, so run it as `py2cpp_print_bench > /dev/null`
+// (or into a file); results are written to stderr.
+
+struct PrintResult {
+    std::string name;
+    size_t lines = 0;
+    double seconds = 0;
+};
+
+static PrintResult run(const std::string& name, size_t lines, const std::function<void(size_t)>& body) {
+    auto start = std::chrono::steady_clock::now();
+    body(lines);
+    PrintResult result;
+    result.name = name;
+    result.lines = lines;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+// print(f"item {i}: value={value:.2f} ok={flag}") and print(i, value, name)
+static std::vector<PrintResult> runAll(size_t lines, const std::string& only) {
+    static const py2cpp::FormatSpec twoDecimals{' ', 0, '-', false, 0, 0, 2, 'f'};
+    const std::string name = "widget";
+    std::vector<PrintResult> results;
+    auto wanted = [&only](const char* benchmark) { return only.empty() || only == benchmark; };
+
+    if (wanted("cout_endl")) {
+        results.push_back(run("cout_endl", lines, [&](size_t n) {
+            std::cout << std::fixed;
+            std::cout.precision(2);
+            for (size_t i = 0; i < n; ++i) {
+                double value = static_cast<double>(i) * 0.5;
+                std::cout << "item " << i << ": value=" << value << " ok=" << (i % 3 == 0 ? "True" : "False")
+                          << std::endl;
+            }
+        }));
+    }
+    if (wanted("py2cpp_fstring")) {
+        results.push_back(run("py2cpp_fstring", lines, [&](size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                double value = static_cast<double>(i) * 0.5;
+                py2cpp::print(py2cpp::fstring("item ", i, ": value=", py2cpp::fmt(value, twoDecimals), " ok=",
+                                              i % 3 == 0));
+            }
+            py2cpp::stdoutBuffer().flush();
+        }));
+    }
+    if (wanted("cout_endl_args")) {
+        results.push_back(run("cout_endl_args", lines, [&](size_t n) {
+            std::cout.unsetf(std::ios::floatfield);
+            std::cout.precision(17);
+            for (size_t i = 0; i < n; ++i) {
+                std::cout << i << " " << static_cast<double>(i) * 0.25 << " " << name << std::endl;
+            }
+        }));
+    }
+    if (wanted("py2cpp_args")) {
+        results.push_back(run("py2cpp_args", lines, [&](size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                py2cpp::print(i, static_cast<double>(i) * 0.25, name);
+            }
+            py2cpp::stdoutBuffer().flush();
+        }));
+    }
+    return results;
+}
+
+static void writeJson(std::ostream& out, const std::vector<PrintResult>& results) {
+    out << "{\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const PrintResult& r = results[i];
+        double seconds = r.seconds > 0 ? r.seconds : 1e-9;
+        char buffer[256];
+        std::snprintf(buffer, sizeof(buffer),
+                      "    {\"name\": \"%s\", \"lines\": %zu, \"seconds\": %.6f, \"ns_per_line\": %.1f, "
+                      "\"lines_per_sec\": %.0f}",
+                      r.name.c_str(), r.lines, r.seconds, 1e9 * seconds / static_cast<double>(r.lines ? r.lines : 1),
+                      r.lines / seconds);
+        out << buffer << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] > /dev/null" << std::endl;
+    std::cerr << "  --lines N            Lines printed per benchmark (default 10000000)" << std::endl;
+    std::cerr << "  --only NAME          Run one of cout_endl, py2cpp_fstring, cout_endl_args, py2cpp_args"
+              << std::endl;
+    std::cerr << "  --json FILE          Write results to FILE instead of stderr" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    size_t lines = 10000000;
+    std::string only;
+    std::string jsonOut;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--lines") {
+            lines = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--only") {
+            only = value;
+        } else if (arg == "--json") {
+            jsonOut = value;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<PrintResult> results = runAll(lines, only);
+    if (jsonOut.empty()) {
+        writeJson(std::cerr, results);
+        return 0;
+    }
+    std::ofstream file(jsonOut);
+    writeJson(file, results);
+    if (!file) {
+        std::cerr << "Error: Could not write results file " << jsonOut << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,387 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "allocation_counter.hpp"
+#include "corpus_generator.hpp"
+#include "py_to_cpp_decompiler.hpp"
+
+struct BenchResult {
+    std::string name;
+    size_t items = 0;        // Nodes handled per iteration
+    size_t lines = 0;        // Source lines covered per iteration
+    size_t inputBytes = 0;   // Source bytes per iteration (end-to-end only)
+    size_t outputBytes = 0;  // Generated bytes per iteration
+    size_t iterations = 0;
+    size_t allocations = 0;  // Over all iterations
+    double seconds = 0;
+};
+
+// Drives the private converters of PythonToCppDecompiler on nodes taken from a
+// parsed corpus, one benchmark per converter
+class DecompilerBench {
+private:
+    using Decompiler = PythonToCppDecompiler;
+
+    struct Nodes {
+        std::vector<const ClassDef*> classes;
+        std::vector<std::pair<const ClassDef*, const FunctionDef*>> methods;
+        std::vector<const FunctionDef*> functions;
+        std::vector<const TryStmt*> tries;
+        std::vector<const ForStmt*> loops;
+        std::vector<const IfStmt*> conditionals;
+        std::vector<const Stmt*> simpleStatements;
+        std::vector<const FStringExpr*> fstrings;
+        std::vector<const ComprehensionExpr*> comprehensions;
+    };
+
+    static int lastLine(const Stmt* stmt) {
+        int last = stmt->line;
+        auto visit = [&last](const StmtList& body) {
+            if (!body.empty()) {
+                last = std::max(last, lastLine(body.back()));
+            }
+        };
+        switch (stmt->kind) {
+            case StmtKind::If:
+            case StmtKind::While:
+                visit(static_cast<const IfStmt*>(stmt)->body);
+                visit(static_cast<const IfStmt*>(stmt)->orelse);
+                break;
+            case StmtKind::For:
+                visit(static_cast<const ForStmt*>(stmt)->body);
+                visit(static_cast<const ForStmt*>(stmt)->orelse);
+                break;
+            case StmtKind::FunctionDef:
+                visit(static_cast<const FunctionDef*>(stmt)->body);
+                break;
+            case StmtKind::ClassDef:
+                visit(static_cast<const ClassDef*>(stmt)->body);
+                break;
+            case StmtKind::Try: {
+                auto* tryStmt = static_cast<const TryStmt*>(stmt);
+                visit(tryStmt->body);
+                for (const ExceptHandler* handler : tryStmt->handlers) {
+                    visit(handler->body);
+                }
+                visit(tryStmt->orelse);
+                visit(tryStmt->finalbody);
+                break;
+            }
+            case StmtKind::With:
+                visit(static_cast<const WithStmt*>(stmt)->body);
+                break;
+            default:
+                break;
+        }
+        return last;
+    }
+
+    static void collectExpression(const Expr* expr, Nodes& nodes) {
+        if (expr == nullptr) {
+            return;
+        }
+        if (expr->kind == ExprKind::FString) {
+            nodes.fstrings.push_back(static_cast<const FStringExpr*>(expr));
+        } else if (expr->kind == ExprKind::ListComp || expr->kind == ExprKind::SetComp) {
+            nodes.comprehensions.push_back(static_cast<const ComprehensionExpr*>(expr));
+        } else if (expr->kind == ExprKind::Call) {
+            for (const Expr* arg : static_cast<const CallExpr*>(expr)->args) {
+                collectExpression(arg->kind == ExprKind::Keyword ? static_cast<const KeywordExpr*>(arg)->value : arg,
+                                  nodes);
+            }
+        }
+    }
+
+    static void collect(const StmtList& body, const ClassDef* owner, bool topLevel, Nodes& nodes) {
+        for (const Stmt* stmt : body) {
+            switch (stmt->kind) {
+                case StmtKind::ClassDef: {
+                    auto* cls = static_cast<const ClassDef*>(stmt);
+                    nodes.classes.push_back(cls);
+                    collect(cls->body, cls, false, nodes);
+                    break;
+                }
+                case StmtKind::FunctionDef: {
+                    auto* def = static_cast<const FunctionDef*>(stmt);
+                    if (owner != nullptr) {
+                        nodes.methods.emplace_back(owner, def);
+                    } else if (topLevel) {
+                        nodes.functions.push_back(def);
+                    }
+                    collect(def->body, nullptr, false, nodes);
+                    break;
+                }
+                case StmtKind::Try: {
+                    auto* tryStmt = static_cast<const TryStmt*>(stmt);
+                    nodes.tries.push_back(tryStmt);
+                    collect(tryStmt->body, nullptr, false, nodes);
+                    for (const ExceptHandler* handler : tryStmt->handlers) {
+                        collect(handler->body, nullptr, false, nodes);
+                    }
+                    collect(tryStmt->finalbody, nullptr, false, nodes);
+                    break;
+                }
+                case StmtKind::For: {
+                    auto* loop = static_cast<const ForStmt*>(stmt);
+                    nodes.loops.push_back(loop);
+                    collect(loop->body, nullptr, false, nodes);
+                    break;
+                }
+                case StmtKind::If:
+                case StmtKind::While: {
+                    auto* cond = static_cast<const IfStmt*>(stmt);
+                    if (stmt->kind == StmtKind::If && !cond->isElif) {
+                        nodes.conditionals.push_back(cond);
+                    }
+                    collect(cond->body, nullptr, false, nodes);
+                    collect(cond->orelse, nullptr, false, nodes);
+                    break;
+                }
+                case StmtKind::Expr:
+                    nodes.simpleStatements.push_back(stmt);
+                    collectExpression(static_cast<const ExprStmt*>(stmt)->value, nodes);
+                    break;
+                case StmtKind::Assign:
+                    nodes.simpleStatements.push_back(stmt);
+                    collectExpression(static_cast<const AssignStmt*>(stmt)->value, nodes);
+                    break;
+                case StmtKind::Return:
+                    nodes.simpleStatements.push_back(stmt);
+                    collectExpression(static_cast<const ValueStmt*>(stmt)->value, nodes);
+                    break;
+                case StmtKind::AugAssign:
+                case StmtKind::AnnAssign:
+                case StmtKind::Raise:
+                case StmtKind::Pass:
+                case StmtKind::Break:
+                case StmtKind::Continue:
+                    nodes.simpleStatements.push_back(stmt);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    // Runs `body` over all items until at least minSeconds have passed
+    template <typename T, typename F>
+    static BenchResult run(const char* name, const std::vector<T>& items, double minSeconds,
+                           std::function<int(const T&)> lines, F body) {
+        BenchResult result;
+        result.name = name;
+        result.items = items.size();
+        for (const T& item : items) {
+            result.lines += static_cast<size_t>(lines(item));
+        }
+        if (items.empty()) {
+            return result;
+        }
+        std::string out;
+        size_t allocationsBefore = allocation_counter::allocations;
+        auto start = std::chrono::steady_clock::now();
+        do {
+            result.outputBytes = 0;
+            for (const T& item : items) {
+                out.clear();
+                body(item, out);
+                result.outputBytes += out.size();
+            }
+            ++result.iterations;
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (result.seconds < minSeconds);
+        result.allocations = allocation_counter::allocations - allocationsBefore;
+        return result;
+    }
+
+public:
+    static BenchResult endToEnd(const std::string& corpus, size_t lines, double minSeconds) {
+        BenchResult result;
+        result.name = "decompile";
+        result.items = 1;
+        result.lines = lines;
+        result.inputBytes = corpus.size();
+        size_t allocationsBefore = allocation_counter::allocations;
+        auto start = std::chrono::steady_clock::now();
+        do {
+            PythonToCppDecompiler decompiler(corpus);
+            result.outputBytes = decompiler.decompile().size();
+            ++result.iterations;
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (result.seconds < minSeconds);
+        result.allocations = allocation_counter::allocations - allocationsBefore;
+        return result;
+    }
+
+    static std::vector<BenchResult> converters(const std::string& corpus, double minSeconds) {
+        Decompiler d(corpus);
+        d.reset();
+        d.collectDefinitions();
+        PythonParser parser(d.pythonCode, d.arena, d.interner);
+        const Module* module = parser.parseModule();
+        d.types.analyze(module->body);
+        Nodes nodes;
+        collect(module->body, nullptr, true, nodes);
+
+        auto stmtLines = [](const auto* stmt) { return lastLine(stmt) - stmt->line + 1; };
+        auto exprLines = [](const auto*) { return 1; };
+        std::vector<BenchResult> results;
+
+        results.push_back(run<const ClassDef*>("convertClass", nodes.classes, minSeconds, stmtLines,
+            [&d](const ClassDef* cls, std::string& out) { d.convertClass(cls, 0, out); }));
+
+        results.push_back(run<std::pair<const ClassDef*, const FunctionDef*>>(
+            "convertClassMethod", nodes.methods, minSeconds,
+            [](const std::pair<const ClassDef*, const FunctionDef*>& m) {
+                return lastLine(m.second) - m.second->line + 1;
+            },
+            [&d](const std::pair<const ClassDef*, const FunctionDef*>& m, std::string& out) {
+                d.currentClass = m.first;
+                d.currentBaseClass.clear();
+                if (!m.first->bases.empty()) {
+                    d.convertExpression(m.first->bases[0], d.currentBaseClass);
+                }
+                d.convertClassMethod(m.second, 1, out);
+            }));
+
+        results.push_back(run<const FunctionDef*>("convertFunction", nodes.functions, minSeconds, stmtLines,
+            [&d](const FunctionDef* def, std::string& out) { d.convertFunction(def, 0, out); }));
+
+        results.push_back(run<const TryStmt*>("handleExceptions", nodes.tries, minSeconds, stmtLines,
+            [&d](const TryStmt* stmt, std::string& out) { d.handleExceptions(stmt, 1, out); }));
+
+        results.push_back(run<const ForStmt*>("convertFor", nodes.loops, minSeconds, stmtLines,
+            [&d](const ForStmt* stmt, std::string& out) { d.convertFor(stmt, 1, out); }));
+
+        results.push_back(run<const IfStmt*>("convertIf", nodes.conditionals, minSeconds, stmtLines,
+            [&d](const IfStmt* stmt, std::string& out) { d.convertIf(stmt, 1, out); }));
+
+        results.push_back(run<const Stmt*>("processLine", nodes.simpleStatements, minSeconds, stmtLines,
+            [&d](const Stmt* stmt, std::string& out) { d.processLine(stmt, out); }));
+
+        results.push_back(run<const FStringExpr*>("convertStringFormatting", nodes.fstrings, minSeconds, exprLines,
+            [&d](const FStringExpr* fstring, std::string& out) { d.convertStringFormatting(fstring, out); }));
+
+        results.push_back(run<const ComprehensionExpr*>("convertListComprehension", nodes.comprehensions, minSeconds,
+            exprLines,
+            [&d](const ComprehensionExpr* comp, std::string& out) { d.convertListComprehension(comp, out); }));
+        return results;
+    }
+};
+
+static void writeJson(std::ostream& out, const CorpusOptions& options, size_t lines, size_t bytes,
+                      const std::vector<BenchResult>& results) {
+    out << "{\n";
+    out << "  \"corpus\": {\"lines\": " << lines << ", \"bytes\": " << bytes << ", \"seed\": " << options.seed
+        << ", \"mix\": {\"classes\": " << options.classes << ", \"comprehensions\": " << options.comprehensions
+        << ", \"fstrings\": " << options.fstrings << ", \"loops\": " << options.loops
+        << ", \"exceptions\": " << options.exceptions << "}},\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        double totalLines = static_cast<double>(r.lines) * r.iterations;
+        double seconds = r.seconds > 0 ? r.seconds : 1e-9;
+        char buffer[512];
+        std::snprintf(buffer, sizeof(buffer),
+                      "    {\"name\": \"%s\", \"items\": %zu, \"lines\": %zu, \"iterations\": %zu, "
+                      "\"seconds\": %.6f, \"ns_per_item\": %.1f, \"lines_per_sec\": %.0f, "
+                      "\"input_bytes_per_sec\": %.0f, \"output_bytes_per_sec\": %.0f, "
+                      "\"allocations_per_line\": %.3f}",
+                      r.name.c_str(), r.items, r.lines, r.iterations, r.seconds,
+                      r.items > 0 && r.iterations > 0 ? 1e9 * r.seconds / (static_cast<double>(r.items) * r.iterations) : 0.0,
+                      totalLines / seconds, static_cast<double>(r.inputBytes) * r.iterations / seconds,
+                      static_cast<double>(r.outputBytes) * r.iterations / seconds,
+                      totalLines > 0 ? r.allocations / totalLines : 0.0);
+        out << buffer << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl;
+    std::cout << "  --lines N            Size of the generated corpus (default 20000)" << std::endl;
+    std::cout << "  --seed N             Generator seed (default 1)" << std::endl;
+    std::cout << "  --classes W          Weight of class hierarchies (default 1)" << std::endl;
+    std::cout << "  --comprehensions W   Weight of comprehension lines (default 1)" << std::endl;
+    std::cout << "  --fstrings W         Weight of f-string code (default 1)" << std::endl;
+    std::cout << "  --loops W            Weight of nested loops (default 1)" << std::endl;
+    std::cout << "  --exceptions W       Weight of try/except blocks (default 1)" << std::endl;
+    std::cout << "  --min-time S         Minimum seconds per benchmark (default 0.5)" << std::endl;
+    std::cout << "  --corpus-out FILE    Write the generated corpus to FILE and exit" << std::endl;
+    std::cout << "  --json FILE          Write results to FILE instead of stdout" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    CorpusOptions options;
+    double minSeconds = 0.5;
+    std::string corpusOut;
+    std::string jsonOut;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--lines") {
+            options.lines = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--seed") {
+            options.seed = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--classes") {
+            options.classes = static_cast<unsigned>(std::atoi(value));
+        } else if (arg == "--comprehensions") {
+            options.comprehensions = static_cast<unsigned>(std::atoi(value));
+        } else if (arg == "--fstrings") {
+            options.fstrings = static_cast<unsigned>(std::atoi(value));
+        } else if (arg == "--loops") {
+            options.loops = static_cast<unsigned>(std::atoi(value));
+        } else if (arg == "--exceptions") {
+            options.exceptions = static_cast<unsigned>(std::atoi(value));
+        } else if (arg == "--min-time") {
+            minSeconds = std::atof(value);
+        } else if (arg == "--corpus-out") {
+            corpusOut = value;
+        } else if (arg == "--json") {
+            jsonOut = value;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    CorpusGenerator generator(options);
+    std::string corpus = generator.generate();
+    if (!corpusOut.empty()) {
+        std::ofstream file(corpusOut, std::ios::binary);
+        file << corpus;
+        if (!file) {
+            std::cerr << "Error: Could not write corpus file " << corpusOut << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    std::vector<BenchResult> results;
+    results.push_back(DecompilerBench::endToEnd(corpus, generator.lines(), minSeconds));
+    for (BenchResult& result : DecompilerBench::converters(corpus, minSeconds)) {
+        results.push_back(std::move(result));
+    }
+
+    if (jsonOut.empty()) {
+        writeJson(std::cout, options, generator.lines(), corpus.size(), results);
+        return 0;
+    }
+    std::ofstream file(jsonOut);
+    writeJson(file, options, generator.lines(), corpus.size(), results);
+    if (!file) {
+        std::cerr << "Error: Could not write results file " << jsonOut << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "corpus_generator.hpp"
+#include "py_to_cpp_decompiler.hpp"
+#include "serve.hpp"
+
+extern char** environ;
+
+// Per-file latency of translating many small modules three ways: one py2cpp
+// process per file (how build systems call the CLI), one `py2cpp --serve`
+// process answering framed requests over pipes, and translate() on a reused
+// in-process decompiler. The py2cpp binary is looked up next to this one.
+
+struct LatencyResult {
+    std::string mode;
+    std::vector<double> micros;  // One entry per file, sorted
+};
+
+static LatencyResult finish(const std::string& mode, std::vector<double> micros) {
+    std::sort(micros.begin(), micros.end());
+    return {mode, std::move(micros)};
+}
+
+static double elapsedMicros(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool runProcess(const std::vector<std::string>& args) {
+    std::vector<char*> argv;
+    for (const std::string& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    pid_t pid;
+    int status = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (status != 0 || waitpid(pid, &status, 0) < 0) {
+        return false;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static bool runOneShot(const std::string& py2cpp, const std::vector<std::string>& inputs,
+                       const std::filesystem::path& outputDir, LatencyResult& result) {
+    std::vector<double> micros;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        std::string output = (outputDir / ("oneshot" + std::to_string(i) + ".cpp")).string();
+        auto start = std::chrono::steady_clock::now();
+        if (!runProcess({py2cpp, inputs[i], output})) {
+            std::cerr << "Error: " << py2cpp << " failed on " << inputs[i] << std::endl;
+            return false;
+        }
+        micros.push_back(elapsedMicros(start));
+    }
+    result = finish("oneshot_cli", std::move(micros));
+    return true;
+}
+
+// `command` is "translate" (payload: the source) or "file" (payload: the paths)
+static bool runServer(const std::string& py2cpp, const std::string& command,
+                      const std::vector<std::string>& payloads, LatencyResult& result) {
+    int requests[2];
+    int responses[2];
+    if (pipe(requests) != 0 || pipe(responses) != 0) {
+        return false;
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, requests[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, responses[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, requests[1]);
+    posix_spawn_file_actions_addclose(&actions, responses[0]);
+    std::string serveFlag = "--serve";
+    char* argv[] = {const_cast<char*>(py2cpp.c_str()), const_cast<char*>(serveFlag.c_str()), nullptr};
+    pid_t pid;
+    int status = posix_spawn(&pid, argv[0], &actions, nullptr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(requests[0]);
+    close(responses[1]);
+    if (status != 0) {
+        return false;
+    }
+
+    FrameChannel channel(responses[0], requests[1]);
+    std::vector<double> micros;
+    std::string reply;
+    std::string payload;
+    bool ok = true;
+    for (const std::string& request : payloads) {
+        auto start = std::chrono::steady_clock::now();
+        if (!channel.writeFrame(command, request) || !channel.readFrame(reply, payload) || reply != "ok") {
+            std::cerr << "Error: py2cpp --serve failed: " << (reply == "error" ? payload : channel.error()) << std::endl;
+            ok = false;
+            break;
+        }
+        micros.push_back(elapsedMicros(start));
+    }
+    close(requests[1]);
+    close(responses[0]);
+    waitpid(pid, &status, 0);
+    result = finish("serve_" + command, std::move(micros));
+    return ok;
+}
+
+static LatencyResult runInProcess(const std::vector<std::string>& sources) {
+    PythonToCppDecompiler decompiler;
+    std::vector<double> micros;
+    for (const std::string& source : sources) {
+        auto start = std::chrono::steady_clock::now();
+        decompiler.translate(source);
+        micros.push_back(elapsedMicros(start));
+    }
+    return finish("library_translate", std::move(micros));
+}
+
+static void writeJson(std::ostream& out, size_t files, size_t lines, const std::vector<LatencyResult>& results) {
+    out << "{\n";
+    out << "  \"files\": " << files << ", \"lines_per_file\": " << lines << ",\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const std::vector<double>& micros = results[i].micros;
+        double total = 0;
+        for (double m : micros) {
+            total += m;
+        }
+        auto percentile = [&micros](double p) {
+            return micros.empty() ? 0.0 : micros[std::min(micros.size() - 1, static_cast<size_t>(p * micros.size()))];
+        };
+        char buffer[384];
+        std::snprintf(buffer, sizeof(buffer),
+                      "    {\"mode\": \"%s\", \"mean_us\": %.1f, \"p50_us\": %.1f, \"p90_us\": %.1f, "
+                      "\"p99_us\": %.1f}",
+                      results[i].mode.c_str(), micros.empty() ? 0.0 : total / micros.size(), percentile(0.5),
+                      percentile(0.9), percentile(0.99));
+        out << buffer << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]" << std::endl;
+    std::cerr << "  --files N            Small modules to translate (default 200)" << std::endl;
+    std::cerr << "  --lines N            Lines per module (default 40)" << std::endl;
+    std::cerr << "  --py2cpp PATH        py2cpp binary (default: next to this benchmark)" << std::endl;
+    std::cerr << "  --json FILE          Write results to FILE instead of stdout" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    size_t files = 200;
+    size_t lines = 40;
+    std::string py2cpp = (std::filesystem::absolute(argv[0]).parent_path() / "py2cpp").string();
+    std::string jsonOut;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--files") {
+            files = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--lines") {
+            lines = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--py2cpp") {
+            py2cpp = value;
+        } else if (arg == "--json") {
+            jsonOut = value;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (files == 0 || lines == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::error_code ec;
+    std::filesystem::path workDir = std::filesystem::temp_directory_path(ec) / ("py2cpp_serve_bench" + std::to_string(getpid()));
+    std::filesystem::create_directories(workDir, ec);
+    if (ec) {
+        std::cerr << "Error: Could not create " << workDir.string() << ": " << ec.message() << std::endl;
+        return 1;
+    }
+    std::vector<std::string> sources;
+    std::vector<std::string> inputs;
+    std::vector<std::string> filePayloads;
+    for (size_t i = 0; i < files; ++i) {
+        CorpusOptions options;
+        options.lines = lines;
+        options.seed = i + 1;
+        sources.push_back(CorpusGenerator(options).generate());
+        inputs.push_back((workDir / ("module" + std::to_string(i) + ".py")).string());
+        std::ofstream(inputs.back(), std::ios::binary) << sources.back();
+        filePayloads.push_back(inputs.back() + '\n' + (workDir / ("served" + std::to_string(i) + ".cpp")).string());
+    }
+
+    std::vector<LatencyResult> results(3);
+    bool ok = runOneShot(py2cpp, inputs, workDir, results[0]) &&
+              runServer(py2cpp, "translate", sources, results[1]) &&
+              runServer(py2cpp, "file", filePayloads, results[2]);
+    results.push_back(runInProcess(sources));
+    std::filesystem::remove_all(workDir, ec);
+    if (!ok) {
+        return 1;
+    }
+
+    if (jsonOut.empty()) {
+        writeJson(std::cout, files, lines, results);
+        return 0;
+    }
+    std::ofstream file(jsonOut);
+    writeJson(file, files, lines, results);
+    if (!file) {
+        std::cerr << "Error: Could not write results file " << jsonOut << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "allocation_counter.hpp"
+#include "py2cpp_runtime.hpp"
+
+// Time and heap allocations per record of the string patterns ETL scripts are
+// made of, lowered the way py2cpp used to emit them and through the runtime's
+// string helpers: splitting a CSV line and summing its fields, rebuilding a
+// row with `out = out + field + "|"`, `s += "id" + str(i) + ","` and
+// "|".join(fields).
+
+using allocation_counter::allocations;
+
+struct StringResult {
+    std::string workload;
+    std::string lowering;
+    size_t records = 0;
+    double nsPerRecord = 0;
+    double allocationsPerRecord = 0;
+};
+
+// Lines of `fields` comma separated integers of up to 12 digits
+static std::vector<std::string> makeLines(size_t n, size_t fields) {
+    std::vector<std::string> lines;
+    lines.reserve(n);
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    for (size_t i = 0; i < n; ++i) {
+        std::string line;
+        for (size_t f = 0; f < fields; ++f) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            if (f > 0) {
+                line += ',';
+            }
+            line += std::to_string((state >> 33) % 1000000000000ULL);
+        }
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+// Runs `body` over every record three times and keeps the fastest pass;
+// allocations are counted on the last one
+static StringResult measure(const std::string& workload, const std::string& lowering, size_t records,
+                            const std::function<int64_t(size_t)>& body) {
+    StringResult result;
+    result.workload = workload;
+    result.lowering = lowering;
+    result.records = records;
+    int64_t check = 0;
+    for (int pass = 0; pass < 3; ++pass) {
+        size_t allocationsBefore = allocations;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < records; ++i) {
+            check += body(i);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        ns /= static_cast<double>(records);
+        result.nsPerRecord = pass == 0 ? ns : std::min(result.nsPerRecord, ns);
+        result.allocationsPerRecord =
+            static_cast<double>(allocations - allocationsBefore) / static_cast<double>(records);
+    }
+    if (check == 42) {
+        std::cerr << check << std::endl;
+    }
+    return result;
+}
+
+static std::vector<StringResult> runAll(size_t n, size_t fields) {
+    std::vector<StringResult> results;
+    std::vector<std::string> lines = makeLines(n, fields);
+
+    // total = 0; for f in line.split(","): total += int(f)
+    results.push_back(measure("split_sum", "copied_fields", n, [&](size_t i) {
+        int64_t total = 0;
+        for (const auto& f : py2cpp::split<py2cpp::List<std::string>>(lines[i], ",")) {
+            total += std::stoll(f);
+        }
+        return total;
+    }));
+    results.push_back(measure("split_sum", "string_view_slices", n, [&](size_t i) {
+        int64_t total = 0;
+        for (const auto& f : py2cpp::split(lines[i], ",")) {
+            total += py2cpp::toInt(f);
+        }
+        return total;
+    }));
+
+    std::vector<py2cpp::List<std::string>> rows;
+    rows.reserve(n);
+    for (const std::string& line : lines) {
+        rows.push_back(py2cpp::split<py2cpp::List<std::string>>(line, ","));
+    }
+
+    // out = ""; for f in fields: out = out + f + "|"
+    results.push_back(measure("rebuild_row", "operator_plus", n, [&](size_t i) {
+        std::string out = "";
+        for (const auto& f : rows[i]) {
+            out = out + f + "|";
+        }
+        return static_cast<int64_t>(out.size());
+    }));
+    results.push_back(measure("rebuild_row", "reserved_append", n, [&](size_t i) {
+        std::string out = "";
+        py2cpp::reserveAppends(out, rows[i], 1, 1);
+        for (const auto& f : rows[i]) {
+            py2cpp::append(out, f, "|");
+        }
+        return static_cast<int64_t>(out.size());
+    }));
+
+    // s = ""; for j in range(fields): s += "id" + str(i * fields + j) + ","
+    results.push_back(measure("format_ids", "to_string_temporaries", n, [&](size_t i) {
+        std::string s = "";
+        for (int64_t j = 0; j < static_cast<int64_t>(fields); ++j) {
+            s += "id" + std::to_string(static_cast<int64_t>(i * fields) + j) + ",";
+        }
+        return static_cast<int64_t>(s.size());
+    }));
+    results.push_back(measure("format_ids", "append_to_chars", n, [&](size_t i) {
+        std::string s = "";
+        for (int64_t j = 0; j < static_cast<int64_t>(fields); ++j) {
+            py2cpp::append(s, "id", static_cast<int64_t>(i * fields) + j, ",");
+        }
+        return static_cast<int64_t>(s.size());
+    }));
+
+    // "|".join(fields)
+    results.push_back(measure("join", "growing_string", n, [&](size_t i) {
+        std::string s;
+        bool first = true;
+        for (const auto& f : rows[i]) {
+            if (!first) {
+                s += "|";
+            }
+            first = false;
+            s += f;
+        }
+        return static_cast<int64_t>(s.size());
+    }));
+    results.push_back(measure("join", "sized_join", n, [&](size_t i) {
+        return static_cast<int64_t>(py2cpp::join("|", rows[i]).size());
+    }));
+    return results;
+}
+
+static void writeJson(std::ostream& out, const std::vector<StringResult>& results) {
+    out << "{\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const StringResult& r = results[i];
+        char buffer[320];
+        std::snprintf(buffer, sizeof(buffer),
+                      "    {\"workload\": \"%s\", \"lowering\": \"%s\", \"records\": %zu, \"ns_per_record\": %.1f, "
+                      "\"allocations_per_record\": %.2f}",
+                      r.workload.c_str(), r.lowering.c_str(), r.records, r.nsPerRecord, r.allocationsPerRecord);
+        out << buffer << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]" << std::endl;
+    std::cerr << "  --records N          Lines per workload (default 200000)" << std::endl;
+    std::cerr << "  --fields N           Fields per line (default 12)" << std::endl;
+    std::cerr << "  --json FILE          Write results to FILE instead of stdout" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    size_t records = 200000;
+    size_t fields = 12;
+    std::string jsonOut;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--records") {
+            records = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--fields") {
+            fields = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--json") {
+            jsonOut = value;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (records == 0 || fields == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::vector<StringResult> results = runAll(records, fields);
+    if (jsonOut.empty()) {
+        writeJson(std::cout, results);
+        return 0;
+    }
+    std::ofstream file(jsonOut);
+    writeJson(file, results);
+    if (!file) {
+        std::cerr << "Error: Could not write results file " << jsonOut << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,537 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "python_ast.hpp"
+
+// Evaluation of Python expressions that only involve numeric literals, with
+// Python's semantics (floor division and modulo round towards negative
+// infinity, / is true division), so `60 * 60 * 24` is emitted as 86400.
+// Anything that would overflow int64_t, divide by zero or produce inf/nan is
+// left for the generated code to compute.
+struct Constant {
+    enum class Kind { Int, Float } kind = Kind::Int;
+    int64_t integer = 0;
+    double real = 0;
+
+    double asFloat() const {
+        return kind == Kind::Int ? static_cast<double>(integer) : real;
+    }
+
+    static Constant makeInt(int64_t value) {
+        Constant c;
+        c.integer = value;
+        return c;
+    }
+
+    static Constant makeFloat(double value) {
+        Constant c;
+        c.kind = Kind::Float;
+        c.real = value;
+        return c;
+    }
+};
+
+class ConstantFolder {
+private:
+    static bool parseNumber(std::string_view text, Constant& value) {
+        char buffer[64] = {};
+        size_t length = 0;
+        for (char c : text) {
+            if (c != '_') {
+                if (length == sizeof(buffer)) {
+                    return false;
+                }
+                buffer[length++] = c;
+            }
+        }
+        std::string_view digits(buffer, length);
+        const char* begin = digits.data();
+        const char* end = digits.data() + digits.size();
+        int base = 10;
+        if (digits.size() > 2 && digits[0] == '0') {
+            char prefix = static_cast<char>(digits[1] | 0x20);
+            base = prefix == 'x' ? 16 : prefix == 'o' ? 8 : prefix == 'b' ? 2 : 10;
+            if (base != 10) {
+                begin += 2;
+            }
+        }
+        int64_t integer = 0;
+        auto result = std::from_chars(begin, end, integer, base);
+        if (result.ec == std::errc() && result.ptr == end) {
+            value = Constant::makeInt(integer);
+            return true;
+        }
+        if (base != 10 || digits.find_first_of("jJ") != std::string_view::npos) {
+            return false;
+        }
+        // Integers too large for int64_t stay as written
+        if (digits.find_first_of(".eE") == std::string_view::npos) {
+            return false;
+        }
+        double real = 0;
+        auto parsed = std::from_chars(begin, end, real);
+        if (parsed.ec != std::errc() || parsed.ptr != end) {
+            return false;
+        }
+        value = Constant::makeFloat(real);
+        return true;
+    }
+
+    static bool finite(double value, Constant& result) {
+        if (!std::isfinite(value)) {
+            return false;
+        }
+        result = Constant::makeFloat(value);
+        return true;
+    }
+
+    static bool integerPower(int64_t base, int64_t exponent, int64_t& result) {
+        result = 1;
+        while (exponent > 0) {
+            if ((exponent & 1) != 0 && __builtin_mul_overflow(result, base, &result)) {
+                return false;
+            }
+            exponent >>= 1;
+            if (exponent > 0 && __builtin_mul_overflow(base, base, &base)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool integerBinary(std::string_view op, int64_t a, int64_t b, Constant& result) {
+        int64_t value = 0;
+        if (op == "+") {
+            if (__builtin_add_overflow(a, b, &value)) {
+                return false;
+            }
+        } else if (op == "-") {
+            if (__builtin_sub_overflow(a, b, &value)) {
+                return false;
+            }
+        } else if (op == "*") {
+            if (__builtin_mul_overflow(a, b, &value)) {
+                return false;
+            }
+        } else if (op == "//" || op == "%") {
+            if (b == 0 || (a == std::numeric_limits<int64_t>::min() && b == -1)) {
+                return false;
+            }
+            int64_t quotient = a / b;
+            int64_t remainder = a % b;
+            if (remainder != 0 && ((remainder < 0) != (b < 0))) {
+                --quotient;
+                remainder += b;
+            }
+            value = op == "//" ? quotient : remainder;
+        } else if (op == "/") {
+            return b != 0 && finite(static_cast<double>(a) / static_cast<double>(b), result);
+        } else if (op == "**") {
+            if (b < 0) {
+                return a != 0 && finite(std::pow(static_cast<double>(a), static_cast<double>(b)), result);
+            }
+            if (!integerPower(a, b, value)) {
+                return false;
+            }
+        } else if (op == "&") {
+            value = a & b;
+        } else if (op == "|") {
+            value = a | b;
+        } else if (op == "^") {
+            value = a ^ b;
+        } else if (op == "<<") {
+            if (b < 0 || b >= 63 || a < 0 || a > (std::numeric_limits<int64_t>::max() >> b)) {
+                return false;
+            }
+            value = a << b;
+        } else if (op == ">>") {
+            if (b < 0) {
+                return false;
+            }
+            value = b >= 63 ? (a < 0 ? -1 : 0) : a >> b;
+        } else {
+            return false;
+        }
+        result = Constant::makeInt(value);
+        return true;
+    }
+
+    static bool floatBinary(std::string_view op, double a, double b, Constant& result) {
+        if (op == "+") {
+            return finite(a + b, result);
+        }
+        if (op == "-") {
+            return finite(a - b, result);
+        }
+        if (op == "*") {
+            return finite(a * b, result);
+        }
+        if (op == "/") {
+            return b != 0 && finite(a / b, result);
+        }
+        if (op == "//" || op == "%") {
+            // CPython's float_divmod
+            if (b == 0) {
+                return false;
+            }
+            double remainder = std::fmod(a, b);
+            double quotient = (a - remainder) / b;
+            if (remainder != 0) {
+                if ((b < 0) != (remainder < 0)) {
+                    remainder += b;
+                    quotient -= 1.0;
+                }
+            } else {
+                remainder = std::copysign(0.0, b);
+            }
+            double floored = std::copysign(0.0, a / b);
+            if (quotient != 0) {
+                floored = std::floor(quotient);
+                if (quotient - floored > 0.5) {
+                    floored += 1.0;
+                }
+            }
+            return finite(op == "%" ? remainder : floored, result);
+        }
+        if (op == "**") {
+            return a >= 0 && finite(std::pow(a, b), result);
+        }
+        return false;
+    }
+
+public:
+    // Numeric literals and arithmetic on them; names, calls and bools are not constants
+    static bool evaluate(const Expr* expr, Constant& result) {
+        switch (expr->kind) {
+            case ExprKind::Number:
+                return parseNumber(static_cast<const ConstantExpr*>(expr)->text, result);
+            case ExprKind::Unary: {
+                auto* unary = static_cast<const UnaryExpr*>(expr);
+                Constant operand;
+                if (!evaluate(unary->operand, operand)) {
+                    return false;
+                }
+                if (unary->op == "+") {
+                    result = operand;
+                    return true;
+                }
+                if (unary->op == "-") {
+                    if (operand.kind == Constant::Kind::Float) {
+                        result = Constant::makeFloat(-operand.real);
+                        return true;
+                    }
+                    if (operand.integer == std::numeric_limits<int64_t>::min()) {
+                        return false;
+                    }
+                    result = Constant::makeInt(-operand.integer);
+                    return true;
+                }
+                if (unary->op == "~" && operand.kind == Constant::Kind::Int) {
+                    result = Constant::makeInt(~operand.integer);
+                    return true;
+                }
+                return false;
+            }
+            case ExprKind::Binary: {
+                auto* op = static_cast<const BinaryExpr*>(expr);
+                Constant left;
+                Constant right;
+                if (!evaluate(op->left, left) || !evaluate(op->right, right)) {
+                    return false;
+                }
+                if (left.kind == Constant::Kind::Int && right.kind == Constant::Kind::Int) {
+                    return integerBinary(op->op, left.integer, right.integer, result);
+                }
+                return floatBinary(op->op, left.asFloat(), right.asFloat(), result);
+            }
+            default:
+                return false;
+        }
+    }
+
+    // C++ literal for the value; floats round-trip and always read as double
+    static void append(std::string& out, const Constant& value) {
+        char buffer[32];
+        if (value.kind == Constant::Kind::Int) {
+            if (value.integer == std::numeric_limits<int64_t>::min()) {
+                out += "(-9223372036854775807 - 1)";
+                return;
+            }
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), value.integer);
+            out.append(buffer, result.ptr);
+            return;
+        }
+        auto result = std::to_chars(buffer, buffer + sizeof(buffer), value.real);
+        std::string_view text(buffer, static_cast<size_t>(result.ptr - buffer));
+        out += text;
+        if (text.find_first_of(".e") == std::string_view::npos) {
+            out += ".0";
+        }
+    }
+
+    // Negative results bind like a unary minus
+    static bool negative(const Constant& value) {
+        return value.kind == Constant::Kind::Int ? value.integer < 0 : std::signbit(value.real);
+    }
+};
+
+// Top-level functions emitted as constexpr: pure functions on ints, floats and
+// bools that read only their own parameters and locals, and call only each
+// other or int()/float()/bool(). Bounded ones (no loops, no recursion) are
+// cheap enough to evaluate for every iteration of a constant range(), which is
+// how loops like `for i in range(10): print(f(i, 5))` get precomputed tables.
+class CompileTimeFunctions {
+public:
+    struct Function {
+        std::string_view name;
+        bool bounded;
+    };
+
+private:
+    std::vector<Function> functions;
+
+    // State of the function being checked
+    std::string_view current;
+    std::vector<std::string_view> bound;
+    bool bounded = true;
+
+    static bool sameName(std::string_view a, std::string_view b) {
+        return a.data() == b.data() && a.size() == b.size();
+    }
+
+    static bool contains(const std::vector<std::string_view>& list, std::string_view name) {
+        for (std::string_view n : list) {
+            if (sameName(n, name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void bind(const StmtList& body) {
+        for (const Stmt* stmt : body) {
+            switch (stmt->kind) {
+                case StmtKind::Assign:
+                    for (const Expr* target : static_cast<const AssignStmt*>(stmt)->targets) {
+                        if (target->kind == ExprKind::Name) {
+                            bound.push_back(static_cast<const NameExpr*>(target)->id);
+                        }
+                    }
+                    break;
+                case StmtKind::AnnAssign: {
+                    const Expr* target = static_cast<const AnnAssignStmt*>(stmt)->target;
+                    if (target->kind == ExprKind::Name) {
+                        bound.push_back(static_cast<const NameExpr*>(target)->id);
+                    }
+                    break;
+                }
+                case StmtKind::If:
+                case StmtKind::While:
+                    bind(static_cast<const IfStmt*>(stmt)->body);
+                    bind(static_cast<const IfStmt*>(stmt)->orelse);
+                    break;
+                case StmtKind::For: {
+                    auto* forStmt = static_cast<const ForStmt*>(stmt);
+                    if (forStmt->target->kind == ExprKind::Name) {
+                        bound.push_back(static_cast<const NameExpr*>(forStmt->target)->id);
+                    }
+                    bind(forStmt->body);
+                    bind(forStmt->orelse);
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+
+    bool expression(const Expr* expr) {
+        if (expr == nullptr) {
+            return true;
+        }
+        switch (expr->kind) {
+            case ExprKind::Name:
+                return contains(bound, static_cast<const NameExpr*>(expr)->id);
+            case ExprKind::Number:
+            case ExprKind::Bool:
+                return true;
+            case ExprKind::Unary:
+                return expression(static_cast<const UnaryExpr*>(expr)->operand);
+            case ExprKind::Binary: {
+                // ** becomes std::pow, which is not constexpr, unless it folds
+                auto* op = static_cast<const BinaryExpr*>(expr);
+                Constant folded;
+                if (ConstantFolder::evaluate(expr, folded)) {
+                    return true;
+                }
+                return op->op != "**" && op->op != "@" && expression(op->left) && expression(op->right);
+            }
+            case ExprKind::BoolOp: {
+                auto* op = static_cast<const BinaryExpr*>(expr);
+                return expression(op->left) && expression(op->right);
+            }
+            case ExprKind::Compare: {
+                auto* cmp = static_cast<const CompareExpr*>(expr);
+                for (std::string_view op : cmp->ops) {
+                    if (op == "in" || op == "not in") {
+                        return false;
+                    }
+                }
+                for (const Expr* operand : cmp->operands) {
+                    if (!expression(operand)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            case ExprKind::Conditional: {
+                auto* cond = static_cast<const ConditionalExpr*>(expr);
+                return expression(cond->test) && expression(cond->body) && expression(cond->orelse);
+            }
+            case ExprKind::Call: {
+                auto* call = static_cast<const CallExpr*>(expr);
+                if (call->func->kind != ExprKind::Name) {
+                    return false;
+                }
+                std::string_view callee = static_cast<const NameExpr*>(call->func)->id;
+                bool conversion = (callee == "int" || callee == "float" || callee == "bool") && call->args.size() == 1;
+                const Function* function = find(callee);
+                if (sameName(callee, current)) {
+                    bounded = false;
+                } else if (function != nullptr) {
+                    bounded = bounded && function->bounded;
+                } else if (!conversion) {
+                    return false;
+                }
+                for (const Expr* arg : call->args) {
+                    if (arg->kind == ExprKind::Keyword || arg->kind == ExprKind::Starred || !expression(arg)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    bool block(const StmtList& body) {
+        for (const Stmt* stmt : body) {
+            if (!statement(stmt)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool statement(const Stmt* stmt) {
+        switch (stmt->kind) {
+            case StmtKind::Pass:
+            case StmtKind::Break:
+            case StmtKind::Continue:
+            case StmtKind::Comment:
+                return true;
+            case StmtKind::Expr:
+                return static_cast<const ExprStmt*>(stmt)->value->kind == ExprKind::String;
+            case StmtKind::Assign: {
+                auto* assign = static_cast<const AssignStmt*>(stmt);
+                return assign->targets.size() == 1 && assign->targets[0]->kind == ExprKind::Name &&
+                       expression(assign->value);
+            }
+            case StmtKind::AugAssign: {
+                auto* assign = static_cast<const AugAssignStmt*>(stmt);
+                return assign->op != "**=" && assign->op != "@=" && expression(assign->target) &&
+                       expression(assign->value);
+            }
+            case StmtKind::AnnAssign: {
+                auto* assign = static_cast<const AnnAssignStmt*>(stmt);
+                return assign->target->kind == ExprKind::Name && assign->value != nullptr && expression(assign->value);
+            }
+            case StmtKind::Return:
+                return static_cast<const ValueStmt*>(stmt)->value != nullptr &&
+                       expression(static_cast<const ValueStmt*>(stmt)->value);
+            case StmtKind::If: {
+                auto* ifStmt = static_cast<const IfStmt*>(stmt);
+                return expression(ifStmt->test) && block(ifStmt->body) && block(ifStmt->orelse);
+            }
+            case StmtKind::While: {
+                auto* whileStmt = static_cast<const IfStmt*>(stmt);
+                bounded = false;
+                return whileStmt->orelse.empty() && expression(whileStmt->test) && block(whileStmt->body);
+            }
+            case StmtKind::For: {
+                // Only counted loops over range()
+                auto* forStmt = static_cast<const ForStmt*>(stmt);
+                if (forStmt->target->kind != ExprKind::Name || forStmt->iter->kind != ExprKind::Call ||
+                    !forStmt->orelse.empty()) {
+                    return false;
+                }
+                auto* call = static_cast<const CallExpr*>(forStmt->iter);
+                if (call->func->kind != ExprKind::Name || static_cast<const NameExpr*>(call->func)->id != "range" ||
+                    call->args.empty() || call->args.size() > 3) {
+                    return false;
+                }
+                bounded = false;
+                for (const Expr* arg : call->args) {
+                    if (arg->kind == ExprKind::Keyword || arg->kind == ExprKind::Starred || !expression(arg)) {
+                        return false;
+                    }
+                }
+                return block(forStmt->body);
+            }
+            default:
+                return false;
+        }
+    }
+
+public:
+    // Functions are offered in module order, after their types are known;
+    // scalarTypes says every parameter, local and the result is an int, float or bool
+    bool add(const FunctionDef* def, bool scalarTypes) {
+        if (!scalarTypes || !def->decorators.empty()) {
+            return false;
+        }
+        current = def->name;
+        bound.clear();
+        bounded = true;
+        for (const Param* param : def->params) {
+            if (param->kind != Param::Normal) {
+                return false;
+            }
+            bound.push_back(param->name);
+        }
+        for (const Param* param : def->params) {
+            Constant ignored;
+            if (param->defaultValue != nullptr && !ConstantFolder::evaluate(param->defaultValue, ignored) &&
+                param->defaultValue->kind != ExprKind::Bool) {
+                return false;
+            }
+        }
+        bind(def->body);
+        if (!block(def->body)) {
+            return false;
+        }
+        functions.push_back({def->name, bounded});
+        return true;
+    }
+
+    const Function* find(std::string_view name) const {
+        for (const Function& function : functions) {
+            if (sameName(function.name, name)) {
+                return &function;
+            }
+        }
+        return nullptr;
+    }
+
+    void clear() {
+        functions.clear();
+    }
+};
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole input file. The file is memory-mapped, so the
+// translator works on string_views into the page cache instead of a heap copy.
+class MappedFile {
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        close();
+    }
+
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            close();
+            return false;
+        }
+        length = static_cast<size_t>(size.QuadPart);
+        if (length == 0) {
+            return true;  // Empty files cannot be mapped
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            close();
+            return false;
+        }
+        data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+            close();
+            return false;
+        }
+        length = static_cast<size_t>(info.st_size);
+        if (length == 0) {
+            return true;  // Empty files cannot be mapped
+        }
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close();
+            return false;
+        }
+        // The lexer reads front to back exactly once
+        madvise(mapped, length, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapped);
+#endif
+        if (data == nullptr) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data != nullptr) {
+            UnmapViewOfFile(data);
+        }
+        if (mapping != nullptr) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (data != nullptr) {
+            munmap(const_cast<char*>(data), length);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+#endif
+        data = nullptr;
+        length = 0;
+    }
+
+    std::string_view view() const {
+        return data != nullptr ? std::string_view(data, length) : std::string_view();
+    }
+
+    size_t size() const {
+        return length;
+    }
+};
+
+// Destination for generated code. The decompiler hands over text in chunks as
+// each top-level statement is finished, so output never has to be held whole.
+class CodeSink {
+public:
+    virtual ~CodeSink() = default;
+    virtual void write(std::string_view text) = 0;
+};
+
+class StringSink : public CodeSink {
+private:
+    std::string& out;
+
+public:
+    explicit StringSink(std::string& target) : out(target) {}
+
+    void write(std::string_view text) override {
+        out += text;
+    }
+};
+
+// Writes to a temporary file next to the target and renames it into place on
+// close(), so readers never see a partial file and an existing output that is
+// a hard link (into the translation cache) is replaced rather than written through.
+class FileSink : public CodeSink {
+private:
+    std::ofstream file;
+    std::string target;
+    std::string temporary;
+    size_t written = 0;
+
+public:
+    FileSink() = default;
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    ~FileSink() {
+        if (file.is_open()) {
+            file.close();
+            std::error_code ec;
+            std::filesystem::remove(temporary, ec);
+        }
+    }
+
+    bool open(const std::string& path) {
+        target = path;
+        temporary = path + ".py2cpp-tmp";
+        file.open(temporary, std::ios::binary);
+        return file.is_open();
+    }
+
+    void write(std::string_view text) override {
+        file.write(text.data(), static_cast<std::streamsize>(text.size()));
+        written += text.size();
+    }
+
+    // Flushes, renames the file into place and reports whether every write reached it
+    bool close() {
+        file.close();
+        std::error_code ec;
+        if (!file.fail()) {
+            std::filesystem::rename(temporary, target, ec);
+        }
+        if (file.fail() || ec) {
+            std::filesystem::remove(temporary, ec);
+            return false;
+        }
+        return true;
+    }
+
+    size_t bytesWritten() const {
+        return written;
+    }
+};
+
+// Append-only text buffer that moves to an anonymous temporary file once it
+// grows past a threshold, for output that can only be written out at the end.
+class SpillBuffer {
+private:
+    static constexpr size_t kSpillThreshold = 1024 * 1024;
+
+    std::string memory;
+    std::FILE* spill = nullptr;
+    size_t total = 0;
+
+public:
+    SpillBuffer() = default;
+    SpillBuffer(const SpillBuffer&) = delete;
+    SpillBuffer& operator=(const SpillBuffer&) = delete;
+
+    ~SpillBuffer() {
+        if (spill != nullptr) {
+            std::fclose(spill);
+        }
+    }
+
+    void append(std::string_view text) {
+        total += text.size();
+        if (spill == nullptr && memory.size() + text.size() > kSpillThreshold) {
+            spill = std::tmpfile();
+            if (spill != nullptr) {
+                std::fwrite(memory.data(), 1, memory.size(), spill);
+                std::string().swap(memory);
+            }
+        }
+        if (spill != nullptr) {
+            std::fwrite(text.data(), 1, text.size(), spill);
+        } else {
+            memory += text;
+        }
+    }
+
+    bool empty() const {
+        return total == 0;
+    }
+
+    void copyTo(CodeSink& sink) {
+        if (spill == nullptr) {
+            sink.write(memory);
+            return;
+        }
+        std::rewind(spill);
+        char chunk[64 * 1024];
+        size_t n;
+        while ((n = std::fread(chunk, 1, sizeof(chunk), spill)) > 0) {
+            sink.write(std::string_view(chunk, n));
+        }
+    }
+};
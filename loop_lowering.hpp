@@ -0,0 +1,391 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "python_ast.hpp"
+
+// Analysis behind the lowering of `for i in range(...)` loops. It recognises the
+// range call and records what the loop body does with the index and with the
+// sequence the range was sized from, so the decompiler can pick an index type,
+// hoist the bounds and turn `for i in range(len(xs))` loops that only read
+// xs[i] into a range-for the C++ compiler can vectorize.
+struct RangeLoop {
+    std::string_view index;
+    const Expr* start = nullptr;  // Null for range(stop)
+    const Expr* stop = nullptr;
+    const Expr* step = nullptr;   // Null for the default step of 1
+    int64_t stepValue = 1;        // Meaningful when constantStep is set
+    bool constantStep = true;
+    const Expr* length = nullptr;  // xs when stop is len(xs)
+    std::string_view sequence;     // Its name when xs is a plain name
+
+    // Filled in by analyzeBody()
+    bool indexOnlySubscripts = true;  // Every use of the index is some_sequence[index]
+    bool indexOnlyElement = true;     // ... and always sequence[index], read only
+    bool indexAssigned = false;
+    bool sequenceOnlyRead = true;     // The sequence only appears as sequence[index] or len(sequence)
+    bool opaque = false;              // Nested definitions or verbatim statements in the body
+    bool exits = false;               // break, return, raise or try in the body, which may stop it early
+    std::vector<std::string_view> stored;  // Names rebound in the body
+    std::vector<std::string_view> names;   // Every name the body mentions
+
+    bool mentions(std::string_view name) const {
+        return contains(names, name);
+    }
+
+    bool rebinds(std::string_view name) const {
+        return contains(stored, name);
+    }
+
+    // range(len(xs)) whose body only reads xs[i] can iterate xs directly
+    bool iteratesSequence() const {
+        return !sequence.empty() && start == nullptr && constantStep && stepValue == 1 && !opaque &&
+               !indexAssigned && indexOnlyElement && sequenceOnlyRead && !rebinds(sequence);
+    }
+
+    static bool sameName(std::string_view a, std::string_view b) {
+        return a.data() == b.data() && a.size() == b.size();
+    }
+
+    static bool contains(const std::vector<std::string_view>& list, std::string_view name) {
+        for (std::string_view n : list) {
+            if (sameName(n, name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+class LoopAnalysis {
+private:
+    enum class Use { Read, Store };
+
+    RangeLoop& loop;
+
+    static bool isName(const Expr* expr, std::string_view id) {
+        return expr != nullptr && expr->kind == ExprKind::Name && static_cast<const NameExpr*>(expr)->id == id;
+    }
+
+    bool isElement(const Expr* expr) const {
+        if (expr->kind != ExprKind::Subscript || loop.sequence.empty()) {
+            return false;
+        }
+        auto* sub = static_cast<const SubscriptExpr*>(expr);
+        return isName(sub->value, loop.sequence) && isName(sub->index, loop.index);
+    }
+
+    void name(std::string_view id, Use use) {
+        loop.names.push_back(id);
+        if (use == Use::Store) {
+            loop.stored.push_back(id);
+        }
+        if (RangeLoop::sameName(id, loop.index)) {
+            loop.indexOnlySubscripts = false;
+            loop.indexOnlyElement = false;
+            loop.indexAssigned |= use == Use::Store;
+        }
+        if (!loop.sequence.empty() && RangeLoop::sameName(id, loop.sequence)) {
+            loop.sequenceOnlyRead = false;
+        }
+    }
+
+    void expressions(const NodeList<Expr*>& list, Use use = Use::Read) {
+        for (const Expr* e : list) {
+            expression(e, use);
+        }
+    }
+
+    // Store marks a rebound name, or an object that is assigned into or has a
+    // method called on it
+    void expression(const Expr* expr, Use use = Use::Read) {
+        if (expr == nullptr) {
+            return;
+        }
+        switch (expr->kind) {
+            case ExprKind::Name:
+                name(static_cast<const NameExpr*>(expr)->id, use);
+                break;
+            case ExprKind::Subscript: {
+                auto* sub = static_cast<const SubscriptExpr*>(expr);
+                if (isElement(expr)) {
+                    loop.names.push_back(loop.sequence);
+                    loop.names.push_back(loop.index);
+                    if (use == Use::Store) {
+                        loop.sequenceOnlyRead = false;
+                        loop.indexOnlyElement = false;
+                    }
+                    break;
+                }
+                expression(sub->value, use);
+                if (isName(sub->index, loop.index)) {
+                    loop.names.push_back(loop.index);
+                    loop.indexOnlyElement = false;
+                } else {
+                    expression(sub->index);
+                }
+                break;
+            }
+            case ExprKind::Attribute:
+                expression(static_cast<const AttributeExpr*>(expr)->value, use);
+                break;
+            case ExprKind::Call: {
+                auto* call = static_cast<const CallExpr*>(expr);
+                if (isName(call->func, "len") && call->args.size() == 1 && isName(call->args[0], loop.sequence)) {
+                    loop.names.push_back(loop.sequence);
+                    break;
+                }
+                // A method may mutate its object
+                if (call->func->kind == ExprKind::Attribute) {
+                    expression(static_cast<const AttributeExpr*>(call->func)->value, Use::Store);
+                } else {
+                    expression(call->func);
+                }
+                expressions(call->args);
+                break;
+            }
+            case ExprKind::FString:
+                expressions(static_cast<const FStringExpr*>(expr)->parts);
+                break;
+            case ExprKind::FormattedValue:
+                expression(static_cast<const FormattedValueExpr*>(expr)->value);
+                break;
+            case ExprKind::Unary:
+                expression(static_cast<const UnaryExpr*>(expr)->operand);
+                break;
+            case ExprKind::Binary:
+            case ExprKind::BoolOp: {
+                auto* op = static_cast<const BinaryExpr*>(expr);
+                expression(op->left);
+                expression(op->right);
+                break;
+            }
+            case ExprKind::Compare:
+                expressions(static_cast<const CompareExpr*>(expr)->operands);
+                break;
+            case ExprKind::Conditional: {
+                auto* cond = static_cast<const ConditionalExpr*>(expr);
+                expression(cond->test);
+                expression(cond->body);
+                expression(cond->orelse);
+                break;
+            }
+            case ExprKind::Keyword:
+                expression(static_cast<const KeywordExpr*>(expr)->value);
+                break;
+            case ExprKind::Starred:
+                expression(static_cast<const StarredExpr*>(expr)->value, use);
+                break;
+            case ExprKind::Slice: {
+                auto* slice = static_cast<const SliceExpr*>(expr);
+                expression(slice->lower);
+                expression(slice->upper);
+                expression(slice->step);
+                break;
+            }
+            case ExprKind::List:
+            case ExprKind::Tuple:
+            case ExprKind::Set:
+                expressions(static_cast<const SequenceExpr*>(expr)->elements, use);
+                break;
+            case ExprKind::Dict: {
+                auto* dict = static_cast<const DictExpr*>(expr);
+                expressions(dict->keys);
+                expressions(dict->values);
+                break;
+            }
+            case ExprKind::ListComp:
+            case ExprKind::SetComp:
+            case ExprKind::DictComp:
+            case ExprKind::GeneratorExp: {
+                auto* comp = static_cast<const ComprehensionExpr*>(expr);
+                for (const Comprehension* gen : comp->generators) {
+                    expression(gen->target, Use::Store);
+                    expression(gen->iter);
+                    expressions(gen->ifs);
+                }
+                expression(comp->element);
+                expression(comp->value);
+                break;
+            }
+            case ExprKind::Lambda:
+                // Captures are not tracked
+                loop.opaque = true;
+                expression(static_cast<const LambdaExpr*>(expr)->body);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void block(const StmtList& body) {
+        for (const Stmt* stmt : body) {
+            statement(stmt);
+        }
+    }
+
+    void statement(const Stmt* stmt) {
+        switch (stmt->kind) {
+            case StmtKind::Expr:
+                expression(static_cast<const ExprStmt*>(stmt)->value);
+                break;
+            case StmtKind::Assign: {
+                auto* assign = static_cast<const AssignStmt*>(stmt);
+                expressions(assign->targets, Use::Store);
+                expression(assign->value);
+                break;
+            }
+            case StmtKind::AugAssign: {
+                auto* assign = static_cast<const AugAssignStmt*>(stmt);
+                expression(assign->target, Use::Store);
+                expression(assign->value);
+                break;
+            }
+            case StmtKind::AnnAssign: {
+                auto* assign = static_cast<const AnnAssignStmt*>(stmt);
+                expression(assign->target, Use::Store);
+                expression(assign->value);
+                break;
+            }
+            case StmtKind::Return:
+            case StmtKind::Raise: {
+                loop.exits = true;
+                auto* value = static_cast<const ValueStmt*>(stmt);
+                expression(value->value);
+                expression(value->cause);
+                break;
+            }
+            case StmtKind::Del:
+                expressions(static_cast<const ExprListStmt*>(stmt)->expressions, Use::Store);
+                break;
+            case StmtKind::Assert:
+                expressions(static_cast<const ExprListStmt*>(stmt)->expressions);
+                break;
+            case StmtKind::If:
+            case StmtKind::While: {
+                auto* ifStmt = static_cast<const IfStmt*>(stmt);
+                expression(ifStmt->test);
+                block(ifStmt->body);
+                block(ifStmt->orelse);
+                break;
+            }
+            case StmtKind::For: {
+                auto* forStmt = static_cast<const ForStmt*>(stmt);
+                expression(forStmt->target, Use::Store);
+                expression(forStmt->iter);
+                block(forStmt->body);
+                block(forStmt->orelse);
+                break;
+            }
+            case StmtKind::Try: {
+                auto* tryStmt = static_cast<const TryStmt*>(stmt);
+                loop.exits = true;
+                block(tryStmt->body);
+                for (const ExceptHandler* handler : tryStmt->handlers) {
+                    expression(handler->type);
+                    if (!handler->name.empty()) {
+                        name(handler->name, Use::Store);
+                    }
+                    block(handler->body);
+                }
+                block(tryStmt->orelse);
+                block(tryStmt->finalbody);
+                break;
+            }
+            case StmtKind::With: {
+                auto* with = static_cast<const WithStmt*>(stmt);
+                for (const WithItem* item : with->items) {
+                    expression(item->context);
+                    expression(item->var, Use::Store);
+                }
+                block(with->body);
+                break;
+            }
+            case StmtKind::Break:
+                loop.exits = true;
+                break;
+            case StmtKind::Global:
+            case StmtKind::Nonlocal:
+                for (std::string_view id : static_cast<const NamesStmt*>(stmt)->names) {
+                    name(id, Use::Store);
+                }
+                break;
+            case StmtKind::FunctionDef:
+            case StmtKind::ClassDef:
+            case StmtKind::Unsupported:
+                loop.opaque = true;
+                loop.indexOnlySubscripts = false;
+                loop.indexOnlyElement = false;
+                break;
+            default:
+                break;
+        }
+    }
+
+public:
+    explicit LoopAnalysis(RangeLoop& target) : loop(target) {}
+
+    // Integer literal, optionally negated, as written in the source
+    static bool integerLiteral(const Expr* expr, int64_t& value) {
+        bool negative = false;
+        if (expr->kind == ExprKind::Unary && static_cast<const UnaryExpr*>(expr)->op == "-") {
+            negative = true;
+            expr = static_cast<const UnaryExpr*>(expr)->operand;
+        }
+        if (expr->kind != ExprKind::Number) {
+            return false;
+        }
+        std::string_view text = static_cast<const ConstantExpr*>(expr)->text;
+        auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (result.ec != std::errc() || result.ptr != text.data() + text.size()) {
+            return false;
+        }
+        value = negative ? -value : value;
+        return true;
+    }
+
+    // Matches `target in range(...)` with a plain name target and positional arguments
+    static bool matchRange(const Expr* target, const Expr* iter, RangeLoop& loop) {
+        if (target->kind != ExprKind::Name || iter->kind != ExprKind::Call) {
+            return false;
+        }
+        auto* call = static_cast<const CallExpr*>(iter);
+        if (!isName(call->func, "range") || call->args.empty() || call->args.size() > 3) {
+            return false;
+        }
+        for (const Expr* arg : call->args) {
+            if (arg->kind == ExprKind::Keyword || arg->kind == ExprKind::Starred) {
+                return false;
+            }
+        }
+        loop.index = static_cast<const NameExpr*>(target)->id;
+        loop.start = call->args.size() > 1 ? call->args[0] : nullptr;
+        loop.stop = call->args.size() > 1 ? call->args[1] : call->args[0];
+        loop.step = call->args.size() > 2 ? call->args[2] : nullptr;
+        if (loop.step != nullptr) {
+            loop.constantStep = integerLiteral(loop.step, loop.stepValue) && loop.stepValue != 0;
+        }
+        // range(0, len(xs)) is range(len(xs))
+        int64_t startValue = 0;
+        if (loop.start != nullptr && integerLiteral(loop.start, startValue) && startValue == 0) {
+            loop.start = nullptr;
+        }
+        if (loop.stop->kind == ExprKind::Call) {
+            auto* len = static_cast<const CallExpr*>(loop.stop);
+            if (isName(len->func, "len") && len->args.size() == 1 && len->args[0]->kind != ExprKind::Starred) {
+                loop.length = len->args[0];
+                if (loop.length->kind == ExprKind::Name) {
+                    loop.sequence = static_cast<const NameExpr*>(loop.length)->id;
+                }
+            }
+        }
+        return true;
+    }
+
+    void analyzeBody(const StmtList& body) {
+        block(body);
+    }
+};
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "file_io.hpp"
+#include "python_lexer.hpp"
+
+// The modules of a project translated with --modules and the imports between
+// them. Every .py file under the input directory is a module named after its
+// path (pkg/util.py is pkg.util, pkg/__init__.py is pkg). Imports of anything
+// else, like the standard library, are not part of the graph.
+class ModuleGraph {
+public:
+    struct Module {
+        std::string name;                    // Dotted module name
+        std::string cppNamespace;            // pkg::util
+        std::filesystem::path source;        // The .py file
+        std::string stem;                    // Output path below the root without extension, with '/'
+        std::vector<std::string> functions;  // Top-level names from-imports can refer to
+        std::vector<std::string> classes;
+        std::vector<size_t> imports;         // Project modules imported anywhere in the file
+        bool imported = false;               // Modules nobody imports are entry points and get main()
+    };
+
+private:
+    struct ImportSpec {
+        std::string module;
+        int level = 0;
+        std::vector<std::string> names;  // from-imports only
+    };
+
+    std::vector<Module> modules;
+    std::unordered_map<std::string, size_t> byName;
+    // Every dotted prefix of a module name: the packages, with or without __init__.py
+    std::vector<std::string> packages;
+
+    static std::string identifier(std::string_view text) {
+        std::string id;
+        for (char c : text) {
+            bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+            id += valid ? c : '_';
+        }
+        if (id.empty() || (id[0] >= '0' && id[0] <= '9')) {
+            id.insert(id.begin(), '_');
+        }
+        return id;
+    }
+
+    // Dotted name at `tok`, which is left on the token after it
+    static std::string dottedName(PythonLexer& lexer, Token& tok) {
+        std::string name;
+        while (tok.kind == TokenKind::Name) {
+            name += tok.text;
+            tok = lexer.next();
+            if (!tok.isOp(".")) {
+                break;
+            }
+            name += '.';
+            tok = lexer.next();
+        }
+        return name;
+    }
+
+    // Lexer-only pass over one file: its imports at any depth, and the
+    // functions and classes it defines at the top level
+    static void scan(std::string_view code, Module& module, std::vector<ImportSpec>& imports) {
+        PythonLexer lexer(code);
+        int depth = 0;
+        bool lineStart = true;
+        Token tok = lexer.next();
+        while (tok.kind != TokenKind::EndOfFile) {
+            if (tok.kind == TokenKind::Indent || tok.kind == TokenKind::Dedent) {
+                depth += tok.kind == TokenKind::Indent ? 1 : -1;
+            } else if (tok.kind == TokenKind::Newline) {
+                lineStart = true;
+            } else if (tok.kind != TokenKind::Comment) {
+                bool statementStart = lineStart;
+                lineStart = false;
+                if (statementStart && tok.isKeyword("import")) {
+                    do {
+                        tok = lexer.next();
+                        ImportSpec spec;
+                        spec.module = dottedName(lexer, tok);
+                        if (tok.isKeyword("as")) {
+                            lexer.next();
+                            tok = lexer.next();
+                        }
+                        imports.push_back(std::move(spec));
+                    } while (tok.isOp(","));
+                    continue;
+                }
+                if (statementStart && tok.isKeyword("from")) {
+                    ImportSpec spec;
+                    for (tok = lexer.next(); tok.isOp(".") || tok.isOp("..."); tok = lexer.next()) {
+                        spec.level += static_cast<int>(tok.text.size());
+                    }
+                    spec.module = dottedName(lexer, tok);
+                    if (tok.isKeyword("import")) {
+                        for (tok = lexer.next(); tok.kind == TokenKind::Name || tok.isOp(",") || tok.isOp("(") ||
+                                                 tok.isKeyword("as");
+                             tok = lexer.next()) {
+                            if (tok.isKeyword("as")) {
+                                lexer.next();
+                            } else if (tok.kind == TokenKind::Name) {
+                                spec.names.emplace_back(cppIdentifier(tok.text));
+                            }
+                        }
+                    }
+                    imports.push_back(std::move(spec));
+                    continue;
+                }
+                if (statementStart && depth == 0 && (tok.isKeyword("def") || tok.isKeyword("class"))) {
+                    bool isClass = tok.isKeyword("class");
+                    tok = lexer.next();
+                    if (tok.kind == TokenKind::Name) {
+                        (isClass ? module.classes : module.functions).emplace_back(cppIdentifier(tok.text));
+                    }
+                    continue;
+                }
+                // `async def` still starts a definition
+                lineStart = statementStart && tok.isKeyword("async");
+            }
+            tok = lexer.next();
+        }
+    }
+
+    void addEdge(Module& from, std::string_view name) {
+        const Module* target = find(name);
+        if (target == nullptr || target == &from) {
+            return;
+        }
+        size_t index = static_cast<size_t>(target - modules.data());
+        if (std::find(from.imports.begin(), from.imports.end(), index) == from.imports.end()) {
+            from.imports.push_back(index);
+            modules[index].imported = true;
+        }
+    }
+
+    void visit(size_t index, std::vector<char>& state, std::vector<size_t>& order) const {
+        // 0 unvisited, 1 on the stack (an import cycle), 2 done
+        if (state[index] != 0) {
+            return;
+        }
+        state[index] = 1;
+        for (size_t dependency : modules[index].imports) {
+            visit(dependency, state, order);
+        }
+        state[index] = 2;
+        order.push_back(index);
+    }
+
+public:
+    // Names every file, then reads each one for its imports
+    bool build(const std::filesystem::path& root, const std::vector<std::filesystem::path>& sources,
+               std::string& error) {
+        for (const std::filesystem::path& source : sources) {
+            Module module;
+            module.source = source;
+            std::filesystem::path relative = source.lexically_relative(root);
+            relative.replace_extension();
+            module.stem = relative.generic_string();
+            if (relative.filename() == "__init__") {
+                relative = relative.parent_path();
+            }
+            for (const std::filesystem::path& part : relative) {
+                if (!module.name.empty()) {
+                    module.name += '.';
+                    module.cppNamespace += "::";
+                }
+                module.name += part.string();
+                module.cppNamespace += identifier(part.string());
+            }
+            if (module.name.empty()) {
+                // An __init__.py at the root itself belongs to no package
+                module.name = "__init__";
+                module.cppNamespace = "__init__";
+            }
+            byName.emplace(module.name, modules.size());
+            for (size_t dot = module.name.find('.'); dot != std::string::npos; dot = module.name.find('.', dot + 1)) {
+                packages.push_back(module.name.substr(0, dot));
+            }
+            modules.push_back(std::move(module));
+        }
+        std::sort(packages.begin(), packages.end());
+        packages.erase(std::unique(packages.begin(), packages.end()), packages.end());
+
+        for (Module& module : modules) {
+            MappedFile input;
+            if (!input.open(module.source.string())) {
+                error = "Could not open input file " + module.source.string();
+                return false;
+            }
+            std::vector<ImportSpec> imports;
+            scan(input.view(), module, imports);
+            for (const ImportSpec& spec : imports) {
+                std::string target = resolve(module, spec.module, spec.level);
+                if (spec.level == 0) {
+                    // Importing a.b.c, or from it, also imports a and a.b
+                    for (size_t dot = target.find('.'); dot != std::string::npos; dot = target.find('.', dot + 1)) {
+                        addEdge(module, std::string_view(target).substr(0, dot));
+                    }
+                }
+                addEdge(module, target);
+                for (const std::string& name : spec.names) {
+                    addEdge(module, target.empty() ? name : target + '.' + name);
+                }
+            }
+        }
+        return true;
+    }
+
+    // Absolute name of `module` imported with `level` leading dots from `from`
+    std::string resolve(const Module& from, std::string_view module, int level) const {
+        if (level == 0) {
+            return std::string(module);
+        }
+        // The package a relative import starts from; a package's __init__ is its own
+        std::string base = from.name;
+        bool package = from.stem == "__init__" || (from.stem.size() > 9 && from.stem.compare(from.stem.size() - 9, 9, "/__init__") == 0);
+        for (int i = package ? 1 : 0; i < level; ++i) {
+            size_t dot = base.rfind('.');
+            base = dot == std::string::npos ? std::string() : base.substr(0, dot);
+        }
+        if (module.empty()) {
+            return base;
+        }
+        return base.empty() ? std::string(module) : base + '.' + std::string(module);
+    }
+
+    const Module* find(std::string_view name) const {
+        auto it = byName.find(std::string(name));
+        return it != byName.end() ? &modules[it->second] : nullptr;
+    }
+
+    // A module, or a directory of modules that an import can name
+    bool isModuleOrPackage(std::string_view name) const {
+        return find(name) != nullptr || std::binary_search(packages.begin(), packages.end(), name);
+    }
+
+    // C++ namespace of a module or package name
+    static std::string namespaceOf(std::string_view name) {
+        std::string result;
+        size_t start = 0;
+        while (true) {
+            size_t dot = name.find('.', start);
+            result += identifier(name.substr(start, dot == std::string_view::npos ? std::string_view::npos : dot - start));
+            if (dot == std::string_view::npos) {
+                return result;
+            }
+            result += "::";
+            start = dot + 1;
+        }
+    }
+
+    // `file` (a path below the root with '/') as written in an #include from
+    // the output files of `from`
+    static std::string includePath(const Module& from, const std::string& file) {
+        std::string path;
+        for (char c : from.stem) {
+            if (c == '/') {
+                path += "../";
+            }
+        }
+        return path + file;
+    }
+
+    // Dependencies before the modules that import them; cycles are broken at
+    // the first module of the cycle that is reached
+    std::vector<size_t> order() const {
+        std::vector<char> state(modules.size(), 0);
+        std::vector<size_t> result;
+        for (size_t i = 0; i < modules.size(); ++i) {
+            visit(i, state, result);
+        }
+        return result;
+    }
+
+    // Spreads the imported modules over `count` unity files of about equal
+    // weight (generated bytes), each in dependency order. Entry points stay out:
+    // each one has its own main() and is compiled on its own.
+    std::vector<std::vector<size_t>> unityGroups(const std::vector<size_t>& weights, size_t count) const {
+        std::vector<size_t> library;
+        for (size_t i = 0; i < modules.size(); ++i) {
+            if (modules[i].imported) {
+                library.push_back(i);
+            }
+        }
+        count = std::max<size_t>(1, std::min(count, library.size()));
+        std::sort(library.begin(), library.end(), [&weights](size_t a, size_t b) {
+            return weights[a] > weights[b];
+        });
+        // Heaviest module into the lightest group
+        std::vector<size_t> load(count, 0);
+        std::vector<size_t> group(modules.size(), 0);
+        for (size_t index : library) {
+            size_t lightest = static_cast<size_t>(std::min_element(load.begin(), load.end()) - load.begin());
+            group[index] = lightest;
+            load[lightest] += weights[index];
+        }
+        std::vector<std::vector<size_t>> groups(library.empty() ? 0 : count);
+        for (size_t index : order()) {
+            if (modules[index].imported) {
+                groups[group[index]].push_back(index);
+            }
+        }
+        return groups;
+    }
+
+    const std::vector<Module>& all() const {
+        return modules;
+    }
+
+    size_t size() const {
+        return modules.size();
+    }
+};
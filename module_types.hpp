@@ -0,0 +1,487 @@
+#pragma once
+
+#include <cstddef>
+#include <exception>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "arena.hpp"
+#include "file_io.hpp"
+#include "module_graph.hpp"
+#include "python_ast.hpp"
+#include "python_parser.hpp"
+#include "type_inference.hpp"
+
+// --modules: type inference across the module graph. Each module is typed by
+// its own TypeInference, as a single file is, but it knows the functions and
+// classes it imports from the project: their return and member types come
+// from the defining module's inference, and the argument types of its calls
+// into them become that module's parameter types. infer() analyses every
+// module until none of this changes, before any of them is split into a
+// header and a source file; decompileModule() then types its module with
+// analyze(), the same way the last pass did.
+class ModuleTypes {
+private:
+    static constexpr int kMaxPasses = 8;
+
+    // Types travel between modules spelled like annotations (int, list[str],
+    // dict[str, float]) with a class as module:Class, since each module has
+    // its own interner and type table. `?` is a type nothing was seen for and
+    // `int+` an int known not to be negative.
+    struct Signature {
+        std::vector<std::string> names;
+        std::vector<std::string> params;
+        std::string returns;
+        bool isStatic = false;
+        bool isClassMethod = false;
+
+        friend bool operator==(const Signature& a, const Signature& b) {
+            return a.names == b.names && a.params == b.params && a.returns == b.returns &&
+                   a.isStatic == b.isStatic && a.isClassMethod == b.isClassMethod;
+        }
+    };
+
+    // Methods and fields include the inherited ones
+    struct ClassInterface {
+        std::map<std::string, Signature> methods;
+        std::vector<std::pair<std::string, std::string>> fields;
+
+        friend bool operator==(const ClassInterface& a, const ClassInterface& b) {
+            return a.methods == b.methods && a.fields == b.fields;
+        }
+    };
+
+    struct Interface {
+        std::map<std::string, Signature> functions;
+        std::map<std::string, ClassInterface> classes;
+
+        friend bool operator==(const Interface& a, const Interface& b) {
+            return a.functions == b.functions && a.classes == b.classes;
+        }
+    };
+
+    // A definition of another module that a module can reach
+    struct Import {
+        size_t module;
+        std::string name;        // In the defining module
+        bool isClass;
+        std::string_view bound;  // Name a from-import binds, if any
+        std::string_view key;    // The bound name, or else ::namespace::name
+    };
+
+    struct Imports {
+        std::vector<Import> definitions;
+        std::vector<std::pair<std::string, size_t>> dotted;  // util.f as written, to its definition
+    };
+
+    struct Parsed {
+        MappedFile input;
+        Arena arena{16 * 1024};
+        Arena nameArena{16 * 1024};
+        StringInterner interner{nameArena};
+        const Module* module = nullptr;
+    };
+
+    static inline const std::map<std::string, TypeKind, std::less<>> kinds = {
+        {"?", TypeKind::Unknown}, {"auto", TypeKind::Auto}, {"None", TypeKind::None},
+        {"bool", TypeKind::Bool}, {"int", TypeKind::Int}, {"float", TypeKind::Float},
+        {"str", TypeKind::Str}, {"Any", TypeKind::Dynamic}, {"list", TypeKind::List},
+        {"set", TypeKind::Set}, {"dict", TypeKind::Dict}, {"tuple", TypeKind::Tuple}
+    };
+
+    const ModuleGraph* graph = nullptr;
+    // What each module's inference found for its own definitions
+    std::vector<Interface> exports;
+    // calls[callee] maps each importing module to the argument types of its
+    // calls into the callee; only the parameters are filled in
+    std::vector<std::map<size_t, Interface>> calls;
+
+    static bool contains(const std::vector<std::string>& names, std::string_view name) {
+        for (const std::string& entry : names) {
+            if (entry == name) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The definitions module `index` imports at the top level, mirroring the
+    // names the decompiler's using-declarations and module paths make visible
+    Imports imports(size_t index, const StmtList& body, StringInterner& interner) const {
+        const ModuleGraph::Module& module = graph->all()[index];
+        Imports result;
+        auto add = [&](const ModuleGraph::Module* from, std::string_view name, std::string_view bound) {
+            bool isClass = contains(from->classes, name);
+            if (!isClass && !contains(from->functions, name)) {
+                return result.definitions.size();
+            }
+            size_t target = static_cast<size_t>(from - graph->all().data());
+            for (size_t i = 0; i < result.definitions.size(); ++i) {
+                Import& known = result.definitions[i];
+                // One entry per definition, keyed by its from-import name when it has one
+                if (known.module == target && known.name == name) {
+                    if (known.bound.empty()) {
+                        known.bound = bound;
+                    }
+                    return i;
+                }
+            }
+            result.definitions.push_back(Import{target, std::string(name), isClass, bound, {}});
+            return result.definitions.size() - 1;
+        };
+        // Every definition of the module `name`, reached as `prefix.definition`
+        auto addModule = [&](std::string_view name, const std::string& prefix) {
+            const ModuleGraph::Module* from = graph->find(name);
+            if (from == nullptr || from == &module) {
+                return;
+            }
+            for (const std::vector<std::string>* names : {&from->functions, &from->classes}) {
+                for (const std::string& definition : *names) {
+                    size_t i = add(from, definition, {});
+                    result.dotted.emplace_back(prefix + '.' + definition, i);
+                }
+            }
+        };
+        for (const Stmt* stmt : body) {
+            if (stmt->kind != StmtKind::Import && stmt->kind != StmtKind::ImportFrom) {
+                continue;
+            }
+            auto* import = static_cast<const ImportStmt*>(stmt);
+            if (stmt->kind == StmtKind::Import) {
+                for (const Alias* alias : import->names) {
+                    if (!alias->asname.empty()) {
+                        addModule(alias->name, std::string(alias->asname));
+                        continue;
+                    }
+                    // import a.b binds a, so a.f and a.b.f are both reachable
+                    for (size_t dot = alias->name.find('.');; dot = alias->name.find('.', dot + 1)) {
+                        std::string prefix(alias->name.substr(0, dot));
+                        addModule(prefix, prefix);
+                        if (dot == std::string_view::npos) {
+                            break;
+                        }
+                    }
+                }
+                continue;
+            }
+            std::string source = graph->resolve(module, import->module, import->level);
+            const ModuleGraph::Module* from = graph->find(source);
+            for (const Alias* alias : import->names) {
+                std::string_view bound = alias->asname.empty() ? alias->name : alias->asname;
+                std::string submodule = source.empty() ? std::string(alias->name) : source + '.' + std::string(alias->name);
+                if (alias->name != "*" && graph->isModuleOrPackage(submodule)) {
+                    addModule(submodule, std::string(bound));
+                } else if (from == nullptr || from == &module) {
+                    continue;
+                } else if (alias->name == "*") {
+                    for (const std::vector<std::string>* names : {&from->functions, &from->classes}) {
+                        for (const std::string& definition : *names) {
+                            add(from, definition, interner.intern(definition));
+                        }
+                    }
+                } else {
+                    add(from, alias->name, bound);
+                }
+            }
+        }
+        for (Import& definition : result.definitions) {
+            definition.key = !definition.bound.empty()
+                ? definition.bound
+                : interner.intern("::" + graph->all()[definition.module].cppNamespace + "::" + definition.name);
+        }
+        return result;
+    }
+
+    std::string spell(const Type* type, size_t index, const Imports& reachable) const {
+        switch (type->kind) {
+            case TypeKind::Unknown:
+                return "?";
+            case TypeKind::Auto:
+                return "auto";
+            case TypeKind::None:
+                return "None";
+            case TypeKind::Bool:
+                return "bool";
+            case TypeKind::Int:
+                return type->name == TypeInference::kNonNegative ? "int+" : "int";
+            case TypeKind::Float:
+                return "float";
+            case TypeKind::Str:
+                return "str";
+            case TypeKind::Dynamic:
+                return "Any";
+            case TypeKind::Class:
+                for (const Import& definition : reachable.definitions) {
+                    if (definition.isClass && definition.key == type->name) {
+                        return graph->all()[definition.module].name + ':' + definition.name;
+                    }
+                }
+                return contains(graph->all()[index].classes, type->name)
+                    ? graph->all()[index].name + ':' + std::string(type->name)
+                    : "auto";
+            default:
+                break;
+        }
+        std::string text = type->kind == TypeKind::List ? "list[" : type->kind == TypeKind::Set ? "set["
+                         : type->kind == TypeKind::Dict ? "dict[" : "tuple[";
+        for (size_t i = 0; i < type->args.size(); ++i) {
+            text += i > 0 ? ", " : "";
+            text += spell(type->args[i], index, reachable);
+        }
+        return text + ']';
+    }
+
+    // Reads one spelled type off the front of `text`. A class this module
+    // cannot name is left to the C++ compiler.
+    const Type* parse(std::string_view& text, size_t index, const Imports& reachable, TypeInference& types,
+                      StringInterner& interner) const {
+        size_t end = text.find_first_of("[], ");
+        std::string_view name = text.substr(0, end);
+        text.remove_prefix(name.size());
+        std::vector<const Type*> args;
+        if (!text.empty() && text[0] == '[') {
+            text.remove_prefix(1);
+            while (!text.empty() && text[0] != ']') {
+                args.push_back(parse(text, index, reachable, types, interner));
+                if (text.size() >= 2 && text[0] == ',') {
+                    text.remove_prefix(2);
+                }
+            }
+            text.remove_prefix(text.empty() ? 0 : 1);
+        }
+        if (name == "int+") {
+            return types.type(TypeKind::Int, {}, TypeInference::kNonNegative);
+        }
+        auto kind = kinds.find(name);
+        if (kind != kinds.end()) {
+            return types.type(kind->second, std::move(args));
+        }
+        size_t colon = name.find(':');
+        std::string_view module = name.substr(0, colon);
+        std::string_view cls = colon == std::string_view::npos ? std::string_view() : name.substr(colon + 1);
+        if (module == graph->all()[index].name) {
+            return types.type(TypeKind::Class, {}, interner.intern(cls));
+        }
+        for (const Import& definition : reachable.definitions) {
+            if (definition.isClass && definition.name == cls && graph->all()[definition.module].name == module) {
+                return types.type(TypeKind::Class, {}, definition.key);
+            }
+        }
+        return types.type(TypeKind::Auto);
+    }
+
+    const Type* parse(const std::string& text, size_t index, const Imports& reachable, TypeInference& types,
+                      StringInterner& interner) const {
+        std::string_view rest = text;
+        return parse(rest, index, reachable, types, interner);
+    }
+
+    Signature signature(const TypeInference::FunctionTypes& function, size_t index, const Imports& reachable) const {
+        Signature result;
+        for (size_t i = 0; i < function.params.size(); ++i) {
+            result.names.emplace_back(function.paramNames[i]);
+            result.params.push_back(spell(function.params[i], index, reachable));
+        }
+        result.returns = spell(function.returns, index, reachable);
+        result.isStatic = function.isStatic;
+        result.isClassMethod = function.isClassMethod;
+        return result;
+    }
+
+    // Fills an imported function in from what its module found; the parameters
+    // start empty so they only collect this module's calls
+    void declare(TypeInference::FunctionTypes& function, const Signature& exported, const Type* self, size_t index,
+                 const Imports& reachable, TypeInference& types, StringInterner& interner) const {
+        for (size_t i = 0; i < exported.params.size(); ++i) {
+            bool bound = self != nullptr && i == 0 && !exported.isStatic;
+            function.paramNames.push_back(interner.intern(exported.names[i]));
+            function.params.push_back(bound ? (exported.isClassMethod ? types.type(TypeKind::Auto) : self)
+                                            : types.type(TypeKind::Unknown));
+            function.pinned.push_back(bound);
+        }
+        function.returns = parse(exported.returns, index, reachable, types, interner);
+        function.returnsValue = function.returns->kind != TypeKind::Unknown && function.returns->kind != TypeKind::None;
+        function.isStatic = exported.isStatic;
+        function.isClassMethod = exported.isClassMethod;
+    }
+
+    void seed(TypeInference::FunctionTypes* function, const Signature& observed, size_t index, const Imports& reachable,
+              TypeInference& types, StringInterner& interner) const {
+        if (function == nullptr) {
+            return;
+        }
+        for (size_t i = 0; i < observed.params.size(); ++i) {
+            types.seed(*function, i, parse(observed.params[i], index, reachable, types, interner));
+        }
+    }
+
+    // The method `name` of `cls` or of the closest base that has one
+    static TypeInference::FunctionTypes* method(TypeInference& types, TypeInference::ClassTypes* cls,
+                                                std::string_view name) {
+        for (; cls != nullptr; cls = cls->base) {
+            if (TypeInference::FunctionTypes* found = types.method(cls, name)) {
+                return found;
+            }
+        }
+        return nullptr;
+    }
+
+    ClassInterface classInterface(TypeInference::ClassTypes* cls, size_t index, const Imports& reachable) const {
+        ClassInterface result;
+        for (; cls != nullptr; cls = cls->base) {
+            for (const auto& field : cls->fields.entries) {
+                bool inherited = false;
+                for (const auto& known : result.fields) {
+                    inherited = inherited || known.first == field.first;
+                }
+                if (!inherited) {
+                    result.fields.emplace_back(std::string(field.first), spell(field.second, index, reachable));
+                }
+            }
+            for (const auto& entry : cls->methods) {
+                result.methods.emplace(std::string(entry.first), signature(entry.second, index, reachable));
+            }
+        }
+        return result;
+    }
+
+    // Registers the imports of module `index`, seeds its parameters with the
+    // types the importing modules pass, and runs types.analyze(body)
+    Imports analyzeModule(size_t index, const StmtList& body, TypeInference& types, StringInterner& interner) const {
+        Imports reachable = imports(index, body, interner);
+        for (const Import& definition : reachable.definitions) {
+            const Interface& from = exports[definition.module];
+            if (!definition.isClass) {
+                auto exported = from.functions.find(definition.name);
+                TypeInference::FunctionTypes& function = types.importFunction(definition.key);
+                if (exported != from.functions.end()) {
+                    declare(function, exported->second, nullptr, index, reachable, types, interner);
+                }
+                continue;
+            }
+            TypeInference::ClassTypes& cls = types.importClass(definition.key);
+            auto exported = from.classes.find(definition.name);
+            if (exported == from.classes.end()) {
+                continue;
+            }
+            const Type* self = types.type(TypeKind::Class, {}, definition.key);
+            for (const auto& field : exported->second.fields) {
+                cls.fields.slot(interner.intern(field.first), parse(field.second, index, reachable, types, interner));
+            }
+            for (const auto& entry : exported->second.methods) {
+                TypeInference::FunctionTypes& function = cls.methods[interner.intern(entry.first)];
+                function.owner = &cls;
+                declare(function, entry.second, self, index, reachable, types, interner);
+            }
+        }
+        for (const auto& call : reachable.dotted) {
+            types.importCall(call.first, reachable.definitions[call.second].key);
+        }
+        types.analyze(body, [&] {
+            for (const auto& entry : calls[index]) {
+                for (const auto& function : entry.second.functions) {
+                    seed(types.function(function.first), function.second, index, reachable, types, interner);
+                }
+                for (const auto& cls : entry.second.classes) {
+                    TypeInference::ClassTypes* own = types.findClass(cls.first);
+                    for (const auto& observed : cls.second.methods) {
+                        seed(method(types, own, observed.first), observed.second, index, reachable, types, interner);
+                    }
+                }
+            }
+        });
+        return reachable;
+    }
+
+    // One pass for module `index`: types it with what is known so far and
+    // stores what it found. Returns true when anything stored changed.
+    bool update(size_t index, Parsed& parsed) {
+        TypeInference types;
+        Imports reachable = analyzeModule(index, parsed.module->body, types, parsed.interner);
+        bool changed = false;
+
+        Interface exported;
+        const ModuleGraph::Module& module = graph->all()[index];
+        for (const std::string& name : module.functions) {
+            if (TypeInference::FunctionTypes* function = types.function(name)) {
+                exported.functions.emplace(name, signature(*function, index, reachable));
+            }
+        }
+        for (const std::string& name : module.classes) {
+            if (TypeInference::ClassTypes* cls = types.findClass(name)) {
+                exported.classes.emplace(name, classInterface(cls, index, reachable));
+            }
+        }
+        if (!(exported == exports[index])) {
+            exports[index] = std::move(exported);
+            changed = true;
+        }
+
+        std::map<size_t, Interface> observed;
+        for (const Import& definition : reachable.definitions) {
+            Interface& into = observed[definition.module];
+            if (!definition.isClass) {
+                if (TypeInference::FunctionTypes* function = types.function(definition.key)) {
+                    into.functions[definition.name] = signature(*function, index, reachable);
+                }
+            } else if (TypeInference::ClassTypes* cls = types.findClass(definition.key)) {
+                into.classes[definition.name] = classInterface(cls, index, reachable);
+            }
+        }
+        for (auto& entry : observed) {
+            Interface& stored = calls[entry.first][index];
+            if (!(entry.second == stored)) {
+                stored = std::move(entry.second);
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
+public:
+    // Parses every module of `project` once and analyses them all until the
+    // types they share settle. A module that cannot be read or parsed is left
+    // out; translating it reports the error.
+    void infer(const ModuleGraph& project) {
+        PY2CPP_PROFILE_SCOPE("module types");
+        graph = &project;
+        exports.assign(project.size(), Interface());
+        calls.assign(project.size(), {});
+        std::vector<std::unique_ptr<Parsed>> parsed(project.size());
+        for (size_t i = 0; i < project.size(); ++i) {
+            auto module = std::make_unique<Parsed>();
+            if (!module->input.open(project.all()[i].source.string())) {
+                continue;
+            }
+            try {
+                PythonParser parser(module->input.view(), module->arena, module->interner);
+                module->module = parser.parseModule();
+            } catch (const std::exception&) {
+                continue;
+            }
+            parsed[i] = std::move(module);
+        }
+        std::vector<size_t> order = project.order();
+        for (int pass = 0; pass < kMaxPasses; ++pass) {
+            bool changed = false;
+            for (size_t index : order) {
+                if (parsed[index] != nullptr) {
+                    changed = update(index, *parsed[index]) || changed;
+                }
+            }
+            if (!changed) {
+                break;
+            }
+        }
+    }
+
+    // Types module `index` of the graph passed to infer() the way its last
+    // pass did. `interner` has to be the one `body` was parsed with.
+    void analyze(size_t index, const StmtList& body, TypeInference& types, StringInterner& interner) const {
+        analyzeModule(index, body, types, interner);
+    }
+};
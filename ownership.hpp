@@ -0,0 +1,604 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "python_ast.hpp"
+
+// Analysis behind parameter passing and moves in generated functions. It
+// records what a function body does with each name: whether it is rebound,
+// written into or has methods called on it (so a parameter can be taken by
+// const reference when it is only read), and where it is used for the last
+// time, so a local handed to something that copies it (an assignment, a
+// container display, append(), a user function) can be moved there instead.
+struct NameUsage {
+    std::string_view name;
+    bool local = false;        // First bound by a plain assignment in this function
+    bool parameter = false;
+    bool rebound = false;      // Assigned, deleted, or bound by for/with/except/global
+    // x[i] = ..., x.f = ..., del x[i], a method called on x[i] / x.f, x.append(...) and the like,
+    // a method of the module's classes called on x, or x passed to a reference parameter
+    bool writtenInto = false;
+    bool captured = false;     // Mentioned inside a nested function or lambda
+    bool returned = false;     // `return x`, which C++ already moves
+    std::vector<std::string_view> methods;  // Methods called on the name itself
+
+    // The last occurrence, and whether it sits where the value is copied
+    const Expr* last = nullptr;
+    bool lastIsSink = false;
+    bool sharesStatement = false;  // The occurrence before it is in the same statement
+    std::vector<uint32_t> lastLoops;     // Loops enclosing the last occurrence
+    std::vector<uint32_t> bindingLoops;  // Loops enclosing the first binding
+
+    // Loops around the last use must also enclose the binding, so no later
+    // iteration reads the moved-from value
+    bool movable() const {
+        if (last == nullptr || !lastIsSink || sharesStatement || captured || (!local && !parameter)) {
+            return false;
+        }
+        if (lastLoops.size() > bindingLoops.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < lastLoops.size(); ++i) {
+            if (lastLoops[i] != bindingLoops[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Call arguments that bind to non-const reference parameters: those of the
+// module's functions, of its constructors (under the class name) and of its
+// methods (under the method name, merged across classes). Every method is
+// listed, with or without such parameters, since calling one can change the
+// object it is called on. Names are interned, so they are ordered and
+// compared by address.
+class ReferenceTable {
+private:
+    struct Entry {
+        std::string_view callee;
+        bool method = false;
+        std::vector<size_t> positions;  // Sorted call argument indices, self not counted
+    };
+    std::vector<Entry> entries;  // Sorted by (method, callee address) once sealed
+
+    static bool before(const Entry& entry, std::pair<bool, const char*> key) {
+        if (entry.method != key.first) {
+            return entry.method < key.first;
+        }
+        return std::less<const char*>()(entry.callee.data(), key.second);
+    }
+
+    // entries.size() when missing
+    size_t indexOf(std::string_view callee, bool method) const {
+        auto it = std::lower_bound(entries.begin(), entries.end(), std::make_pair(method, callee.data()), before);
+        if (it == entries.end() || it->method != method || it->callee.data() != callee.data()) {
+            return entries.size();
+        }
+        return static_cast<size_t>(it - entries.begin());
+    }
+
+public:
+    void clear() {
+        entries.clear();
+    }
+
+    bool empty() const {
+        return entries.empty();
+    }
+
+    void add(std::string_view callee, bool method) {
+        entries.push_back(Entry{callee, method, {}});
+    }
+
+    // Call once every callable is added, before mark() and positions()
+    void seal() {
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+            return before(a, std::make_pair(b.method, b.callee.data()));
+        });
+        entries.erase(std::unique(entries.begin(), entries.end(),
+                                  [](const Entry& a, const Entry& b) {
+                                      return a.method == b.method && a.callee.data() == b.callee.data();
+                                  }),
+                      entries.end());
+    }
+
+    // True when the position was not marked before
+    bool mark(std::string_view callee, bool method, size_t position) {
+        size_t index = indexOf(callee, method);
+        if (index == entries.size()) {
+            return false;
+        }
+        std::vector<size_t>& marked = entries[index].positions;
+        auto it = std::lower_bound(marked.begin(), marked.end(), position);
+        if (it != marked.end() && *it == position) {
+            return false;
+        }
+        marked.insert(it, position);
+        return true;
+    }
+
+    // Null when the call does not go to one of the module's functions, classes or methods
+    const std::vector<size_t>* positions(const CallExpr* call) const {
+        bool method = call->func->kind == ExprKind::Attribute;
+        std::string_view callee;
+        if (method) {
+            callee = static_cast<const AttributeExpr*>(call->func)->attr;
+        } else if (call->func->kind == ExprKind::Name) {
+            callee = static_cast<const NameExpr*>(call->func)->id;
+        } else {
+            return nullptr;
+        }
+        size_t index = indexOf(callee, method);
+        return index != entries.size() ? &entries[index].positions : nullptr;
+    }
+
+    static bool contains(const std::vector<size_t>* positions, size_t position) {
+        return positions != nullptr && std::binary_search(positions->begin(), positions->end(), position);
+    }
+};
+
+class OwnershipAnalysis {
+private:
+    enum class Use { Read, Sink, Bind, Write };
+
+    const std::vector<std::string_view>& functions;
+    const std::vector<std::string_view>& classes;
+    const ReferenceTable* references;
+    std::vector<NameUsage> usages;
+    std::vector<uint32_t> loops;
+    uint32_t nextLoop = 0;
+    uint32_t statement = 0;
+    int nested = 0;  // Depth inside lambdas, comprehensions and nested functions
+    std::vector<uint32_t> lastStatement;  // Per usage, statement of its latest occurrence
+    bool opaque = false;
+
+    static bool sameName(std::string_view a, std::string_view b) {
+        return a.data() == b.data() && a.size() == b.size();
+    }
+
+    NameUsage& usageOf(std::string_view id) {
+        for (NameUsage& usage : usages) {
+            if (sameName(usage.name, id)) {
+                return usage;
+            }
+        }
+        usages.emplace_back();
+        usages.back().name = id;
+        lastStatement.push_back(0);
+        return usages.back();
+    }
+
+    void occurrence(std::string_view id, const Expr* node, Use use) {
+        NameUsage& usage = usageOf(id);
+        size_t index = static_cast<size_t>(&usage - usages.data());
+        bool first = usage.last == nullptr && !usage.rebound && !usage.parameter;
+        if (use == Use::Bind) {
+            if (first && nested == 0) {
+                usage.local = true;
+                usage.bindingLoops = loops;
+            }
+            usage.rebound = true;
+        } else if (use == Use::Write) {
+            usage.writtenInto = true;
+        }
+        if (nested > 0) {
+            usage.captured = true;
+        }
+        usage.sharesStatement = usage.last != nullptr && lastStatement[index] == statement;
+        usage.last = node;
+        usage.lastIsSink = use == Use::Sink && nested == 0;
+        usage.lastLoops = loops;
+        lastStatement[index] = statement;
+    }
+
+    // Binding of a name that is a C++ reference or counter, never worth moving
+    void boundName(std::string_view id) {
+        NameUsage& usage = usageOf(id);
+        usage.rebound = true;
+        usage.captured = true;
+    }
+
+    void expressions(const NodeList<Expr*>& list, Use use = Use::Read) {
+        for (const Expr* e : list) {
+            expression(e, use);
+        }
+    }
+
+    // Elements of a display are copied into the new container
+    void elements(const NodeList<Expr*>& list, Use use) {
+        for (const Expr* e : list) {
+            expression(e, use == Use::Read ? Use::Sink : use);
+        }
+    }
+
+    // Methods of list, dict and set that change the container
+    static bool mutatingMethod(std::string_view method) {
+        return method == "append" || method == "extend" || method == "insert" || method == "pop" ||
+               method == "remove" || method == "clear" || method == "sort" || method == "reverse" ||
+               method == "add" || method == "discard" || method == "update" || method == "setdefault" ||
+               method == "popitem";
+    }
+
+    // The name an attribute, subscript or method call is taken from, if any
+    static const NameExpr* rootName(const Expr* expr) {
+        while (expr != nullptr) {
+            switch (expr->kind) {
+                case ExprKind::Name:
+                    return static_cast<const NameExpr*>(expr);
+                case ExprKind::Attribute:
+                    expr = static_cast<const AttributeExpr*>(expr)->value;
+                    break;
+                case ExprKind::Subscript:
+                    expr = static_cast<const SubscriptExpr*>(expr)->value;
+                    break;
+                case ExprKind::Call:
+                    // d.items() is taken from d; f(x) from nothing
+                    expr = static_cast<const CallExpr*>(expr)->func;
+                    if (expr->kind != ExprKind::Attribute) {
+                        return nullptr;
+                    }
+                    break;
+                default:
+                    return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+    // Calls that keep their arguments: container inserts, base constructors, user functions and classes
+    bool keepsArguments(const CallExpr* call) const {
+        if (call->func->kind == ExprKind::Attribute) {
+            std::string_view method = static_cast<const AttributeExpr*>(call->func)->attr;
+            return method == "append" || method == "add" || method == "insert" || method == "push_back" ||
+                   method == "setdefault" || method == "__init__";
+        }
+        if (call->func->kind == ExprKind::Name) {
+            std::string_view id = static_cast<const NameExpr*>(call->func)->id;
+            return std::binary_search(functions.begin(), functions.end(), id) ||
+                   std::binary_search(classes.begin(), classes.end(), id);
+        }
+        return false;
+    }
+
+    void expression(const Expr* expr, Use use = Use::Read) {
+        if (expr == nullptr) {
+            return;
+        }
+        switch (expr->kind) {
+            case ExprKind::Name:
+                occurrence(static_cast<const NameExpr*>(expr)->id, expr, use);
+                break;
+            case ExprKind::Subscript:
+            case ExprKind::Attribute: {
+                // Stores into part of an object, and methods called on a part, write into the root
+                const Expr* value = expr->kind == ExprKind::Subscript ? static_cast<const SubscriptExpr*>(expr)->value
+                                                                      : static_cast<const AttributeExpr*>(expr)->value;
+                expression(value, use == Use::Bind || use == Use::Write ? Use::Write : Use::Read);
+                if (expr->kind == ExprKind::Subscript) {
+                    expression(static_cast<const SubscriptExpr*>(expr)->index);
+                }
+                break;
+            }
+            case ExprKind::Call: {
+                auto* call = static_cast<const CallExpr*>(expr);
+                const std::vector<size_t>* referenced = references != nullptr ? references->positions(call) : nullptr;
+                if (call->func->kind == ExprKind::Attribute) {
+                    auto* method = static_cast<const AttributeExpr*>(call->func);
+                    if (method->value->kind == ExprKind::Name) {
+                        auto* object = static_cast<const NameExpr*>(method->value);
+                        usageOf(object->id).methods.push_back(method->attr);
+                        bool writes = referenced != nullptr || mutatingMethod(method->attr);
+                        expression(object, writes ? Use::Write : Use::Read);
+                    } else {
+                        expression(method->value, Use::Write);
+                    }
+                } else {
+                    expression(call->func);
+                }
+                Use argumentUse = keepsArguments(call) ? Use::Sink : Use::Read;
+                for (size_t i = 0; i < call->args.size(); ++i) {
+                    const Expr* arg = call->args[i];
+                    Use use = ReferenceTable::contains(referenced, i) ? Use::Write : argumentUse;
+                    if (arg->kind == ExprKind::Keyword) {
+                        expression(static_cast<const KeywordExpr*>(arg)->value, use);
+                    } else {
+                        expression(arg, use);
+                    }
+                }
+                break;
+            }
+            case ExprKind::FString:
+                expressions(static_cast<const FStringExpr*>(expr)->parts);
+                break;
+            case ExprKind::FormattedValue:
+                expression(static_cast<const FormattedValueExpr*>(expr)->value);
+                break;
+            case ExprKind::Unary:
+                expression(static_cast<const UnaryExpr*>(expr)->operand);
+                break;
+            case ExprKind::Binary:
+            case ExprKind::BoolOp: {
+                auto* op = static_cast<const BinaryExpr*>(expr);
+                expression(op->left);
+                expression(op->right);
+                break;
+            }
+            case ExprKind::Compare:
+                expressions(static_cast<const CompareExpr*>(expr)->operands);
+                break;
+            case ExprKind::Conditional: {
+                auto* cond = static_cast<const ConditionalExpr*>(expr);
+                expression(cond->test);
+                expression(cond->body);
+                expression(cond->orelse);
+                break;
+            }
+            case ExprKind::Keyword:
+                expression(static_cast<const KeywordExpr*>(expr)->value);
+                break;
+            case ExprKind::Starred:
+                expression(static_cast<const StarredExpr*>(expr)->value, use == Use::Sink ? Use::Read : use);
+                break;
+            case ExprKind::Slice: {
+                auto* slice = static_cast<const SliceExpr*>(expr);
+                expression(slice->lower);
+                expression(slice->upper);
+                expression(slice->step);
+                break;
+            }
+            case ExprKind::List:
+            case ExprKind::Tuple:
+            case ExprKind::Set:
+                elements(static_cast<const SequenceExpr*>(expr)->elements, use);
+                break;
+            case ExprKind::Dict: {
+                auto* dict = static_cast<const DictExpr*>(expr);
+                elements(dict->keys, Use::Read);
+                elements(dict->values, Use::Read);
+                break;
+            }
+            case ExprKind::ListComp:
+            case ExprKind::SetComp:
+            case ExprKind::DictComp:
+            case ExprKind::GeneratorExp: {
+                // Runs once per item inside a lambda, so nothing in it is a last use
+                auto* comp = static_cast<const ComprehensionExpr*>(expr);
+                ++nested;
+                for (const Comprehension* gen : comp->generators) {
+                    expression(gen->iter);
+                    expression(gen->target, Use::Bind);
+                    expressions(gen->ifs);
+                }
+                expression(comp->element);
+                expression(comp->value);
+                --nested;
+                break;
+            }
+            case ExprKind::Lambda:
+                ++nested;
+                expression(static_cast<const LambdaExpr*>(expr)->body);
+                --nested;
+                break;
+            default:
+                break;
+        }
+    }
+
+    void block(const StmtList& body) {
+        for (const Stmt* stmt : body) {
+            statementOf(stmt);
+        }
+    }
+
+    void loopBody(const StmtList& body) {
+        loops.push_back(nextLoop++);
+        block(body);
+        loops.pop_back();
+    }
+
+    // for/with/except targets are generated as references or counters
+    void boundTarget(const Expr* target) {
+        if (target == nullptr) {
+            return;
+        }
+        if (target->kind == ExprKind::Name) {
+            boundName(static_cast<const NameExpr*>(target)->id);
+        } else if (target->kind == ExprKind::Tuple || target->kind == ExprKind::List) {
+            for (const Expr* element : static_cast<const SequenceExpr*>(target)->elements) {
+                boundTarget(element);
+            }
+        } else {
+            expression(target, Use::Bind);
+        }
+    }
+
+    bool writesTarget(const Expr* target) {
+        if (target->kind == ExprKind::Name) {
+            return usageOf(static_cast<const NameExpr*>(target)->id).writtenInto;
+        }
+        if (target->kind == ExprKind::Tuple || target->kind == ExprKind::List) {
+            auto& elements = static_cast<const SequenceExpr*>(target)->elements;
+            return std::any_of(elements.begin(), elements.end(), [&](const Expr* e) { return writesTarget(e); });
+        }
+        return false;
+    }
+
+    void statementOf(const Stmt* stmt) {
+        ++statement;
+        switch (stmt->kind) {
+            case StmtKind::Expr:
+                expression(static_cast<const ExprStmt*>(stmt)->value);
+                break;
+            case StmtKind::Assign: {
+                // The value is evaluated before the targets are bound
+                auto* assign = static_cast<const AssignStmt*>(stmt);
+                expression(assign->value, assign->targets.size() == 1 ? Use::Sink : Use::Read);
+                expressions(assign->targets, Use::Bind);
+                break;
+            }
+            case StmtKind::AugAssign: {
+                auto* assign = static_cast<const AugAssignStmt*>(stmt);
+                expression(assign->value);
+                expression(assign->target, Use::Bind);
+                break;
+            }
+            case StmtKind::AnnAssign: {
+                auto* assign = static_cast<const AnnAssignStmt*>(stmt);
+                expression(assign->value, Use::Sink);
+                expression(assign->target, Use::Bind);
+                break;
+            }
+            case StmtKind::Return: {
+                auto* ret = static_cast<const ValueStmt*>(stmt);
+                if (ret->value != nullptr && ret->value->kind == ExprKind::Name) {
+                    usageOf(static_cast<const NameExpr*>(ret->value)->id).returned = true;
+                }
+                expression(ret->value);
+                break;
+            }
+            case StmtKind::Raise: {
+                auto* value = static_cast<const ValueStmt*>(stmt);
+                expression(value->value);
+                expression(value->cause);
+                break;
+            }
+            case StmtKind::Del:
+                expressions(static_cast<const ExprListStmt*>(stmt)->expressions, Use::Bind);
+                break;
+            case StmtKind::Assert:
+                expressions(static_cast<const ExprListStmt*>(stmt)->expressions);
+                break;
+            case StmtKind::If: {
+                auto* ifStmt = static_cast<const IfStmt*>(stmt);
+                expression(ifStmt->test);
+                block(ifStmt->body);
+                block(ifStmt->orelse);
+                break;
+            }
+            case StmtKind::While: {
+                auto* whileStmt = static_cast<const IfStmt*>(stmt);
+                loops.push_back(nextLoop++);
+                expression(whileStmt->test);
+                block(whileStmt->body);
+                loops.pop_back();
+                block(whileStmt->orelse);
+                break;
+            }
+            case StmtKind::For: {
+                auto* forStmt = static_cast<const ForStmt*>(stmt);
+                expression(forStmt->iter);
+                loops.push_back(nextLoop++);
+                boundTarget(forStmt->target);
+                block(forStmt->body);
+                loops.pop_back();
+                // Elements changed through the loop variable change the iterable
+                if (writesTarget(forStmt->target)) {
+                    if (const NameExpr* root = rootName(forStmt->iter)) {
+                        usageOf(root->id).writtenInto = true;
+                    }
+                }
+                block(forStmt->orelse);
+                break;
+            }
+            case StmtKind::Try: {
+                auto* tryStmt = static_cast<const TryStmt*>(stmt);
+                block(tryStmt->body);
+                for (const ExceptHandler* handler : tryStmt->handlers) {
+                    expression(handler->type);
+                    if (!handler->name.empty()) {
+                        boundName(handler->name);
+                    }
+                    block(handler->body);
+                }
+                block(tryStmt->orelse);
+                block(tryStmt->finalbody);
+                break;
+            }
+            case StmtKind::With: {
+                auto* with = static_cast<const WithStmt*>(stmt);
+                for (const WithItem* item : with->items) {
+                    expression(item->context);
+                    boundTarget(item->var);
+                }
+                block(with->body);
+                break;
+            }
+            case StmtKind::Global:
+            case StmtKind::Nonlocal:
+                for (std::string_view id : static_cast<const NamesStmt*>(stmt)->names) {
+                    boundName(id);
+                }
+                break;
+            case StmtKind::FunctionDef: {
+                // Nested functions become lambdas capturing by reference
+                auto* def = static_cast<const FunctionDef*>(stmt);
+                boundName(def->name);
+                ++nested;
+                for (const Param* param : def->params) {
+                    expression(param->defaultValue);
+                }
+                block(def->body);
+                --nested;
+                break;
+            }
+            case StmtKind::ClassDef:
+            case StmtKind::Unsupported:
+                opaque = true;
+                break;
+            default:
+                break;
+        }
+    }
+
+public:
+    // Calls to the module's own functions and classes (sorted) keep their arguments;
+    // arguments at the `references` positions of a call are written into
+    OwnershipAnalysis(const FunctionDef* def, const std::vector<std::string_view>& functions,
+                      const std::vector<std::string_view>& classes, const ReferenceTable* references = nullptr)
+        : functions(functions), classes(classes), references(references) {
+        for (const Param* param : def->params) {
+            NameUsage& usage = usageOf(param->name);
+            usage.parameter = true;
+            if (param->kind != Param::Normal) {
+                usage.captured = true;
+            }
+        }
+        block(def->body);
+    }
+
+    // Module-level code, leaving out the function and class definitions
+    OwnershipAnalysis(const StmtList& body, const std::vector<std::string_view>& functions,
+                      const std::vector<std::string_view>& classes, const ReferenceTable* references = nullptr)
+        : functions(functions), classes(classes), references(references) {
+        for (const Stmt* stmt : body) {
+            if (stmt->kind != StmtKind::FunctionDef && stmt->kind != StmtKind::ClassDef) {
+                statementOf(stmt);
+            }
+        }
+    }
+
+    // Null for names the body never mentions
+    const NameUsage* usage(std::string_view name) const {
+        for (const NameUsage& usage : usages) {
+            if (sameName(usage.name, name)) {
+                return &usage;
+            }
+        }
+        return nullptr;
+    }
+
+    const std::vector<NameUsage>& names() const {
+        return usages;
+    }
+
+    // Verbatim statements or class definitions in the body; nothing is moved
+    bool isOpaque() const {
+        return opaque;
+    }
+};
@@ -0,0 +1,361 @@
+#pragma once
+
+// Per-stage timing and counters behind --profile. Instrumentation points use the
+// PY2CPP_PROFILE_* macros; with PY2CPP_PROFILING set to 0 they expand to nothing,
+// and when compiled in but not enabled at run time each point costs one load of
+// a thread-local pointer.
+
+#ifndef PY2CPP_PROFILING
+#define PY2CPP_PROFILING 0
+#endif
+
+#if PY2CPP_PROFILING
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Profiler {
+public:
+    static constexpr bool kEnabled = true;
+
+    struct StageStats {
+        uint64_t calls = 0;
+        uint64_t totalNs = 0;
+        uint64_t selfNs = 0;
+    };
+
+private:
+    struct TraceEvent {
+        int stage;
+        uint32_t thread;
+        uint64_t startNs;
+        uint64_t durationNs;
+    };
+
+    struct OpenScope {
+        int stage;
+        uint64_t startNs;
+        uint64_t childNs;
+    };
+
+    struct LineSample {
+        uint32_t file;
+        int line;
+        uint64_t ns;
+    };
+
+    static constexpr size_t kMaxTraceEvents = 1000000;
+    static constexpr size_t kSlowestLines = 10;
+
+    std::vector<StageStats> stages;
+    std::vector<uint64_t> counters;
+    std::vector<OpenScope> stack;
+    std::vector<TraceEvent> events;
+    std::vector<LineSample> lines;
+    std::vector<std::string> files;
+    uint32_t thread = 0;
+    size_t droppedEvents = 0;
+
+    // Stage and counter names are shared by every profiler in the process
+    static std::mutex& registryMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::vector<std::string>& stageNames() {
+        static std::vector<std::string> names;
+        return names;
+    }
+
+    static std::vector<std::string>& counterNames() {
+        static std::vector<std::string> names;
+        return names;
+    }
+
+    static int registerName(std::vector<std::string>& names, const char* name) {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        auto it = std::find(names.begin(), names.end(), name);
+        if (it != names.end()) {
+            return static_cast<int>(it - names.begin());
+        }
+        names.push_back(name);
+        return static_cast<int>(names.size() - 1);
+    }
+
+    static std::chrono::steady_clock::time_point epoch() {
+        static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        return start;
+    }
+
+    static void appendJsonString(std::string& out, const std::string& text) {
+        out += '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+            }
+            out += c;
+        }
+        out += '"';
+    }
+
+public:
+    explicit Profiler(uint32_t threadId = 0) : thread(threadId) {
+        epoch();
+    }
+
+    static int registerStage(const char* name) {
+        return registerName(stageNames(), name);
+    }
+
+    static int registerCounter(const char* name) {
+        return registerName(counterNames(), name);
+    }
+
+    // Profiler collecting for the calling thread, or null when profiling is off
+    static Profiler*& current() {
+        static thread_local Profiler* active = nullptr;
+        return active;
+    }
+
+    static uint64_t now() {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch()).count());
+    }
+
+    void begin(int stage) {
+        stack.push_back({stage, now(), 0});
+    }
+
+    void end() {
+        OpenScope scope = stack.back();
+        stack.pop_back();
+        uint64_t duration = now() - scope.startNs;
+        if (static_cast<size_t>(scope.stage) >= stages.size()) {
+            stages.resize(scope.stage + 1);
+        }
+        StageStats& stats = stages[scope.stage];
+        ++stats.calls;
+        stats.totalNs += duration;
+        stats.selfNs += duration - std::min(duration, scope.childNs);
+        if (!stack.empty()) {
+            stack.back().childNs += duration;
+        }
+        if (events.size() < kMaxTraceEvents) {
+            events.push_back({scope.stage, thread, scope.startNs, duration});
+        } else {
+            ++droppedEvents;
+        }
+    }
+
+    void count(int counter, uint64_t amount = 1) {
+        if (static_cast<size_t>(counter) >= counters.size()) {
+            counters.resize(counter + 1);
+        }
+        counters[counter] += amount;
+    }
+
+    // Starts attributing recordLine() samples to `file`
+    void beginFile(const std::string& file) {
+        files.push_back(file);
+    }
+
+    void recordLine(int line, uint64_t ns) {
+        lines.push_back({static_cast<uint32_t>(files.empty() ? 0 : files.size() - 1), line, ns});
+    }
+
+    // Folds another profiler (typically a finished worker's) into this one
+    void merge(const Profiler& other) {
+        if (stages.size() < other.stages.size()) {
+            stages.resize(other.stages.size());
+        }
+        for (size_t i = 0; i < other.stages.size(); ++i) {
+            stages[i].calls += other.stages[i].calls;
+            stages[i].totalNs += other.stages[i].totalNs;
+            stages[i].selfNs += other.stages[i].selfNs;
+        }
+        for (size_t i = 0; i < other.counters.size(); ++i) {
+            count(static_cast<int>(i), other.counters[i]);
+        }
+        uint32_t fileBase = static_cast<uint32_t>(files.size());
+        files.insert(files.end(), other.files.begin(), other.files.end());
+        for (const LineSample& sample : other.lines) {
+            lines.push_back({sample.file + fileBase, sample.line, sample.ns});
+        }
+        size_t room = kMaxTraceEvents - std::min(kMaxTraceEvents, events.size());
+        size_t taken = std::min(room, other.events.size());
+        events.insert(events.end(), other.events.begin(), other.events.begin() + taken);
+        droppedEvents += other.droppedEvents + other.events.size() - taken;
+    }
+
+    void printTable(std::ostream& out) const {
+        std::vector<std::string> names;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            names = stageNames();
+        }
+        std::vector<size_t> order;
+        for (size_t i = 0; i < stages.size(); ++i) {
+            if (stages[i].calls > 0) {
+                order.push_back(i);
+            }
+        }
+        std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+            return stages[a].selfNs > stages[b].selfNs;
+        });
+
+        char line[256];
+        std::snprintf(line, sizeof(line), "%-28s %12s %12s %12s %10s\n", "Stage", "Calls", "Total ms", "Self ms",
+                      "Avg us");
+        out << line;
+        for (size_t i : order) {
+            const StageStats& s = stages[i];
+            std::snprintf(line, sizeof(line), "%-28s %12llu %12.3f %12.3f %10.3f\n", names[i].c_str(),
+                          static_cast<unsigned long long>(s.calls), s.totalNs / 1e6, s.selfNs / 1e6,
+                          s.totalNs / 1e3 / static_cast<double>(s.calls));
+            out << line;
+        }
+
+        std::vector<std::string> counterLabels;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            counterLabels = counterNames();
+        }
+        if (!counters.empty()) {
+            std::snprintf(line, sizeof(line), "\n%-28s %12s\n", "Counter", "Count");
+            out << line;
+            for (size_t i = 0; i < counters.size(); ++i) {
+                if (counters[i] > 0) {
+                    std::snprintf(line, sizeof(line), "%-28s %12llu\n", counterLabels[i].c_str(),
+                                  static_cast<unsigned long long>(counters[i]));
+                    out << line;
+                }
+            }
+        }
+
+        if (!lines.empty()) {
+            std::vector<LineSample> slowest = lines;
+            size_t shown = std::min(kSlowestLines, slowest.size());
+            std::partial_sort(slowest.begin(), slowest.begin() + shown, slowest.end(),
+                              [](const LineSample& a, const LineSample& b) { return a.ns > b.ns; });
+            out << "\nSlowest top-level statements\n";
+            for (size_t i = 0; i < shown; ++i) {
+                const std::string& file = files.empty() ? std::string() : files[slowest[i].file];
+                std::snprintf(line, sizeof(line), "  %12.3f ms  %s:%d\n", slowest[i].ns / 1e6, file.c_str(),
+                              slowest[i].line);
+                out << line;
+            }
+        }
+        if (droppedEvents > 0) {
+            out << "\n(" << droppedEvents << " trace events beyond the first " << kMaxTraceEvents
+                << " were not recorded)\n";
+        }
+    }
+
+    // Chrome trace-event format, loadable in chrome://tracing or Perfetto
+    bool writeTrace(const std::string& path) const {
+        std::vector<std::string> names;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex());
+            names = stageNames();
+        }
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        std::string out = "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        char numbers[128];
+        for (size_t i = 0; i < events.size(); ++i) {
+            const TraceEvent& e = events[i];
+            out += "{\"name\": ";
+            appendJsonString(out, names[e.stage]);
+            std::snprintf(numbers, sizeof(numbers), ", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %u}",
+                          e.startNs / 1e3, e.durationNs / 1e3, e.thread);
+            out += numbers;
+            out += i + 1 < events.size() ? ",\n" : "\n";
+            if (out.size() > (1 << 20)) {
+                file << out;
+                out.clear();
+            }
+        }
+        out += "]}\n";
+        file << out;
+        return static_cast<bool>(file);
+    }
+};
+
+// Times the enclosing block as one call of `stage`
+class ProfileScope {
+private:
+    Profiler* profiler;
+
+public:
+    explicit ProfileScope(int stage) : profiler(Profiler::current()) {
+        if (profiler != nullptr) {
+            profiler->begin(stage);
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+    ~ProfileScope() {
+        if (profiler != nullptr) {
+            profiler->end();
+        }
+    }
+};
+
+#define PY2CPP_PROFILE_CONCAT_INNER(a, b) a##b
+#define PY2CPP_PROFILE_CONCAT(a, b) PY2CPP_PROFILE_CONCAT_INNER(a, b)
+
+#define PY2CPP_PROFILE_SCOPE(name)                                                              \
+    static const int PY2CPP_PROFILE_CONCAT(profileStage_, __LINE__) = Profiler::registerStage(name); \
+    ProfileScope PY2CPP_PROFILE_CONCAT(profileScope_, __LINE__)(PY2CPP_PROFILE_CONCAT(profileStage_, __LINE__))
+
+#define PY2CPP_PROFILE_COUNT(name)                                   \
+    do {                                                             \
+        if (Profiler* activeProfiler = Profiler::current()) {        \
+            static const int counterId = Profiler::registerCounter(name); \
+            activeProfiler->count(counterId);                        \
+        }                                                            \
+    } while (0)
+
+#else
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Stand-in so drivers build unchanged; they check kEnabled before using it
+class Profiler {
+public:
+    static constexpr bool kEnabled = false;
+
+    explicit Profiler(uint32_t = 0) {}
+
+    static Profiler*& current() {
+        static Profiler* none = nullptr;
+        return none;
+    }
+
+    void beginFile(const std::string&) {}
+    void merge(const Profiler&) {}
+    void printTable(std::ostream&) const {}
+
+    bool writeTrace(const std::string&) const {
+        return false;
+    }
+};
+
+#define PY2CPP_PROFILE_SCOPE(name) ((void)0)
+#define PY2CPP_PROFILE_COUNT(name) ((void)0)
+
+#endif
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "python_ast.hpp"
+
+// Which top-level functions and expressions are free of side effects. A pure
+// function only binds local names, reads its arguments and module names, and
+// calls builtins that do not print or mutate, or other pure functions. Pure
+// expressions can be evaluated in any order and on any thread, which is what
+// the --parallel lowering of comprehensions and reductions relies on.
+class PurityAnalysis {
+private:
+    std::vector<std::string_view> pureFunctions;
+    // Functions being checked; calls between them (and recursion) are assumed pure
+    std::vector<std::string_view> candidates;
+
+    static bool sameName(std::string_view a, std::string_view b) {
+        return a.data() == b.data() && a.size() == b.size();
+    }
+
+    static bool contains(const std::vector<std::string_view>& list, std::string_view name) {
+        for (std::string_view n : list) {
+            if (sameName(n, name)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Builtins that neither print nor change their arguments
+    static bool pureBuiltin(std::string_view name) {
+        static constexpr std::string_view builtins[] = {
+            "abs", "all", "any", "bool", "chr", "divmod", "enumerate", "float", "int", "len", "max",
+            "min", "ord", "pow", "range", "reversed", "round", "sorted", "str", "sum", "tuple", "zip"};
+        for (std::string_view builtin : builtins) {
+            if (name == builtin) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool pureCallee(std::string_view name) const {
+        return pureBuiltin(name) || contains(pureFunctions, name) || contains(candidates, name);
+    }
+
+    bool expressionsPure(const NodeList<Expr*>& list, std::vector<std::string_view>* names) const {
+        for (const Expr* e : list) {
+            if (!expression(e, names)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool expression(const Expr* expr, std::vector<std::string_view>* names) const {
+        if (expr == nullptr) {
+            return true;
+        }
+        switch (expr->kind) {
+            case ExprKind::Name:
+                if (names != nullptr) {
+                    names->push_back(static_cast<const NameExpr*>(expr)->id);
+                }
+                return true;
+            case ExprKind::Number:
+            case ExprKind::String:
+            case ExprKind::Bool:
+            case ExprKind::None:
+                return true;
+            case ExprKind::FString:
+                return expressionsPure(static_cast<const FStringExpr*>(expr)->parts, names);
+            case ExprKind::FormattedValue:
+                return expression(static_cast<const FormattedValueExpr*>(expr)->value, names);
+            case ExprKind::Unary:
+                return expression(static_cast<const UnaryExpr*>(expr)->operand, names);
+            case ExprKind::Binary:
+            case ExprKind::BoolOp: {
+                auto* op = static_cast<const BinaryExpr*>(expr);
+                return expression(op->left, names) && expression(op->right, names);
+            }
+            case ExprKind::Compare:
+                return expressionsPure(static_cast<const CompareExpr*>(expr)->operands, names);
+            case ExprKind::Conditional: {
+                auto* cond = static_cast<const ConditionalExpr*>(expr);
+                return expression(cond->test, names) && expression(cond->body, names) &&
+                       expression(cond->orelse, names);
+            }
+            case ExprKind::Attribute:
+                return expression(static_cast<const AttributeExpr*>(expr)->value, names);
+            case ExprKind::Subscript: {
+                auto* sub = static_cast<const SubscriptExpr*>(expr);
+                return expression(sub->value, names) && expression(sub->index, names);
+            }
+            case ExprKind::Slice: {
+                auto* slice = static_cast<const SliceExpr*>(expr);
+                return expression(slice->lower, names) && expression(slice->upper, names) &&
+                       expression(slice->step, names);
+            }
+            case ExprKind::List:
+            case ExprKind::Tuple:
+            case ExprKind::Set:
+                return expressionsPure(static_cast<const SequenceExpr*>(expr)->elements, names);
+            case ExprKind::Dict: {
+                auto* dict = static_cast<const DictExpr*>(expr);
+                return expressionsPure(dict->keys, names) && expressionsPure(dict->values, names);
+            }
+            case ExprKind::ListComp:
+            case ExprKind::SetComp:
+            case ExprKind::DictComp:
+            case ExprKind::GeneratorExp: {
+                auto* comp = static_cast<const ComprehensionExpr*>(expr);
+                for (const Comprehension* gen : comp->generators) {
+                    if (!expression(gen->iter, names) || !expressionsPure(gen->ifs, names)) {
+                        return false;
+                    }
+                }
+                return expression(comp->element, names) && expression(comp->value, names);
+            }
+            case ExprKind::Call: {
+                // Methods may mutate their object, so only plain calls qualify
+                auto* call = static_cast<const CallExpr*>(expr);
+                if (call->func->kind != ExprKind::Name || !pureCallee(static_cast<const NameExpr*>(call->func)->id)) {
+                    return false;
+                }
+                for (const Expr* arg : call->args) {
+                    const Expr* value = arg->kind == ExprKind::Keyword ? static_cast<const KeywordExpr*>(arg)->value : arg;
+                    if (value->kind == ExprKind::Starred || !expression(value, names)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    // Plain names, or tuples of them, rebound in the function itself
+    static bool localTarget(const Expr* target) {
+        if (target->kind == ExprKind::Name) {
+            return true;
+        }
+        if (target->kind != ExprKind::Tuple && target->kind != ExprKind::List) {
+            return false;
+        }
+        for (const Expr* element : static_cast<const SequenceExpr*>(target)->elements) {
+            if (!localTarget(element)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool blockPure(const StmtList& body) const {
+        for (const Stmt* stmt : body) {
+            if (!statementPure(stmt)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool statementPure(const Stmt* stmt) const {
+        switch (stmt->kind) {
+            case StmtKind::Pass:
+            case StmtKind::Break:
+            case StmtKind::Continue:
+            case StmtKind::Comment:
+                return true;
+            case StmtKind::Expr:
+                // Only docstrings; a bare expression is there for its effect
+                return static_cast<const ExprStmt*>(stmt)->value->kind == ExprKind::String;
+            case StmtKind::Assign: {
+                auto* assign = static_cast<const AssignStmt*>(stmt);
+                for (const Expr* target : assign->targets) {
+                    if (!localTarget(target)) {
+                        return false;
+                    }
+                }
+                return expression(assign->value, nullptr);
+            }
+            case StmtKind::AugAssign: {
+                auto* assign = static_cast<const AugAssignStmt*>(stmt);
+                return assign->target->kind == ExprKind::Name && expression(assign->value, nullptr);
+            }
+            case StmtKind::AnnAssign: {
+                auto* assign = static_cast<const AnnAssignStmt*>(stmt);
+                return assign->target->kind == ExprKind::Name && expression(assign->value, nullptr);
+            }
+            case StmtKind::Return:
+                return expression(static_cast<const ValueStmt*>(stmt)->value, nullptr);
+            case StmtKind::If:
+            case StmtKind::While: {
+                auto* ifStmt = static_cast<const IfStmt*>(stmt);
+                return expression(ifStmt->test, nullptr) && blockPure(ifStmt->body) && blockPure(ifStmt->orelse);
+            }
+            case StmtKind::For: {
+                auto* forStmt = static_cast<const ForStmt*>(stmt);
+                return localTarget(forStmt->target) && expression(forStmt->iter, nullptr) &&
+                       blockPure(forStmt->body) && blockPure(forStmt->orelse);
+            }
+            default:
+                return false;
+        }
+    }
+
+    static bool candidate(const FunctionDef* def) {
+        if (!def->decorators.empty()) {
+            return false;
+        }
+        for (const Param* param : def->params) {
+            if (param->kind != Param::Normal) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool functionPure(const FunctionDef* def) const {
+        for (const Param* param : def->params) {
+            if (!expression(param->defaultValue, nullptr)) {
+                return false;
+            }
+        }
+        return blockPure(def->body);
+    }
+
+public:
+    // Whole modules: functions may call each other in any order, so every
+    // candidate starts out pure and is dropped until nothing changes
+    void analyze(const StmtList& module) {
+        std::vector<const FunctionDef*> defs;
+        for (const Stmt* stmt : module) {
+            if (stmt->kind == StmtKind::FunctionDef && candidate(static_cast<const FunctionDef*>(stmt))) {
+                defs.push_back(static_cast<const FunctionDef*>(stmt));
+                candidates.push_back(defs.back()->name);
+            }
+        }
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t i = 0; i < defs.size(); ++i) {
+                if (!functionPure(defs[i])) {
+                    defs.erase(defs.begin() + static_cast<std::ptrdiff_t>(i));
+                    candidates.erase(candidates.begin() + static_cast<std::ptrdiff_t>(i));
+                    changed = true;
+                    --i;
+                }
+            }
+        }
+        pureFunctions.insert(pureFunctions.end(), candidates.begin(), candidates.end());
+        candidates.clear();
+    }
+
+    // Streamed modules see one function at a time; it may call itself and the
+    // pure functions defined before it
+    void analyzeFunction(const FunctionDef* def) {
+        if (!candidate(def)) {
+            return;
+        }
+        candidates.push_back(def->name);
+        bool pure = functionPure(def);
+        candidates.clear();
+        if (pure) {
+            pureFunctions.push_back(def->name);
+        }
+    }
+
+    bool isPureFunction(std::string_view name) const {
+        return contains(pureFunctions, name);
+    }
+
+    // Appends every name the expression reads to `names` when given
+    bool isPure(const Expr* expr, std::vector<std::string_view>* names = nullptr) const {
+        return expression(expr, names);
+    }
+
+    void clear() {
+        pureFunctions.clear();
+        candidates.clear();
+    }
+};
@@ -0,0 +1,2872 @@
+#pragma once
+
+// Runtime support for code generated by py2cpp: the List, Dict and Set
+// containers translated code builds, print() and f-string formatting with
+// Python's str()/repr() output, written through a buffered stdout, and the
+// PyValue type used where a value's type is only known at run time. py2cpp
+// writes this header next to every file it generates.
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if defined(PY2CPP_PARALLEL_STL)
+#include <execution>
+#include <numeric>
+#endif
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// Holds a Python value whose type is only known at run time
+using PyValue = std::variant<std::monostate, bool, int64_t, double, std::string>;
+
+namespace py2cpp {
+
+namespace detail {
+
+// Final mix of MurmurHash3, so patterned keys (multiples of 2^k, pointers)
+// still spread over the whole table
+inline uint64_t mixHash(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+}  // namespace detail
+
+template <typename T, typename = void>
+struct Hash {
+    uint64_t operator()(const T& value) const {
+        return detail::mixHash(static_cast<uint64_t>(std::hash<T>{}(value)));
+    }
+};
+
+template <typename... T>
+struct Hash<std::tuple<T...>> {
+    uint64_t operator()(const std::tuple<T...>& value) const {
+        return std::apply(
+            [](const auto&... element) {
+                uint64_t h = 0x345678;
+                ((h = detail::mixHash(h ^ Hash<std::decay_t<decltype(element)>>{}(element))), ...);
+                return h;
+            },
+            value);
+    }
+};
+
+template <typename A, typename B>
+struct Hash<std::pair<A, B>> {
+    uint64_t operator()(const std::pair<A, B>& value) const {
+        return detail::mixHash(Hash<A>{}(value.first) ^ (Hash<B>{}(value.second) * 0x9e3779b97f4a7c15ULL));
+    }
+};
+
+namespace detail {
+
+// Index of the highest set bit of a non-zero value
+inline unsigned highestBit(size_t value) {
+#if defined(__GNUC__)
+    return static_cast<unsigned>(sizeof(unsigned long long) * 8 - 1) -
+           static_cast<unsigned>(__builtin_clzll(static_cast<unsigned long long>(value)));
+#else
+    unsigned bit = 0;
+    while (value >>= 1) {
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+// A vector whose elements never move: chunk c holds 8 << c elements, so
+// growing allocates a new chunk instead of relocating the old ones. A
+// reference to d[b] taken before `d[a] = d[b]` inserts a stays valid, as it
+// would with std::map. Finding an element is a count of leading zeros.
+template <typename T>
+class StableVector {
+private:
+    static constexpr unsigned kFirstShift = 3;
+
+    std::vector<T*> chunks;
+    size_t count = 0;
+    size_t room = 0;
+
+    static unsigned chunkOf(size_t index) {
+        return highestBit((index >> kFirstShift) + 1);
+    }
+
+    static size_t chunkStart(unsigned chunk) {
+        return ((size_t(1) << chunk) - 1) << kFirstShift;
+    }
+
+    void grow() {
+        size_t length = chunkSize(static_cast<unsigned>(chunks.size()));
+        chunks.push_back(std::allocator<T>().allocate(length));
+        room += length;
+    }
+
+    void release() {
+        truncate(0);
+        for (size_t c = 0; c < chunks.size(); ++c) {
+            std::allocator<T>().deallocate(chunks[c], chunkSize(static_cast<unsigned>(c)));
+        }
+        chunks.clear();
+        room = 0;
+    }
+
+public:
+    StableVector() = default;
+
+    StableVector(const StableVector& other) {
+        reserve(other.count);
+        for (size_t i = 0; i < other.count; ++i) {
+            push_back(other[i]);
+        }
+    }
+
+    StableVector(StableVector&& other) noexcept
+        : chunks(std::move(other.chunks)), count(other.count), room(other.room) {
+        other.chunks.clear();
+        other.count = 0;
+        other.room = 0;
+    }
+
+    StableVector& operator=(StableVector other) noexcept {
+        std::swap(chunks, other.chunks);
+        std::swap(count, other.count);
+        std::swap(room, other.room);
+        return *this;
+    }
+
+    ~StableVector() {
+        release();
+    }
+
+    static size_t chunkSize(unsigned chunk) {
+        return size_t(1) << (chunk + kFirstShift);
+    }
+
+    T& operator[](size_t index) {
+        unsigned chunk = chunkOf(index);
+        return chunks[chunk][index - chunkStart(chunk)];
+    }
+
+    const T& operator[](size_t index) const {
+        unsigned chunk = chunkOf(index);
+        return chunks[chunk][index - chunkStart(chunk)];
+    }
+
+    T* const* chunkData() const {
+        return chunks.data();
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    size_t capacity() const {
+        return room;
+    }
+
+    void reserve(size_t wanted) {
+        while (room < wanted) {
+            grow();
+        }
+    }
+
+    void push_back(T value) {
+        if (count == room) {
+            grow();
+        }
+        unsigned chunk = chunkOf(count);
+        ::new (static_cast<void*>(chunks[chunk] + (count - chunkStart(chunk)))) T(std::move(value));
+        ++count;
+    }
+
+    void pop_back() {
+        (*this)[--count].~T();
+    }
+
+    // Destroys the elements from `length` on; the chunks stay allocated
+    void truncate(size_t length) {
+        while (count > length) {
+            pop_back();
+        }
+    }
+
+    void clear() {
+        truncate(0);
+    }
+
+    // The chunk holding element `index`, and its offset in that chunk
+    static unsigned chunkFor(size_t index, size_t& offset) {
+        unsigned chunk = chunkOf(index);
+        offset = index - chunkStart(chunk);
+        return chunk;
+    }
+};
+
+// Index shared by Dict and Set: entries are kept in insertion order, as in
+// CPython's dict, in a StableVector, so inserting never moves an existing
+// one, and an open-addressing table of 8-byte slots maps hashes to entry
+// positions with linear probing. A slot packs 32 bits of the hash with the
+// entry position plus one, so most mismatches are rejected without touching
+// the entry. Erasing leaves a tombstone slot and a hole in the entries that
+// iteration skips; holes are squeezed out once they make up half the entries
+// or the table is rebuilt.
+template <typename Entry, typename Key, typename KeyOf, typename H>
+class FlatTable {
+protected:
+    static constexpr uint64_t kErased = 0;  // hash of an erased entry
+    static constexpr uint32_t kTombstone = 0xFFFFFFFFu;
+    static constexpr size_t kMissing = static_cast<size_t>(-1);
+    static constexpr size_t kMinSlots = 8;
+
+    StableVector<Entry> entries;
+    std::vector<uint64_t> hashes;
+    std::vector<uint64_t> slots;
+    size_t live = 0;
+    size_t tombstones = 0;
+    unsigned shift = 64;  // slots.size() == 2^(64 - shift)
+
+    static uint64_t hashOf(const Key& key) {
+        uint64_t h = H{}(key);
+        return h == kErased ? 1 : h;
+    }
+
+    size_t home(uint64_t h) const {
+        return static_cast<size_t>(h >> shift);
+    }
+
+    static uint64_t slotFor(uint64_t h, size_t index) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(h)) << 32) | (index + 1);
+    }
+
+    size_t findSlot(const Key& key, uint64_t h) const {
+        if (slots.empty()) {
+            return kMissing;
+        }
+        size_t mask = slots.size() - 1;
+        uint32_t tag = static_cast<uint32_t>(h);
+        for (size_t i = home(h);; i = (i + 1) & mask) {
+            uint64_t slot = slots[i];
+            if (slot == 0) {
+                return kMissing;
+            }
+            uint32_t position = static_cast<uint32_t>(slot);
+            if (position != kTombstone && static_cast<uint32_t>(slot >> 32) == tag &&
+                KeyOf{}(entries[position - 1]) == key) {
+                return i;
+            }
+        }
+    }
+
+    size_t findEntry(const Key& key) const {
+        size_t slot = findSlot(key, hashOf(key));
+        return slot == kMissing ? kMissing : static_cast<uint32_t>(slots[slot]) - 1;
+    }
+
+    // Position of key's entry and whether it was added; make() builds a missing entry
+    template <typename Make>
+    std::pair<size_t, bool> findOrAdd(const Key& key, Make&& make) {
+        uint64_t h = hashOf(key);
+        size_t slot = findSlot(key, h);
+        if (slot != kMissing) {
+            return {static_cast<uint32_t>(slots[slot]) - 1, false};
+        }
+        if ((live + tombstones + 1) * 4 > slots.size() * 3) {
+            rebuild(slotCountFor(live + 1));
+        }
+        size_t index = entries.size();
+        if (index >= kTombstone - 1) {
+            throw std::length_error("py2cpp: container too large");
+        }
+        entries.push_back(make());
+        hashes.push_back(h);
+        ++live;
+        size_t mask = slots.size() - 1;
+        size_t i = home(h);
+        while (slots[i] != 0 && static_cast<uint32_t>(slots[i]) != kTombstone) {
+            i = (i + 1) & mask;
+        }
+        if (slots[i] != 0) {
+            --tombstones;
+        }
+        slots[i] = slotFor(h, index);
+        return {index, true};
+    }
+
+    bool eraseKey(const Key& key) {
+        size_t slot = findSlot(key, hashOf(key));
+        if (slot == kMissing) {
+            return false;
+        }
+        size_t index = static_cast<uint32_t>(slots[slot]) - 1;
+        slots[slot] = kTombstone;
+        ++tombstones;
+        --live;
+        if (index + 1 == entries.size()) {
+            entries.pop_back();
+            hashes.pop_back();
+        } else {
+            hashes[index] = kErased;
+            if ((entries.size() - live) * 2 > entries.size()) {
+                rebuild(slots.size());
+            }
+        }
+        return true;
+    }
+
+    // Rebuilt tables start at most half full
+    static size_t slotCountFor(size_t count) {
+        size_t wanted = kMinSlots;
+        while (wanted < count * 2) {
+            wanted *= 2;
+        }
+        return wanted;
+    }
+
+    // Drops erased entries, keeping order, and re-inserts every entry into a
+    // table of slotCount slots using the stored hashes
+    void rebuild(size_t slotCount) {
+        if (live != entries.size()) {
+            size_t out = 0;
+            for (size_t i = 0; i < entries.size(); ++i) {
+                if (hashes[i] == kErased) {
+                    continue;
+                }
+                if (out != i) {
+                    entries[out] = std::move(entries[i]);
+                    hashes[out] = hashes[i];
+                }
+                ++out;
+            }
+            entries.truncate(out);
+            hashes.resize(out);
+        }
+        slots.assign(slotCount, 0);
+        tombstones = 0;
+        shift = 64;
+        for (size_t n = slotCount; n > 1; n >>= 1) {
+            --shift;
+        }
+        size_t mask = slotCount - 1;
+        for (size_t e = 0; e < entries.size(); ++e) {
+            size_t i = home(hashes[e]);
+            while (slots[i] != 0) {
+                i = (i + 1) & mask;
+            }
+            slots[i] = slotFor(hashes[e], e);
+        }
+    }
+
+public:
+    // Walks the entries in insertion order, stepping over erased ones
+    template <typename Value>
+    class Iterator {
+    private:
+        Value* entry = nullptr;
+        Value* chunkEnd = nullptr;
+        Value* const* nextChunk = nullptr;
+        unsigned chunk = 0;
+        const uint64_t* hash = nullptr;
+        const uint64_t* hashEnd = nullptr;
+
+        void advance() {
+            ++entry;
+            ++hash;
+            if (entry == chunkEnd && hash != hashEnd) {
+                entry = *nextChunk++;
+                chunkEnd = entry + StableVector<Entry>::chunkSize(++chunk);
+            }
+        }
+
+        void skipErased() {
+            while (hash != hashEnd && *hash == kErased) {
+                advance();
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::remove_const_t<Value>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Value*;
+        using reference = Value&;
+
+        Iterator() = default;
+
+        // The entry at `index` of `count`, whose hashes start at `hashes`
+        Iterator(Value* const* chunks, size_t index, size_t count, const uint64_t* hashes)
+            : hash(hashes + index), hashEnd(hashes + count) {
+            if (index < count) {
+                size_t offset = 0;
+                chunk = StableVector<Entry>::chunkFor(index, offset);
+                entry = chunks[chunk] + offset;
+                chunkEnd = chunks[chunk] + StableVector<Entry>::chunkSize(chunk);
+                nextChunk = chunks + chunk + 1;
+                skipErased();
+            }
+        }
+
+        template <typename Other, typename = std::enable_if_t<std::is_convertible_v<Other*, Value*>>>
+        Iterator(const Iterator<Other>& other)
+            : entry(other.entry), chunkEnd(other.chunkEnd), nextChunk(other.nextChunk), chunk(other.chunk),
+              hash(other.hash), hashEnd(other.hashEnd) {}
+
+        Value& operator*() const {
+            return *entry;
+        }
+
+        Value* operator->() const {
+            return entry;
+        }
+
+        Iterator& operator++() {
+            advance();
+            skipErased();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        // Positions are told apart by their hash, which end() has too
+        friend bool operator==(const Iterator& a, const Iterator& b) {
+            return a.hash == b.hash;
+        }
+
+        friend bool operator!=(const Iterator& a, const Iterator& b) {
+            return a.hash != b.hash;
+        }
+
+        template <typename>
+        friend class Iterator;
+    };
+
+protected:
+    // Iterator at entry `index`, or end() for entries.size()
+    template <typename Value>
+    Iterator<Value> iteratorAt(size_t index) const {
+        return Iterator<Value>(entries.chunkData(), index, entries.size(), hashes.data());
+    }
+
+public:
+    size_t size() const {
+        return live;
+    }
+
+    bool empty() const {
+        return live == 0;
+    }
+
+    void clear() {
+        entries.clear();
+        hashes.clear();
+        slots.clear();
+        live = 0;
+        tombstones = 0;
+        shift = 64;
+    }
+
+    void reserve(size_t count) {
+        entries.reserve(count);
+        hashes.reserve(count);
+        size_t wanted = slotCountFor(count);
+        if (wanted > slots.size()) {
+            rebuild(wanted);
+        }
+    }
+
+    size_t count(const Key& key) const {
+        return findEntry(key) != kMissing ? 1 : 0;
+    }
+
+    bool contains(const Key& key) const {
+        return findEntry(key) != kMissing;
+    }
+
+    // Bytes held by the entry vectors and the slot table
+    size_t memoryUsage() const {
+        return entries.capacity() * sizeof(Entry) + hashes.capacity() * sizeof(uint64_t) +
+               slots.capacity() * sizeof(uint64_t);
+    }
+};
+
+struct FirstOf {
+    template <typename P>
+    const auto& operator()(const P& pair) const {
+        return pair.first;
+    }
+};
+
+struct Itself {
+    template <typename T>
+    const T& operator()(const T& value) const {
+        return value;
+    }
+};
+
+}  // namespace detail
+
+// dict: a flat hash map that iterates in insertion order. Keeps the parts of
+// the std::map interface generated code uses alongside dict's own methods.
+template <typename K, typename V, typename H = Hash<K>>
+class Dict : public detail::FlatTable<std::pair<K, V>, K, detail::FirstOf, H> {
+private:
+    using Table = detail::FlatTable<std::pair<K, V>, K, detail::FirstOf, H>;
+    using Table::entries;
+    using Table::hashes;
+    using Table::kMissing;
+
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using iterator = typename Table::template Iterator<value_type>;
+    using const_iterator = typename Table::template Iterator<const value_type>;
+
+    Dict() = default;
+
+    Dict(std::initializer_list<value_type> items) {
+        this->reserve(items.size());
+        for (const value_type& item : items) {
+            insert_or_assign(item.first, item.second);
+        }
+    }
+
+    template <typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+    Dict(It first, It last) {
+        for (; first != last; ++first) {
+            insert_or_assign(first->first, first->second);
+        }
+    }
+
+    iterator begin() {
+        return this->template iteratorAt<value_type>(0);
+    }
+
+    iterator end() {
+        return this->template iteratorAt<value_type>(entries.size());
+    }
+
+    const_iterator begin() const {
+        return this->template iteratorAt<const value_type>(0);
+    }
+
+    const_iterator end() const {
+        return this->template iteratorAt<const value_type>(entries.size());
+    }
+
+    iterator find(const K& key) {
+        size_t index = this->findEntry(key);
+        return index == kMissing ? end() : this->template iteratorAt<value_type>(index);
+    }
+
+    const_iterator find(const K& key) const {
+        size_t index = this->findEntry(key);
+        return index == kMissing ? end() : this->template iteratorAt<const value_type>(index);
+    }
+
+    V& operator[](const K& key) {
+        return entries[this->findOrAdd(key, [&] { return value_type(key, V()); }).first].second;
+    }
+
+    V& operator[](K&& key) {
+        size_t index = this->findOrAdd(key, [&] { return value_type(std::move(key), V()); }).first;
+        return entries[index].second;
+    }
+
+    // d[key] on a missing key raises KeyError, which generated code maps to std::out_of_range
+    V& at(const K& key) {
+        size_t index = this->findEntry(key);
+        if (index == kMissing) {
+            throw std::out_of_range("KeyError");
+        }
+        return entries[index].second;
+    }
+
+    const V& at(const K& key) const {
+        size_t index = this->findEntry(key);
+        if (index == kMissing) {
+            throw std::out_of_range("KeyError");
+        }
+        return entries[index].second;
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(const K& key, Args&&... args) {
+        auto [index, added] = this->findOrAdd(
+            key, [&] { return value_type(std::piecewise_construct, std::forward_as_tuple(key),
+                                         std::forward_as_tuple(std::forward<Args>(args)...)); });
+        return {this->template iteratorAt<value_type>(index), added};
+    }
+
+    std::pair<iterator, bool> insert(const value_type& item) {
+        return emplace(item.first, item.second);
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(const K& key, M&& value) {
+        auto [index, added] = this->findOrAdd(key, [&] { return value_type(key, V(value)); });
+        if (!added) {
+            entries[index].second = std::forward<M>(value);
+        }
+        return {this->template iteratorAt<value_type>(index), added};
+    }
+
+    size_t erase(const K& key) {
+        return this->eraseKey(key) ? 1 : 0;
+    }
+
+    // dict.get(key, default)
+    V get(const K& key, const V& fallback = V()) const {
+        size_t index = this->findEntry(key);
+        return index == kMissing ? fallback : entries[index].second;
+    }
+
+    // dict.pop(key); raises KeyError when missing
+    V pop(const K& key) {
+        size_t index = this->findEntry(key);
+        if (index == kMissing) {
+            throw std::out_of_range("KeyError");
+        }
+        V value = std::move(entries[index].second);
+        this->eraseKey(key);
+        return value;
+    }
+
+    V pop(const K& key, const V& fallback) {
+        size_t index = this->findEntry(key);
+        if (index == kMissing) {
+            return fallback;
+        }
+        V value = std::move(entries[index].second);
+        this->eraseKey(key);
+        return value;
+    }
+
+    V& setdefault(const K& key, const V& fallback = V()) {
+        return entries[this->findOrAdd(key, [&] { return value_type(key, fallback); }).first].second;
+    }
+
+    void update(const Dict& other) {
+        for (const value_type& item : other) {
+            insert_or_assign(item.first, item.second);
+        }
+    }
+
+    Dict copy() const {
+        return *this;
+    }
+
+    // dict.keys() and dict.values() as lightweight views
+    template <bool Keys>
+    class View {
+    private:
+        const Dict* dict;
+
+    public:
+        class iterator {
+        private:
+            const_iterator it;
+
+        public:
+            explicit iterator(const_iterator it) : it(it) {}
+
+            const auto& operator*() const {
+                if constexpr (Keys) {
+                    return it->first;
+                } else {
+                    return it->second;
+                }
+            }
+
+            iterator& operator++() {
+                ++it;
+                return *this;
+            }
+
+            bool operator!=(const iterator& other) const {
+                return it != other.it;
+            }
+
+            bool operator==(const iterator& other) const {
+                return it == other.it;
+            }
+        };
+
+        explicit View(const Dict* dict) : dict(dict) {}
+
+        iterator begin() const {
+            return iterator(dict->begin());
+        }
+
+        iterator end() const {
+            return iterator(dict->end());
+        }
+
+        size_t size() const {
+            return dict->size();
+        }
+    };
+
+    View<true> keys() const {
+        return View<true>(this);
+    }
+
+    View<false> values() const {
+        return View<false>(this);
+    }
+
+    const Dict& items() const {
+        return *this;
+    }
+
+    // Equal when both hold the same pairs, whatever their order
+    friend bool operator==(const Dict& a, const Dict& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (const value_type& item : a) {
+            auto it = b.find(item.first);
+            if (it == b.end() || !(it->second == item.second)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    friend bool operator!=(const Dict& a, const Dict& b) {
+        return !(a == b);
+    }
+};
+
+// set: the same flat table holding bare keys. Iterates in insertion order,
+// which is one of the orders Python leaves a set free to use.
+template <typename T, typename H = Hash<T>>
+class Set : public detail::FlatTable<T, T, detail::Itself, H> {
+private:
+    using Table = detail::FlatTable<T, T, detail::Itself, H>;
+    using Table::entries;
+    using Table::hashes;
+    using Table::kMissing;
+
+public:
+    using key_type = T;
+    using value_type = T;
+    using iterator = typename Table::template Iterator<const T>;
+    using const_iterator = iterator;
+
+    Set() = default;
+
+    Set(std::initializer_list<T> items) {
+        this->reserve(items.size());
+        for (const T& item : items) {
+            insert(item);
+        }
+    }
+
+    template <typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+    Set(It first, It last) {
+        for (; first != last; ++first) {
+            insert(*first);
+        }
+    }
+
+    iterator begin() const {
+        return this->template iteratorAt<const T>(0);
+    }
+
+    iterator end() const {
+        return this->template iteratorAt<const T>(entries.size());
+    }
+
+    iterator find(const T& key) const {
+        size_t index = this->findEntry(key);
+        return index == kMissing ? end() : this->template iteratorAt<const T>(index);
+    }
+
+    std::pair<iterator, bool> insert(const T& value) {
+        auto [index, added] = this->findOrAdd(value, [&] { return value; });
+        return {this->template iteratorAt<const T>(index), added};
+    }
+
+    std::pair<iterator, bool> insert(T&& value) {
+        auto [index, added] = this->findOrAdd(value, [&] { return std::move(value); });
+        return {this->template iteratorAt<const T>(index), added};
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        return insert(T(std::forward<Args>(args)...));
+    }
+
+    size_t erase(const T& value) {
+        return this->eraseKey(value) ? 1 : 0;
+    }
+
+    void add(const T& value) {
+        insert(value);
+    }
+
+    void discard(const T& value) {
+        this->eraseKey(value);
+    }
+
+    // set.remove(); raises KeyError when missing
+    void remove(const T& value) {
+        if (!this->eraseKey(value)) {
+            throw std::out_of_range("KeyError");
+        }
+    }
+
+    template <typename Iterable>
+    void update(const Iterable& values) {
+        for (const auto& value : values) {
+            insert(value);
+        }
+    }
+
+    Set copy() const {
+        return *this;
+    }
+
+    friend bool operator==(const Set& a, const Set& b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (const T& value : a) {
+            if (!b.contains(value)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    friend bool operator!=(const Set& a, const Set& b) {
+        return !(a == b);
+    }
+};
+
+namespace detail {
+
+// Elements kept inside a List before it allocates. Only scalar element types
+// get a buffer: they are complete wherever the List is named, while a class
+// can hold a List of itself.
+template <typename T>
+constexpr size_t inlineCapacity() {
+    if constexpr (std::is_class_v<T> || std::is_union_v<T>) {
+        return 0;
+    } else {
+        return sizeof(T) >= 32 ? 0 : (32 / sizeof(T) > 16 ? 16 : 32 / sizeof(T));
+    }
+}
+
+template <typename T, size_t N>
+struct InlineStorage {
+    alignas(T) unsigned char bytes[N * sizeof(T)];
+
+    InlineStorage() {}
+
+    T* data() {
+        return std::launder(reinterpret_cast<T*>(bytes));
+    }
+
+    const T* data() const {
+        return std::launder(reinterpret_cast<const T*>(bytes));
+    }
+};
+
+template <typename T>
+struct InlineStorage<T, 0> {
+    T* data() const {
+        return nullptr;
+    }
+};
+
+}  // namespace detail
+
+template <typename T, size_t N = detail::inlineCapacity<T>()>
+class List;
+
+namespace detail {
+
+// Types a List moves by copying bytes: trivially copyable ones, and Lists of
+// them once a copied List that used its inline buffer is re-aimed at its own
+template <typename T>
+struct IsRelocatable : std::is_trivially_copyable<T> {};
+template <typename T, size_t N>
+struct IsRelocatable<List<T, N>> : IsRelocatable<T> {};
+
+}  // namespace detail
+
+// list: a vector that keeps its first N elements inline, so the many short
+// lists translated code builds (pairs of coordinates, small rows) never touch
+// the heap. Provides the std::vector interface plus list's own methods.
+template <typename T, size_t N>
+class List {
+private:
+    detail::InlineStorage<T, N> local;
+    T* items;
+    size_t length = 0;
+    size_t room = N;
+
+    template <typename, size_t>
+    friend class List;
+
+    bool onHeap() {
+        return items != local.data();
+    }
+
+    // Moves count elements into raw storage at `to`, ending the originals
+    static void relocate(T* from, size_t count, T* to) {
+        if constexpr (detail::IsRelocatable<T>::value) {
+            if (count > 0) {
+                std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), count * sizeof(T));
+            }
+            if constexpr (!std::is_trivially_copyable_v<T>) {
+                for (size_t i = 0; i < count; ++i) {
+                    to[i].reaim(from[i]);
+                }
+            }
+        } else {
+            std::uninitialized_move(from, from + count, to);
+            std::destroy(from, from + count);
+        }
+    }
+
+    // After a byte copy of original, points back at this List's own inline buffer
+    void reaim(const List& original) {
+        if (items == original.local.data()) {
+            items = local.data();
+        }
+    }
+
+    static T* allocate(size_t count) {
+        return std::allocator<T>().allocate(count);
+    }
+
+    void release() {
+        if (onHeap()) {
+            std::allocator<T>().deallocate(items, room);
+        }
+    }
+
+    // Moves the elements into a buffer of newRoom, constructing the element at
+    // `at` from args first so arguments aliasing an element stay valid
+    template <typename... Args>
+    T* grow(size_t newRoom, size_t at, Args&&... args) {
+        T* fresh = allocate(newRoom);
+        T* made = fresh + at;
+        ::new (static_cast<void*>(made)) T(std::forward<Args>(args)...);
+        relocate(items, at, fresh);
+        relocate(items + at, length - at, made + 1);
+        release();
+        items = fresh;
+        room = newRoom;
+        ++length;
+        return made;
+    }
+
+    size_t nextRoom(size_t needed) const {
+        size_t doubled = room * 2;
+        return doubled > needed ? doubled : (needed < 4 ? 4 : needed);
+    }
+
+    void takeFrom(List&& other) {
+        if (other.onHeap()) {
+            items = other.items;
+            room = other.room;
+            length = other.length;
+            other.items = other.local.data();
+            other.room = N;
+            other.length = 0;
+            return;
+        }
+        std::uninitialized_move(other.items, other.items + other.length, items);
+        length = other.length;
+        other.clear();
+    }
+
+    size_t normalize(int64_t index) const {
+        int64_t position = index < 0 ? index + static_cast<int64_t>(length) : index;
+        if (position < 0 || position >= static_cast<int64_t>(length)) {
+            throw std::out_of_range("IndexError");
+        }
+        return static_cast<size_t>(position);
+    }
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using iterator = T*;
+    using const_iterator = const T*;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    List() : items(local.data()) {}
+
+    List(std::initializer_list<T> values) : items(local.data()) {
+        assign(values.begin(), values.end());
+    }
+
+    explicit List(size_t count) : items(local.data()) {
+        resize(count);
+    }
+
+    List(size_t count, const T& value) : items(local.data()) {
+        resize(count, value);
+    }
+
+    template <typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+    List(It first, It last) : items(local.data()) {
+        assign(first, last);
+    }
+
+    List(const List& other) : items(local.data()) {
+        assign(other.begin(), other.end());
+    }
+
+    List(List&& other) noexcept(std::is_nothrow_move_constructible_v<T>) : items(local.data()) {
+        takeFrom(std::move(other));
+    }
+
+    List& operator=(const List& other) {
+        if (this != &other) {
+            assign(other.begin(), other.end());
+        }
+        return *this;
+    }
+
+    List& operator=(List&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+        if (this != &other) {
+            clear();
+            release();
+            items = local.data();
+            room = N;
+            takeFrom(std::move(other));
+        }
+        return *this;
+    }
+
+    ~List() {
+        std::destroy(items, items + length);
+        release();
+    }
+
+    template <typename It>
+    void assign(It first, It last) {
+        clear();
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag,
+                                        typename std::iterator_traits<It>::iterator_category>) {
+            reserve(static_cast<size_t>(std::distance(first, last)));
+        }
+        for (; first != last; ++first) {
+            emplace_back(*first);
+        }
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    bool empty() const {
+        return length == 0;
+    }
+
+    size_t capacity() const {
+        return room;
+    }
+
+    T* data() {
+        return items;
+    }
+
+    const T* data() const {
+        return items;
+    }
+
+    iterator begin() {
+        return items;
+    }
+
+    iterator end() {
+        return items + length;
+    }
+
+    const_iterator begin() const {
+        return items;
+    }
+
+    const_iterator end() const {
+        return items + length;
+    }
+
+    reverse_iterator rbegin() {
+        return reverse_iterator(end());
+    }
+
+    reverse_iterator rend() {
+        return reverse_iterator(begin());
+    }
+
+    const_reverse_iterator rbegin() const {
+        return const_reverse_iterator(end());
+    }
+
+    const_reverse_iterator rend() const {
+        return const_reverse_iterator(begin());
+    }
+
+    T& operator[](size_t index) {
+        return items[index];
+    }
+
+    const T& operator[](size_t index) const {
+        return items[index];
+    }
+
+    T& at(size_t index) {
+        if (index >= length) {
+            throw std::out_of_range("IndexError");
+        }
+        return items[index];
+    }
+
+    const T& at(size_t index) const {
+        if (index >= length) {
+            throw std::out_of_range("IndexError");
+        }
+        return items[index];
+    }
+
+    // xs[i] where i may be negative; counts from the end and raises IndexError like Python
+    T& item(int64_t index) {
+        return items[normalize(index)];
+    }
+
+    const T& item(int64_t index) const {
+        return items[normalize(index)];
+    }
+
+    T& front() {
+        return items[0];
+    }
+
+    const T& front() const {
+        return items[0];
+    }
+
+    T& back() {
+        return items[length - 1];
+    }
+
+    const T& back() const {
+        return items[length - 1];
+    }
+
+    void reserve(size_t count) {
+        if (count <= room) {
+            return;
+        }
+        T* fresh = allocate(count);
+        relocate(items, length, fresh);
+        release();
+        items = fresh;
+        room = count;
+    }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (length == room) {
+            return *grow(nextRoom(length + 1), length, std::forward<Args>(args)...);
+        }
+        T* made = ::new (static_cast<void*>(items + length)) T(std::forward<Args>(args)...);
+        ++length;
+        return *made;
+    }
+
+    void push_back(const T& value) {
+        emplace_back(value);
+    }
+
+    void push_back(T&& value) {
+        emplace_back(std::move(value));
+    }
+
+    void pop_back() {
+        --length;
+        std::destroy_at(items + length);
+    }
+
+    void clear() {
+        std::destroy(items, items + length);
+        length = 0;
+    }
+
+    void resize(size_t count) {
+        reserve(count);
+        while (length < count) {
+            emplace_back();
+        }
+        while (length > count) {
+            pop_back();
+        }
+    }
+
+    void resize(size_t count, const T& value) {
+        if (count > room) {
+            T copy = value;
+            reserve(count);
+            while (length < count) {
+                emplace_back(copy);
+            }
+        }
+        while (length < count) {
+            emplace_back(value);
+        }
+        while (length > count) {
+            pop_back();
+        }
+    }
+
+    iterator insert(const_iterator position, const T& value) {
+        size_t at = static_cast<size_t>(position - items);
+        if (length == room) {
+            return grow(nextRoom(length + 1), at, value);
+        }
+        T copy = value;
+        emplace_back(std::move(copy));
+        std::rotate(items + at, items + length - 1, items + length);
+        return items + at;
+    }
+
+    template <typename It, typename = std::enable_if_t<!std::is_integral_v<It>>>
+    iterator insert(const_iterator position, It first, It last) {
+        size_t at = static_cast<size_t>(position - items);
+        size_t before = length;
+        for (; first != last; ++first) {
+            emplace_back(*first);
+        }
+        std::rotate(items + at, items + before, items + length);
+        return items + at;
+    }
+
+    iterator erase(const_iterator position) {
+        return erase(position, position + 1);
+    }
+
+    iterator erase(const_iterator first, const_iterator last) {
+        T* from = items + (first - items);
+        T* to = items + (last - items);
+        T* kept = std::move(to, items + length, from);
+        std::destroy(kept, items + length);
+        length = static_cast<size_t>(kept - items);
+        return from;
+    }
+
+    // list.append(x), list.extend(xs)
+    void append(const T& value) {
+        emplace_back(value);
+    }
+
+    void append(T&& value) {
+        emplace_back(std::move(value));
+    }
+
+    template <typename Iterable>
+    void extend(const Iterable& values) {
+        if constexpr (std::is_same_v<Iterable, List>) {
+            if (&values == this) {
+                List copy = values;
+                extend(copy);
+                return;
+            }
+        }
+        insert(end(), std::begin(values), std::end(values));
+    }
+
+    // list.pop() and list.pop(i); raise IndexError when out of range
+    T pop(int64_t index = -1) {
+        size_t position = normalize(index);
+        T value = std::move(items[position]);
+        erase(items + position);
+        return value;
+    }
+
+    // list.insert(i, x); the index clamps to the ends like Python's
+    template <typename I, typename = std::enable_if_t<std::is_integral_v<I>>>
+    void insert(I index, const T& value) {
+        int64_t position = static_cast<int64_t>(index);
+        int64_t count = static_cast<int64_t>(length);
+        position = position < 0 ? std::max<int64_t>(position + count, 0) : std::min(position, count);
+        insert(items + position, value);
+    }
+
+    // list.index(x); raises ValueError when missing
+    size_t index(const T& value) const {
+        const T* found = std::find(begin(), end(), value);
+        if (found == end()) {
+            throw std::invalid_argument("ValueError");
+        }
+        return static_cast<size_t>(found - items);
+    }
+
+    size_t count(const T& value) const {
+        return static_cast<size_t>(std::count(begin(), end(), value));
+    }
+
+    void remove(const T& value) {
+        erase(begin() + index(value));
+    }
+
+    void reverse() {
+        std::reverse(begin(), end());
+    }
+
+    void sort() {
+        std::sort(begin(), end());
+    }
+
+    List copy() const {
+        return *this;
+    }
+
+    void swap(List& other) {
+        List moved = std::move(other);
+        other = std::move(*this);
+        *this = std::move(moved);
+    }
+
+    List& operator+=(const List& other) {
+        extend(other);
+        return *this;
+    }
+
+    friend List operator+(const List& a, const List& b) {
+        List result;
+        result.reserve(a.size() + b.size());
+        result.insert(result.end(), a.begin(), a.end());
+        result.insert(result.end(), b.begin(), b.end());
+        return result;
+    }
+
+    // [x] * n
+    template <typename I, typename = std::enable_if_t<std::is_integral_v<I>>>
+    friend List operator*(const List& list, I times) {
+        List result;
+        if (times <= 0) {
+            return result;
+        }
+        result.reserve(list.size() * static_cast<size_t>(times));
+        for (I i = 0; i < times; ++i) {
+            result.insert(result.end(), list.begin(), list.end());
+        }
+        return result;
+    }
+
+    friend bool operator==(const List& a, const List& b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+    }
+
+    friend bool operator!=(const List& a, const List& b) {
+        return !(a == b);
+    }
+
+    friend bool operator<(const List& a, const List& b) {
+        return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+    }
+
+    friend bool operator>(const List& a, const List& b) {
+        return b < a;
+    }
+
+    friend bool operator<=(const List& a, const List& b) {
+        return !(b < a);
+    }
+
+    friend bool operator>=(const List& a, const List& b) {
+        return !(a < b);
+    }
+};
+
+namespace detail {
+
+template <typename C, typename = void>
+struct HasSize : std::false_type {};
+template <typename C>
+struct HasSize<C, std::void_t<decltype(std::declval<const C&>().size())>> : std::true_type {};
+
+template <typename C, typename = void>
+struct HasReserve : std::false_type {};
+template <typename C>
+struct HasReserve<C, std::void_t<decltype(std::declval<C&>().reserve(size_t()))>> : std::true_type {};
+
+template <typename C, typename T, typename = void>
+struct HasContains : std::false_type {};
+template <typename C, typename T>
+struct HasContains<C, T, std::void_t<decltype(std::declval<const C&>().contains(std::declval<const T&>()))>>
+    : std::true_type {};
+
+template <typename C, typename T, typename = void>
+struct HasFind : std::false_type {};
+template <typename C, typename T>
+struct HasFind<C, T, std::void_t<decltype(std::declval<const C&>().find(std::declval<const T&>()) ==
+                                          std::declval<const C&>().end())>> : std::true_type {};
+
+// Python's divmod() on floats, as CPython's float_divmod computes it
+inline std::pair<double, double> floatDivMod(double a, double b) {
+    double remainder = std::fmod(a, b);
+    double quotient = (a - remainder) / b;
+    if (remainder != 0) {
+        if ((b < 0) != (remainder < 0)) {
+            remainder += b;
+            quotient -= 1.0;
+        }
+    } else {
+        remainder = std::copysign(0.0, b);
+    }
+    double floored = std::copysign(0.0, a / b);
+    if (quotient != 0) {
+        floored = std::floor(quotient);
+        if (quotient - floored > 0.5) {
+            floored += 1.0;
+        }
+    }
+    return {floored, remainder};
+}
+
+}  // namespace detail
+
+// Makes room for count more elements where the container can
+template <typename Result>
+void reserve(Result& result, size_t count) {
+    if constexpr (detail::HasReserve<Result>::value) {
+        result.reserve(result.size() + count);
+    }
+}
+
+// Sizes a comprehension's result for one element per item of iterable
+template <typename Result, typename Iterable>
+void reserveFor(Result& result, const Iterable& iterable) {
+    if constexpr (detail::HasSize<Iterable>::value) {
+        reserve(result, static_cast<size_t>(iterable.size()));
+    }
+}
+
+// Number of values range(start, stop, step) yields
+template <typename A, typename B, typename C = int64_t>
+size_t rangeLength(A start, B stop, C step = 1) {
+    int64_t from = static_cast<int64_t>(start);
+    int64_t to = static_cast<int64_t>(stop);
+    int64_t by = static_cast<int64_t>(step);
+    if (by > 0 && to > from) {
+        return static_cast<size_t>((to - from + by - 1) / by);
+    }
+    if (by < 0 && from > to) {
+        return static_cast<size_t>((from - to - by - 1) / -by);
+    }
+    return 0;
+}
+
+// Python's ** on ints with a non-negative exponent, by repeated squaring;
+// like the other int64_t arithmetic it wraps around on overflow
+template <typename A, typename B>
+constexpr int64_t intPow(A base, B exponent) {
+    uint64_t result = 1;
+    uint64_t factor = static_cast<uint64_t>(static_cast<int64_t>(base));
+    for (auto remaining = static_cast<uint64_t>(exponent); remaining > 0; remaining >>= 1) {
+        if (remaining & 1) {
+            result *= factor;
+        }
+        factor *= factor;
+    }
+    return static_cast<int64_t>(result);
+}
+
+// Python's a // b, which rounds towards negative infinity where C++'s /
+// truncates towards zero
+template <typename A, typename B>
+constexpr auto floorDiv(A a, B b) {
+    if constexpr (std::is_integral_v<A> && std::is_integral_v<B>) {
+        auto quotient = a / b;
+        if (a % b != 0 && (a < 0) != (b < 0)) {
+            --quotient;
+        }
+        return quotient;
+    } else {
+        return detail::floatDivMod(static_cast<double>(a), static_cast<double>(b)).first;
+    }
+}
+
+// Python's a % b, which takes the sign of b where C++'s % takes the sign of a
+template <typename A, typename B>
+constexpr auto mod(A a, B b) {
+    if constexpr (std::is_integral_v<A> && std::is_integral_v<B>) {
+        auto remainder = a % b;
+        if (remainder != 0 && (remainder < 0) != (b < 0)) {
+            remainder += b;
+        }
+        return remainder;
+    } else {
+        return detail::floatDivMod(static_cast<double>(a), static_cast<double>(b)).second;
+    }
+}
+
+// `value is None`; only a PyValue can hold None
+inline bool isNone(const PyValue& value) {
+    return std::holds_alternative<std::monostate>(value);
+}
+
+// `value in container`: hashed or ordered lookup when the container has one,
+// substring search for strings and a linear scan otherwise
+template <typename C, typename T>
+bool contains(const C& container, const T& value) {
+    if constexpr (std::is_convertible_v<const C&, std::string_view>) {
+        return std::string_view(container).find(value) != std::string_view::npos;
+    } else if constexpr (detail::HasContains<C, T>::value) {
+        return container.contains(value);
+    } else if constexpr (detail::HasFind<C, T>::value) {
+        return container.find(value) != container.end();
+    } else {
+        return std::find(std::begin(container), std::end(container), value) != std::end(container);
+    }
+}
+
+// A temporary passed to a parameter the translation takes by reference,
+// because the function changes it in place. It lives until the end of the
+// full expression, which is as long as Python's caller could have seen it.
+template <typename T>
+T& lvalue(T&& value) {
+    return value;
+}
+
+// Python's list, set and dict methods on std::vector, std::set and std::map,
+// for --std-containers. Methods with a std counterpart (append, add, discard,
+// setdefault) are emitted as that member function instead.
+namespace method {
+
+namespace detail {
+
+// Position of Python index i in a sequence of `length`; IndexError past either end
+inline size_t position(int64_t index, size_t length) {
+    int64_t count = static_cast<int64_t>(length);
+    if (index < 0) {
+        index += count;
+    }
+    if (index < 0 || index >= count) {
+        throw std::out_of_range("IndexError");
+    }
+    return static_cast<size_t>(index);
+}
+
+// dict.keys() and dict.values() of a std::map without copying it
+template <typename Map, bool Keys>
+class MapView {
+private:
+    const Map* map;
+
+public:
+    class iterator {
+    private:
+        typename Map::const_iterator it;
+
+    public:
+        explicit iterator(typename Map::const_iterator it) : it(it) {}
+
+        const auto& operator*() const {
+            if constexpr (Keys) {
+                return it->first;
+            } else {
+                return it->second;
+            }
+        }
+
+        iterator& operator++() {
+            ++it;
+            return *this;
+        }
+
+        bool operator!=(const iterator& other) const {
+            return it != other.it;
+        }
+
+        bool operator==(const iterator& other) const {
+            return it == other.it;
+        }
+    };
+
+    explicit MapView(const Map* map) : map(map) {}
+
+    iterator begin() const {
+        return iterator(map->begin());
+    }
+
+    iterator end() const {
+        return iterator(map->end());
+    }
+
+    size_t size() const {
+        return map->size();
+    }
+};
+
+}  // namespace detail
+
+// Arguments are converted to the element type instead of deducing it, so
+// xs.index(5) on a vector of int64_t and d.get("a") on a map keyed by
+// std::string both match
+template <typename T>
+using Element = typename std::enable_if<true, T>::type;
+
+// list.extend(xs) and set.update(xs)
+template <typename T, typename A, typename Iterable>
+void extend(std::vector<T, A>& list, const Iterable& values) {
+    if (static_cast<const void*>(&values) == &list) {
+        std::vector<T, A> copy = list;
+        list.insert(list.end(), copy.begin(), copy.end());
+        return;
+    }
+    list.insert(list.end(), std::begin(values), std::end(values));
+}
+
+template <typename T, typename C, typename A, typename Iterable>
+void update(std::set<T, C, A>& set, const Iterable& values) {
+    set.insert(std::begin(values), std::end(values));
+}
+
+// xs[i] where i may be negative; counts from the end and raises IndexError like Python
+template <typename T, typename A>
+decltype(auto) item(std::vector<T, A>& list, int64_t index) {
+    return list[detail::position(index, list.size())];
+}
+
+template <typename T, typename A>
+decltype(auto) item(const std::vector<T, A>& list, int64_t index) {
+    return list[detail::position(index, list.size())];
+}
+
+// list.pop() and list.pop(i); raise IndexError when out of range
+template <typename T, typename A>
+T pop(std::vector<T, A>& list, int64_t index = -1) {
+    size_t at = detail::position(index, list.size());
+    T value = std::move(list[at]);
+    list.erase(list.begin() + static_cast<std::ptrdiff_t>(at));
+    return value;
+}
+
+// list.insert(i, x); the index clamps to the ends like Python's
+template <typename T, typename A, typename V>
+void insert(std::vector<T, A>& list, int64_t index, V&& value) {
+    int64_t count = static_cast<int64_t>(list.size());
+    index = index < 0 ? std::max<int64_t>(index + count, 0) : std::min(index, count);
+    list.insert(list.begin() + static_cast<std::ptrdiff_t>(index), std::forward<V>(value));
+}
+
+// list.index(x); raises ValueError when missing
+template <typename T, typename A>
+size_t index(const std::vector<T, A>& list, const Element<T>& value) {
+    auto found = std::find(list.begin(), list.end(), value);
+    if (found == list.end()) {
+        throw std::invalid_argument("ValueError");
+    }
+    return static_cast<size_t>(found - list.begin());
+}
+
+template <typename T, typename A>
+size_t count(const std::vector<T, A>& list, const Element<T>& value) {
+    return static_cast<size_t>(std::count(list.begin(), list.end(), value));
+}
+
+// list.remove(x) raises ValueError and set.remove(x) KeyError when x is missing
+template <typename T, typename A>
+void remove(std::vector<T, A>& list, const Element<T>& value) {
+    list.erase(list.begin() + static_cast<std::ptrdiff_t>(index(list, value)));
+}
+
+template <typename T, typename C, typename A>
+void remove(std::set<T, C, A>& set, const Element<T>& value) {
+    if (set.erase(value) == 0) {
+        throw std::out_of_range("KeyError");
+    }
+}
+
+template <typename T, typename A>
+void sort(std::vector<T, A>& list) {
+    std::sort(list.begin(), list.end());
+}
+
+template <typename T, typename A>
+void reverse(std::vector<T, A>& list) {
+    std::reverse(list.begin(), list.end());
+}
+
+// dict.get(key, default)
+template <typename K, typename V, typename C, typename A>
+V get(const std::map<K, V, C, A>& dict, const Element<K>& key, const Element<V>& fallback = V()) {
+    auto found = dict.find(key);
+    return found == dict.end() ? fallback : found->second;
+}
+
+// dict.pop(key) raises KeyError when key is missing; dict.pop(key, default) returns default
+template <typename K, typename V, typename C, typename A>
+V pop(std::map<K, V, C, A>& dict, const Element<K>& key) {
+    auto found = dict.find(key);
+    if (found == dict.end()) {
+        throw std::out_of_range("KeyError");
+    }
+    V value = std::move(found->second);
+    dict.erase(found);
+    return value;
+}
+
+template <typename K, typename V, typename C, typename A>
+V pop(std::map<K, V, C, A>& dict, const Element<K>& key, const Element<V>& fallback) {
+    auto found = dict.find(key);
+    if (found == dict.end()) {
+        return fallback;
+    }
+    V value = std::move(found->second);
+    dict.erase(found);
+    return value;
+}
+
+template <typename K, typename V, typename C, typename A>
+void update(std::map<K, V, C, A>& dict, const std::map<K, V, C, A>& other) {
+    for (const auto& item : other) {
+        dict.insert_or_assign(item.first, item.second);
+    }
+}
+
+template <typename K, typename V, typename C, typename A>
+detail::MapView<std::map<K, V, C, A>, true> keys(const std::map<K, V, C, A>& dict) {
+    return detail::MapView<std::map<K, V, C, A>, true>(&dict);
+}
+
+template <typename K, typename V, typename C, typename A>
+detail::MapView<std::map<K, V, C, A>, false> values(const std::map<K, V, C, A>& dict) {
+    return detail::MapView<std::map<K, V, C, A>, false>(&dict);
+}
+
+}  // namespace method
+
+// f(0) .. f(N - 1), computed while compiling when used to initialize a
+// constexpr variable
+template <typename T, size_t N, typename F>
+constexpr std::array<T, N> constexprTable(F f) {
+    std::array<T, N> table{};
+    for (size_t i = 0; i < N; ++i) {
+        table[i] = f(static_cast<int64_t>(i));
+    }
+    return table;
+}
+
+// Entry::at(0) .. Entry::at(N - 1) of a constexpr function, which py2cpp emits
+// for range(N) loops that call it on the loop index. When some entry is not a
+// constant expression (it divides by zero, say, on an index the loop never
+// reaches) the table is dropped and indexing calls Entry::at like the loop did
+template <typename T, size_t N, typename Entry, typename = void>
+struct ConstexprTable {
+    T operator[](int64_t index) const {
+        return Entry::at(index);
+    }
+};
+
+template <typename T, size_t N, typename Entry>
+struct ConstexprTable<T, N, Entry, std::enable_if_t<constexprTable<T, N>(Entry::at).size() == N>> {
+    static constexpr std::array<T, N> values = constexprTable<T, N>(Entry::at);
+
+    constexpr T operator[](int64_t index) const {
+        return values[static_cast<size_t>(index)];
+    }
+};
+
+// Loops emitted by `py2cpp --parallel` for pure comprehensions and sums.
+// Compiled with -fopenmp they are split across OpenMP threads; with
+// PY2CPP_PARALLEL_STL defined they run on std::execution::par_unseq instead
+// (libstdc++ needs -ltbb for that); otherwise they run sequentially. Loops
+// over fewer items than the threshold always run sequentially, where starting
+// threads costs more than the work.
+#ifndef PY2CPP_PARALLEL_THRESHOLD
+#define PY2CPP_PARALLEL_THRESHOLD 32768
+#endif
+
+// The values of range(start, stop, step), indexable like a list
+class Range {
+private:
+    int64_t first;
+    int64_t stride;
+    size_t count;
+
+public:
+    template <typename A, typename B, typename C = int64_t>
+    Range(A start, B stop, C step = 1)
+        : first(static_cast<int64_t>(start)), stride(static_cast<int64_t>(step)), count(rangeLength(start, stop, step)) {}
+
+    size_t size() const {
+        return count;
+    }
+
+    int64_t operator[](size_t i) const {
+        return first + static_cast<int64_t>(i) * stride;
+    }
+};
+
+#if defined(PY2CPP_PARALLEL_STL) && !defined(_OPENMP)
+namespace detail {
+
+// Counts 0, 1, 2, ... so the parallel algorithms can index into the source
+class IndexIterator {
+private:
+    size_t index = 0;
+
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const size_t*;
+    using reference = size_t;
+
+    IndexIterator() = default;
+    explicit IndexIterator(size_t index) : index(index) {}
+
+    size_t operator*() const {
+        return index;
+    }
+
+    size_t operator[](difference_type n) const {
+        return index + static_cast<size_t>(n);
+    }
+
+    IndexIterator& operator++() {
+        ++index;
+        return *this;
+    }
+
+    IndexIterator operator++(int) {
+        return IndexIterator(index++);
+    }
+
+    IndexIterator& operator--() {
+        --index;
+        return *this;
+    }
+
+    IndexIterator operator--(int) {
+        return IndexIterator(index--);
+    }
+
+    IndexIterator& operator+=(difference_type n) {
+        index += static_cast<size_t>(n);
+        return *this;
+    }
+
+    IndexIterator& operator-=(difference_type n) {
+        index -= static_cast<size_t>(n);
+        return *this;
+    }
+
+    friend IndexIterator operator+(IndexIterator it, difference_type n) {
+        return it += n;
+    }
+
+    friend IndexIterator operator+(difference_type n, IndexIterator it) {
+        return it += n;
+    }
+
+    friend IndexIterator operator-(IndexIterator it, difference_type n) {
+        return it -= n;
+    }
+
+    friend difference_type operator-(IndexIterator a, IndexIterator b) {
+        return static_cast<difference_type>(a.index) - static_cast<difference_type>(b.index);
+    }
+
+    friend bool operator==(IndexIterator a, IndexIterator b) {
+        return a.index == b.index;
+    }
+
+    friend bool operator!=(IndexIterator a, IndexIterator b) {
+        return a.index != b.index;
+    }
+
+    friend bool operator<(IndexIterator a, IndexIterator b) {
+        return a.index < b.index;
+    }
+
+    friend bool operator>(IndexIterator a, IndexIterator b) {
+        return a.index > b.index;
+    }
+
+    friend bool operator<=(IndexIterator a, IndexIterator b) {
+        return a.index <= b.index;
+    }
+
+    friend bool operator>=(IndexIterator a, IndexIterator b) {
+        return a.index >= b.index;
+    }
+};
+
+}  // namespace detail
+#endif
+
+// [f(x) for x in source], where source is a List, vector or Range and f has
+// no side effects
+template <typename Result, typename Source, typename F>
+Result parallelMap(const Source& source, F f) {
+    size_t n = source.size();
+    Result result;
+    result.resize(n);
+#if defined(_OPENMP)
+    const int64_t count = static_cast<int64_t>(n);
+#pragma omp parallel for schedule(static) if (n >= PY2CPP_PARALLEL_THRESHOLD)
+    for (int64_t i = 0; i < count; ++i) {
+        result[static_cast<size_t>(i)] = f(source[static_cast<size_t>(i)]);
+    }
+#elif defined(PY2CPP_PARALLEL_STL)
+    auto element = [&](size_t i) { return f(source[i]); };
+    if (n >= PY2CPP_PARALLEL_THRESHOLD) {
+        std::transform(std::execution::par_unseq, detail::IndexIterator(0), detail::IndexIterator(n), result.begin(),
+                       element);
+    } else {
+        std::transform(detail::IndexIterator(0), detail::IndexIterator(n), result.begin(), element);
+    }
+#else
+    for (size_t i = 0; i < n; ++i) {
+        result[i] = f(source[i]);
+    }
+#endif
+    return result;
+}
+
+// The sum of f(x) for x in source. Float sums are added in a different order
+// than Python's loop once they run in parallel, so the last bits can differ.
+template <typename T, typename Source, typename F>
+T parallelSum(const Source& source, F f) {
+    size_t n = source.size();
+    T total = T();
+#if defined(_OPENMP)
+    const int64_t count = static_cast<int64_t>(n);
+#pragma omp parallel for schedule(static) reduction(+ : total) if (n >= PY2CPP_PARALLEL_THRESHOLD)
+    for (int64_t i = 0; i < count; ++i) {
+        total += static_cast<T>(f(source[static_cast<size_t>(i)]));
+    }
+#else
+#if defined(PY2CPP_PARALLEL_STL)
+    if (n >= PY2CPP_PARALLEL_THRESHOLD) {
+        return std::transform_reduce(std::execution::par_unseq, detail::IndexIterator(0), detail::IndexIterator(n),
+                                     T(), std::plus<T>(), [&](size_t i) { return static_cast<T>(f(source[i])); });
+    }
+#endif
+    for (size_t i = 0; i < n; ++i) {
+        total += static_cast<T>(f(source[i]));
+    }
+#endif
+    return total;
+}
+
+// Parsed format spec: [[fill]align][sign][#][0][width][grouping][.precision][type].
+// py2cpp parses the specs of f-strings while translating and emits them as
+// aggregate literals, so nothing is parsed at run time.
+struct FormatSpec {
+    char fill = ' ';
+    char align = 0;  // '<', '>', '^', '=' or 0 for the value's default
+    char sign = '-';
+    bool alternate = false;
+    int width = 0;
+    char grouping = 0;  // ',' or '_'
+    int precision = -1;
+    char type = 0;
+
+    static constexpr bool isAlign(char c) {
+        return c == '<' || c == '>' || c == '^' || c == '=';
+    }
+
+    static constexpr bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    // False when text is not a valid spec
+    static constexpr bool parse(std::string_view text, FormatSpec& spec) {
+        size_t i = 0;
+        if (text.size() >= 2 && isAlign(text[1])) {
+            spec.fill = text[0];
+            spec.align = text[1];
+            i = 2;
+        } else if (!text.empty() && isAlign(text[0])) {
+            spec.align = text[0];
+            i = 1;
+        }
+        if (i < text.size() && (text[i] == '+' || text[i] == '-' || text[i] == ' ')) {
+            spec.sign = text[i++];
+        }
+        if (i < text.size() && text[i] == '#') {
+            spec.alternate = true;
+            ++i;
+        }
+        if (i < text.size() && text[i] == '0') {
+            // Zero padding goes between the sign and the digits
+            if (spec.align == 0) {
+                spec.fill = '0';
+                spec.align = '=';
+            }
+            ++i;
+        }
+        while (i < text.size() && isDigit(text[i])) {
+            spec.width = spec.width * 10 + (text[i++] - '0');
+        }
+        if (i < text.size() && (text[i] == ',' || text[i] == '_')) {
+            spec.grouping = text[i++];
+        }
+        if (i < text.size() && text[i] == '.') {
+            ++i;
+            if (i == text.size() || !isDigit(text[i])) {
+                return false;
+            }
+            spec.precision = 0;
+            while (i < text.size() && isDigit(text[i])) {
+                spec.precision = spec.precision * 10 + (text[i++] - '0');
+            }
+        }
+        if (i < text.size()) {
+            spec.type = text[i++];
+        }
+        return i == text.size();
+    }
+};
+
+// Fixed-size buffer in front of a stdio stream. Like CPython, it flushes after
+// every print() when the stream is a terminal and only when full otherwise.
+class OutputBuffer {
+private:
+    static constexpr size_t kCapacity = 1 << 16;
+
+    std::FILE* file;
+    bool lineBuffered;
+    size_t used = 0;
+    char data[kCapacity];
+
+public:
+    explicit OutputBuffer(std::FILE* target) : file(target) {
+#if defined(_WIN32)
+        lineBuffered = _isatty(_fileno(target)) != 0;
+#else
+        lineBuffered = isatty(fileno(target)) != 0;
+#endif
+    }
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    ~OutputBuffer() {
+        flush();
+    }
+
+    void write(const char* text, size_t size) {
+        if (size > kCapacity - used) {
+            flush();
+            if (size >= kCapacity) {
+                std::fwrite(text, 1, size, file);
+                return;
+            }
+        }
+        std::memcpy(data + used, text, size);
+        used += size;
+    }
+
+    void write(std::string_view text) {
+        write(text.data(), text.size());
+    }
+
+    void put(char c) {
+        if (used == kCapacity) {
+            flush();
+        }
+        data[used++] = c;
+    }
+
+    void flush() {
+        if (used > 0) {
+            std::fwrite(data, 1, used, file);
+            used = 0;
+        }
+        std::fflush(file);
+    }
+
+    void endPrint(bool forceFlush) {
+        if (forceFlush || lineBuffered) {
+            flush();
+        }
+    }
+};
+
+OutputBuffer& stdoutBuffer();
+
+namespace detail {
+
+inline std::terminate_handler previousTerminate = nullptr;
+
+// Output printed before an uncaught exception is not lost
+inline void flushAndTerminate() {
+    stdoutBuffer().flush();
+    if (previousTerminate != nullptr) {
+        previousTerminate();
+    }
+    std::abort();
+}
+
+}  // namespace detail
+
+// Buffered stdout, flushed at exit
+inline OutputBuffer& stdoutBuffer() {
+    static OutputBuffer buffer(stdout);
+    static const bool installed = [] {
+        detail::previousTerminate = std::set_terminate(detail::flushAndTerminate);
+        return true;
+    }();
+    (void)installed;
+    return buffer;
+}
+
+// Buffered stderr for print(..., file=sys.stderr), which flushes after every
+// print() like CPython's line-buffered stderr
+inline OutputBuffer& stderrBuffer() {
+    static OutputBuffer buffer(stderr);
+    return buffer;
+}
+
+// Appends to a std::string with the same interface as OutputBuffer
+struct StringWriter {
+    std::string& text;
+
+    void write(const char* data, size_t size) {
+        text.append(data, size);
+    }
+
+    void write(std::string_view data) {
+        text.append(data.data(), data.size());
+    }
+
+    void put(char c) {
+        text += c;
+    }
+};
+
+template <typename T>
+struct Formatted {
+    const T& value;
+    FormatSpec spec;
+};
+
+// f"{value:spec}"
+template <typename T>
+Formatted<T> fmt(const T& value, const FormatSpec& spec) {
+    return {value, spec};
+}
+
+template <typename T>
+struct Repr {
+    const T& value;
+};
+
+// f"{value!r}"
+template <typename T>
+Repr<T> repr(const T& value) {
+    return {value};
+}
+
+// An f-string written piece by piece; only lives for the print() it is passed to
+template <typename... Parts>
+struct FString {
+    std::tuple<const Parts&...> parts;
+};
+
+template <typename... Parts>
+FString<Parts...> fstring(const Parts&... parts) {
+    return {std::tuple<const Parts&...>(parts...)};
+}
+
+namespace detail {
+
+template <typename T>
+struct IsVector : std::false_type {};
+template <typename T, typename A>
+struct IsVector<std::vector<T, A>> : std::true_type {};
+template <typename T, size_t N>
+struct IsVector<List<T, N>> : std::true_type {};
+
+template <typename T>
+struct IsSet : std::false_type {};
+template <typename T, typename C, typename A>
+struct IsSet<std::set<T, C, A>> : std::true_type {};
+template <typename T, typename H>
+struct IsSet<Set<T, H>> : std::true_type {};
+
+template <typename T>
+struct IsMap : std::false_type {};
+template <typename K, typename V, typename C, typename A>
+struct IsMap<std::map<K, V, C, A>> : std::true_type {};
+template <typename K, typename V, typename H>
+struct IsMap<Dict<K, V, H>> : std::true_type {};
+
+template <typename T>
+struct IsTuple : std::false_type {};
+template <typename... T>
+struct IsTuple<std::tuple<T...>> : std::true_type {};
+template <typename A, typename B>
+struct IsTuple<std::pair<A, B>> : std::true_type {};
+
+template <typename T>
+struct IsVariant : std::false_type {};
+template <typename... T>
+struct IsVariant<std::variant<T...>> : std::true_type {};
+
+template <typename T>
+struct IsFormatted : std::false_type {};
+template <typename T>
+struct IsFormatted<Formatted<T>> : std::true_type {};
+
+template <typename T>
+struct IsRepr : std::false_type {};
+template <typename T>
+struct IsRepr<Repr<T>> : std::true_type {};
+
+template <typename T>
+struct IsFString : std::false_type {};
+template <typename... T>
+struct IsFString<FString<T...>> : std::true_type {};
+
+template <typename T, typename = void>
+struct Streamable : std::false_type {};
+template <typename T>
+struct Streamable<T, std::void_t<decltype(std::declval<std::ostream&>() << std::declval<const T&>())>>
+    : std::true_type {};
+
+template <typename T>
+constexpr bool isString = std::is_convertible_v<const T&, std::string_view> && !std::is_same_v<T, std::nullptr_t>;
+
+template <typename Sink>
+void writeString(Sink& sink, std::string_view text, bool quoted) {
+    if (!quoted) {
+        sink.write(text);
+        return;
+    }
+    // repr() prefers single quotes unless the text contains them and no double quotes
+    char quote = text.find('\'') != std::string_view::npos && text.find('"') == std::string_view::npos ? '"' : '\'';
+    sink.put(quote);
+    for (char c : text) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (c == quote || c == '\\') {
+            sink.put('\\');
+            sink.put(c);
+        } else if (c == '\n') {
+            sink.write("\\n", 2);
+        } else if (c == '\t') {
+            sink.write("\\t", 2);
+        } else if (c == '\r') {
+            sink.write("\\r", 2);
+        } else if (u < 0x20 || u == 0x7f) {
+            char escape[4] = {'\\', 'x', "0123456789abcdef"[u >> 4], "0123456789abcdef"[u & 15]};
+            sink.write(escape, 4);
+        } else {
+            sink.put(c);
+        }
+    }
+    sink.put(quote);
+}
+
+template <typename Sink, typename T>
+void writeInteger(Sink& sink, T value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    sink.write(digits, static_cast<size_t>(result.ptr - digits));
+}
+
+// repr() of a float: the shortest digits that round-trip, in fixed notation
+// for exponents in [-4, 16) and scientific notation otherwise
+template <typename Sink>
+void writeFloat(Sink& sink, double value) {
+    if (std::isnan(value)) {
+        sink.write("nan", 3);
+        return;
+    }
+    if (std::isinf(value)) {
+        sink.write(value < 0 ? "-inf" : "inf", value < 0 ? 4 : 3);
+        return;
+    }
+    char scientific[32];
+    auto result = std::to_chars(scientific, scientific + sizeof(scientific), value, std::chars_format::scientific);
+    std::string_view text(scientific, static_cast<size_t>(result.ptr - scientific));
+    size_t e = text.find('e');
+    std::string_view mantissa = text.substr(0, e);
+    int exponent = 0;
+    const char* exponentStart = scientific + e + 1;
+    std::from_chars(exponentStart + (*exponentStart == '+'), result.ptr, exponent);
+
+    char digits[24];
+    size_t count = 0;
+    bool negative = false;
+    for (char c : mantissa) {
+        if (c == '-') {
+            negative = true;
+        } else if (c != '.') {
+            digits[count++] = c;
+        }
+    }
+    if (negative) {
+        sink.put('-');
+    }
+    if (exponent >= -4 && exponent < 16) {
+        if (exponent < 0) {
+            sink.write("0.", 2);
+            for (int i = -1; i > exponent; --i) {
+                sink.put('0');
+            }
+            sink.write(digits, count);
+            return;
+        }
+        size_t integerDigits = static_cast<size_t>(exponent) + 1;
+        for (size_t i = 0; i < integerDigits; ++i) {
+            sink.put(i < count ? digits[i] : '0');
+        }
+        sink.put('.');
+        if (count > integerDigits) {
+            sink.write(digits + integerDigits, count - integerDigits);
+        } else {
+            sink.put('0');
+        }
+        return;
+    }
+    sink.put(digits[0]);
+    if (count > 1) {
+        sink.put('.');
+        sink.write(digits + 1, count - 1);
+    }
+    char exponentText[8];
+    int length = std::snprintf(exponentText, sizeof(exponentText), "e%c%02d", exponent < 0 ? '-' : '+',
+                               exponent < 0 ? -exponent : exponent);
+    sink.write(exponentText, static_cast<size_t>(length));
+}
+
+template <typename Sink, typename T>
+void writeValue(Sink& sink, const T& value, bool quoted = false);
+
+template <typename Sink, typename Container>
+void writeElements(Sink& sink, const Container& container) {
+    bool first = true;
+    for (const auto& element : container) {
+        if (!first) {
+            sink.write(", ", 2);
+        }
+        first = false;
+        writeValue(sink, element, true);
+    }
+}
+
+template <typename Sink, typename Tuple, size_t... I>
+void writeTuple(Sink& sink, const Tuple& tuple, std::index_sequence<I...>) {
+    sink.put('(');
+    ((I > 0 ? sink.write(", ", 2) : void(), writeValue(sink, std::get<I>(tuple), true)), ...);
+    if (sizeof...(I) == 1) {
+        sink.put(',');
+    }
+    sink.put(')');
+}
+
+template <typename Sink, typename T>
+void writeFormatted(Sink& sink, const T& value, const FormatSpec& spec);
+
+// str() of value, or repr() when quoted is set, as used for container elements
+template <typename Sink, typename T>
+void writeValue(Sink& sink, const T& value, bool quoted) {
+    if constexpr (std::is_same_v<T, bool>) {
+        sink.write(value ? "True" : "False", value ? 4 : 5);
+    } else if constexpr (std::is_same_v<T, char>) {
+        writeString(sink, std::string_view(&value, 1), quoted);
+    } else if constexpr (std::is_integral_v<T>) {
+        writeInteger(sink, value);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        writeFloat(sink, static_cast<double>(value));
+    } else if constexpr (std::is_array_v<T> && std::is_same_v<std::remove_cv_t<std::remove_extent_t<T>>, char>) {
+        // String literal
+        writeString(sink, std::string_view(value, std::extent_v<T> - 1), quoted);
+    } else if constexpr (isString<T>) {
+        writeString(sink, std::string_view(value), quoted);
+    } else if constexpr (std::is_same_v<T, std::nullptr_t> || std::is_same_v<T, std::monostate>) {
+        sink.write("None", 4);
+    } else if constexpr (IsVector<T>::value) {
+        sink.put('[');
+        writeElements(sink, value);
+        sink.put(']');
+    } else if constexpr (IsSet<T>::value) {
+        if (value.empty()) {
+            sink.write("set()", 5);
+            return;
+        }
+        sink.put('{');
+        writeElements(sink, value);
+        sink.put('}');
+    } else if constexpr (IsMap<T>::value) {
+        sink.put('{');
+        bool first = true;
+        for (const auto& entry : value) {
+            if (!first) {
+                sink.write(", ", 2);
+            }
+            first = false;
+            writeValue(sink, entry.first, true);
+            sink.write(": ", 2);
+            writeValue(sink, entry.second, true);
+        }
+        sink.put('}');
+    } else if constexpr (IsTuple<T>::value) {
+        writeTuple(sink, value, std::make_index_sequence<std::tuple_size_v<T>>());
+    } else if constexpr (IsVariant<T>::value) {
+        std::visit([&sink, quoted](const auto& v) { writeValue(sink, v, quoted); }, value);
+    } else if constexpr (IsFormatted<T>::value) {
+        writeFormatted(sink, value.value, value.spec);
+    } else if constexpr (IsRepr<T>::value) {
+        writeValue(sink, value.value, true);
+    } else if constexpr (IsFString<T>::value) {
+        std::apply([&sink](const auto&... parts) { (writeValue(sink, parts), ...); }, value.parts);
+    } else if constexpr (Streamable<T>::value) {
+        std::ostringstream stream;
+        stream << value;
+        sink.write(stream.str());
+    } else {
+        sink.write("<object>", 8);
+    }
+}
+
+// Pads body (sign and prefix first) to the spec's width
+template <typename Sink>
+void writePadded(Sink& sink, const FormatSpec& spec, std::string_view prefix, std::string_view body, char defaultAlign) {
+    size_t length = prefix.size();
+    for (char c : body) {
+        // Width counts code points, not UTF-8 bytes
+        length += (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+    }
+    size_t padding = spec.width > 0 && static_cast<size_t>(spec.width) > length ? spec.width - length : 0;
+    char align = spec.align != 0 ? spec.align : defaultAlign;
+    size_t before = align == '>' ? padding : align == '^' ? padding / 2 : 0;
+    size_t after = align == '<' ? padding : align == '^' ? padding - padding / 2 : 0;
+    for (size_t i = 0; i < before; ++i) {
+        sink.put(spec.fill);
+    }
+    sink.write(prefix);
+    if (align == '=') {
+        for (size_t i = 0; i < padding; ++i) {
+            sink.put(spec.fill);
+        }
+    }
+    sink.write(body);
+    for (size_t i = 0; i < after; ++i) {
+        sink.put(spec.fill);
+    }
+}
+
+// Inserts the grouping separator into the leading run of digits
+inline std::string groupDigits(std::string_view digits, char separator, size_t every) {
+    size_t end = 0;
+    while (end < digits.size() && ((digits[end] >= '0' && digits[end] <= '9') ||
+                                   (every == 4 && ((digits[end] >= 'a' && digits[end] <= 'f') ||
+                                                   (digits[end] >= 'A' && digits[end] <= 'F'))))) {
+        ++end;
+    }
+    std::string grouped;
+    grouped.reserve(digits.size() + end / every);
+    for (size_t i = 0; i < end; ++i) {
+        if (i > 0 && (end - i) % every == 0) {
+            grouped += separator;
+        }
+        grouped += digits[i];
+    }
+    grouped.append(digits.substr(end));
+    return grouped;
+}
+
+template <typename Sink>
+void writeNumber(Sink& sink, const FormatSpec& spec, bool negative, std::string_view prefix, std::string_view digits,
+                 size_t groupEvery = 3) {
+    char signPrefix[4] = {};
+    size_t signLength = 0;
+    if (negative) {
+        signPrefix[signLength++] = '-';
+    } else if (spec.sign == '+' || spec.sign == ' ') {
+        signPrefix[signLength++] = spec.sign;
+    }
+    if (!prefix.empty()) {
+        // An empty prefix may have a null data()
+        std::memcpy(signPrefix + signLength, prefix.data(), prefix.size());
+    }
+    std::string_view head(signPrefix, signLength + prefix.size());
+    if (spec.grouping != 0) {
+        writePadded(sink, spec, head, groupDigits(digits, spec.grouping, groupEvery), '>');
+    } else {
+        writePadded(sink, spec, head, digits, '>');
+    }
+}
+
+template <typename Sink>
+void writeFormattedFloat(Sink& sink, double value, const FormatSpec& spec) {
+    char type = spec.type;
+    bool negative = std::signbit(value) && !std::isnan(value);
+    double magnitude = std::fabs(value);
+    char digits[400];
+    size_t length = 0;
+    if (type == 0 && spec.precision < 0) {
+        std::string text;
+        StringWriter writer{text};
+        writeFloat(writer, magnitude);
+        writeNumber(sink, spec, negative, {}, text);
+        return;
+    }
+    if (std::isinf(magnitude) || std::isnan(magnitude)) {
+        bool upper = type == 'F' || type == 'E' || type == 'G';
+        const char* text = std::isnan(magnitude) ? (upper ? "NAN" : "nan") : (upper ? "INF" : "inf");
+        writeNumber(sink, spec, negative, {}, std::string_view(text, 3));
+        return;
+    }
+    int precision = spec.precision >= 0 ? spec.precision : 6;
+    if (type == '%') {
+        magnitude *= 100;
+    }
+    std::chars_format format = type == 'e' || type == 'E' ? std::chars_format::scientific
+                             : type == 'f' || type == 'F' || type == '%' ? std::chars_format::fixed
+                             : std::chars_format::general;
+    if (format == std::chars_format::general && precision == 0) {
+        precision = 1;
+    }
+    auto result = std::to_chars(digits, digits + sizeof(digits) - 2, magnitude, format, precision);
+    length = static_cast<size_t>(result.ptr - digits);
+    if (type == 0 && std::string_view(digits, length).find_first_of(".e") == std::string_view::npos) {
+        // Without a type at least one digit follows the point
+        digits[length++] = '.';
+        digits[length++] = '0';
+    }
+    if (type == '%') {
+        digits[length++] = '%';
+    }
+    if (type == 'E' || type == 'G') {
+        for (size_t i = 0; i < length; ++i) {
+            digits[i] = digits[i] == 'e' ? 'E' : digits[i];
+        }
+    }
+    writeNumber(sink, spec, negative, {}, std::string_view(digits, length));
+}
+
+template <typename Sink, typename T>
+void writeFormattedInteger(Sink& sink, T value, const FormatSpec& spec) {
+    char type = spec.type;
+    if (type == 'e' || type == 'E' || type == 'f' || type == 'F' || type == 'g' || type == 'G' || type == '%') {
+        writeFormattedFloat(sink, static_cast<double>(value), spec);
+        return;
+    }
+    if (type == 'c') {
+        char c = static_cast<char>(value);
+        writePadded(sink, spec, {}, std::string_view(&c, 1), '<');
+        return;
+    }
+    int base = type == 'b' ? 2 : type == 'o' ? 8 : type == 'x' || type == 'X' ? 16 : 10;
+    bool negative = value < 0;
+    using Unsigned = std::make_unsigned_t<T>;
+    Unsigned magnitude = negative ? Unsigned(0) - static_cast<Unsigned>(value) : static_cast<Unsigned>(value);
+    char digits[72];
+    auto result = std::to_chars(digits, digits + sizeof(digits), magnitude, base);
+    size_t length = static_cast<size_t>(result.ptr - digits);
+    if (type == 'X') {
+        for (size_t i = 0; i < length; ++i) {
+            digits[i] = digits[i] >= 'a' && digits[i] <= 'f' ? static_cast<char>(digits[i] - 'a' + 'A') : digits[i];
+        }
+    }
+    std::string_view prefix;
+    if (spec.alternate && base != 10) {
+        prefix = type == 'b' ? "0b" : type == 'o' ? "0o" : type == 'x' ? "0x" : "0X";
+    }
+    writeNumber(sink, spec, negative, prefix, std::string_view(digits, length), base == 10 ? 3 : 4);
+}
+
+template <typename Sink, typename T>
+void writeFormatted(Sink& sink, const T& value, const FormatSpec& spec) {
+    if constexpr (std::is_same_v<T, bool>) {
+        if (spec.type == 0 && spec.width == 0 && spec.precision < 0) {
+            writeValue(sink, value);
+        } else {
+            writeFormattedInteger(sink, static_cast<int64_t>(value), spec);
+        }
+    } else if constexpr (std::is_integral_v<T> && !std::is_same_v<T, char>) {
+        writeFormattedInteger(sink, value, spec);
+    } else if constexpr (std::is_floating_point_v<T>) {
+        writeFormattedFloat(sink, static_cast<double>(value), spec);
+    } else if constexpr (IsVariant<T>::value) {
+        std::visit([&sink, &spec](const auto& v) { writeFormatted(sink, v, spec); }, value);
+    } else {
+        std::string text;
+        StringWriter writer{text};
+        writeValue(writer, value);
+        std::string_view body = text;
+        if (spec.precision >= 0 && static_cast<size_t>(spec.precision) < body.size()) {
+            body = body.substr(0, static_cast<size_t>(spec.precision));
+        }
+        writePadded(sink, spec, {}, body, '<');
+    }
+}
+
+}  // namespace detail
+
+// str() of any supported value
+template <typename T>
+std::string str(const T& value) {
+    std::string text;
+    StringWriter writer{text};
+    detail::writeValue(writer, value);
+    return text;
+}
+
+// f-string outside print(): formats every part into one string
+template <typename... Parts>
+std::string format(const Parts&... parts) {
+    std::string text;
+    StringWriter writer{text};
+    (detail::writeValue(writer, parts), ...);
+    return text;
+}
+
+// str() of an integer: the digits go into a stack buffer and the result is
+// made once at its final length
+inline std::string intToString(int64_t value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    return std::string(digits, static_cast<size_t>(result.ptr - digits));
+}
+
+namespace detail {
+
+// The characters of a string part, or nothing for a number
+template <typename T>
+std::string_view textOf(const T& part) {
+    if constexpr (std::is_same_v<T, char>) {
+        return std::string_view(&part, 1);
+    } else if constexpr (std::is_array_v<T> && std::is_same_v<std::remove_cv_t<std::remove_extent_t<T>>, char>) {
+        return std::string_view(part, std::extent_v<T> - 1);
+    } else if constexpr (isString<T>) {
+        return std::string_view(part);
+    } else {
+        return {};
+    }
+}
+
+// Room for `extra` more bytes; grows at least geometrically so a loop of
+// small reservations stays amortized
+inline void reserveMore(std::string& text, size_t extra) {
+    size_t needed = text.size() + extra;
+    if (needed > text.capacity()) {
+        text.reserve(std::max(needed, text.capacity() * 2));
+    }
+}
+
+// Python's whitespace for str.split() with no separator
+inline bool isSpace(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r') || (c >= '\x1c' && c <= '\x1f');
+}
+
+// int() and float() accept surrounding whitespace and a leading '+' that
+// from_chars does not
+inline std::string_view numberText(std::string_view text) {
+    while (!text.empty() && isSpace(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && isSpace(text.back())) {
+        text.remove_suffix(1);
+    }
+    if (text.size() > 1 && text[0] == '+' && text[1] != '-') {
+        text.remove_prefix(1);
+    }
+    return text;
+}
+
+}  // namespace detail
+
+// text += a + str(n) + ...: one reservation for the string parts, numbers
+// written in place, no temporaries. No part may alias text.
+template <typename... Parts>
+void append(std::string& text, const Parts&... parts) {
+    detail::reserveMore(text, (detail::textOf(parts).size() + ... + 0));
+    StringWriter writer{text};
+    (detail::writeValue(writer, parts), ...);
+}
+
+// Ahead of `for x in items: text += x + ","` style loops: room for `copies`
+// of every element and `bytes` more per element
+template <typename C>
+void reserveAppends(std::string& text, const C& items, size_t copies, size_t bytes) {
+    size_t extra = items.size() * bytes;
+    if (copies > 0) {
+        for (const auto& item : items) {
+            extra += detail::textOf(item).size() * copies;
+        }
+    }
+    detail::reserveMore(text, extra);
+}
+
+// separator.join(items): the result is measured first and built in one allocation
+template <typename C>
+std::string join(std::string_view separator, const C& items) {
+    size_t size = 0;
+    size_t count = 0;
+    for (const auto& item : items) {
+        size += detail::textOf(item).size();
+        ++count;
+    }
+    std::string text;
+    text.reserve(size + (count > 0 ? (count - 1) * separator.size() : 0));
+    bool first = true;
+    for (const auto& item : items) {
+        if (!first) {
+            text.append(separator);
+        }
+        first = false;
+        text.append(detail::textOf(item));
+    }
+    return text;
+}
+
+// str.split() and str.split(None, maxsplit): runs of whitespace separate the
+// fields. The fields are slices of text unless Fields holds std::strings.
+template <typename Fields = List<std::string_view>>
+Fields split(std::string_view text, std::nullptr_t = nullptr, int64_t maxsplit = -1) {
+    Fields fields;
+    size_t i = 0;
+    while (true) {
+        while (i < text.size() && detail::isSpace(text[i])) {
+            ++i;
+        }
+        if (i == text.size()) {
+            return fields;
+        }
+        if (maxsplit >= 0 && static_cast<int64_t>(fields.size()) == maxsplit) {
+            fields.emplace_back(text.substr(i));
+            return fields;
+        }
+        size_t start = i;
+        while (i < text.size() && !detail::isSpace(text[i])) {
+            ++i;
+        }
+        fields.emplace_back(text.substr(start, i - start));
+    }
+}
+
+// str.split(sep) and str.split(sep, maxsplit)
+template <typename Fields = List<std::string_view>>
+Fields split(std::string_view text, std::string_view separator, int64_t maxsplit = -1) {
+    if (separator.empty()) {
+        throw std::invalid_argument("ValueError");
+    }
+    // Counting the separators first makes the list once at its final size
+    size_t count = 1;
+    for (size_t at = text.find(separator); at != std::string_view::npos &&
+                                           (maxsplit < 0 || static_cast<int64_t>(count) <= maxsplit);
+         at = text.find(separator, at + separator.size())) {
+        ++count;
+    }
+    Fields fields;
+    fields.reserve(count);
+    size_t start = 0;
+    while (maxsplit < 0 || static_cast<int64_t>(fields.size()) < maxsplit) {
+        size_t at = text.find(separator, start);
+        if (at == std::string_view::npos) {
+            break;
+        }
+        fields.emplace_back(text.substr(start, at - start));
+        start = at + separator.size();
+    }
+    fields.emplace_back(text.substr(start));
+    return fields;
+}
+
+// int() and float() of a slice, such as a split() field kept as a view
+inline int64_t toInt(std::string_view text) {
+    text = detail::numberText(text);
+    int64_t value = 0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc() || result.ptr != text.data() + text.size()) {
+        throw std::invalid_argument("ValueError");
+    }
+    return value;
+}
+
+inline double toFloat(std::string_view text) {
+    text = detail::numberText(text);
+    double value = 0;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc() || result.ptr != text.data() + text.size()) {
+        throw std::invalid_argument("ValueError");
+    }
+    return value;
+}
+
+// Keyword arguments of print()
+struct PrintOptions {
+    std::string_view sep = " ";
+    std::string_view end = "\n";
+    bool flush = false;
+    bool toStderr = false;  // file=sys.stderr
+};
+
+template <typename... Args>
+void print(const PrintOptions& options, const Args&... args) {
+    OutputBuffer& out = options.toStderr ? stderrBuffer() : stdoutBuffer();
+    bool first = true;
+    ((first ? void() : out.write(options.sep), first = false, detail::writeValue(out, args)), ...);
+    out.write(options.end);
+    out.endPrint(options.flush || options.toStderr);
+}
+
+template <typename... Args>
+void print(const Args&... args) {
+    print(PrintOptions{}, args...);
+}
+
+}  // namespace py2cpp
+
+inline std::ostream& operator<<(std::ostream& os, const PyValue& value) {
+    return os << py2cpp::str(value);
+}
@@ -1,472 +1,582 @@
-#include <iostream>
-#include <fstream>
-#include <string>
-#include <vector>
-#include <map>
-#include <sstream>
-#include <regex>
-#include <algorithm>
-
-class PythonToCppDecompiler {
-private:
-    std::string pythonCode;
-    bool hasClasses = false;
-    std::vector<std::string> definedFunctions;
-    std::vector<std::string> definedClasses;
-    int currentClassIndent = 0;
-    bool inClassMethod = false;
-    bool inMainGuard = false;
-    std::vector<std::string> mainCode;
-    std::vector<std::string> globalCode;
-    
-    std::map<std::string, std::string> typeMap = {
-        {"int", "int"},
-        {"str", "std::string"},
-        {"float", "double"},
-        {"list", "std::vector"},
-        {"dict", "std::map"},
-        {"bool", "bool"},
-        {"tuple", "std::tuple"},
-        {"set", "std::set"}
-    };
-
-    // Helper functions
-    std::string indentation(int level) {
-        return std::string(level * 4, ' ');
-    }
-
-    std::string processIndentation(const std::string& line) {
-        int indent = 0;
-        while (indent < line.length() && line[indent] == ' ') {
-            indent++;
-        }
-        return std::string(indent / 4 * 4, ' ');
-    }
-
-    std::string convertPythonType(const std::string& pythonType) {
-        auto it = typeMap.find(pythonType);
-        return it != typeMap.end() ? it->second : "auto";
-    }
-
-    std::string convertStringFormatting(const std::string& line) {
-        std::string result = line;
-        std::regex fstringRegex("f\"([^\"]*)\\{([^}]*)\\}(.*)\"");
-        std::smatch matches;
-        
-        while (std::regex_search(result, matches, fstringRegex)) {
-            std::string before = matches[1].str();
-            std::string var = matches[2].str();
-            std::string after = matches[3].str();
-            
-            result = "std::cout << \"" + before + "\" << " + var + " << \"" + after + "\" << std::endl";
-        }
-        
-        return result;
-    }
-
-    std::string convertListComprehension(const std::string& line) {
-        std::regex listCompRegex("\\[(.*?) for (.*?) in (.*?)\\]");
-        std::smatch matches;
-        if (std::regex_search(line, matches, listCompRegex)) {
-            std::string expr = matches[1].str();
-            std::string var = matches[2].str();
-            std::string container = matches[3].str();
-            
-            return "([&]() {\n"
-                   "    std::vector<auto> result;\n"
-                   "    for(const auto& " + var + " : " + container + ") {\n"
-                   "        result.push_back(" + expr + ");\n"
-                   "    }\n"
-                   "    return result;\n"
-                   "})()";
-        }
-        return line;
-    }
-
-    std::string convertDictComprehension(const std::string& line) {
-        std::regex dictCompRegex("\\{(.*?):(.*?) for (.*?) in (.*?)\\}");
-        std::smatch matches;
-        if (std::regex_search(line, matches, dictCompRegex)) {
-            std::string key = matches[1].str();
-            std::string value = matches[2].str();
-            std::string var = matches[3].str();
-            std::string container = matches[4].str();
-            
-            return "([&]() {\n"
-                   "    std::map<std::string, auto> result;\n"
-                   "    for(const auto& " + var + " : " + container + ") {\n"
-                   "        result[" + key + "] = " + value + ";\n"
-                   "    }\n"
-                   "    return result;\n"
-                   "})()";
-        }
-        return line;
-    }
-
-    std::string convertPythonFunction(const std::string& line) {
-        std::string result = line;
-        
-        // Convert print function
-        std::regex printRegex("print\\((.*)\\)");
-        result = std::regex_replace(result, printRegex, "std::cout << $1 << std::endl");
-
-        // Convert len function
-        std::regex lenRegex("len\\((.*)\\)");
-        result = std::regex_replace(result, lenRegex, "$1.size()");
-
-        // Convert super() call
-        std::regex superRegex("super\\(\\).__init__\\((.*)\\)");
-        if (std::regex_search(result, superRegex)) {
-            std::string baseClass = definedClasses[definedClasses.size() - 2];
-            result = std::regex_replace(result, superRegex, baseClass + "::__init__($1)");
-        }
-
-        // Convert self.attribute to this->attribute
-        std::regex selfRegex("self\\.");
-        result = std::regex_replace(result, selfRegex, "this->");
-
-        return result;
-    }
-
-    std::string convertPythonOperators(const std::string& line) {
-        std::string result = line;
-        
-        // Convert Python's not to C++'s !
-        std::regex notRegex("\\bnot\\b");
-        result = std::regex_replace(result, notRegex, "!");
-
-        // Convert and to &&
-        std::regex andRegex("\\band\\b");
-        result = std::regex_replace(result, andRegex, "&&");
-
-        // Convert or to ||
-        std::regex orRegex("\\bor\\b");
-        result = std::regex_replace(result, orRegex, "||");
-
-        // Convert is to ==
-        std::regex isRegex("\\bis\\b");
-        result = std::regex_replace(result, isRegex, "==");
-
-        // Convert is not to !=
-        std::regex isNotRegex("\\bis not\\b");
-        result = std::regex_replace(result, isNotRegex, "!=");
-
-        return result;
-    }
-
-    bool isClassDefinition(const std::string& line) {
-        return line.find("class ") == 0;
-    }
-
-    bool isClassMethod(const std::string& line, int indent) {
-        return indent > currentClassIndent && line.find("def ") == 0;
-    }
-
-    std::string convertClass(const std::string& line) {
-        std::regex classRegex("class (\\w+)(?:\\((.*)\\))?:");
-        std::smatch matches;
-        if (std::regex_search(line, matches, classRegex)) {
-            std::string className = matches[1].str();
-            std::string inheritance = matches[2].str();
-            definedClasses.push_back(className);
-            
-            std::string result = "\nclass " + className;
-            if (!inheritance.empty()) {
-                result += " : public " + inheritance;
-            }
-            result += " {\npublic:";
-            return result;
-        }
-        return line;
-    }
-
-    std::string convertClassMethod(const std::string& line) {
-        std::regex methodRegex("def (\\w+)\\(self(?:,\\s*(.*))?\\):");
-        std::smatch matches;
-        if (std::regex_search(line, matches, methodRegex)) {
-            std::string methodName = matches[1].str();
-            std::string params = matches[2].str();
-            inClassMethod = true;
-            
-            if (methodName == "__init__") {
-                return definedClasses.back() + "(" + (params.empty() ? "" : params) + ") {";
-            }
-            
-            return "auto " + methodName + "(" + (params.empty() ? "" : params) + ") {";
-        }
-        return line;
-    }
-
-    std::string handleExceptions(const std::string& line) {
-        if (line.find("try:") == 0) {
-            return "try {";
-        }
-        std::regex exceptRegex("except(?: (\\w+))?(?: as (\\w+))?:");
-        std::smatch matches;
-        if (std::regex_search(line, matches, exceptRegex)) {
-            std::string exceptionType = matches[1].str();
-            std::string exceptionVar = matches[2].str();
-            
-            if (exceptionType.empty()) {
-                return "} catch (...) {";
-            }
-            
-            return "} catch (const std::" + exceptionType + "& " + 
-                   (exceptionVar.empty() ? "e" : exceptionVar) + ") {";
-        }
-        return line;
-    }
-
-    bool isMainGuard(const std::string& line) {
-        return line.find("if __name__ == \"__main__\":") == 0;
-    }
-
-    std::string processLine(const std::string& line, int indentLevel, bool inClass) {
-        std::string processedLine = line;
-
-        // Skip empty lines and comments
-        if (line.empty() || line.find("#") == 0) {
-            return line;
-        }
-
-        // Convert basic Python constructs to C++
-        if (line.find("if ") == 0) {
-            processedLine = "if (" + line.substr(3) + ") {";
-        }
-        else if (line.find("else:") == 0) {
-            processedLine = "} else {";
-        }
-        else if (line.find("elif ") == 0) {
-            processedLine = "} else if (" + line.substr(5) + ") {";
-        }
-        else if (line.find("while ") == 0) {
-            processedLine = "while (" + line.substr(6) + ") {";
-        }
-        else if (line.find("for ") == 0) {
-            std::regex forInRegex("for (.*) in (.*):");
-            std::smatch matches;
-            if (std::regex_search(line, matches, forInRegex)) {
-                std::string var = matches[1].str();
-                std::string container = matches[2].str();
-                
-                if (container.find("range(") == 0) {
-                    std::regex rangeRegex("range\\((\\d+)(?:,\\s*(\\d+))?\\)");
-                    std::smatch rangeMatches;
-                    if (std::regex_search(container, rangeMatches, rangeRegex)) {
-                        std::string start = rangeMatches[1].str();
-                        std::string end = rangeMatches[2].str();
-                        if (end.empty()) {
-                            processedLine = "for(int " + var + " = 0; " + var + " < " + start + "; ++" + var + ") {";
-                        } else {
-                            processedLine = "for(int " + var + " = " + start + "; " + var + " < " + end + "; ++" + var + ") {";
-                        }
-                    }
-                } else {
-                    processedLine = "for(const auto& " + var + " : " + container + ") {";
-                }
-            }
-        }
-        else if (line.find("def ") == 0 && !inClass) {
-            std::regex defRegex("def (\\w+)\\((.*)\\):");
-            std::smatch matches;
-            if (std::regex_search(line, matches, defRegex)) {
-                std::string funcName = matches[1].str();
-                std::string params = matches[2].str();
-                processedLine = "\nauto " + funcName + "(" + params + ") {";
-            }
-        }
-        else if (line.find("return ") == 0) {
-            processedLine = "return " + line.substr(7) + ";";
-        }
-        else if (line.find("raise ") == 0) {
-            std::regex raiseRegex("raise (\\w+)\\((.*)\\)");
-            std::smatch matches;
-            if (std::regex_search(line, matches, raiseRegex)) {
-                std::string exceptionType = matches[1].str();
-                std::string message = matches[2].str();
-                processedLine = "throw std::" + exceptionType + "(" + message + ");";
-            }
-        }
-        else if (line.find("try:") == 0 || line.find("except") == 0) {
-            processedLine = handleExceptions(line);
-        }
-        else if (line.find("pass") == 0) {
-            processedLine = "// pass";
-        }
-        else {
-            processedLine = convertPythonFunction(processedLine);
-            processedLine = convertPythonOperators(processedLine);
-            processedLine = convertStringFormatting(processedLine);
-            processedLine = convertListComprehension(processedLine);
-            processedLine = convertDictComprehension(processedLine);
-            if (!processedLine.empty() && processedLine.back() != '{' && processedLine.find("//") != 0) {
-                processedLine += ";";
-            }
-        }
-
-        return processedLine;
-    }
-
-public:
-    PythonToCppDecompiler(const std::string& code) : pythonCode(code) {}
-
-    std::string decompile() {
-        std::stringstream result;
-        result << "#include <iostream>\n";
-        result << "#include <string>\n";
-        result << "#include <vector>\n";
-        result << "#include <map>\n";
-        result << "#include <set>\n";
-        result << "#include <tuple>\n";
-        result << "#include <stdexcept>\n";
-        result << "#include <algorithm>\n\n";
-
-        // First pass to collect functions and classes
-        std::stringstream ss(pythonCode);
-        std::string line;
-        while (std::getline(ss, line)) {
-            if (line.find("def ") == 0) {
-                std::regex defRegex("def (\\w+)");
-                std::smatch matches;
-                if (std::regex_search(line, matches, defRegex)) {
-                    definedFunctions.push_back(matches[1].str());
-                }
-            }
-            else if (isClassDefinition(line)) {
-                hasClasses = true;
-            }
-        }
-
-        // Reset stream for second pass
-        ss.clear();
-        ss.str(pythonCode);
-
-        int currentIndentLevel = 0;
-        bool inClass = false;
-        bool inFunction = false;
-
-        // Process the code
-        while (std::getline(ss, line)) {
-            if (line.empty() || line.find_first_not_of(" \t") == std::string::npos) {
-                result << "\n";
-                continue;
-            }
-
-            std::string indent = processIndentation(line);
-            int indentLevel = static_cast<int>(indent.length() / 4);
-            line = line.substr(indent.length());
-
-            // Skip comments
-            if (line.find("#") == 0) {
-                result << indentation(currentIndentLevel) << "//" << line.substr(1) << "\n";
-                continue;
-            }
-
-            // Handle main guard
-            if (isMainGuard(line)) {
-                inMainGuard = true;
-                continue;
-            }
-            
-            // Store main code for later
-            if (inMainGuard) {
-                if (indentLevel > 0) {
-                    mainCode.push_back(line);
-                }
-                continue;
-            }
-            
-            // Handle class definitions
-            if (isClassDefinition(line)) {
-                line = convertClass(line);
-                inClass = true;
-                currentClassIndent = indentLevel;
-            }
-            // Handle class methods
-            else if (isClassMethod(line, indentLevel)) {
-                line = convertClassMethod(line);
-            }
-            else {
-                line = processLine(line, indentLevel, inClass);
-            }
-
-            // Handle indentation and scope
-            if (line.find("}") != std::string::npos) {
-                currentIndentLevel--;
-                if (inClass && currentIndentLevel == currentClassIndent) {
-                    inClass = false;
-                    line += ";";  // Class definition needs semicolon
-                }
-                if (inFunction && currentIndentLevel == (inClass ? currentClassIndent + 1 : 0)) {
-                    inFunction = false;
-                }
-                if (inClassMethod && currentIndentLevel == currentClassIndent + 1) {
-                    inClassMethod = false;
-                }
-            }
-
-            result << indentation(currentIndentLevel) << line << "\n";
-
-            if (line.find("{") != std::string::npos) {
-                currentIndentLevel++;
-            }
-        }
-
-        // Add main function with the collected main code
-        if (!mainCode.empty()) {
-            result << "\nint main() {\n";
-            for (const auto& line : mainCode) {
-                std::string processedLine = processLine(line, 1, false);
-                result << "    " << processedLine << "\n";
-            }
-            result << "    return 0;\n";
-            result << "}\n";
-        }
-        else if (!hasClasses && definedFunctions.empty()) {
-            result << "\nint main() {\n";
-            result << "    return 0;\n";
-            result << "}\n";
-        }
-
-        return result.str();
-    }
-};
-
-int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cout << "Usage: " << argv[0] << " <input_python_file> <output_cpp_file>" << std::endl;
-        return 1;
-    }
-
-    std::string inputFile = argv[1];
-    std::string outputFile = argv[2];
-
-    // Read Python file
-    std::ifstream pyFile(inputFile);
-    if (!pyFile.is_open()) {
-        std::cerr << "Error: Could not open input file " << inputFile << std::endl;
-        return 1;
-    }
-
-    std::stringstream buffer;
-    buffer << pyFile.rdbuf();
-    std::string pythonCode = buffer.str();
-    pyFile.close();
-
-    // Decompile Python to C++
-    PythonToCppDecompiler decompiler(pythonCode);
-    std::string cppCode = decompiler.decompile();
-
-    // Write C++ file
-    std::ofstream cppFile(outputFile);
-    if (!cppFile.is_open()) {
-        std::cerr << "Error: Could not open output file " << outputFile << std::endl;
-        return 1;
-    }
-
-    cppFile << cppCode;
-    cppFile.close();
-
-    std::cout << "Decompilation completed successfully!" << std::endl;
-    return 0;
-} 
\ No newline at end of file
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+#include "file_io.hpp"
+#include "module_graph.hpp"
+#include "profiler.hpp"
+#include "py2cpp_runtime_source.hpp"
+#include "py_to_cpp_decompiler.hpp"
+#include "serve.hpp"
+#include "thread_pool.hpp"
+#include "translation_cache.hpp"
+
+struct TranslationResult {
+    size_t bytesIn = 0;
+    size_t bytesOut = 0;
+    std::string error;
+};
+
+// The output of a file with statements py2cpp cannot translate is still
+// written, with an #error for each, but the translation counts as failed
+static bool unsupportedError(const std::string& inputFile, const PythonToCppDecompiler& decompiler,
+                             std::string& error) {
+    const std::vector<std::string>& statements = decompiler.unsupportedStatements();
+    if (statements.empty()) {
+        return false;
+    }
+    error = (inputFile.empty() ? "" : inputFile + ": ") + "unsupported statement at " + statements.front();
+    if (statements.size() > 1) {
+        error += " (and " + std::to_string(statements.size() - 1) + " more)";
+    }
+    return true;
+}
+
+// Reads, translates and writes one file; with a cache, unchanged inputs reuse
+// the stored output without running the decompiler at all
+static TranslationResult translateFile(const std::string& inputFile, const std::string& outputFile,
+                                       PythonToCppDecompiler& decompiler, TranslationCache* cache) {
+    TranslationResult result;
+    if (Profiler* profiler = Profiler::current()) {
+        profiler->beginFile(inputFile);
+    }
+    MappedFile input;
+    if (!input.open(inputFile)) {
+        result.error = "Could not open input file " + inputFile;
+        return result;
+    }
+    std::string_view pythonCode = input.view();
+    result.bytesIn = pythonCode.size();
+
+    std::string cacheKey;
+    if (cache != nullptr) {
+        cacheKey = cache->key(pythonCode);
+        if (cache->fetch(cacheKey, outputFile, result.bytesOut)) {
+            return result;
+        }
+    }
+
+    FileSink output;
+    if (!output.open(outputFile)) {
+        result.error = "Could not open output file " + outputFile;
+        return result;
+    }
+    try {
+        decompiler.decompile(pythonCode, output);
+    } catch (const std::exception& e) {
+        result.error = inputFile + ": " + e.what();
+        return result;
+    }
+    if (!output.close()) {
+        result.error = "Could not write output file " + outputFile;
+        return result;
+    }
+    result.bytesOut = output.bytesWritten();
+    if (unsupportedError(inputFile, decompiler, result.error)) {
+        return result;
+    }
+    if (cache != nullptr) {
+        cache->store(cacheKey, outputFile);
+    }
+    return result;
+}
+
+// --modules: translates one module of the project into <stem>.hpp and <stem>.cpp
+static TranslationResult translateModule(const ModuleGraph& graph, const ModuleTypes& types, size_t index,
+                                         const std::filesystem::path& outputDir, PythonToCppDecompiler& decompiler) {
+    TranslationResult result;
+    const ModuleGraph::Module& module = graph.all()[index];
+    std::string inputFile = module.source.string();
+    if (Profiler* profiler = Profiler::current()) {
+        profiler->beginFile(inputFile);
+    }
+    MappedFile input;
+    if (!input.open(inputFile)) {
+        result.error = "Could not open input file " + inputFile;
+        return result;
+    }
+    result.bytesIn = input.size();
+    std::string header;
+    std::string source;
+    try {
+        decompiler.decompileModule(input.view(), graph, index, header, source, &types);
+    } catch (const std::exception& e) {
+        result.error = inputFile + ": " + e.what();
+        return result;
+    }
+    for (const std::string* text : {&header, &source}) {
+        std::string outputFile = (outputDir / (module.stem + (text == &header ? ".hpp" : ".cpp"))).string();
+        FileSink output;
+        if (!output.open(outputFile)) {
+            result.error = "Could not open output file " + outputFile;
+            return result;
+        }
+        output.write(*text);
+        if (!output.close()) {
+            result.error = "Could not write output file " + outputFile;
+            return result;
+        }
+    }
+    result.bytesOut = header.size() + source.size();
+    unsupportedError(inputFile, decompiler, result.error);
+    return result;
+}
+
+static bool writeText(const std::filesystem::path& path, std::string_view text, std::string& error) {
+    FileSink output;
+    if (!output.open(path.string())) {
+        error = "Could not open output file " + path.string();
+        return false;
+    }
+    output.write(text);
+    if (!output.close()) {
+        error = "Could not write output file " + path.string();
+        return false;
+    }
+    return true;
+}
+
+// Jumbo translation units that each #include a share of the imported modules'
+// .cpp files; entry points are left to be compiled on their own
+static bool writeUnityFiles(const std::filesystem::path& outputDir, const ModuleGraph& graph,
+                            const std::vector<size_t>& weights, size_t count, std::string& error) {
+    std::vector<std::vector<size_t>> groups = graph.unityGroups(weights, count);
+    for (size_t i = 0; i < groups.size(); ++i) {
+        std::string text = "// Unity build: compile this file instead of the modules it includes\n";
+        text += "#include \"" + std::string(PythonToCppDecompiler::kPrecompiledHeader) + "\"\n";
+        for (size_t index : groups[i]) {
+            text += "#include \"" + graph.all()[index].stem + ".cpp\"\n";
+        }
+        if (!writeText(outputDir / ("py2cpp_unity_" + std::to_string(i) + ".cpp"), text, error)) {
+            return false;
+        }
+    }
+    std::cout << "Unity build: " << groups.size() << " files for " << count << " cores\n";
+    return true;
+}
+
+// Generated files include py2cpp_runtime.hpp from their own directory. An
+// up-to-date copy is left alone so builds of the output stay incremental.
+static bool writeRuntime(const std::filesystem::path& directory, std::string& error) {
+    std::string path = (directory.empty() ? std::filesystem::path(".") : directory) / "py2cpp_runtime.hpp";
+    {
+        MappedFile existing;
+        if (existing.open(path) && existing.view() == kRuntimeSource) {
+            return true;
+        }
+    }
+    FileSink output;
+    if (!output.open(path)) {
+        error = "Could not open output file " + path;
+        return false;
+    }
+    output.write(kRuntimeSource);
+    if (!output.close()) {
+        error = "Could not write output file " + path;
+        return false;
+    }
+    return true;
+}
+
+static void printCacheStats(const TranslationCache& cache) {
+    size_t lookups = cache.hits() + cache.misses();
+    std::cout << "Cache: " << cache.hits() << " hits, " << cache.misses() << " misses ("
+              << std::fixed << std::setprecision(1) << (lookups > 0 ? 100.0 * cache.hits() / lookups : 0.0)
+              << "% hit rate)\n";
+}
+
+// Translates every .py file under inputDir into the same layout under outputDir.
+// Each file gets its own decompiler, so no state is shared between workers.
+// With `modules` every file becomes a .hpp/.cpp pair instead, and unityFiles
+// above zero also writes that many unity translation units.
+static int runBatch(const std::filesystem::path& inputDir, const std::filesystem::path& outputDir, size_t jobs,
+                    const DecompilerOptions& options, TranslationCache* cache, Profiler* profile, bool modules,
+                    size_t unityFiles) {
+    namespace fs = std::filesystem;
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::pair<fs::path, fs::path>> files;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(inputDir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file(ec) && it->path().extension() == ".py") {
+            fs::path target = outputDir / fs::relative(it->path(), inputDir);
+            target.replace_extension(".cpp");
+            files.emplace_back(it->path(), target);
+        }
+    }
+    if (ec) {
+        std::cerr << "Error: Could not scan input directory " << inputDir.string() << ": " << ec.message() << std::endl;
+        return 1;
+    }
+    ModuleGraph graph;
+    ModuleTypes moduleTypes;
+    if (modules) {
+        std::vector<fs::path> sources;
+        for (const auto& file : files) {
+            sources.push_back(file.first);
+        }
+        std::string error;
+        if (!graph.build(inputDir, sources, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+        // Types flow along the imports, so the whole project is typed before
+        // any module is split up
+        Profiler::current() = profile;
+        moduleTypes.infer(graph);
+        Profiler::current() = nullptr;
+    }
+    // Directories are created up front so workers never race on them. Modules
+    // share one runtime header and precompiled header at the root.
+    std::set<fs::path> directories;
+    for (const auto& file : files) {
+        if (directories.insert(file.second.parent_path()).second) {
+            fs::create_directories(file.second.parent_path(), ec);
+            std::string error;
+            if (!modules && !writeRuntime(file.second.parent_path(), error)) {
+                std::cerr << "Error: " << error << std::endl;
+                return 1;
+            }
+        }
+    }
+    if (modules) {
+        fs::create_directories(outputDir, ec);
+        std::string error;
+        if (!writeRuntime(outputDir, error) ||
+            !writeText(outputDir / PythonToCppDecompiler::kPrecompiledHeader,
+                       PythonToCppDecompiler::precompiledHeader(), error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+    }
+    std::vector<size_t> weights(files.size(), 0);
+
+    std::atomic<size_t> bytesIn{0};
+    std::atomic<size_t> bytesOut{0};
+    std::atomic<size_t> failures{0};
+    std::mutex errorMutex;
+    std::mutex profileMutex;
+    std::atomic<uint32_t> nextThreadId{1};
+    WorkStealingPool pool(jobs);
+    for (size_t i = 0; i < files.size(); ++i) {
+        pool.submit([i, &files, &graph, &moduleTypes, &weights, modules, &outputDir, &options, cache, profile, &bytesIn, &bytesOut,
+                     &failures, &errorMutex, &profileMutex, &nextThreadId] {
+            auto translate = [&] {
+                PythonToCppDecompiler decompiler(options);
+                if (modules) {
+                    return translateModule(graph, moduleTypes, i, outputDir, decompiler);
+                }
+                return translateFile(files[i].first.string(), files[i].second.string(), decompiler, cache);
+            };
+            TranslationResult result;
+            if (profile != nullptr) {
+                // Each file is profiled on its own and folded into the run total
+                static thread_local uint32_t threadId = nextThreadId++;
+                Profiler fileProfile(threadId);
+                Profiler::current() = &fileProfile;
+                result = translate();
+                Profiler::current() = nullptr;
+                std::lock_guard<std::mutex> lock(profileMutex);
+                profile->merge(fileProfile);
+            } else {
+                result = translate();
+            }
+            if (!result.error.empty()) {
+                ++failures;
+                std::lock_guard<std::mutex> lock(errorMutex);
+                std::cerr << "Error: " << result.error << std::endl;
+                return;
+            }
+            bytesIn += result.bytesIn;
+            bytesOut += result.bytesOut;
+            weights[i] = result.bytesOut;
+        });
+    }
+    pool.wait();
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double megabytes = bytesIn / (1024.0 * 1024.0);
+    std::cout << "Translated " << files.size() - failures << " of " << files.size() << " files, "
+              << bytesIn << " bytes in, " << bytesOut << " bytes out\n";
+    std::cout << "Wall time " << std::fixed << std::setprecision(3) << wall << " s, "
+              << std::setprecision(1) << (wall > 0 ? megabytes / wall : 0.0) << " MB/s on "
+              << pool.size() << " workers\n";
+    std::vector<WorkStealingPool::WorkerStats> stats = pool.stats();
+    for (size_t i = 0; i < stats.size(); ++i) {
+        std::cout << "  worker " << i << ": " << stats[i].tasks << " files (" << stats[i].stolen << " stolen), busy "
+                  << std::setprecision(3) << stats[i].busySeconds << " s, "
+                  << std::setprecision(1) << (wall > 0 ? 100.0 * stats[i].busySeconds / wall : 0.0) << "% utilisation\n";
+    }
+    if (cache != nullptr) {
+        printCacheStats(*cache);
+    }
+    if (unityFiles > 0 && failures == 0) {
+        std::string error;
+        if (!writeUnityFiles(outputDir, graph, weights, unityFiles, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+#ifndef _WIN32
+// Everything --serve keeps between requests: the decompiler with its arenas and
+// buffers, the cache, and the buffer cache hits are loaded into
+struct ServeState {
+    PythonToCppDecompiler decompiler;
+    TranslationCache* cache;
+    std::string cached;
+
+    ServeState(const DecompilerOptions& options, TranslationCache* translationCache)
+        : decompiler(options), cache(translationCache) {}
+};
+
+static bool serveTranslate(FrameChannel& channel, ServeState& state, const std::string& source) {
+    std::string cacheKey;
+    if (state.cache != nullptr) {
+        cacheKey = state.cache->key(source);
+        if (state.cache->load(cacheKey, state.cached)) {
+            return channel.writeFrame("ok", state.cached);
+        }
+    }
+    try {
+        const std::string& translation = state.decompiler.translate(source);
+        std::string error;
+        if (unsupportedError("", state.decompiler, error)) {
+            return channel.writeFrame("error", error);
+        }
+        if (state.cache != nullptr) {
+            state.cache->storeText(cacheKey, translation);
+        }
+        return channel.writeFrame("ok", translation);
+    } catch (const std::exception& e) {
+        return channel.writeFrame("error", e.what());
+    }
+}
+
+// The payload is the input path and the output path on two lines
+static bool serveFile(FrameChannel& channel, ServeState& state, const std::string& paths) {
+    size_t split = paths.find('\n');
+    if (split == std::string::npos) {
+        return channel.writeFrame("error", "file requests need an input and an output path");
+    }
+    std::string outputFile = paths.substr(split + 1);
+    TranslationResult result = translateFile(paths.substr(0, split), outputFile, state.decompiler, state.cache);
+    if (result.error.empty()) {
+        writeRuntime(std::filesystem::path(outputFile).parent_path(), result.error);
+    }
+    return result.error.empty() ? channel.writeFrame("ok", "") : channel.writeFrame("error", result.error);
+}
+
+// Answers requests on one connection until the client closes it. Returns false
+// once a client has asked the server to shut down.
+static bool serveConnection(FrameChannel& channel, ServeState& state) {
+    std::string command;
+    std::string payload;
+    while (channel.readFrame(command, payload)) {
+        bool sent = false;
+        if (command == "translate") {
+            sent = serveTranslate(channel, state, payload);
+        } else if (command == "file") {
+            sent = serveFile(channel, state, payload);
+        } else if (command == "shutdown") {
+            channel.writeFrame("ok", "");
+            return false;
+        } else {
+            sent = channel.writeFrame("error", "unknown command '" + command + "'");
+        }
+        if (!sent) {
+            break;
+        }
+    }
+    if (!channel.error().empty()) {
+        std::cerr << "Error: " << channel.error() << std::endl;
+        // The stream is out of sync after a bad frame, so the connection ends here
+        channel.writeFrame("error", channel.error());
+    }
+    return true;
+}
+
+// Serves translation requests on stdin/stdout, or on a Unix domain socket one
+// client at a time, with one warm decompiler for the whole session
+static int runServe(const DecompilerOptions& options, TranslationCache* cache, const std::string& socketPath) {
+    // A client that goes away mid-response must not take the server with it
+    std::signal(SIGPIPE, SIG_IGN);
+    ServeState state(options, cache);
+    if (socketPath.empty()) {
+        FrameChannel channel(STDIN_FILENO, STDOUT_FILENO);
+        serveConnection(channel, state);
+        return channel.error().empty() ? 0 : 1;
+    }
+    UnixListener listener;
+    std::string error;
+    if (!listener.listen(socketPath, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+    std::cerr << "Listening on " << socketPath << std::endl;
+    while (true) {
+        int client = listener.accept();
+        if (client < 0) {
+            std::cerr << "Error: Could not accept a connection: " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        FrameChannel channel(client, client);
+        bool serving = serveConnection(channel, state);
+        ::close(client);
+        if (!serving) {
+            return 0;
+        }
+    }
+}
+#endif
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " <input_python_file> <output_cpp_file>" << std::endl;
+    std::cout << "       " << program << " [--jobs N] <input_dir> <output_dir>" << std::endl;
+    std::cout << "       " << program << " --serve [--socket PATH]" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --jobs N         Worker threads for directory input (default: all cores)" << std::endl;
+    std::cout << "  --cache-dir DIR  Reuse translations of unchanged files stored in DIR" << std::endl;
+    std::cout << "  --std-containers Emit std::vector/map/set instead of the runtime's List/Dict/Set" << std::endl;
+    std::cout << "  --parallel       Run pure list comprehensions and sums on all cores (build with -fopenmp)"
+              << std::endl;
+    std::cout << "  --modules        For directory input, emit a .hpp/.cpp pair per module linked by its imports"
+              << std::endl;
+    std::cout << "  --unity N|auto   With --modules, also write N unity build files (auto: one per core)" << std::endl;
+    std::cout << "  --serve          Answer framed translation requests on stdin/stdout with a warm decompiler"
+              << std::endl;
+    std::cout << "  --socket PATH    With --serve, listen on a Unix domain socket instead" << std::endl;
+    std::cout << "  --profile        Print per-stage timings and counters, and write a Chrome trace" << std::endl;
+    std::cout << "  --profile-out F  Trace file for --profile (default: py2cpp_trace.json)" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+    std::string cacheDir;
+    bool profileEnabled = false;
+    DecompilerOptions options;
+    std::string traceFile = "py2cpp_trace.json";
+    bool serve = false;
+    bool modules = false;
+    size_t unityFiles = 0;
+    std::string socketPath;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if ((arg == "--jobs" || arg == "-j") && i + 1 < argc) {
+            jobs = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--cache-dir" && i + 1 < argc) {
+            cacheDir = argv[++i];
+        } else if (arg == "--std-containers") {
+            options.stdContainers = true;
+        } else if (arg == "--parallel") {
+            options.parallel = true;
+        } else if (arg == "--modules") {
+            modules = true;
+        } else if (arg == "--unity" && i + 1 < argc) {
+            std::string value = argv[++i];
+            unityFiles = value == "auto" ? std::max(1u, std::thread::hardware_concurrency())
+                                         : static_cast<size_t>(std::max(1, std::atoi(value.c_str())));
+        } else if (arg == "--serve") {
+            serve = true;
+        } else if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "--profile") {
+            profileEnabled = true;
+        } else if (arg == "--profile-out" && i + 1 < argc) {
+            profileEnabled = true;
+            traceFile = argv[++i];
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() != (serve ? 0 : 2) || (!socketPath.empty() && !serve) || (serve && profileEnabled) ||
+        (unityFiles > 0 && !modules)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::unique_ptr<TranslationCache> cache;
+    if (!cacheDir.empty()) {
+        cache = std::make_unique<TranslationCache>(cacheDir, PythonToCppDecompiler::kVersion, options.key());
+        std::string error;
+        if (!cache->open(error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+    }
+
+    if (serve) {
+#ifdef _WIN32
+        std::cerr << "Error: --serve is not available on Windows" << std::endl;
+        return 1;
+#else
+        return runServe(options, cache.get(), socketPath);
+#endif
+    }
+
+    std::string inputFile = paths[0];
+    std::string outputFile = paths[1];
+
+    std::unique_ptr<Profiler> profile;
+    if (profileEnabled) {
+        if (!Profiler::kEnabled) {
+            std::cerr << "Error: --profile is not available, this build has PY2CPP_PROFILING turned off" << std::endl;
+            return 1;
+        }
+        profile = std::make_unique<Profiler>();
+    }
+
+    int status = 0;
+    if (std::filesystem::is_directory(inputFile)) {
+        // Module output depends on the whole project, so it is never cached
+        status = runBatch(inputFile, outputFile, jobs, options, modules ? nullptr : cache.get(), profile.get(), modules,
+                          unityFiles);
+    } else if (modules) {
+        std::cerr << "Error: --modules needs an input directory" << std::endl;
+        return 1;
+    } else {
+        Profiler::current() = profile.get();
+        PythonToCppDecompiler decompiler(options);
+        TranslationResult result = translateFile(inputFile, outputFile, decompiler, cache.get());
+        Profiler::current() = nullptr;
+        if (result.error.empty()) {
+            writeRuntime(std::filesystem::path(outputFile).parent_path(), result.error);
+        }
+        if (!result.error.empty()) {
+            std::cerr << "Error: " << result.error << std::endl;
+            return 1;
+        }
+        if (cache != nullptr) {
+            printCacheStats(*cache);
+        }
+        std::cout << "Decompilation completed successfully!" << std::endl;
+    }
+
+    if (profile != nullptr) {
+        std::cout << '\n';
+        profile->printTable(std::cout);
+        if (profile->writeTrace(traceFile)) {
+            std::cout << "\nTrace written to " << traceFile << std::endl;
+        } else {
+            std::cerr << "Error: Could not write trace file " << traceFile << std::endl;
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,3751 @@
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "arena.hpp"
+#include "constant_folding.hpp"
+#include "file_io.hpp"
+#include "loop_lowering.hpp"
+#include "module_graph.hpp"
+#include "module_types.hpp"
+#include "ownership.hpp"
+#include "py2cpp_runtime.hpp"
+#include "profiler.hpp"
+#include "purity.hpp"
+#include "python_ast.hpp"
+#include "python_lexer.hpp"
+#include "python_parser.hpp"
+#include "string_lowering.hpp"
+#include "type_inference.hpp"
+
+// Choices that change the generated code; key() goes into cache keys
+struct DecompilerOptions {
+    bool stdContainers = false;  // std::vector/map/set instead of the runtime's List/Dict/Set
+    bool parallel = false;       // Pure list comprehensions and sums through py2cpp::parallelMap/parallelSum
+
+    std::string key() const {
+        std::string key = stdContainers ? "std-containers" : "";
+        if (parallel) {
+            key += key.empty() ? "parallel" : ",parallel";
+        }
+        return key;
+    }
+};
+
+// Translates one Python module to C++. Instances hold per-file state only, so
+// separate instances can run concurrently on different threads.
+class PythonToCppDecompiler {
+private:
+    // Microbenchmarks drive the individual converters directly
+    friend class DecompilerBench;
+
+    // C++ operator precedence, higher binds tighter
+    enum Precedence {
+        kLowest = 0,
+        kConditional = 1,
+        kLogicalOr = 2,
+        kLogicalAnd = 3,
+        kBitOr = 4,
+        kBitXor = 5,
+        kBitAnd = 6,
+        kEquality = 7,
+        kRelational = 8,
+        kShift = 9,
+        kAdditive = 10,
+        kMultiplicative = 11,
+        kUnary = 12,
+        kPostfix = 13,
+        kPrimary = 14
+    };
+
+    // Names already declared in the function (or main) being generated. Names are
+    // interned by the parser, so comparing the data pointers is enough.
+    struct Scope {
+        std::vector<std::string_view> names;
+        std::vector<std::string_view> exceptionVars;
+
+        static bool contains(const std::vector<std::string_view>& list, std::string_view name) {
+            for (std::string_view n : list) {
+                if (n.data() == name.data() && n.size() == name.size()) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool declared(std::string_view name) const {
+            return contains(names, name);
+        }
+
+        void declare(std::string_view name) {
+            if (!declared(name)) {
+                names.push_back(name);
+            }
+        }
+    };
+
+    // Output is handed to the sink whenever this much has been generated
+    static constexpr size_t kFlushSize = 64 * 1024;
+    // Inputs up to this size are parsed whole so types can be inferred across
+    // the module; larger ones are streamed with statement-local inference
+    static constexpr size_t kWholeModuleLimit = 16 * 1024 * 1024;
+
+    std::string_view pythonCode;
+    DecompilerOptions options;
+    // AST nodes live only until their top-level statement has been generated;
+    // interned names are kept for the whole file
+    Arena arena;
+    Arena nameArena;
+    StringInterner interner{nameArena};
+    // Output of translate(); keeps its capacity from one call to the next
+    std::string translation;
+    bool hasClasses = false;
+    std::vector<std::string_view> definedFunctions;
+    std::vector<std::string_view> definedClasses;
+    std::string currentBaseClass;
+    const ClassDef* currentClass = nullptr;
+    bool inClassMethod = false;
+    Scope globalScope;
+    Scope* scope = &globalScope;
+    TypeInference types;
+    PurityAnalysis purity;
+    CompileTimeFunctions compileTime;
+    // Variable types of the function (or main) being generated
+    TypeInference::FunctionTypes* localTypes = nullptr;
+    // Signature whose return statements are being generated; null inside lambdas
+    const TypeInference::FunctionTypes* returnTypes = nullptr;
+
+    // xs[i] inside a range(len(xs)) loop lowered to a range-for over xs
+    struct ElementAlias {
+        std::string_view sequence;
+        std::string_view index;
+        std::string_view element;
+    };
+    std::vector<ElementAlias> elementAliases;
+
+    // Parameters of the function being generated that are taken by const
+    // reference, and the name occurrences that are moved from
+    std::vector<std::string_view> constRefParams;
+    std::vector<const Expr*> movedNames;
+    // Parameters taken by reference because the body changes them, and the
+    // names whose value is changed in place; loop variables among them, and
+    // elements of such sequences, are bound by reference
+    std::vector<std::string_view> refParams;
+    std::vector<std::string_view> changedNames;
+    // Which call arguments bind to such parameters; empty unless the whole
+    // module is translated at once, since every caller has to be known
+    ReferenceTable references;
+    // The analyses of the last pass over the functions that have list, dict,
+    // set or object parameters, which saw the final table, and those functions
+    std::vector<OwnershipAnalysis> referenceAnalyses;
+    std::vector<const FunctionDef*> referenceDefs;
+
+    // Loop variables bound to std::string_view slices of a split() string
+    std::vector<std::string_view> viewNames;
+
+    // Per enclosing loop, the flag its break sets so its else block is
+    // skipped; empty for loops without one
+    std::vector<std::string_view> breakFlags;
+
+    // "line N: text" for each statement emitted as #error, so callers can fail
+    // the translation instead of handing back code that does not compile
+    std::vector<std::string> unsupported;
+    // Set by an expression with no translation (an f-string's nested format
+    // spec, print() to a file), which turns the statement holding it into an #error
+    bool unsupportedExpression = false;
+
+    // Counted range(N) loop whose calls of bounded constexpr functions on the
+    // index read from tables computed while compiling
+    struct TableLoop {
+        const RangeLoop* loop;
+        int64_t count;
+        int level;
+        std::string tables;  // Definitions, inserted ahead of the loop
+        std::vector<std::pair<std::string, std::string_view>> built;  // Call -> table name
+    };
+    std::vector<TableLoop> tableLoops;
+    // --modules: the project and the module being translated, and the names
+    // its imports bind to project modules (with the dotted module name)
+    const ModuleGraph* graph = nullptr;
+    const ModuleGraph::Module* currentModule = nullptr;
+    std::vector<std::pair<std::string_view, std::string>> moduleAliases;
+    static constexpr int64_t kMaxTableSize = 4096;
+
+    // Lookup tables are immutable and shared by every decompiler instance
+    static inline const std::map<std::string, std::string> exceptionMap = {
+        {"BaseException", "std::exception"},
+        {"Exception", "std::exception"},
+        {"ValueError", "std::invalid_argument"},
+        {"TypeError", "std::invalid_argument"},
+        {"KeyError", "std::out_of_range"},
+        {"IndexError", "std::out_of_range"},
+        {"RuntimeError", "std::runtime_error"},
+        {"ArithmeticError", "std::runtime_error"},
+        {"ZeroDivisionError", "std::domain_error"},
+        {"OverflowError", "std::overflow_error"},
+        {"NotImplementedError", "std::logic_error"},
+        {"AssertionError", "std::logic_error"}
+    };
+
+    // Helper functions
+    void indentation(std::string& out, int level) {
+        out.append(level * 4, ' ');
+    }
+
+    // Finishes a line built in place in the output
+    void endLine(std::string& out, std::string_view comment = {}) {
+        if (!comment.empty()) {
+            out += " //";
+            out += comment;
+        }
+        out += '\n';
+    }
+
+    void emitLine(std::string& out, int level, std::string_view line, std::string_view comment = {}) {
+        indentation(out, level);
+        out += line;
+        endLine(out, comment);
+    }
+
+    // Maps an annotation such as list[int] or dict[str, float] to a C++ type
+    std::string convertAnnotation(const Expr* annotation) {
+        return types.cppType(types.fromAnnotation(annotation));
+    }
+
+    std::string convertExceptionType(std::string_view pythonName, bool forThrow) {
+        auto it = exceptionMap.find(std::string(pythonName));
+        if (it != exceptionMap.end()) {
+            // std::exception has no message constructor
+            return forThrow && it->second == "std::exception" ? "std::runtime_error" : it->second;
+        }
+        if (std::find(definedClasses.begin(), definedClasses.end(), pythonName) != definedClasses.end()) {
+            return std::string(pythonName);
+        }
+        return forThrow ? "std::runtime_error" : "std::exception";
+    }
+
+    static bool isName(const Expr* expr, std::string_view id) {
+        return expr != nullptr && expr->kind == ExprKind::Name && static_cast<const NameExpr*>(expr)->id == id;
+    }
+
+    // Writes the body of a Python string literal as a C++ string literal
+    static void appendStringLiteral(std::string& out, std::string_view literal, bool raw) {
+        out += '"';
+        for (size_t i = 0; i < literal.size(); ++i) {
+            char c = literal[i];
+            if (c == '\\' && !raw && i + 1 < literal.size()) {
+                if (literal[i + 1] == '\n') {
+                    ++i;  // Escaped newline joins the lines
+                    continue;
+                }
+                if (literal[i + 1] == '\'') {
+                    out += '\'';
+                } else {
+                    out += c;
+                    out += literal[i + 1];
+                }
+                ++i;
+            } else if (c == '"' || (c == '\\' && raw)) {
+                out += '\\';
+                out += c;
+            } else if (c == '\n') {
+                out += "\\n";
+            } else {
+                out += c;
+            }
+        }
+        out += '"';
+    }
+
+    static void appendNumber(std::string& out, std::string_view text) {
+        size_t start = out.size();
+        for (char c : text) {
+            out += c == '_' ? '\'' : c;
+        }
+        // 0o17 -> 017
+        if (text.size() > 2 && text[0] == '0' && (text[1] == 'o' || text[1] == 'O')) {
+            out.erase(start + 1, 1);
+        }
+    }
+
+    static void appendCharLiteral(std::string& out, char c) {
+        if (c == 0) {
+            out += '0';
+            return;
+        }
+        out += '\'';
+        if (c == '\'' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+        out += '\'';
+    }
+
+    // The spec is parsed here, so the generated code carries it as a constant
+    static bool appendFormatSpec(std::string& out, std::string_view text) {
+        py2cpp::FormatSpec spec;
+        if (text.find('{') != std::string_view::npos || !py2cpp::FormatSpec::parse(text, spec)) {
+            return false;
+        }
+        out += "py2cpp::FormatSpec{";
+        appendCharLiteral(out, spec.fill);
+        out += ", ";
+        appendCharLiteral(out, spec.align);
+        out += ", ";
+        appendCharLiteral(out, spec.sign);
+        out += spec.alternate ? ", true, " : ", false, ";
+        out += std::to_string(spec.width);
+        out += ", ";
+        appendCharLiteral(out, spec.grouping);
+        out += ", ";
+        out += std::to_string(spec.precision);
+        out += ", ";
+        appendCharLiteral(out, spec.type);
+        out += '}';
+        return true;
+    }
+
+    // Arguments for the runtime's f-string helpers: literals as they are,
+    // placeholders wrapped for their !r conversion and format spec
+    void appendFStringParts(std::string& out, const FStringExpr* fstring) {
+        bool first = true;
+        for (const Expr* part : fstring->parts) {
+            if (!first) {
+                out += ", ";
+            }
+            first = false;
+            if (part->kind == ExprKind::String) {
+                auto* str = static_cast<const StringExpr*>(part);
+                appendStringLiteral(out, str->body, str->raw);
+                continue;
+            }
+            if (part->kind != ExprKind::FormattedValue) {
+                convertExpression(part, out);
+                continue;
+            }
+            auto* value = static_cast<const FormattedValueExpr*>(part);
+            std::string spec;
+            bool hasSpec = !value->formatSpec.empty() && appendFormatSpec(spec, value->formatSpec);
+            if (!value->formatSpec.empty() && !hasSpec) {
+                unsupportedExpression = true;
+            }
+            bool repr = value->conversion == 'r' || value->conversion == 'a';
+            if (hasSpec) {
+                out += "py2cpp::fmt(";
+            }
+            if (repr) {
+                out += "py2cpp::repr(";
+            }
+            convertExpression(value->value, out);
+            if (repr) {
+                out += ')';
+            }
+            if (hasSpec) {
+                out += ", ";
+                out += spec;
+                out += ')';
+            }
+        }
+    }
+
+    void convertStringFormatting(const FStringExpr* fstring, std::string& out) {
+        PY2CPP_PROFILE_SCOPE("convertStringFormatting");
+        bool literalOnly = std::all_of(fstring->parts.begin(), fstring->parts.end(),
+                                       [](const Expr* part) { return part->kind == ExprKind::String; });
+        if (literalOnly) {
+            // Implicitly concatenated literals stay adjacent literals in C++
+            for (size_t i = 0; i < fstring->parts.size(); ++i) {
+                if (i > 0) {
+                    out += ' ';
+                }
+                auto* str = static_cast<const StringExpr*>(fstring->parts[i]);
+                appendStringLiteral(out, str->body, str->raw);
+            }
+            if (fstring->parts.empty()) {
+                out += "\"\"";
+            }
+            return;
+        }
+        out += "py2cpp::format(";
+        appendFStringParts(out, fstring);
+        out += ')';
+    }
+
+    void appendTarget(std::string& out, const Expr* target) {
+        if (target->kind == ExprKind::Tuple) {
+            // Tuple targets become structured bindings
+            out += '[';
+            bool first = true;
+            for (const Expr* element : static_cast<const SequenceExpr*>(target)->elements) {
+                if (!first) {
+                    out += ", ";
+                }
+                convertExpression(element, out);
+                first = false;
+            }
+            out += ']';
+        } else {
+            convertExpression(target, out);
+        }
+    }
+
+    void declareTarget(const Expr* target) {
+        if (target->kind == ExprKind::Name) {
+            scope->declare(static_cast<const NameExpr*>(target)->id);
+        } else if (target->kind == ExprKind::Tuple || target->kind == ExprKind::List) {
+            for (const Expr* element : static_cast<const SequenceExpr*>(target)->elements) {
+                declareTarget(element);
+            }
+        }
+    }
+
+    // Iterable of a for loop or comprehension; a dict yields its keys, as in Python
+    void appendIterable(const Expr* iter, std::string& out) {
+        if (types.typeOf(iter, localTypes)->kind != TypeKind::Dict) {
+            convertExpression(iter, out);
+        } else if (options.stdContainers) {
+            out += "py2cpp::method::keys(";
+            convertExpression(iter, out, kConditional);
+            out += ')';
+        } else {
+            convertExpression(iter, out, kPostfix);
+            out += ".keys()";
+        }
+    }
+
+    void appendComprehensionLoops(std::string& out, const ComprehensionExpr* comp, std::string_view body) {
+        for (const Comprehension* gen : comp->generators) {
+            RangeLoop loop;
+            if (LoopAnalysis::matchRange(gen->target, gen->iter, loop)) {
+                appendRangeHeader(out, loop, loop.index, false);
+                out += " { ";
+            } else {
+                out += "for (const auto& ";
+                appendTarget(out, gen->target);
+                out += " : ";
+                appendIterable(gen->iter, out);
+                out += ") { ";
+            }
+            for (const Expr* cond : gen->ifs) {
+                out += "if (";
+                convertExpression(cond, out);
+                out += ") ";
+            }
+        }
+        out += body;
+        for (size_t i = 0; i < comp->generators.size(); ++i) {
+            out += " }";
+        }
+        out += ' ';
+    }
+
+    // Range bounds that are cheap and safe to evaluate twice
+    static bool isCheapBound(const Expr* expr) {
+        if (expr == nullptr || expr->kind == ExprKind::Number || expr->kind == ExprKind::Name) {
+            return true;
+        }
+        if (expr->kind == ExprKind::Unary) {
+            auto* unary = static_cast<const UnaryExpr*>(expr);
+            return unary->op == "-" && unary->operand->kind == ExprKind::Number;
+        }
+        if (expr->kind == ExprKind::Call) {
+            auto* call = static_cast<const CallExpr*>(expr);
+            return call->func->kind == ExprKind::Name && static_cast<const NameExpr*>(call->func)->id == "len" &&
+                   call->args.size() == 1 && call->args[0]->kind == ExprKind::Name;
+        }
+        return false;
+    }
+
+    // A comprehension with one unfiltered generator produces one element per
+    // item, so its result can be sized before the loop when the item count is
+    // cheap to get
+    void appendComprehensionReserve(std::string& out, const ComprehensionExpr* comp) {
+        if (comp->generators.size() != 1 || !comp->generators[0]->ifs.empty()) {
+            return;
+        }
+        const Comprehension* gen = comp->generators[0];
+        RangeLoop loop;
+        if (LoopAnalysis::matchRange(gen->target, gen->iter, loop)) {
+            if (!isCheapBound(loop.start) || !isCheapBound(loop.stop) || !isCheapBound(loop.step)) {
+                return;
+            }
+            out += "py2cpp::reserve(result, py2cpp::rangeLength(";
+            if (loop.start != nullptr) {
+                convertExpression(loop.start, out, kConditional);
+            } else {
+                out += '0';
+            }
+            out += ", ";
+            convertExpression(loop.stop, out, kConditional);
+            if (loop.step != nullptr) {
+                out += ", ";
+                convertExpression(loop.step, out, kConditional);
+            }
+            out += ")); ";
+        } else if (gen->iter->kind == ExprKind::Name || gen->iter->kind == ExprKind::Attribute) {
+            out += "py2cpp::reserveFor(result, ";
+            convertExpression(gen->iter, out);
+            out += "); ";
+        }
+    }
+
+    // The sequence a --parallel loop indexes: a list, or range() as a py2cpp::Range
+    bool appendParallelSource(const Expr* target, const Expr* iter, std::string& out) {
+        RangeLoop loop;
+        if (LoopAnalysis::matchRange(target, iter, loop)) {
+            out += "py2cpp::Range(";
+            if (loop.start != nullptr) {
+                convertExpression(loop.start, out, kConditional);
+            } else {
+                out += '0';
+            }
+            out += ", ";
+            convertExpression(loop.stop, out, kConditional);
+            if (loop.step != nullptr) {
+                out += ", ";
+                convertExpression(loop.step, out, kConditional);
+            }
+            out += ')';
+            return true;
+        }
+        if ((iter->kind == ExprKind::Name || iter->kind == ExprKind::Attribute) &&
+            types.typeOf(iter, localTypes)->kind == TypeKind::List) {
+            convertExpression(iter, out);
+            return true;
+        }
+        return false;
+    }
+
+    // --parallel: [f(x) for x in xs] over a list or range() with a side-effect
+    // free f fills its result through py2cpp::parallelMap. Bool results stay
+    // sequential, since neighbouring elements of a vector<bool> share a word,
+    // and so do classes, which need not be default-constructible.
+    bool convertParallelComprehension(const ComprehensionExpr* comp, std::string& out) {
+        if (comp->generators.size() != 1) {
+            return false;
+        }
+        const Comprehension* gen = comp->generators[0];
+        if (!gen->ifs.empty() || gen->target->kind != ExprKind::Name || !purity.isPure(comp->element)) {
+            return false;
+        }
+        const Type* type = types.typeOf(comp, localTypes);
+        if (!TypeInference::determined(type) || type->args[0]->kind == TypeKind::Bool ||
+            type->args[0]->kind == TypeKind::Class) {
+            return false;
+        }
+        std::string source;
+        if (!appendParallelSource(gen->target, gen->iter, source)) {
+            return false;
+        }
+        out += "py2cpp::parallelMap<";
+        out += types.cppType(type);
+        out += ">(";
+        out += source;
+        out += ", [&](const auto& ";
+        out += static_cast<const NameExpr*>(gen->target)->id;
+        out += ") { return ";
+        convertExpression(comp->element, out);
+        out += "; })";
+        return true;
+    }
+
+    void convertListComprehension(const ComprehensionExpr* comp, std::string& out) {
+        PY2CPP_PROFILE_SCOPE("convertListComprehension");
+        bool isSet = comp->kind == ExprKind::SetComp;
+        if (options.parallel && !isSet && convertParallelComprehension(comp, out)) {
+            return;
+        }
+        std::string body = isSet ? "result.insert(" : "result.push_back(";
+        convertExpression(comp->element, body);
+        body += ");";
+
+        out += "[&]() { ";
+        out += types.cppType(types.typeOf(comp, localTypes));
+        out += " result; ";
+        appendComprehensionReserve(out, comp);
+        appendComprehensionLoops(out, comp, body);
+        out += "return result; }()";
+    }
+
+    void convertDictComprehension(const ComprehensionExpr* comp, std::string& out) {
+        PY2CPP_PROFILE_SCOPE("convertDictComprehension");
+        std::string body = "result[";
+        convertExpression(comp->element, body);
+        body += "] = ";
+        convertExpression(comp->value, body);
+        body += ";";
+
+        out += "[&]() { ";
+        out += types.cppType(types.typeOf(comp, localTypes));
+        out += " result; ";
+        appendComprehensionReserve(out, comp);
+        appendComprehensionLoops(out, comp, body);
+        out += "return result; }()";
+    }
+
+    static bool isSysStream(const Expr* expr, std::string_view stream) {
+        return expr->kind == ExprKind::Attribute && static_cast<const AttributeExpr*>(expr)->attr == stream &&
+               isName(static_cast<const AttributeExpr*>(expr)->value, "sys");
+    }
+
+    // Lowers print(...) onto the runtime's buffered print, honouring the sep=,
+    // end=, flush= and file=sys.stdout/sys.stderr keywords; any other keyword
+    // or file makes the statement unsupported. f-string arguments are written
+    // without building a temporary string
+    void convertPrint(const CallExpr* call, std::string& out) {
+        PY2CPP_PROFILE_SCOPE("convertPrint");
+        const Expr* sep = nullptr;
+        const Expr* end = nullptr;
+        const Expr* flush = nullptr;
+        bool toStderr = false;
+        std::vector<const Expr*> positional;
+        for (const Expr* arg : call->args) {
+            if (arg->kind == ExprKind::Keyword) {
+                auto* kw = static_cast<const KeywordExpr*>(arg);
+                if (kw->name == "sep") {
+                    sep = kw->value;
+                } else if (kw->name == "end") {
+                    end = kw->value;
+                } else if (kw->name == "flush") {
+                    flush = kw->value;
+                } else if (kw->name == "file" && isSysStream(kw->value, "stderr")) {
+                    toStderr = true;
+                } else if (kw->name != "file" || !isSysStream(kw->value, "stdout")) {
+                    unsupportedExpression = true;
+                }
+                continue;
+            }
+            positional.push_back(arg);
+        }
+
+        out += "py2cpp::print(";
+        bool first = true;
+        if (sep != nullptr || end != nullptr || flush != nullptr || toStderr) {
+            out += "py2cpp::PrintOptions{";
+            if (sep != nullptr) {
+                convertExpression(sep, out);
+            } else {
+                out += "\" \"";
+            }
+            out += ", ";
+            if (end != nullptr) {
+                convertExpression(end, out);
+            } else {
+                out += "\"\\n\"";
+            }
+            if (flush != nullptr || toStderr) {
+                out += ", ";
+                if (flush != nullptr) {
+                    convertExpression(flush, out);
+                } else {
+                    out += "false";
+                }
+            }
+            if (toStderr) {
+                out += ", true";
+            }
+            out += '}';
+            first = false;
+        }
+        for (const Expr* arg : positional) {
+            if (!first) {
+                out += ", ";
+            }
+            first = false;
+            const FStringExpr* fstring = arg->kind == ExprKind::FString ? static_cast<const FStringExpr*>(arg) : nullptr;
+            if (fstring != nullptr && fstring->parts.size() > 1) {
+                out += "py2cpp::fstring(";
+                appendFStringParts(out, fstring);
+                out += ')';
+            } else if (fstring != nullptr && fstring->parts.size() == 1) {
+                appendFStringParts(out, fstring);
+            } else {
+                convertExpression(arg, out);
+            }
+        }
+        out += ')';
+    }
+
+    // A temporary passed at one of the `referenced` positions, which bind to
+    // non-const references, goes through py2cpp::lvalue
+    void appendArguments(std::string& out, const NodeList<Expr*>& args,
+                         const std::vector<size_t>* referenced = nullptr) {
+        for (size_t i = 0; i < args.size(); ++i) {
+            const Expr* arg = args[i];
+            if (i > 0) {
+                out += ", ";
+            }
+            if (arg->kind == ExprKind::Keyword) {
+                auto* kw = static_cast<const KeywordExpr*>(arg);
+                // C++ has no keyword arguments; keep the name as a hint
+                out += "/*";
+                out += kw->name.empty() ? std::string_view("**") : kw->name;
+                out += "=*/";
+                arg = kw->value;
+            }
+            bool temporary = ReferenceTable::contains(referenced, i) && arg->kind != ExprKind::Name &&
+                             arg->kind != ExprKind::Attribute && arg->kind != ExprKind::Subscript;
+            if (temporary) {
+                out += "py2cpp::lvalue(";
+                convertExpression(arg, out);
+                out += ')';
+            } else {
+                convertExpression(arg, out, kConditional);
+            }
+        }
+    }
+
+    // super().__init__(...) or Base.__init__(self, ...)
+    bool isBaseInitCall(const Expr* expr) {
+        if (expr->kind != ExprKind::Call) {
+            return false;
+        }
+        auto* call = static_cast<const CallExpr*>(expr);
+        if (call->func->kind != ExprKind::Attribute) {
+            return false;
+        }
+        auto* attr = static_cast<const AttributeExpr*>(call->func);
+        if (attr->attr != "__init__") {
+            return false;
+        }
+        if (attr->value->kind == ExprKind::Call) {
+            return isName(static_cast<const CallExpr*>(attr->value)->func, "super");
+        }
+        return attr->value->kind == ExprKind::Name && !currentBaseClass.empty() &&
+               static_cast<const NameExpr*>(attr->value)->id == currentBaseClass;
+    }
+
+    // str(), int() and float() become the C++ conversion for the argument's type
+    bool convertConversion(std::string_view name, const Expr* arg, std::string& out) {
+        TypeKind from = types.typeOf(arg, localTypes)->kind;
+        bool numeric = from == TypeKind::Int || from == TypeKind::Float || from == TypeKind::Bool;
+        if (name == "str") {
+            if (from == TypeKind::Str) {
+                out += "std::string(";
+            } else if (from == TypeKind::Int) {
+                out += "py2cpp::intToString(";
+            } else {
+                // Python's str() of floats, bools, containers and PyValue
+                out += "py2cpp::str(";
+            }
+        } else if (from == TypeKind::Str && arg->kind == ExprKind::Name &&
+                   Scope::contains(viewNames, static_cast<const NameExpr*>(arg)->id)) {
+            out += name == "int" ? "py2cpp::toInt(" : "py2cpp::toFloat(";
+        } else if (from == TypeKind::Str) {
+            out += name == "int" ? "std::stoll(" : "std::stod(";
+        } else if (numeric) {
+            out += name == "int" ? "static_cast<int64_t>(" : "static_cast<double>(";
+        } else {
+            return false;
+        }
+        convertExpression(arg, out);
+        out += ')';
+        return true;
+    }
+
+    // text.split(), text.split(sep) or text.split(sep, maxsplit) on a str
+    const CallExpr* splitCall(const Expr* expr) {
+        if (expr->kind != ExprKind::Call) {
+            return nullptr;
+        }
+        auto* call = static_cast<const CallExpr*>(expr);
+        if (call->func->kind != ExprKind::Attribute || call->args.size() > 2 ||
+            static_cast<const AttributeExpr*>(call->func)->attr != "split") {
+            return nullptr;
+        }
+        for (const Expr* arg : call->args) {
+            if (arg->kind == ExprKind::Keyword || arg->kind == ExprKind::Starred) {
+                return nullptr;
+            }
+        }
+        const Expr* text = static_cast<const AttributeExpr*>(call->func)->value;
+        return types.typeOf(text, localTypes)->kind == TypeKind::Str ? call : nullptr;
+    }
+
+    // The fields are slices of the string with `views`, which only holds
+    // where the string outlives them; otherwise they are copied out
+    void appendSplit(const CallExpr* call, bool views, std::string& out) {
+        out += "py2cpp::split";
+        if (!views) {
+            out += '<';
+            out += types.cppType(types.typeOf(call, localTypes));
+            out += '>';
+        }
+        out += '(';
+        convertExpression(static_cast<const AttributeExpr*>(call->func)->value, out, kConditional);
+        for (const Expr* arg : call->args) {
+            out += ", ";
+            convertExpression(arg, out, kConditional);
+        }
+        out += ')';
+    }
+
+    // sep.join(items) sizes the result before building it; a split() passed
+    // straight in is joined from its slices
+    bool convertJoin(const CallExpr* call, std::string& out) {
+        if (call->func->kind != ExprKind::Attribute || call->args.size() != 1 ||
+            call->args[0]->kind == ExprKind::Keyword || call->args[0]->kind == ExprKind::Starred) {
+            return false;
+        }
+        auto* attr = static_cast<const AttributeExpr*>(call->func);
+        if (attr->attr != "join" || types.typeOf(attr->value, localTypes)->kind != TypeKind::Str) {
+            return false;
+        }
+        out += "py2cpp::join(";
+        convertExpression(attr->value, out, kConditional);
+        out += ", ";
+        if (const CallExpr* split = splitCall(call->args[0])) {
+            appendSplit(split, true, out);
+        } else {
+            convertExpression(call->args[0], out, kConditional);
+        }
+        out += ')';
+        return true;
+    }
+
+    // With --std-containers, Python's list, set and dict methods become the
+    // std member function that does the same, or a py2cpp::method helper
+    bool convertStdMethod(const CallExpr* call, std::string& out) {
+        if (call->func->kind != ExprKind::Attribute) {
+            return false;
+        }
+        for (const Expr* arg : call->args) {
+            if (arg->kind == ExprKind::Keyword || arg->kind == ExprKind::Starred) {
+                return false;
+            }
+        }
+        auto* attr = static_cast<const AttributeExpr*>(call->func);
+        std::string_view method = attr->attr;
+        size_t count = call->args.size();
+        std::string_view member;
+        bool helper = false;
+        bool itself = method == "copy" && count == 0;
+        switch (types.typeOf(attr->value, localTypes)->kind) {
+            case TypeKind::List:
+                if (method == "append" && count == 1) {
+                    member = "push_back";
+                }
+                helper = (count == 0 && (method == "pop" || method == "sort" || method == "reverse")) ||
+                         (count == 1 && (method == "pop" || method == "extend" || method == "index" ||
+                                         method == "count" || method == "remove")) ||
+                         (count == 2 && method == "insert");
+                break;
+            case TypeKind::Set:
+                if ((method == "add" || method == "discard") && count == 1) {
+                    member = method == "add" ? "insert" : "erase";
+                }
+                helper = count == 1 && (method == "remove" || method == "update");
+                break;
+            case TypeKind::Dict:
+                if (method == "setdefault" && (count == 1 || count == 2)) {
+                    // try_emplace leaves an existing value alone
+                    convertExpression(attr->value, out, kPostfix);
+                    out += ".try_emplace(";
+                    appendArguments(out, call->args);
+                    out += ").first->second";
+                    return true;
+                }
+                // A std::map iterates over its (key, value) pairs
+                itself = itself || (method == "items" && count == 0);
+                helper = (count == 0 && (method == "keys" || method == "values")) ||
+                         ((count == 1 || count == 2) && (method == "get" || method == "pop")) ||
+                         (count == 1 && method == "update");
+                break;
+            default:
+                return false;
+        }
+        if (itself) {
+            convertExpression(attr->value, out, kPostfix);
+        } else if (!member.empty()) {
+            convertExpression(attr->value, out, kPostfix);
+            out += '.';
+            out += member;
+            out += '(';
+            appendArguments(out, call->args);
+            out += ')';
+        } else if (helper) {
+            out += "py2cpp::method::";
+            out += method;
+            out += '(';
+            convertExpression(attr->value, out, kConditional);
+            for (const Expr* arg : call->args) {
+                out += ", ";
+                convertExpression(arg, out, kConditional);
+            }
+            out += ')';
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // x of a str(x) call
+    static const Expr* strArgument(const Expr* expr) {
+        if (expr->kind != ExprKind::Call) {
+            return nullptr;
+        }
+        auto* call = static_cast<const CallExpr*>(expr);
+        if (!isName(call->func, "str") || call->args.size() != 1 || call->args[0]->kind == ExprKind::Keyword ||
+            call->args[0]->kind == ExprKind::Starred) {
+            return nullptr;
+        }
+        return call->args[0];
+    }
+
+    // text += a + str(n) + f"{x}" on a str variable appends every part in
+    // place through py2cpp::append, numbers without a temporary string.
+    // Parts that read text itself keep the plain +=.
+    bool convertStringAppend(const Expr* target, const std::vector<const Expr*>& parts, std::string& out) {
+        if (target->kind != ExprKind::Name || types.typeOf(target, localTypes)->kind != TypeKind::Str) {
+            return false;
+        }
+        std::string_view text = static_cast<const NameExpr*>(target)->id;
+        TextUses uses(text);
+        for (const Expr* part : parts) {
+            uses.analyzeExpression(part);
+        }
+        if (uses.mentioned()) {
+            return false;
+        }
+        const Expr* only = parts.size() == 1 ? parts[0] : nullptr;
+        if (only != nullptr && only->kind != ExprKind::FString && strArgument(only) == nullptr) {
+            out += text;
+            out += " += ";
+            convertExpression(only, out, kConditional);
+            out += ';';
+            return true;
+        }
+        out += "py2cpp::append(";
+        out += text;
+        for (const Expr* part : parts) {
+            out += ", ";
+            if (const Expr* value = strArgument(part)) {
+                // append() writes any value as str() does
+                convertExpression(value, out, kConditional);
+            } else if (part->kind == ExprKind::FString) {
+                appendFStringParts(out, static_cast<const FStringExpr*>(part));
+            } else {
+                convertExpression(part, out, kConditional);
+            }
+        }
+        out += ");";
+        return true;
+    }
+
+    // f(i, 5) inside a tabulated range(N) loop reads f's precomputed table
+    bool appendTableLookup(const CallExpr* call, std::string& out) {
+        TableLoop& table = tableLoops.back();
+        if (call->func->kind != ExprKind::Name) {
+            return false;
+        }
+        std::string_view name = static_cast<const NameExpr*>(call->func)->id;
+        const CompileTimeFunctions::Function* function = compileTime.find(name);
+        if (function == nullptr || !function->bounded) {
+            return false;
+        }
+        bool usesIndex = false;
+        for (const Expr* arg : call->args) {
+            Constant ignored;
+            if (isName(arg, table.loop->index)) {
+                usesIndex = true;
+            } else if (arg->kind != ExprKind::Bool && !ConstantFolder::evaluate(arg, ignored)) {
+                return false;
+            }
+        }
+        if (!usesIndex) {
+            return false;
+        }
+
+        std::string entry = std::string(name);
+        entry += '(';
+        appendArguments(entry, call->args);
+        entry += ')';
+
+        std::string_view tableName;
+        for (const auto& built : table.built) {
+            if (built.first == entry) {
+                tableName = built.second;
+            }
+        }
+        if (tableName.empty()) {
+            // A local struct rather than a lambda, which C++17 cannot pass as a template argument
+            std::string_view entryName = loopName(*table.loop, std::string(name) + "_entry");
+            scope->declare(entryName);
+            tableName = loopName(*table.loop, std::string(name) + "_table");
+            scope->declare(tableName);
+            std::string returnType = types.returnType(*types.function(name));
+            indentation(table.tables, table.level);
+            table.tables += "struct ";
+            table.tables += entryName;
+            table.tables += " { static constexpr ";
+            table.tables += returnType;
+            table.tables += " at(int64_t ";
+            table.tables += table.loop->index;
+            table.tables += ") { return ";
+            table.tables += entry;
+            table.tables += "; } };\n";
+            indentation(table.tables, table.level);
+            table.tables += "static constexpr py2cpp::ConstexprTable<";
+            table.tables += returnType;
+            table.tables += ", ";
+            table.tables += std::to_string(table.count);
+            table.tables += ", ";
+            table.tables += entryName;
+            table.tables += "> ";
+            table.tables += tableName;
+            table.tables += "{};\n";
+            table.built.emplace_back(std::move(entry), tableName);
+        }
+        out += tableName;
+        out += '[';
+        out += table.loop->index;
+        out += ']';
+        return true;
+    }
+
+    int convertPythonFunction(const CallExpr* call, std::string& out) {
+        PY2CPP_PROFILE_SCOPE("convertPythonFunction");
+        if (!tableLoops.empty() && appendTableLookup(call, out)) {
+            return kPostfix;
+        }
+        if (call->func->kind == ExprKind::Name) {
+            std::string_view name = static_cast<const NameExpr*>(call->func)->id;
+
+            // Convert print function
+            if (name == "print") {
+                convertPrint(call, out);
+                return kPostfix;
+            }
+
+            // Convert len function
+            if (name == "len" && call->args.size() == 1) {
+                if (const CallExpr* split = splitCall(call->args[0])) {
+                    appendSplit(split, true, out);
+                } else {
+                    convertExpression(call->args[0], out, kPostfix);
+                }
+                out += ".size()";
+                return kPostfix;
+            }
+
+            if ((name == "str" || name == "int" || name == "float") && call->args.size() == 1 &&
+                call->args[0]->kind != ExprKind::Keyword && convertConversion(name, call->args[0], out)) {
+                return kPostfix;
+            }
+        }
+
+        if (const CallExpr* split = splitCall(call)) {
+            appendSplit(split, false, out);
+            return kPostfix;
+        }
+        if (convertJoin(call, out)) {
+            return kPostfix;
+        }
+        if (options.stdContainers && convertStdMethod(call, out)) {
+            return kPostfix;
+        }
+
+        // Convert super() call
+        if (isBaseInitCall(call) && !currentBaseClass.empty()) {
+            out += currentBaseClass;
+            out += "::__init__(";
+            NodeList<Expr*> args = call->args;
+            if (!args.empty() && isName(args[0], "self")) {
+                ++args.items;
+                --args.count;
+            }
+            appendArguments(out, args);
+            out += ')';
+            return kPostfix;
+        }
+
+        convertExpression(call->func, out, kPostfix);
+        out += '(';
+        appendArguments(out, call->args, references.positions(call));
+        out += ')';
+        return kPostfix;
+    }
+
+    bool isInteger(const Expr* expr) {
+        TypeKind kind = types.typeOf(expr, localTypes)->kind;
+        return kind == TypeKind::Int || kind == TypeKind::Bool;
+    }
+
+    // The function computing op where C++ has no operator with Python's
+    // semantics: ** and the flooring // and %; empty for the others. `result`
+    // has the type of the whole expression, an int when ** keeps ints exact.
+    std::string_view arithmeticHelper(std::string_view op, const Expr* left, const Expr* result) {
+        if (op == "**") {
+            return types.typeOf(result, localTypes)->kind == TypeKind::Int ? "py2cpp::intPow" : "std::pow";
+        }
+        if (op == "//") {
+            return "py2cpp::floorDiv";
+        }
+        if (op == "%" && types.typeOf(left, localTypes)->kind != TypeKind::Str) {
+            return "py2cpp::mod";
+        }
+        return {};
+    }
+
+    int convertPythonOperators(const Expr* expr, std::string& out) {
+        PY2CPP_PROFILE_SCOPE("convertPythonOperators");
+        switch (expr->kind) {
+            case ExprKind::Unary: {
+                auto* unary = static_cast<const UnaryExpr*>(expr);
+                // Convert Python's not to C++'s !
+                out += unary->op == "not" ? std::string_view("!") : unary->op;
+                // Keep - -x from turning into the decrement operator
+                bool nestedSign = unary->operand->kind == ExprKind::Unary && unary->op != "not";
+                convertExpression(unary->operand, out, nestedSign ? kPostfix : kUnary);
+                return kUnary;
+            }
+            case ExprKind::BoolOp: {
+                auto* op = static_cast<const BinaryExpr*>(expr);
+                // Convert and/or to &&/||
+                int prec = op->op == "and" ? kLogicalAnd : kLogicalOr;
+                convertExpression(op->left, out, prec);
+                out += prec == kLogicalAnd ? " && " : " || ";
+                convertExpression(op->right, out, prec + 1);
+                return prec;
+            }
+            case ExprKind::Binary: {
+                auto* op = static_cast<const BinaryExpr*>(expr);
+                std::string_view helper = arithmeticHelper(op->op, op->left, expr);
+                if (!helper.empty()) {
+                    out += helper;
+                    out += '(';
+                    convertExpression(op->left, out, kConditional);
+                    out += ", ";
+                    convertExpression(op->right, out, kConditional);
+                    out += ')';
+                    return kPostfix;
+                }
+                int prec = kMultiplicative;
+                std::string_view cppOp = op->op;
+                if (cppOp == "|") {
+                    prec = kBitOr;
+                } else if (cppOp == "^") {
+                    prec = kBitXor;
+                } else if (cppOp == "&") {
+                    prec = kBitAnd;
+                } else if (cppOp == "<<" || cppOp == ">>") {
+                    prec = kShift;
+                } else if (cppOp == "+" || cppOp == "-") {
+                    prec = kAdditive;
+                } else if (cppOp == "@") {
+                    cppOp = "*";
+                } else if (cppOp == "/" && isInteger(op->left) && isInteger(op->right)) {
+                    // Python's / on two integers is true division
+                    out += "static_cast<double>(";
+                    convertExpression(op->left, out);
+                    out += ") / ";
+                    convertExpression(op->right, out, prec + 1);
+                    return prec;
+                }
+                convertExpression(op->left, out, prec);
+                out += ' ';
+                out += cppOp;
+                out += ' ';
+                convertExpression(op->right, out, prec + 1);
+                return prec;
+            }
+            case ExprKind::Compare: {
+                auto* cmp = static_cast<const CompareExpr*>(expr);
+                // a < b < c becomes a < b && b < c
+                for (size_t i = 0; i < cmp->ops.size(); ++i) {
+                    if (i > 0) {
+                        out += " && ";
+                    }
+                    convertComparison(cmp->operands[i], cmp->ops[i], cmp->operands[i + 1], out,
+                                      cmp->ops.size() > 1 ? kEquality + 1 : kEquality);
+                }
+                return cmp->ops.size() > 1 ? kLogicalAnd : kEquality;
+            }
+            default:
+                return kPrimary;
+        }
+    }
+
+    void convertComparison(const Expr* left, std::string_view op, const Expr* right, std::string& out, int minPrec) {
+        if (op == "in" || op == "not in") {
+            // Hashed lookup for dicts and sets, substring search for strings
+            bool negated = op == "not in";
+            bool needParens = negated && kUnary < minPrec;
+            if (needParens) {
+                out += '(';
+            }
+            out += negated ? "!py2cpp::contains(" : "py2cpp::contains(";
+            convertExpression(right, out, kConditional);
+            out += ", ";
+            convertExpression(left, out, kConditional);
+            out += ')';
+            if (needParens) {
+                out += ')';
+            }
+            return;
+        }
+        // Convert is / is not to == / !=
+        std::string_view cppOp = op == "is" ? "==" : op == "is not" ? "!=" : op;
+        bool equality = cppOp == "==" || cppOp == "!=";
+        if (equality && (left->kind == ExprKind::None || right->kind == ExprKind::None)) {
+            // Only a PyValue can hold None
+            bool negated = cppOp == "!=";
+            bool needParens = negated && kUnary < minPrec;
+            out += needParens ? "(" : "";
+            out += negated ? "!py2cpp::isNone(" : "py2cpp::isNone(";
+            convertExpression(left->kind == ExprKind::None ? right : left, out, kConditional);
+            out += needParens ? "))" : ")";
+            return;
+        }
+        bool needParens = (equality ? kEquality : kRelational) < minPrec;
+        if (needParens) {
+            out += '(';
+        }
+        int prec = equality ? kEquality : kRelational;
+        convertExpression(left, out, prec);
+        out += ' ';
+        out += cppOp;
+        out += ' ';
+        convertExpression(right, out, prec + 1);
+        if (needParens) {
+            out += ')';
+        }
+    }
+
+    int convertExpressionNode(const Expr* expr, std::string& out) {
+        switch (expr->kind) {
+            case ExprKind::Name: {
+                std::string_view id = static_cast<const NameExpr*>(expr)->id;
+                if (id == "self") {
+                    out += "(*this)";
+                } else if (std::find(movedNames.begin(), movedNames.end(), expr) != movedNames.end()) {
+                    // Last use of a local whose value is copied here
+                    out += "std::move(";
+                    out += id;
+                    out += ')';
+                    return kPostfix;
+                } else {
+                    out += id;
+                    // Python prints an exception through str(e)
+                    if (Scope::contains(scope->exceptionVars, id)) {
+                        out += ".what()";
+                        return kPostfix;
+                    }
+                }
+                return kPrimary;
+            }
+            case ExprKind::Number:
+                appendNumber(out, static_cast<const ConstantExpr*>(expr)->text);
+                return kPrimary;
+            case ExprKind::String: {
+                auto* str = static_cast<const StringExpr*>(expr);
+                appendStringLiteral(out, str->body, str->raw);
+                return kPrimary;
+            }
+            case ExprKind::FString:
+                convertStringFormatting(static_cast<const FStringExpr*>(expr), out);
+                return kPostfix;
+            case ExprKind::Bool:
+                out += static_cast<const ConstantExpr*>(expr)->text == "True" ? "true" : "false";
+                return kPrimary;
+            case ExprKind::None:
+                out += "nullptr";
+                return kPrimary;
+            case ExprKind::Ellipsis:
+                out += "/* ... */";
+                return kPrimary;
+            case ExprKind::Raw:
+                out += static_cast<const ConstantExpr*>(expr)->text;
+                return kLowest;
+            case ExprKind::Unary:
+            case ExprKind::Binary: {
+                Constant value;
+                if (ConstantFolder::evaluate(expr, value)) {
+                    ConstantFolder::append(out, value);
+                    return ConstantFolder::negative(value) ? kUnary : kPrimary;
+                }
+                return convertPythonOperators(expr, out);
+            }
+            case ExprKind::BoolOp:
+            case ExprKind::Compare:
+                return convertPythonOperators(expr, out);
+            case ExprKind::Conditional: {
+                auto* cond = static_cast<const ConditionalExpr*>(expr);
+                convertExpression(cond->test, out, kLogicalOr);
+                out += " ? ";
+                convertExpression(cond->body, out, kConditional);
+                out += " : ";
+                convertExpression(cond->orelse, out, kConditional);
+                return kConditional;
+            }
+            case ExprKind::Call:
+                return convertPythonFunction(static_cast<const CallExpr*>(expr), out);
+            case ExprKind::Keyword:
+                convertExpression(static_cast<const KeywordExpr*>(expr)->value, out);
+                return kPrimary;
+            case ExprKind::Starred:
+                return convertExpressionNode(static_cast<const StarredExpr*>(expr)->value, out);
+            case ExprKind::Attribute: {
+                auto* attr = static_cast<const AttributeExpr*>(expr);
+                // Convert self.attribute to this->attribute
+                if (isName(attr->value, "self")) {
+                    out += "this->";
+                } else if (graph != nullptr && appendModulePath(attr->value, out)) {
+                    out += "::";
+                } else {
+                    convertExpression(attr->value, out, kPostfix);
+                    out += '.';
+                }
+                out += attr->attr;
+                return kPostfix;
+            }
+            case ExprKind::Subscript: {
+                auto* sub = static_cast<const SubscriptExpr*>(expr);
+                if (!elementAliases.empty() && sub->value->kind == ExprKind::Name &&
+                    sub->index->kind == ExprKind::Name) {
+                    std::string_view sequence = static_cast<const NameExpr*>(sub->value)->id;
+                    std::string_view index = static_cast<const NameExpr*>(sub->index)->id;
+                    for (const ElementAlias& alias : elementAliases) {
+                        if (RangeLoop::sameName(alias.sequence, sequence) && RangeLoop::sameName(alias.index, index)) {
+                            out += alias.element;
+                            return kPrimary;
+                        }
+                    }
+                }
+                // operator[] takes a size_t, so an index that may be negative counts from the end through item()
+                const Type* indexType =
+                    sub->index->kind == ExprKind::Slice ? nullptr : types.typeOf(sub->index, localTypes);
+                if (indexType != nullptr && indexType->kind == TypeKind::Int &&
+                    indexType->name != TypeInference::kNonNegative &&
+                    types.typeOf(sub->value, localTypes)->kind == TypeKind::List) {
+                    if (options.stdContainers) {
+                        out += "py2cpp::method::item(";
+                        convertExpression(sub->value, out, kConditional);
+                        out += ", ";
+                    } else {
+                        convertExpression(sub->value, out, kPostfix);
+                        out += ".item(";
+                    }
+                    convertExpression(sub->index, out, kConditional);
+                    out += ')';
+                    return kPostfix;
+                }
+                convertExpression(sub->value, out, kPostfix);
+                // operator[] inserts, so a dict taken by const reference is read through at()
+                if (sub->value->kind == ExprKind::Name &&
+                    Scope::contains(constRefParams, static_cast<const NameExpr*>(sub->value)->id) &&
+                    types.typeOf(sub->value, localTypes)->kind == TypeKind::Dict) {
+                    out += ".at(";
+                    convertExpression(sub->index, out);
+                    out += ')';
+                    return kPostfix;
+                }
+                out += '[';
+                convertExpression(sub->index, out);
+                out += ']';
+                return kPostfix;
+            }
+            case ExprKind::Slice: {
+                // No C++ counterpart; keep the Python form so it stands out
+                auto* slice = static_cast<const SliceExpr*>(expr);
+                if (slice->lower != nullptr) {
+                    convertExpression(slice->lower, out);
+                }
+                out += ':';
+                if (slice->upper != nullptr) {
+                    convertExpression(slice->upper, out);
+                }
+                if (slice->step != nullptr) {
+                    out += ':';
+                    convertExpression(slice->step, out);
+                }
+                return kPrimary;
+            }
+            case ExprKind::List:
+            case ExprKind::Tuple:
+            case ExprKind::Set: {
+                auto* seq = static_cast<const SequenceExpr*>(expr);
+                if (expr->kind != ExprKind::Tuple && convertTypedDisplay(expr, out)) {
+                    return kPostfix;
+                }
+                if (seq->elements.empty() && expr->kind != ExprKind::Tuple) {
+                    out += "{}";
+                    return kPrimary;
+                }
+                if (expr->kind == ExprKind::Tuple) {
+                    out += "std::make_tuple(";
+                } else {
+                    out += types.containerTemplate(expr->kind == ExprKind::List ? TypeKind::List : TypeKind::Set);
+                    out += '{';
+                }
+                appendArguments(out, seq->elements);
+                out += expr->kind == ExprKind::Tuple ? ')' : '}';
+                return kPostfix;
+            }
+            case ExprKind::Dict: {
+                auto* dict = static_cast<const DictExpr*>(expr);
+                if (convertTypedDisplay(expr, out)) {
+                    return kPostfix;
+                }
+                if (dict->keys.empty()) {
+                    out += "{}";
+                    return kPrimary;
+                }
+                out += types.containerTemplate(TypeKind::Dict);
+                out += '{';
+                for (size_t i = 0; i < dict->keys.size(); ++i) {
+                    if (i > 0) {
+                        out += ", ";
+                    }
+                    if (dict->keys[i] == nullptr) {
+                        out += "/* ** */";
+                        convertExpression(dict->values[i], out, kConditional);
+                        continue;
+                    }
+                    out += "std::pair{";
+                    convertExpression(dict->keys[i], out, kConditional);
+                    out += ", ";
+                    convertExpression(dict->values[i], out, kConditional);
+                    out += '}';
+                }
+                out += '}';
+                return kPostfix;
+            }
+            case ExprKind::ListComp:
+            case ExprKind::SetComp:
+            case ExprKind::GeneratorExp:
+                convertListComprehension(static_cast<const ComprehensionExpr*>(expr), out);
+                return kPostfix;
+            case ExprKind::DictComp:
+                convertDictComprehension(static_cast<const ComprehensionExpr*>(expr), out);
+                return kPostfix;
+            case ExprKind::Lambda: {
+                auto* lambda = static_cast<const LambdaExpr*>(expr);
+                out += "[&](";
+                appendParams(out, lambda->params, false);
+                out += ") { return ";
+                convertExpression(lambda->body, out);
+                out += "; }";
+                return kPrimary;
+            }
+            case ExprKind::FormattedValue:
+                return convertExpressionNode(static_cast<const FormattedValueExpr*>(expr)->value, out);
+        }
+        return kPrimary;
+    }
+
+    // Whether `display` can be written as a braced initializer of `type`
+    static bool bracesFit(const Expr* display, const Type* type) {
+        switch (display->kind) {
+            case ExprKind::List:
+            case ExprKind::Set:
+            case ExprKind::Tuple: {
+                TypeKind kind = display->kind == ExprKind::List ? TypeKind::List
+                              : display->kind == ExprKind::Set ? TypeKind::Set : TypeKind::Tuple;
+                const NodeList<Expr*>& elements = static_cast<const SequenceExpr*>(display)->elements;
+                if (type->kind != kind || (kind == TypeKind::Tuple && type->args.size() != elements.size())) {
+                    return false;
+                }
+                return std::none_of(elements.begin(), elements.end(),
+                                    [](const Expr* e) { return e->kind == ExprKind::Starred; });
+            }
+            case ExprKind::Dict: {
+                const NodeList<Expr*>& keys = static_cast<const DictExpr*>(display)->keys;
+                return type->kind == TypeKind::Dict &&
+                       std::none_of(keys.begin(), keys.end(), [](const Expr* key) { return key == nullptr; });
+            }
+            default:
+                return false;
+        }
+    }
+
+    // Writes the elements of a display as a braced initializer for `type`
+    void appendBracedDisplay(const Expr* display, const Type* type, std::string& out) {
+        out += '{';
+        if (display->kind == ExprKind::Dict) {
+            auto* dict = static_cast<const DictExpr*>(display);
+            for (size_t i = 0; i < dict->keys.size(); ++i) {
+                if (i > 0) {
+                    out += ", ";
+                }
+                out += '{';
+                convertElement(dict->keys[i], type->args[0], out);
+                out += ", ";
+                convertElement(dict->values[i], type->args[1], out);
+                out += '}';
+            }
+        } else {
+            const NodeList<Expr*>& elements = static_cast<const SequenceExpr*>(display)->elements;
+            for (size_t i = 0; i < elements.size(); ++i) {
+                if (i > 0) {
+                    out += ", ";
+                }
+                convertElement(elements[i], display->kind == ExprKind::Tuple ? type->args[i] : type->args[0], out);
+            }
+        }
+        out += '}';
+    }
+
+    // Braced initializers reject narrowing, so integers stored as double are converted explicitly
+    void convertElement(const Expr* value, const Type* expected, std::string& out) {
+        if (expected->kind == TypeKind::Float && value->kind != ExprKind::Number) {
+            TypeKind own = types.typeOf(value, localTypes)->kind;
+            if (own == TypeKind::Int || own == TypeKind::Bool) {
+                out += "static_cast<double>(";
+                convertExpression(value, out);
+                out += ')';
+                return;
+            }
+        }
+        convertValue(value, expected, out);
+    }
+
+    // A display whose inferred type is fully known is written with that type
+    bool convertTypedDisplay(const Expr* display, std::string& out) {
+        const Type* type = types.typeOf(display, localTypes);
+        if (!TypeInference::determined(type) || !bracesFit(display, type)) {
+            return false;
+        }
+        out += types.cppType(type);
+        appendBracedDisplay(display, type, out);
+        return true;
+    }
+
+    // Emits `value` where a value of type `expected` is required. Displays and
+    // None take the expected type, so `x = []` or `return None` fit the
+    // declaration even when the literal alone says nothing about it.
+    void convertValue(const Expr* value, const Type* expected, std::string& out) {
+        if (value->kind == ExprKind::None && TypeInference::determined(expected)) {
+            out += "{}";
+            return;
+        }
+        if (bracesFit(value, expected)) {
+            appendBracedDisplay(value, expected, out);
+            return;
+        }
+        convertExpression(value, out, kConditional);
+    }
+
+    // Emits `expr`, parenthesised if it binds looser than `minPrec` in C++
+    void convertExpression(const Expr* expr, std::string& out, int minPrec = kLowest) {
+        size_t start = out.size();
+        int prec = convertExpressionNode(expr, out);
+        if (prec < minPrec) {
+            out.insert(out.begin() + static_cast<std::ptrdiff_t>(start), '(');
+            out += ')';
+        }
+    }
+
+    std::string expressionString(const Expr* expr) {
+        std::string out;
+        convertExpression(expr, out);
+        return out;
+    }
+
+    // Parameter types come from `signature` when there is one; lambdas stay generic
+    // With `templateParams` (functions and methods, not lambdas) a parameter
+    // whose type is left to the compiler gets a template type parameter
+    // T_name, listed there, since `auto` parameters need C++20
+    void appendParams(std::string& out, const NodeList<Param*>& params, bool skipSelf,
+                      const TypeInference::FunctionTypes* signature = nullptr, bool defaults = true,
+                      std::vector<std::string>* templateParams = nullptr) {
+        bool first = true;
+        for (size_t i = 0; i < params.size(); ++i) {
+            const Param* param = params[i];
+            if (skipSelf && i == 0 && (param->name == "self" || param->name == "cls")) {
+                continue;
+            }
+            if (!first) {
+                out += ", ";
+            }
+            first = false;
+            bool pack = param->kind != Param::Normal;
+            bool constRef = !pack && signature != nullptr && Scope::contains(constRefParams, param->name);
+            std::string type = pack ? "auto"
+                : signature != nullptr ? types.cppType(signature->params[i], TypeInference::TypeUse::Parameter)
+                : convertAnnotation(param->annotation);
+            if (type == "auto" && templateParams != nullptr) {
+                type = "T_";
+                type += param->name;
+                templateParams->push_back((pack ? "typename... " : "typename ") + type);
+            }
+            out += constRef ? "const " + type + '&' : type;
+            out += !pack && signature != nullptr && Scope::contains(refParams, param->name) ? "&" : "";
+            out += pack ? "..." : "";
+            out += ' ';
+            out += param->name;
+            if (param->defaultValue != nullptr && defaults) {
+                out += " = ";
+                if (signature != nullptr && param->kind == Param::Normal) {
+                    convertValue(param->defaultValue, signature->params[i], out);
+                } else {
+                    convertExpression(param->defaultValue, out, kConditional);
+                }
+            }
+        }
+    }
+
+    // Types that own heap memory, so copying them is worth avoiding
+    static bool ownsMemory(const Type* type) {
+        switch (type->kind) {
+            case TypeKind::Str:
+            case TypeKind::List:
+            case TypeKind::Set:
+            case TypeKind::Dict:
+            case TypeKind::Class:
+                return true;
+            case TypeKind::Tuple:
+                return std::any_of(type->args.begin(), type->args.end(), ownsMemory);
+            default:
+                return false;
+        }
+    }
+
+    // Methods that leave an object of this kind unchanged
+    static bool readOnlyMethod(TypeKind kind, std::string_view method) {
+        switch (kind) {
+            case TypeKind::Str:
+                return true;
+            case TypeKind::List:
+            case TypeKind::Tuple:
+                return method == "index" || method == "count" || method == "copy";
+            case TypeKind::Dict:
+                return method == "get" || method == "keys" || method == "values" || method == "items" ||
+                       method == "copy";
+            case TypeKind::Set:
+                return method == "copy" || method == "issubset" || method == "issuperset" || method == "union" ||
+                       method == "intersection" || method == "difference" || method == "isdisjoint";
+            default:
+                return false;
+        }
+    }
+
+    static bool changedInPlace(const NameUsage& usage, const Type* type) {
+        return usage.writtenInto ||
+               std::any_of(usage.methods.begin(), usage.methods.end(),
+                           [&](std::string_view method) { return !readOnlyMethod(type->kind, method); });
+    }
+
+    // A list, dict, set or object parameter the body changes in place is taken
+    // by reference, so the caller sees the change as in Python. One the body
+    // rebinds stays a copy, and so does one with a default, which a reference
+    // could not bind to.
+    static bool takesReference(const Param* param, const NameUsage* usage, const Type* type) {
+        if (usage == nullptr || param->kind != Param::Normal || param->defaultValue != nullptr || usage->rebound) {
+            return false;
+        }
+        switch (type->kind) {
+            case TypeKind::List:
+            case TypeKind::Set:
+            case TypeKind::Dict:
+            case TypeKind::Class:
+                return changedInPlace(*usage, type);
+            default:
+                return false;
+        }
+    }
+
+    void planChangedNames(const OwnershipAnalysis& analysis, const TypeInference::FunctionTypes* scope) {
+        changedNames.clear();
+        for (const NameUsage& usage : analysis.names()) {
+            bool candidate = usage.writtenInto || !usage.methods.empty();
+            if (candidate && changedInPlace(usage, types.variable(scope, usage.name))) {
+                changedNames.push_back(usage.name);
+            }
+        }
+    }
+
+    // Fills `references` with the parameters of the module's functions,
+    // constructors and methods taken by reference. Passing a parameter on to
+    // one of those changes it too, so this repeats until nothing new turns up.
+    void planReferences(const StmtList& body) {
+        PY2CPP_PROFILE_SCOPE("planReferences");
+        struct Callable {
+            const FunctionDef* def;
+            const TypeInference::FunctionTypes* signature;
+            std::string_view callee;
+            bool method;
+            size_t first;  // Index of the first parameter after self
+        };
+        std::vector<Callable> callables;
+        references.clear();
+        for (const Stmt* stmt : body) {
+            if (stmt->kind == StmtKind::FunctionDef) {
+                auto* def = static_cast<const FunctionDef*>(stmt);
+                if (const TypeInference::FunctionTypes* signature = types.definition(def)) {
+                    callables.push_back({def, signature, def->name, false, 0});
+                }
+            } else if (stmt->kind == StmtKind::ClassDef) {
+                auto* cls = static_cast<const ClassDef*>(stmt);
+                TypeInference::ClassTypes* classTypes = types.findClass(cls->name);
+                for (const Stmt* member : cls->body) {
+                    if (member->kind != StmtKind::FunctionDef || classTypes == nullptr) {
+                        continue;
+                    }
+                    auto* def = static_cast<const FunctionDef*>(member);
+                    bool init = def->name == "__init__";
+                    size_t first = !def->params.empty() && (def->params[0]->name == "self" ||
+                                                             def->params[0]->name == "cls") ? 1 : 0;
+                    if (const TypeInference::FunctionTypes* signature = types.method(classTypes, def)) {
+                        callables.push_back({def, signature, init ? cls->name : def->name, !init, first});
+                    }
+                }
+            }
+        }
+        for (const Callable& callable : callables) {
+            references.add(callable.callee, callable.method);
+        }
+        references.seal();
+        // Only list, dict, set and object parameters can be taken by reference
+        callables.erase(std::remove_if(callables.begin(), callables.end(), [](const Callable& callable) {
+            for (size_t i = callable.first; i < callable.def->params.size(); ++i) {
+                switch (callable.signature->params[i]->kind) {
+                    case TypeKind::List:
+                    case TypeKind::Set:
+                    case TypeKind::Dict:
+                    case TypeKind::Class:
+                        return false;
+                    default:
+                        break;
+                }
+            }
+            return true;
+        }), callables.end());
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            referenceAnalyses.clear();
+            referenceDefs.clear();
+            for (const Callable& callable : callables) {
+                referenceAnalyses.emplace_back(callable.def, definedFunctions, definedClasses, &references);
+                referenceDefs.push_back(callable.def);
+                const OwnershipAnalysis& analysis = referenceAnalyses.back();
+                const NodeList<Param*>& params = callable.def->params;
+                for (size_t i = callable.first; i < params.size(); ++i) {
+                    if (takesReference(params[i], analysis.usage(params[i]->name), callable.signature->params[i]) &&
+                        references.mark(callable.callee, callable.method, i - callable.first)) {
+                        changed = true;
+                    }
+                }
+            }
+        }
+        planChangedNames(OwnershipAnalysis(body, definedFunctions, definedClasses, &references), types.module());
+    }
+
+    // Picks the parameters taken by const reference or reference and the last uses that move
+    void planOwnership(const FunctionDef* def, const TypeInference::FunctionTypes* signature) {
+        constRefParams.clear();
+        movedNames.clear();
+        refParams.clear();
+        changedNames.clear();
+        if (signature == nullptr) {
+            return;
+        }
+        size_t planned = static_cast<size_t>(std::find(referenceDefs.begin(), referenceDefs.end(), def) -
+                                             referenceDefs.begin());
+        std::optional<OwnershipAnalysis> own;
+        if (planned == referenceDefs.size()) {
+            own.emplace(def, definedFunctions, definedClasses, references.empty() ? nullptr : &references);
+        }
+        const OwnershipAnalysis& analysis = own ? *own : referenceAnalyses[planned];
+        planChangedNames(analysis, signature);
+        for (size_t i = 0; i < def->params.size(); ++i) {
+            const Param* param = def->params[i];
+            const NameUsage* usage = analysis.usage(param->name);
+            const Type* type = signature->params[i];
+            if (param->kind != Param::Normal || param->name == "self" || param->name == "cls" ||
+                !ownsMemory(type)) {
+                continue;
+            }
+            if (!references.empty() && takesReference(param, usage, type)) {
+                refParams.push_back(param->name);
+                continue;
+            }
+            bool readOnly = usage == nullptr ||
+                (!usage->rebound && !usage->writtenInto && !usage->returned && !usage->movable() &&
+                 std::all_of(usage->methods.begin(), usage->methods.end(),
+                             [&](std::string_view method) { return readOnlyMethod(type->kind, method); }));
+            if (readOnly) {
+                constRefParams.push_back(param->name);
+            }
+        }
+        if (analysis.isOpaque()) {
+            return;
+        }
+        for (const NameUsage& usage : analysis.names()) {
+            if (!usage.movable() || Scope::contains(constRefParams, usage.name) ||
+                Scope::contains(refParams, usage.name)) {
+                continue;
+            }
+            const Type* type = types.variable(signature, usage.name);
+            if (usage.parameter) {
+                for (size_t i = 0; i < def->params.size(); ++i) {
+                    if (RangeLoop::sameName(def->params[i]->name, usage.name)) {
+                        type = signature->params[i];
+                    }
+                }
+            }
+            if (ownsMemory(type)) {
+                movedNames.push_back(usage.last);
+            }
+        }
+    }
+
+    void declareParams(const NodeList<Param*>& params) {
+        for (const Param* param : params) {
+            scope->declare(param->name);
+        }
+    }
+
+    void emitComments(std::string& out, int level, std::string_view text) {
+        // Docstrings and other multi-line text become one comment line each
+        size_t start = 0;
+        while (start <= text.size()) {
+            size_t end = text.find('\n', start);
+            std::string_view lineText = text.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+            while (!lineText.empty() && (lineText.front() == ' ' || lineText.front() == '\t')) {
+                lineText.remove_prefix(1);
+            }
+            std::string line = "// ";
+            line += lineText;
+            while (!line.empty() && line.back() == ' ') {
+                line.pop_back();
+            }
+            emitLine(out, level, line);
+            if (end == std::string_view::npos) {
+                break;
+            }
+            start = end + 1;
+        }
+    }
+
+    void convertAssignment(const Expr* target, const Expr* value, std::string& line) {
+        PY2CPP_PROFILE_SCOPE("convertAssignment");
+        const Type* declared = nullptr;
+        if (target->kind == ExprKind::Name) {
+            std::string_view id = static_cast<const NameExpr*>(target)->id;
+            declared = types.variable(localTypes, id);
+            if (!scope->declared(id)) {
+                line += types.cppType(declared);
+                line += ' ';
+                scope->declare(id);
+            }
+            line += id;
+        } else if (target->kind == ExprKind::Tuple || target->kind == ExprKind::List) {
+            auto* seq = static_cast<const SequenceExpr*>(target);
+            bool allNew = std::all_of(seq->elements.begin(), seq->elements.end(), [&](const Expr* e) {
+                return e->kind == ExprKind::Name && !scope->declared(static_cast<const NameExpr*>(e)->id);
+            });
+            if (allNew) {
+                line += "auto ";
+                appendTarget(line, target);
+                declareTarget(target);
+            } else {
+                line += "std::tie(";
+                appendArguments(line, seq->elements);
+                line += ')';
+            }
+        } else {
+            declared = types.typeOf(target, localTypes);
+            convertExpression(target, line, kUnary);
+        }
+        line += " = ";
+        if (declared != nullptr) {
+            convertValue(value, declared, line);
+        } else {
+            convertExpression(value, line, kConditional);
+        }
+        line += ';';
+    }
+
+    // text = text + a + ... on a declared str appends instead of copying text
+    bool convertSelfConcat(const AssignStmt* assign, std::string& out) {
+        if (assign->targets.size() != 1 || assign->targets[0]->kind != ExprKind::Name) {
+            return false;
+        }
+        std::string_view text = static_cast<const NameExpr*>(assign->targets[0])->id;
+        std::vector<const Expr*> parts;
+        TextUses::concatParts(assign->value, parts);
+        if (parts.size() < 2 || !isName(parts[0], text) || !scope->declared(text)) {
+            return false;
+        }
+        parts.erase(parts.begin());
+        return convertStringAppend(assign->targets[0], parts, out);
+    }
+
+    // Appends the C++ for a simple statement to the current output line
+    // del d[k] and del xs[i] pop the item, so a missing key or index raises
+    // like Python's; del of a name only ends its use and stays a comment
+    bool convertDel(const ExprListStmt* del, std::string& out) {
+        std::string names;
+        for (const Expr* target : del->expressions) {
+            if (target->kind == ExprKind::Name) {
+                names += ' ';
+                names += static_cast<const NameExpr*>(target)->id;
+                continue;
+            }
+            if (target->kind != ExprKind::Subscript) {
+                return false;
+            }
+            auto* sub = static_cast<const SubscriptExpr*>(target);
+            TypeKind kind = types.typeOf(sub->value, localTypes)->kind;
+            if (sub->index->kind == ExprKind::Slice || (kind != TypeKind::List && kind != TypeKind::Dict)) {
+                return false;
+            }
+            if (!out.empty() && out.back() == ';') {
+                out += ' ';
+            }
+            if (options.stdContainers) {
+                out += "py2cpp::method::pop(";
+                convertExpression(sub->value, out, kConditional);
+                out += ", ";
+            } else {
+                convertExpression(sub->value, out, kPostfix);
+                out += ".pop(";
+            }
+            convertExpression(sub->index, out, kConditional);
+            out += ");";
+        }
+        if (!names.empty()) {
+            if (!out.empty() && out.back() == ';') {
+                out += ' ';
+            }
+            out += "// del";
+            out += names;
+        }
+        return true;
+    }
+
+    // Python line `line`, for messages about it
+    std::string_view sourceLine(int line) const {
+        size_t start = 0;
+        for (int i = 1; i < line && start != std::string_view::npos; ++i) {
+            start = pythonCode.find('\n', start);
+            start = start == std::string_view::npos ? start : start + 1;
+        }
+        if (start == std::string_view::npos) {
+            return {};
+        }
+        size_t end = pythonCode.find('\n', start);
+        std::string_view text = pythonCode.substr(start, end == std::string_view::npos ? end : end - start);
+        size_t first = text.find_first_not_of(" \t");
+        size_t last = text.find_last_not_of(" \t\r");
+        return first == std::string_view::npos ? std::string_view() : text.substr(first, last + 1 - first);
+    }
+
+    // A statement with no translation becomes an #error, so the output fails
+    // to compile, and is recorded for unsupportedStatements()
+    void emitUnsupported(int line, std::string_view text, std::string& out) {
+        std::string_view source = sourceLine(line);
+        std::string message = "line " + std::to_string(line) + ": " + std::string(source.empty() ? text : source);
+        out += "#error \"py2cpp: unsupported statement at ";
+        for (char c : message) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+            }
+            out += c;
+        }
+        out += '"';
+        unsupported.push_back(std::move(message));
+    }
+
+    void processLine(const Stmt* stmt, std::string& processedLine) {
+        PY2CPP_PROFILE_SCOPE("processLine");
+        size_t lineStart = processedLine.size();
+        switch (stmt->kind) {
+            case StmtKind::Expr:
+                convertExpression(static_cast<const ExprStmt*>(stmt)->value, processedLine);
+                processedLine += ';';
+                break;
+            case StmtKind::Assign: {
+                auto* assign = static_cast<const AssignStmt*>(stmt);
+                if (convertSelfConcat(assign, processedLine)) {
+                    break;
+                }
+                // a = b = value assigns right to left, reusing the last target
+                const Expr* value = assign->value;
+                for (size_t i = assign->targets.size(); i-- > 0;) {
+                    if (i + 1 < assign->targets.size()) {
+                        processedLine += ' ';
+                    }
+                    convertAssignment(assign->targets[i], value, processedLine);
+                    value = assign->targets[i];
+                }
+                break;
+            }
+            case StmtKind::AugAssign: {
+                auto* aug = static_cast<const AugAssignStmt*>(stmt);
+                std::string_view op = aug->op.substr(0, aug->op.size() - 1);
+                std::string_view helper = arithmeticHelper(op, aug->target, aug->target);
+                if (!helper.empty()) {
+                    std::string target = expressionString(aug->target);
+                    processedLine += target;
+                    processedLine += " = ";
+                    processedLine += helper;
+                    processedLine += '(';
+                    processedLine += target;
+                    processedLine += ", ";
+                    convertExpression(aug->value, processedLine, kConditional);
+                    processedLine += ");";
+                    break;
+                }
+                if (aug->op == "+=") {
+                    std::vector<const Expr*> parts;
+                    TextUses::concatParts(aug->value, parts);
+                    if (convertStringAppend(aug->target, parts, processedLine)) {
+                        break;
+                    }
+                }
+                convertExpression(aug->target, processedLine, kUnary);
+                processedLine += ' ';
+                processedLine += aug->op;
+                processedLine += ' ';
+                convertExpression(aug->value, processedLine, kConditional);
+                processedLine += ';';
+                break;
+            }
+            case StmtKind::AnnAssign: {
+                auto* ann = static_cast<const AnnAssignStmt*>(stmt);
+                if (ann->target->kind == ExprKind::Name) {
+                    std::string_view id = static_cast<const NameExpr*>(ann->target)->id;
+                    const Type* declared = types.variable(localTypes, id);
+                    if (!scope->declared(id)) {
+                        scope->declare(id);
+                        processedLine += declared->kind == TypeKind::Unknown ? convertAnnotation(ann->annotation)
+                                                                             : types.cppType(declared);
+                        processedLine += ' ';
+                    }
+                    processedLine += id;
+                    if (ann->value != nullptr) {
+                        processedLine += " = ";
+                        convertValue(ann->value, declared, processedLine);
+                    }
+                } else {
+                    convertExpression(ann->target, processedLine, kUnary);
+                    if (ann->value != nullptr) {
+                        processedLine += " = ";
+                        convertExpression(ann->value, processedLine, kConditional);
+                    }
+                }
+                processedLine += ';';
+                break;
+            }
+            case StmtKind::Return: {
+                auto* ret = static_cast<const ValueStmt*>(stmt);
+                processedLine += "return";
+                if (returnTypes != nullptr && TypeInference::returnsVoid(*returnTypes)) {
+                    // return None from a function that never returns anything else
+                    if (ret->value != nullptr && ret->value->kind != ExprKind::None) {
+                        processedLine += ' ';
+                        convertExpression(ret->value, processedLine);
+                    }
+                } else if (ret->value != nullptr) {
+                    processedLine += ' ';
+                    if (returnTypes != nullptr) {
+                        convertValue(ret->value, returnTypes->returns, processedLine);
+                    } else {
+                        convertExpression(ret->value, processedLine);
+                    }
+                }
+                processedLine += ';';
+                break;
+            }
+            case StmtKind::Raise: {
+                auto* raise = static_cast<const ValueStmt*>(stmt);
+                if (raise->value == nullptr || (raise->value->kind == ExprKind::Name &&
+                    Scope::contains(scope->exceptionVars, static_cast<const NameExpr*>(raise->value)->id))) {
+                    processedLine += "throw;";
+                    break;
+                }
+                const Expr* exc = raise->value;
+                const CallExpr* call = exc->kind == ExprKind::Call ? static_cast<const CallExpr*>(exc) : nullptr;
+                const Expr* type = call != nullptr ? call->func : exc;
+                if (type->kind != ExprKind::Name) {
+                    processedLine += "throw ";
+                    convertExpression(exc, processedLine);
+                    processedLine += ';';
+                    break;
+                }
+                std::string_view name = static_cast<const NameExpr*>(type)->id;
+                processedLine += "throw ";
+                processedLine += convertExceptionType(name, true);
+                processedLine += '(';
+                if (call != nullptr && !call->args.empty()) {
+                    appendArguments(processedLine, call->args);
+                } else {
+                    appendStringLiteral(processedLine, name, true);
+                }
+                processedLine += ");";
+                break;
+            }
+            case StmtKind::Pass:
+                processedLine += "// pass";
+                break;
+            case StmtKind::Break:
+                if (!breakFlags.empty() && !breakFlags.back().empty()) {
+                    processedLine += breakFlags.back();
+                    processedLine += " = true; ";
+                }
+                processedLine += "break;";
+                break;
+            case StmtKind::Continue:
+                processedLine += "continue;";
+                break;
+            case StmtKind::Global:
+            case StmtKind::Nonlocal: {
+                auto* names = static_cast<const NamesStmt*>(stmt);
+                processedLine += stmt->kind == StmtKind::Global ? "// global" : "// nonlocal";
+                for (std::string_view name : names->names) {
+                    scope->declare(name);
+                    processedLine += ' ';
+                    processedLine += name;
+                }
+                break;
+            }
+            case StmtKind::Del: {
+                auto* del = static_cast<const ExprListStmt*>(stmt);
+                if (!convertDel(del, processedLine)) {
+                    processedLine.resize(lineStart);
+                    emitUnsupported(stmt->line, "del", processedLine);
+                }
+                break;
+            }
+            case StmtKind::Assert: {
+                auto* assert = static_cast<const ExprListStmt*>(stmt);
+                processedLine += "if (!";
+                convertExpression(assert->expressions[0], processedLine, kUnary);
+                processedLine += ") throw std::logic_error(";
+                if (assert->expressions.size() > 1) {
+                    convertExpression(assert->expressions[1], processedLine, kConditional);
+                } else {
+                    processedLine += "\"assertion failed\"";
+                }
+                processedLine += ");";
+                break;
+            }
+            case StmtKind::Import:
+            case StmtKind::ImportFrom: {
+                auto* import = static_cast<const ImportStmt*>(stmt);
+                processedLine += "// ";
+                if (stmt->kind == StmtKind::ImportFrom) {
+                    processedLine += "from ";
+                    processedLine.append(import->level, '.');
+                    processedLine += import->module;
+                    processedLine += ' ';
+                }
+                processedLine += "import ";
+                for (size_t i = 0; i < import->names.size(); ++i) {
+                    if (i > 0) {
+                        processedLine += ", ";
+                    }
+                    processedLine += import->names[i]->name;
+                    if (!import->names[i]->asname.empty()) {
+                        processedLine += " as ";
+                        processedLine += import->names[i]->asname;
+                    }
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    static bool isDocstring(const Stmt* stmt) {
+        return stmt->kind == StmtKind::Expr && static_cast<const ExprStmt*>(stmt)->value->kind == ExprKind::String;
+    }
+
+    void emitBlock(const StmtList& body, int level, std::string& out) {
+        for (const Stmt* stmt : body) {
+            emitStatement(stmt, level, out);
+        }
+    }
+
+    void convertIf(const IfStmt* stmt, int level, std::string& out) {
+        PY2CPP_PROFILE_SCOPE("convertIf");
+        indentation(out, level);
+        out += "if (";
+        convertExpression(stmt->test, out);
+        out += ") {";
+        endLine(out, stmt->comment);
+        emitBlock(stmt->body, level + 1, out);
+
+        const IfStmt* current = stmt;
+        while (!current->orelse.empty()) {
+            const StmtList& orelse = current->orelse;
+            if (orelse.size() == 1 && orelse[0]->kind == StmtKind::If &&
+                static_cast<const IfStmt*>(orelse[0])->isElif) {
+                current = static_cast<const IfStmt*>(orelse[0]);
+                indentation(out, level);
+                out += "} else if (";
+                convertExpression(current->test, out);
+                out += ") {";
+                endLine(out, current->comment);
+                emitBlock(current->body, level + 1, out);
+                continue;
+            }
+            emitLine(out, level, "} else {");
+            emitBlock(orelse, level + 1, out);
+            break;
+        }
+        emitLine(out, level, "}");
+    }
+
+    void convertWhile(const IfStmt* stmt, int level, std::string& out) {
+        PY2CPP_PROFILE_SCOPE("convertWhile");
+        beginLoop(stmt->body, stmt->orelse, level, out);
+        indentation(out, level);
+        out += "while (";
+        convertExpression(stmt->test, out);
+        out += ") {";
+        endLine(out, stmt->comment);
+        emitBlock(stmt->body, level + 1, out);
+        emitLine(out, level, "}");
+        endLoop(stmt->orelse, level, out);
+    }
+
+    // Whether a break in `body` leaves this loop; breaks in nested loops leave those
+    static bool breaksOut(const StmtList& body) {
+        for (const Stmt* stmt : body) {
+            switch (stmt->kind) {
+                case StmtKind::Break:
+                    return true;
+                case StmtKind::If:
+                    if (breaksOut(static_cast<const IfStmt*>(stmt)->body) ||
+                        breaksOut(static_cast<const IfStmt*>(stmt)->orelse)) {
+                        return true;
+                    }
+                    break;
+                case StmtKind::Try: {
+                    auto* tryStmt = static_cast<const TryStmt*>(stmt);
+                    if (breaksOut(tryStmt->body) || breaksOut(tryStmt->orelse) || breaksOut(tryStmt->finalbody)) {
+                        return true;
+                    }
+                    for (const ExceptHandler* handler : tryStmt->handlers) {
+                        if (breaksOut(handler->body)) {
+                            return true;
+                        }
+                    }
+                    break;
+                }
+                case StmtKind::With:
+                    if (breaksOut(static_cast<const WithStmt*>(stmt)->body)) {
+                        return true;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+        return false;
+    }
+
+    // Starts a loop: a loop with an else block that break can skip gets a
+    // flag, declared here, for its breaks to set
+    void beginLoop(const StmtList& body, const StmtList& orelse, int level, std::string& out) {
+        std::string_view flag;
+        if (!orelse.empty() && breaksOut(body)) {
+            std::string name = "loop_broke";
+            flag = interner.intern(name);
+            while (scope->declared(flag) || Scope::contains(breakFlags, flag) ||
+                   types.variable(localTypes, flag)->kind != TypeKind::Unknown) {
+                name += '_';
+                flag = interner.intern(name);
+            }
+            scope->declare(flag);
+            emitLine(out, level, "bool " + name + " = false;");
+        }
+        breakFlags.push_back(flag);
+    }
+
+    // Ends the loop beginLoop() started, after its closing brace, with its else block
+    void endLoop(const StmtList& orelse, int level, std::string& out) {
+        std::string_view flag = breakFlags.back();
+        breakFlags.pop_back();
+        if (orelse.empty()) {
+            return;
+        }
+        if (flag.empty()) {
+            emitLine(out, level, "// else: the loop has no break, so this always runs");
+            emitLine(out, level, "{");
+        } else {
+            emitLine(out, level, "if (!" + std::string(flag) + ") {");
+        }
+        emitBlock(orelse, level + 1, out);
+        emitLine(out, level, "}");
+    }
+
+    // Name for a generated loop variable that the loop body does not use
+    std::string_view loopName(const RangeLoop& loop, std::string name) {
+        std::string_view id = interner.intern(name);
+        while (loop.mentions(id) || scope->declared(id)) {
+            name += '_';
+            id = interner.intern(name);
+        }
+        return id;
+    }
+
+    // Range bounds convert to the counter type; len() is unsigned in C++
+    void appendRangeBound(std::string& out, const Expr* bound, bool unsignedIndex) {
+        bool length = bound->kind == ExprKind::Call && isName(static_cast<const CallExpr*>(bound)->func, "len");
+        if (length && !unsignedIndex) {
+            out += "static_cast<int64_t>(";
+            convertExpression(bound, out);
+            out += ')';
+        } else {
+            convertExpression(bound, out);
+        }
+    }
+
+    // Header of a counted loop for `for index in range(...)`. Like Python, the
+    // stop and step are evaluated once, so anything but a literal or a name the
+    // body leaves alone is hoisted into the loop's init statement.
+    void appendRangeHeader(std::string& out, const RangeLoop& loop, std::string_view counter, bool unsignedIndex) {
+        out += unsignedIndex ? "for (size_t " : "for (int64_t ";
+        out += counter;
+        out += " = ";
+        if (loop.start != nullptr) {
+            appendRangeBound(out, loop.start, unsignedIndex);
+        } else {
+            out += '0';
+        }
+
+        std::string_view stop;
+        if (loop.stop->kind != ExprKind::Number &&
+            (loop.stop->kind != ExprKind::Name || loop.rebinds(static_cast<const NameExpr*>(loop.stop)->id))) {
+            stop = loopName(loop, std::string(loop.index) + "_stop");
+            out += ", ";
+            out += stop;
+            out += " = ";
+            appendRangeBound(out, loop.stop, unsignedIndex);
+        }
+        std::string_view step;
+        if (!loop.constantStep) {
+            step = loopName(loop, std::string(loop.index) + "_step");
+            out += ", ";
+            out += step;
+            out += " = ";
+            appendRangeBound(out, loop.step, unsignedIndex);
+        }
+
+        auto appendStop = [&]() {
+            if (stop.empty()) {
+                convertExpression(loop.stop, out, kRelational + 1);
+            } else {
+                out += stop;
+            }
+        };
+        out += "; ";
+        if (!loop.constantStep) {
+            out += step;
+            out += " > 0 ? ";
+        }
+        if (!loop.constantStep || loop.stepValue > 0) {
+            out += counter;
+            out += " < ";
+            appendStop();
+        }
+        if (!loop.constantStep) {
+            out += " : ";
+        }
+        if (!loop.constantStep || loop.stepValue < 0) {
+            out += counter;
+            out += " > ";
+            appendStop();
+        }
+
+        out += "; ";
+        if (!loop.constantStep) {
+            out += counter;
+            out += " += ";
+            out += step;
+        } else if (loop.stepValue == 1 || loop.stepValue == -1) {
+            out += loop.stepValue > 0 ? "++" : "--";
+            out += counter;
+        } else {
+            out += counter;
+            out += loop.stepValue > 0 ? " += " : " -= ";
+            out += std::to_string(loop.stepValue > 0 ? loop.stepValue : -loop.stepValue);
+        }
+        out += ')';
+    }
+
+    // Lowers `for i in range(...)`. A range(len(xs)) loop that only reads xs[i]
+    // becomes a range-for over xs; other loops count with size_t when the index
+    // is only ever used to subscript and stays within [0, len), and with int64_t
+    // otherwise. Both shapes let the C++ compiler vectorize simple reductions.
+    void convertRangeFor(const ForStmt* stmt, RangeLoop& loop, int level, size_t loopStart, std::string& out) {
+        PY2CPP_PROFILE_SCOPE("convertRangeFor");
+        LoopAnalysis(loop).analyzeBody(stmt->body);
+        int64_t count = 0;
+        bool tabulate = loop.start == nullptr && loop.step == nullptr && !loop.indexAssigned && !loop.opaque &&
+                        !loop.exits && LoopAnalysis::integerLiteral(loop.stop, count) && count > 0 && count <= kMaxTableSize;
+        if (tabulate) {
+            tableLoops.push_back({&loop, count, level, {}, {}});
+        }
+        if (loop.iteratesSequence()) {
+            TypeKind kind = types.typeOf(loop.length, localTypes)->kind;
+            if (kind == TypeKind::List || kind == TypeKind::Str) {
+                std::string_view element = loopName(loop, std::string(loop.sequence) + "_" + std::string(loop.index));
+                out += Scope::contains(changedNames, loop.sequence) ? "for (auto&& " : "for (const auto& ";
+                out += element;
+                out += " : ";
+                convertExpression(loop.length, out);
+                out += ") {";
+                endLine(out, stmt->comment);
+                elementAliases.push_back({loop.sequence, loop.index, element});
+                emitBlock(stmt->body, level + 1, out);
+                elementAliases.pop_back();
+                return;
+            }
+        }
+
+        int64_t start = 0;
+        bool unsignedIndex = loop.length != nullptr && loop.constantStep && loop.stepValue > 0 &&
+                             (loop.start == nullptr || (LoopAnalysis::integerLiteral(loop.start, start) && start >= 0)) &&
+                             loop.indexOnlySubscripts && !loop.indexAssigned && !loop.opaque;
+        // Assigning the index inside the body must not change the iteration
+        std::string_view counter = loop.indexAssigned ? loopName(loop, std::string(loop.index) + "_next") : loop.index;
+        appendRangeHeader(out, loop, counter, unsignedIndex);
+        out += " {";
+        declareTarget(stmt->target);
+        endLine(out, stmt->comment);
+        if (loop.indexAssigned) {
+            indentation(out, level + 1);
+            out += types.cppType(types.variable(localTypes, loop.index));
+            out += ' ';
+            out += loop.index;
+            out += " = ";
+            out += counter;
+            out += ';';
+            endLine(out);
+        }
+        emitBlock(stmt->body, level + 1, out);
+        if (tabulate) {
+            out.insert(loopStart, tableLoops.back().tables);
+            tableLoops.pop_back();
+        }
+    }
+
+    // --parallel: `for x in xs: total += f(x)` over a list or range() with a
+    // side-effect free f that does not read total becomes one py2cpp::parallelSum
+    bool convertParallelSum(const ForStmt* stmt, int level, std::string& out) {
+        if (stmt->body.size() != 1 || !stmt->orelse.empty() || stmt->target->kind != ExprKind::Name ||
+            stmt->body[0]->kind != StmtKind::AugAssign) {
+            return false;
+        }
+        auto* assign = static_cast<const AugAssignStmt*>(stmt->body[0]);
+        if (assign->op != "+=" || assign->target->kind != ExprKind::Name) {
+            return false;
+        }
+        std::string_view total = static_cast<const NameExpr*>(assign->target)->id;
+        const Type* type = types.variable(localTypes, total);
+        if ((type->kind != TypeKind::Int && type->kind != TypeKind::Float) || !scope->declared(total)) {
+            return false;
+        }
+        std::vector<std::string_view> names;
+        if (!purity.isPure(assign->value, &names) || Scope::contains(names, total)) {
+            return false;
+        }
+        std::string source;
+        if (!appendParallelSource(stmt->target, stmt->iter, source)) {
+            return false;
+        }
+        indentation(out, level);
+        out += total;
+        out += " += py2cpp::parallelSum<";
+        out += types.cppType(type);
+        out += ">(";
+        out += source;
+        out += ", [&](const auto& ";
+        out += static_cast<const NameExpr*>(stmt->target)->id;
+        out += ") { return ";
+        convertExpression(assign->value, out);
+        out += "; });";
+        endLine(out, stmt->comment);
+        return true;
+    }
+
+    // `for field in text.split(...)` walks slices of text when text is a
+    // variable the body leaves alone and field is only ever read as text
+    bool sliceable(const ForStmt* stmt, const CallExpr* split) {
+        const Expr* text = static_cast<const AttributeExpr*>(split->func)->value;
+        if (stmt->target->kind != ExprKind::Name || text->kind != ExprKind::Name) {
+            return false;
+        }
+        TextUses uses(static_cast<const NameExpr*>(stmt->target)->id);
+        uses.analyzeBody(stmt->body);
+        if (!uses.onlyText() || uses.rebinds(static_cast<const NameExpr*>(text)->id)) {
+            return false;
+        }
+        for (std::string_view appended : uses.appendTargets()) {
+            if (types.variable(localTypes, appended)->kind != TypeKind::Str) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Ahead of `for x in xs:` whose body appends x and literals to a declared
+    // str: one reservation for the whole loop. `indentation` is already out.
+    void appendLoopReserve(const ForStmt* stmt, int level, std::string& out) {
+        if (stmt->target->kind != ExprKind::Name || stmt->iter->kind != ExprKind::Name) {
+            return;
+        }
+        const Type* sequence = types.typeOf(stmt->iter, localTypes);
+        if ((sequence->kind != TypeKind::List && sequence->kind != TypeKind::Set) || sequence->args.empty()) {
+            return;
+        }
+        std::string_view element = static_cast<const NameExpr*>(stmt->target)->id;
+        std::string_view items = static_cast<const NameExpr*>(stmt->iter)->id;
+        bool textElements = sequence->args[0]->kind == TypeKind::Str;
+        struct Growth {
+            std::string_view text;
+            size_t copies = 0;
+            size_t bytes = 0;
+        };
+        std::vector<Growth> growths;
+        for (const Stmt* body : stmt->body) {
+            // text += parts, or text = text + parts
+            const Expr* target = nullptr;
+            std::vector<const Expr*> parts;
+            if (body->kind == StmtKind::AugAssign && static_cast<const AugAssignStmt*>(body)->op == "+=") {
+                target = static_cast<const AugAssignStmt*>(body)->target;
+                TextUses::concatParts(static_cast<const AugAssignStmt*>(body)->value, parts);
+            } else if (body->kind == StmtKind::Assign && static_cast<const AssignStmt*>(body)->targets.size() == 1) {
+                target = static_cast<const AssignStmt*>(body)->targets[0];
+                TextUses::concatParts(static_cast<const AssignStmt*>(body)->value, parts);
+                if (parts.size() < 2 || target->kind != ExprKind::Name ||
+                    !isName(parts[0], static_cast<const NameExpr*>(target)->id)) {
+                    continue;
+                }
+                parts.erase(parts.begin());
+            }
+            if (target == nullptr || target->kind != ExprKind::Name) {
+                continue;
+            }
+            std::string_view text = static_cast<const NameExpr*>(target)->id;
+            if (text == element || text == items || !scope->declared(text) ||
+                types.variable(localTypes, text)->kind != TypeKind::Str) {
+                continue;
+            }
+            auto growth = std::find_if(growths.begin(), growths.end(), [text](const Growth& g) {
+                return g.text == text;
+            });
+            if (growth == growths.end()) {
+                growths.push_back({text});
+                growth = growths.end() - 1;
+            }
+            for (const Expr* part : parts) {
+                if (textElements && isName(part, element)) {
+                    ++growth->copies;
+                } else if (part->kind == ExprKind::String) {
+                    // Escapes count their source length, which only over-reserves
+                    growth->bytes += static_cast<const StringExpr*>(part)->body.size();
+                }
+            }
+        }
+        bool first = true;
+        for (const Growth& growth : growths) {
+            if (growth.copies == 0 && growth.bytes == 0) {
+                continue;
+            }
+            if (!first) {
+                indentation(out, level);
+            }
+            first = false;
+            out += "py2cpp::reserveAppends(";
+            out += growth.text;
+            out += ", ";
+            out += items;
+            out += ", ";
+            out += std::to_string(growth.copies);
+            out += ", ";
+            out += std::to_string(growth.bytes);
+            out += ");";
+            endLine(out);
+        }
+        if (!first) {
+            indentation(out, level);
+        }
+    }
+
+    // A loop variable whose element the body changes is bound by reference
+    bool changesTarget(const Expr* target) const {
+        if (target->kind == ExprKind::Name) {
+            return Scope::contains(changedNames, static_cast<const NameExpr*>(target)->id);
+        }
+        if (target->kind == ExprKind::Tuple || target->kind == ExprKind::List) {
+            auto& elements = static_cast<const SequenceExpr*>(target)->elements;
+            return std::any_of(elements.begin(), elements.end(), [&](const Expr* e) { return changesTarget(e); });
+        }
+        return false;
+    }
+
+    void convertFor(const ForStmt* stmt, int level, std::string& out) {
+        PY2CPP_PROFILE_SCOPE("convertFor");
+        if (options.parallel && convertParallelSum(stmt, level, out)) {
+            return;
+        }
+        beginLoop(stmt->body, stmt->orelse, level, out);
+        size_t loopStart = out.size();
+        indentation(out, level);
+        RangeLoop loop;
+        if (LoopAnalysis::matchRange(stmt->target, stmt->iter, loop)) {
+            convertRangeFor(stmt, loop, level, loopStart, out);
+        } else {
+            // for k, v in d.items() iterates the map itself
+            const Expr* iter = stmt->iter;
+            const CallExpr* call = iter->kind == ExprKind::Call ? static_cast<const CallExpr*>(iter) : nullptr;
+            if (call != nullptr && call->args.empty() && call->func->kind == ExprKind::Attribute &&
+                static_cast<const AttributeExpr*>(call->func)->attr == "items") {
+                iter = static_cast<const AttributeExpr*>(call->func)->value;
+            }
+            const CallExpr* split = splitCall(iter);
+            bool views = split != nullptr && sliceable(stmt, split);
+            appendLoopReserve(stmt, level, out);
+            out += changesTarget(stmt->target) ? "for(auto&& " : "for(const auto& ";
+            appendTarget(out, stmt->target);
+            out += " : ";
+            if (views) {
+                appendSplit(split, true, out);
+                viewNames.push_back(static_cast<const NameExpr*>(stmt->target)->id);
+            } else if (iter != stmt->iter) {
+                convertExpression(iter, out);
+            } else {
+                appendIterable(iter, out);
+            }
+            out += ") {";
+            declareTarget(stmt->target);
+            endLine(out, stmt->comment);
+            emitBlock(stmt->body, level + 1, out);
+            if (views) {
+                viewNames.pop_back();
+            }
+        }
+        emitLine(out, level, "}");
+        endLoop(stmt->orelse, level, out);
+    }
+
+    void emitDecorators(const NodeList<Expr*>& decorators, int level, std::string& out) {
+        for (const Expr* decorator : decorators) {
+            emitLine(out, level, "// @" + expressionString(decorator));
+        }
+    }
+
+    static bool scalar(const Type* type) {
+        return type->kind == TypeKind::Int || type->kind == TypeKind::Float || type->kind == TypeKind::Bool;
+    }
+
+    // Parameters, locals and the result are all ints, floats or bools
+    static bool scalarSignature(const TypeInference::FunctionTypes& function) {
+        if (TypeInference::returnsVoid(function) || !scalar(function.returns) ||
+            !std::all_of(function.params.begin(), function.params.end(), scalar)) {
+            return false;
+        }
+        for (const auto& local : function.locals.entries) {
+            if (!scalar(local.second)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Whether a function's body can live in its module's .cpp file: constexpr
+    // functions, deduced return types and auto parameters (which make it a
+    // template) have to be seen by every caller
+    bool separable(const FunctionDef* def, const TypeInference::FunctionTypes* signature, bool isConstexpr) const {
+        if (signature == nullptr || isConstexpr || types.returnType(*signature) == "auto") {
+            return false;
+        }
+        for (size_t i = 0; i < def->params.size(); ++i) {
+            if (def->params[i]->kind != Param::Normal ||
+                types.cppType(signature->params[i], TypeInference::TypeUse::Parameter) == "auto") {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // `template <...>` ahead of a function whose parameters need it
+    static std::string templateHeader(const std::vector<std::string>& params) {
+        std::string header = "template <";
+        for (size_t i = 0; i < params.size(); ++i) {
+            header += i > 0 ? ", " : "";
+            header += params[i];
+        }
+        return header + '>';
+    }
+
+    // Python calls only the last def of a name, while C++ would keep both as
+    // overloads and could pick the earlier one; it is left out with a note
+    bool superseded(const TypeInference::FunctionTypes* latest, const FunctionDef* def, int level, std::string& out) {
+        if (latest == nullptr || latest->def == nullptr || latest->def == def) {
+            return false;
+        }
+        emitLine(out, level, "// " + std::string(def->name) + "() is replaced by a later definition");
+        return true;
+    }
+
+    // With `declaration` (--modules, top-level functions only) the prototype for
+    // the module's header is stored there, or left empty when the whole
+    // definition has to go into the header
+    void convertFunction(const FunctionDef* def, int level, std::string& out, std::string* declaration = nullptr) {
+        PY2CPP_PROFILE_SCOPE("convertFunction");
+        Scope functionScope;
+        Scope* outer = scope;
+        bool nested = outer != &globalScope;
+        if (!nested && superseded(types.function(def->name), def, level, out)) {
+            return;
+        }
+        // Nested functions share the enclosing function's variable types
+        TypeInference::FunctionTypes* signature = nested ? nullptr : types.definition(def);
+        TypeInference::FunctionTypes* outerTypes = localTypes;
+        const TypeInference::FunctionTypes* outerReturns = returnTypes;
+        std::vector<std::string_view> outerConstRefs = constRefParams;
+        std::vector<const Expr*> outerMoves = movedNames;
+        std::vector<std::string_view> outerRefs = refParams;
+        std::vector<std::string_view> outerChanged = changedNames;
+        if (!nested) {
+            planOwnership(def, signature);
+        }
+
+        std::string header;
+        if (nested) {
+            // Nested functions become lambdas capturing the enclosing scope
+            outer->declare(def->name);
+            header = "auto ";
+            header += def->name;
+            header += " = [&](";
+        } else {
+            out += '\n';
+            emitDecorators(def->decorators, level, out);
+            if (signature != nullptr && compileTime.add(def, scalarSignature(*signature))) {
+                header = "constexpr ";
+            }
+            header += signature != nullptr ? types.returnType(*signature) : convertAnnotation(def->returns);
+            header += ' ';
+            header += def->name;
+            header += '(';
+            localTypes = signature;
+        }
+        scope = &functionScope;
+        returnTypes = signature;
+        size_t paramsStart = header.size();
+        std::vector<std::string> templateParams;
+        appendParams(header, def->params, false, signature, true, nested ? nullptr : &templateParams);
+        if (declaration != nullptr && !nested) {
+            bool isConstexpr = header.compare(0, 10, "constexpr ") == 0;
+            if (separable(def, signature, isConstexpr)) {
+                // Default arguments belong to the declaration only
+                *declaration = header + ");";
+                header.resize(paramsStart);
+                appendParams(header, def->params, false, signature, false);
+            } else if (!isConstexpr && templateParams.empty()) {
+                header.insert(0, "inline ");
+            }
+        }
+        declareParams(def->params);
+        header += ") {";
+        if (!templateParams.empty()) {
+            emitLine(out, level, templateHeader(templateParams));
+        }
+        emitLine(out, level, header, def->comment);
+        hoistLocals(def->body, 0, level + 1, out);
+        emitBlock(def->body, level + 1, out);
+        emitLine(out, level, nested ? "};" : "}");
+        scope = outer;
+        localTypes = outerTypes;
+        returnTypes = outerReturns;
+        constRefParams = std::move(outerConstRefs);
+        movedNames = std::move(outerMoves);
+        refParams = std::move(outerRefs);
+        changedNames = std::move(outerChanged);
+    }
+
+    // Whether __init__ has a parameter after self without a default
+    static bool initTakesArguments(const ClassDef* cls) {
+        for (const Stmt* stmt : cls->body) {
+            if (stmt->kind != StmtKind::FunctionDef || static_cast<const FunctionDef*>(stmt)->name != "__init__") {
+                continue;
+            }
+            const NodeList<Param*>& params = static_cast<const FunctionDef*>(stmt)->params;
+            return params.size() > 1 && params[1]->kind == Param::Normal && params[1]->defaultValue == nullptr;
+        }
+        return false;
+    }
+
+    void convertClass(const ClassDef* cls, int level, std::string& out) {
+        PY2CPP_PROFILE_SCOPE("convertClass");
+        const ClassDef* outerClass = currentClass;
+        std::string outerBase = currentBaseClass;
+        currentClass = cls;
+        currentBaseClass.clear();
+
+        std::string result = "class ";
+        result += cls->name;
+        bool firstBase = true;
+        for (const Expr* base : cls->bases) {
+            if (isName(base, "object")) {
+                continue;
+            }
+            std::string baseName = expressionString(base);
+            if (exceptionMap.count(baseName) != 0) {
+                baseName = convertExceptionType(baseName, true);
+            }
+            if (currentBaseClass.empty()) {
+                currentBaseClass = baseName;
+            }
+            result += firstBase ? " : public " : ", public ";
+            result += baseName;
+            firstBase = false;
+        }
+        result += " {";
+
+        out += '\n';
+        emitDecorators(cls->decorators, level, out);
+        emitLine(out, level, result, cls->comment);
+        emitLine(out, level, "public:");
+
+        // Attributes assigned through self become members
+        TypeInference::ClassTypes* classTypes = types.findClass(cls->name);
+        if (classTypes != nullptr) {
+            for (const auto& field : classTypes->fields.entries) {
+                indentation(out, level + 1);
+                out += types.cppType(field.second, TypeInference::TypeUse::Element);
+                out += ' ';
+                out += field.first;
+                out += ';';
+                endLine(out);
+            }
+        }
+        // A module variable holding an instance is declared before main()
+        // constructs it
+        if (initTakesArguments(cls)) {
+            emitLine(out, level + 1, std::string(cls->name) + "() = default;");
+        }
+
+        Scope classScope;
+        Scope* outer = scope;
+        scope = &classScope;
+        TypeInference::FunctionTypes* outerTypes = localTypes;
+        localTypes = classTypes != nullptr ? &classTypes->statics : nullptr;
+        for (const Stmt* stmt : cls->body) {
+            if (stmt->kind == StmtKind::FunctionDef) {
+                convertClassMethod(static_cast<const FunctionDef*>(stmt), level + 1, out);
+            } else if (stmt->kind == StmtKind::Assign || stmt->kind == StmtKind::AnnAssign) {
+                // Class attributes are shared by all instances
+                indentation(out, level + 1);
+                out += "static inline ";
+                processLine(stmt, out);
+                endLine(out, stmt->comment);
+            } else {
+                emitStatement(stmt, level + 1, out);
+            }
+        }
+        scope = outer;
+        localTypes = outerTypes;
+        emitLine(out, level, "};");
+
+        currentClass = outerClass;
+        currentBaseClass = outerBase;
+    }
+
+    void convertClassMethod(const FunctionDef* def, int level, std::string& out) {
+        PY2CPP_PROFILE_SCOPE("convertClassMethod");
+        TypeInference::ClassTypes* classTypes = types.findClass(currentClass->name);
+        if (superseded(types.method(classTypes, def->name), def, level, out)) {
+            return;
+        }
+        Scope methodScope;
+        Scope* outer = scope;
+        scope = &methodScope;
+        inClassMethod = true;
+        TypeInference::FunctionTypes* signature = types.method(classTypes, def);
+        TypeInference::FunctionTypes* outerTypes = localTypes;
+        const TypeInference::FunctionTypes* outerReturns = returnTypes;
+        localTypes = signature;
+        returnTypes = signature;
+        std::vector<std::string_view> outerConstRefs = constRefParams;
+        std::vector<const Expr*> outerMoves = movedNames;
+        std::vector<std::string_view> outerRefs = refParams;
+        std::vector<std::string_view> outerChanged = changedNames;
+        planOwnership(def, signature);
+
+        bool isStatic = false;
+        for (const Expr* decorator : def->decorators) {
+            if (isName(decorator, "staticmethod") || isName(decorator, "classmethod")) {
+                isStatic = true;
+            } else {
+                emitLine(out, level, "// @" + expressionString(decorator));
+            }
+        }
+        bool hasSelf = !isStatic || (!def->params.empty() && def->params[0]->name == "cls");
+
+        std::string header;
+        size_t bodyStart = 0;
+        if (def->name == "__init__") {
+            header += currentClass->name;
+        } else {
+            if (isStatic) {
+                header += "static ";
+            }
+            header += signature != nullptr ? types.returnType(*signature) : convertAnnotation(def->returns);
+            header += ' ';
+            header += def->name;
+        }
+        header += '(';
+        std::vector<std::string> templateParams;
+        appendParams(header, def->params, hasSelf, signature, true, &templateParams);
+        declareParams(def->params);
+        header += ')';
+
+        // A leading base constructor call moves into the initializer list
+        if (def->name == "__init__" && !def->body.empty() && def->body[0]->kind == StmtKind::Expr &&
+            isBaseInitCall(static_cast<const ExprStmt*>(def->body[0])->value) && !currentBaseClass.empty()) {
+            auto* call = static_cast<const CallExpr*>(static_cast<const ExprStmt*>(def->body[0])->value);
+            NodeList<Expr*> args = call->args;
+            if (!args.empty() && isName(args[0], "self")) {
+                ++args.items;
+                --args.count;
+            }
+            header += " : " + currentBaseClass + "(";
+            appendArguments(header, args);
+            header += ')';
+            bodyStart = 1;
+        }
+        header += " {";
+        if (!templateParams.empty()) {
+            emitLine(out, level, templateHeader(templateParams));
+        }
+        emitLine(out, level, header, def->comment);
+        hoistLocals(def->body, bodyStart, level + 1, out);
+        for (size_t i = bodyStart; i < def->body.size(); ++i) {
+            emitStatement(def->body[i], level + 1, out);
+        }
+        emitLine(out, level, "}");
+
+        inClassMethod = false;
+        scope = outer;
+        localTypes = outerTypes;
+        returnTypes = outerReturns;
+        constRefParams = std::move(outerConstRefs);
+        movedNames = std::move(outerMoves);
+        refParams = std::move(outerRefs);
+        changedNames = std::move(outerChanged);
+    }
+
+    void handleExceptions(const TryStmt* stmt, int level, std::string& out) {
+        PY2CPP_PROFILE_SCOPE("handleExceptions");
+        emitLine(out, level, "try {", stmt->comment);
+        emitBlock(stmt->body, level + 1, out);
+        // try/else runs when the body did not raise
+        emitBlock(stmt->orelse, level + 1, out);
+
+        for (const ExceptHandler* handler : stmt->handlers) {
+            std::vector<const Expr*> types;
+            if (handler->type != nullptr && handler->type->kind == ExprKind::Tuple) {
+                for (const Expr* type : static_cast<const SequenceExpr*>(handler->type)->elements) {
+                    types.push_back(type);
+                }
+            } else if (handler->type != nullptr) {
+                types.push_back(handler->type);
+            }
+
+            if (types.empty()) {
+                emitLine(out, level, "} catch (...) {", handler->comment);
+                emitBlock(handler->body, level + 1, out);
+                continue;
+            }
+            // except (A, B) repeats the handler for each distinct C++ type
+            std::vector<std::string> caught;
+            for (const Expr* type : types) {
+                std::string exceptionType = type->kind == ExprKind::Name
+                    ? convertExceptionType(static_cast<const NameExpr*>(type)->id, false)
+                    : expressionString(type);
+                if (std::find(caught.begin(), caught.end(), exceptionType) != caught.end()) {
+                    continue;
+                }
+                caught.push_back(exceptionType);
+                std::string header = "} catch (const " + exceptionType + "& ";
+                header += handler->name.empty() ? std::string_view("e") : handler->name;
+                header += ") {";
+                emitLine(out, level, header, handler->comment);
+                if (!handler->name.empty()) {
+                    scope->exceptionVars.push_back(handler->name);
+                }
+                emitBlock(handler->body, level + 1, out);
+                if (!handler->name.empty()) {
+                    scope->exceptionVars.pop_back();
+                }
+            }
+        }
+        if (stmt->handlers.empty()) {
+            emitLine(out, level, "} catch (...) {");
+            emitLine(out, level + 1, "throw;");
+        }
+        emitLine(out, level, "}");
+
+        if (!stmt->finalbody.empty()) {
+            emitLine(out, level, "{ // finally");
+            emitBlock(stmt->finalbody, level + 1, out);
+            emitLine(out, level, "}");
+        }
+    }
+
+    void convertWith(const WithStmt* stmt, int level, std::string& out) {
+        PY2CPP_PROFILE_SCOPE("convertWith");
+        emitLine(out, level, "{ // with", stmt->comment);
+        for (const WithItem* item : stmt->items) {
+            if (item->var != nullptr) {
+                indentation(out, level + 1);
+                convertAssignment(item->var, item->context, out);
+            } else {
+                indentation(out, level + 1);
+                convertExpression(item->context, out);
+                out += ';';
+            }
+            endLine(out);
+        }
+        emitBlock(stmt->body, level + 1, out);
+        emitLine(out, level, "}");
+    }
+
+    void emitStatement(const Stmt* stmt, int level, std::string& out) {
+        bool outer = std::exchange(unsupportedExpression, false);
+        size_t start = out.size();
+        convertStatement(stmt, level, out);
+        if (unsupportedExpression) {
+            out.resize(start);
+            indentation(out, level);
+            emitUnsupported(stmt->line, "expression", out);
+            endLine(out);
+        }
+        unsupportedExpression = outer;
+    }
+
+    void convertStatement(const Stmt* stmt, int level, std::string& out) {
+        switch (stmt->kind) {
+            case StmtKind::Comment:
+                indentation(out, level);
+                out += "//";
+                out += static_cast<const TextStmt*>(stmt)->text;
+                endLine(out);
+                return;
+            case StmtKind::Unsupported: {
+                auto* text = static_cast<const TextStmt*>(stmt);
+                indentation(out, level);
+                emitUnsupported(stmt->line, text->text, out);
+                endLine(out);
+                if (!text->body.empty()) {
+                    emitLine(out, level, "{");
+                    emitBlock(text->body, level + 1, out);
+                    emitLine(out, level, "}");
+                }
+                return;
+            }
+            case StmtKind::If:
+                convertIf(static_cast<const IfStmt*>(stmt), level, out);
+                return;
+            case StmtKind::While:
+                convertWhile(static_cast<const IfStmt*>(stmt), level, out);
+                return;
+            case StmtKind::For:
+                convertFor(static_cast<const ForStmt*>(stmt), level, out);
+                return;
+            case StmtKind::FunctionDef:
+                convertFunction(static_cast<const FunctionDef*>(stmt), level, out);
+                return;
+            case StmtKind::ClassDef:
+                convertClass(static_cast<const ClassDef*>(stmt), level, out);
+                return;
+            case StmtKind::Try:
+                handleExceptions(static_cast<const TryStmt*>(stmt), level, out);
+                return;
+            case StmtKind::With:
+                convertWith(static_cast<const WithStmt*>(stmt), level, out);
+                return;
+            case StmtKind::Import:
+            case StmtKind::ImportFrom:
+                if (graph != nullptr) {
+                    convertModuleImport(static_cast<const ImportStmt*>(stmt), level, out);
+                    return;
+                }
+                break;
+            default:
+                break;
+        }
+        if (isDocstring(stmt)) {
+            emitComments(out, level, static_cast<const StringExpr*>(static_cast<const ExprStmt*>(stmt)->value)->body);
+            return;
+        }
+        indentation(out, level);
+        processLine(stmt, out);
+        endLine(out, stmt->comment);
+    }
+
+    bool isMainGuard(const Stmt* stmt) {
+        if (stmt->kind != StmtKind::If) {
+            return false;
+        }
+        auto* test = static_cast<const IfStmt*>(stmt)->test;
+        if (test->kind != ExprKind::Compare) {
+            return false;
+        }
+        auto* cmp = static_cast<const CompareExpr*>(test);
+        return cmp->ops.size() == 1 && cmp->ops[0] == "==" && isName(cmp->operands[0], "__name__") &&
+               cmp->operands[1]->kind == ExprKind::String &&
+               static_cast<const StringExpr*>(cmp->operands[1])->body == "__main__";
+    }
+
+    // Module-level code that stays at namespace scope; everything else runs in main()
+    static bool isDeclaration(const Stmt* stmt) {
+        switch (stmt->kind) {
+            case StmtKind::FunctionDef:
+            case StmtKind::ClassDef:
+            case StmtKind::Import:
+            case StmtKind::ImportFrom:
+            case StmtKind::Global:
+            case StmtKind::Pass:
+                return true;
+            case StmtKind::Expr:
+                return isDocstring(stmt);
+            default:
+                return false;
+        }
+    }
+
+    // Top-level function and class names are needed before the statements that
+    // use them are generated, so they are collected with a quick lexer-only pass
+    void collectDefinitions() {
+        PY2CPP_PROFILE_SCOPE("collect definitions");
+        PythonLexer lexer(pythonCode);
+        int depth = 0;
+        bool lineStart = true;
+        for (Token tok = lexer.next(); tok.kind != TokenKind::EndOfFile; tok = lexer.next()) {
+            switch (tok.kind) {
+                case TokenKind::Indent:
+                    ++depth;
+                    break;
+                case TokenKind::Dedent:
+                    --depth;
+                    break;
+                case TokenKind::Newline:
+                    lineStart = true;
+                    break;
+                case TokenKind::Comment:
+                    break;
+                default:
+                    if (lineStart && depth == 0 && (tok.isKeyword("def") || tok.isKeyword("class"))) {
+                        Token name = lexer.next();
+                        if (name.kind == TokenKind::Name) {
+                            if (tok.text == "def") {
+                                definedFunctions.push_back(cppIdentifier(name.text));
+                            } else {
+                                definedClasses.push_back(cppIdentifier(name.text));
+                                hasClasses = true;
+                            }
+                        }
+                    }
+                    // `async def` still starts a definition
+                    lineStart = lineStart && tok.isKeyword("async");
+                    break;
+            }
+        }
+        sortDefinitions();
+    }
+
+    // The same from an already parsed module
+    void collectDefinitions(const StmtList& body) {
+        for (const Stmt* stmt : body) {
+            if (stmt->kind == StmtKind::FunctionDef) {
+                definedFunctions.push_back(static_cast<const FunctionDef*>(stmt)->name);
+            } else if (stmt->kind == StmtKind::ClassDef) {
+                definedClasses.push_back(static_cast<const ClassDef*>(stmt)->name);
+                hasClasses = true;
+            }
+        }
+        sortDefinitions();
+    }
+
+    // Sorted, so the ownership analysis can binary search them for every call
+    void sortDefinitions() {
+        std::sort(definedFunctions.begin(), definedFunctions.end());
+        std::sort(definedClasses.begin(), definedClasses.end());
+    }
+
+    static void emitIncludes(std::string& out) {
+        out += "#include <iostream>\n";
+        out += "#include <string>\n";
+        out += "#include <vector>\n";
+        out += "#include <map>\n";
+        out += "#include <set>\n";
+        out += "#include <tuple>\n";
+        out += "#include <cmath>\n";
+        out += "#include <cstddef>\n";
+        out += "#include <cstdint>\n";
+        out += "#include <stdexcept>\n";
+        out += "#include <algorithm>\n";
+        // print(), f-strings and PyValue
+        out += "#include \"py2cpp_runtime.hpp\"\n";
+    }
+
+    // Generated text of the module, carried from one top-level statement to the next
+    struct ModuleOutput {
+        std::string result;
+        // --modules: what goes into the module's header
+        std::string declarations;
+        std::string mainChunk;
+        SpillBuffer mainBody;
+        Scope mainScope;
+        // Comments go wherever the statement that follows them goes
+        std::vector<const Stmt*> pendingComments;
+        bool afterDefinition = false;
+    };
+
+    void generateTopLevel(const Stmt* stmt, ModuleOutput& module) {
+        if (stmt->kind == StmtKind::Comment) {
+            module.pendingComments.push_back(stmt);
+            return;
+        }
+        if (!isDeclaration(stmt)) {
+            // Module-level code, assignments included, runs in main() in source order
+            if (!isMainGuard(stmt)) {
+                declareGlobals(stmt, module);
+            }
+            scope = &module.mainScope;
+            for (const Stmt* comment : module.pendingComments) {
+                emitStatement(comment, 1, module.mainChunk);
+            }
+            if (isMainGuard(stmt)) {
+                emitBlock(static_cast<const IfStmt*>(stmt)->body, 1, module.mainChunk);
+            } else if (stmt->kind != StmtKind::AnnAssign || static_cast<const AnnAssignStmt*>(stmt)->value != nullptr) {
+                emitStatement(stmt, 1, module.mainChunk);
+            }
+            scope = &globalScope;
+        } else {
+            bool isDefinition = stmt->kind == StmtKind::FunctionDef || stmt->kind == StmtKind::ClassDef;
+            if (!isDefinition && (module.afterDefinition || !module.pendingComments.empty())) {
+                module.result += '\n';
+            }
+            module.afterDefinition = isDefinition;
+            for (const Stmt* comment : module.pendingComments) {
+                emitStatement(comment, 0, module.result);
+            }
+            emitStatement(stmt, 0, module.result);
+        }
+        module.pendingComments.clear();
+    }
+
+    bool modulePath(const Expr* expr, std::string& dotted) {
+        if (expr->kind == ExprKind::Name) {
+            std::string_view id = static_cast<const NameExpr*>(expr)->id;
+            for (auto it = moduleAliases.rbegin(); it != moduleAliases.rend(); ++it) {
+                if (it->first == id) {
+                    dotted = it->second;
+                    return true;
+                }
+            }
+            return false;
+        }
+        if (expr->kind != ExprKind::Attribute) {
+            return false;
+        }
+        auto* attr = static_cast<const AttributeExpr*>(expr);
+        if (!modulePath(attr->value, dotted)) {
+            return false;
+        }
+        dotted += '.';
+        dotted += attr->attr;
+        return graph->isModuleOrPackage(dotted);
+    }
+
+    // --modules: `util` or `pkg.stats` naming an imported project module becomes
+    // its namespace. Leaves `out` alone and returns false for anything else.
+    bool appendModulePath(const Expr* expr, std::string& out) {
+        std::string dotted;
+        if (!modulePath(expr, dotted)) {
+            return false;
+        }
+        out += "::";
+        out += ModuleGraph::namespaceOf(dotted);
+        return true;
+    }
+
+    // --modules: imports of project modules bind names the way Python's do.
+    // `import a.b` lets a.b.f() read ::a::b::f(), `from a import f` becomes a
+    // using-declaration and `from a import b` of a submodule another module
+    // name. Imports from outside the project stay comments.
+    void convertModuleImport(const ImportStmt* import, int level, std::string& out) {
+        indentation(out, level);
+        processLine(import, out);
+        endLine(out, import->comment);
+        if (import->kind == StmtKind::Import) {
+            for (const Alias* alias : import->names) {
+                if (!graph->isModuleOrPackage(alias->name)) {
+                    continue;
+                }
+                if (!alias->asname.empty()) {
+                    moduleAliases.emplace_back(alias->asname, std::string(alias->name));
+                } else {
+                    // import a.b binds a
+                    std::string_view root = alias->name.substr(0, alias->name.find('.'));
+                    moduleAliases.emplace_back(root, std::string(root));
+                }
+            }
+            return;
+        }
+        std::string source = graph->resolve(*currentModule, import->module, import->level);
+        const ModuleGraph::Module* from = graph->find(source);
+        std::string cppNamespace = "::" + ModuleGraph::namespaceOf(source);
+        for (const Alias* alias : import->names) {
+            std::string_view bound = alias->asname.empty() ? alias->name : alias->asname;
+            std::string submodule = source.empty() ? std::string(alias->name) : source + '.' + std::string(alias->name);
+            if (alias->name != "*" && graph->isModuleOrPackage(submodule)) {
+                moduleAliases.emplace_back(bound, submodule);
+            } else if (from == nullptr) {
+                continue;
+            } else if (alias->name == "*") {
+                emitLine(out, level, "using namespace " + cppNamespace + ";");
+            } else if (alias->asname.empty()) {
+                emitLine(out, level, "using " + cppNamespace + "::" + std::string(alias->name) + ";");
+            } else if (std::find(from->classes.begin(), from->classes.end(), alias->name) != from->classes.end()) {
+                emitLine(out, level, "using " + std::string(bound) + " = " + cppNamespace + "::" + std::string(alias->name) + ";");
+            } else if (std::find(from->functions.begin(), from->functions.end(), alias->name) != from->functions.end()) {
+                // Functions cannot be renamed, and templates cannot be referenced, so forward the call
+                emitLine(out, level, "constexpr auto " + std::string(bound) + " = [](auto&&... args) -> decltype(auto) { return " +
+                                         cppNamespace + "::" + std::string(alias->name) +
+                                         "(std::forward<decltype(args)>(args)...); };");
+            } else {
+                emitLine(out, level, std::string(level == 0 ? "inline auto& " : "auto& ") + std::string(bound) + " = " +
+                                         cppNamespace + "::" + std::string(alias->name) + ";");
+            }
+        }
+    }
+
+    // Names a module-level statement binds by assignment, including in the
+    // blocks of its if, for, while, try and with statements
+    static void boundNames(const Stmt* stmt, std::vector<std::string_view>& names) {
+        auto targets = [&](const Expr* target, auto& self) -> void {
+            if (target->kind == ExprKind::Name) {
+                std::string_view id = static_cast<const NameExpr*>(target)->id;
+                if (!Scope::contains(names, id)) {
+                    names.push_back(id);
+                }
+            } else if (target->kind == ExprKind::Tuple || target->kind == ExprKind::List) {
+                for (const Expr* element : static_cast<const SequenceExpr*>(target)->elements) {
+                    self(element, self);
+                }
+            }
+        };
+        auto block = [&](const StmtList& body) {
+            for (const Stmt* inner : body) {
+                boundNames(inner, names);
+            }
+        };
+        switch (stmt->kind) {
+            case StmtKind::Assign:
+                for (const Expr* target : static_cast<const AssignStmt*>(stmt)->targets) {
+                    targets(target, targets);
+                }
+                break;
+            case StmtKind::AnnAssign:
+                targets(static_cast<const AnnAssignStmt*>(stmt)->target, targets);
+                break;
+            case StmtKind::If:
+            case StmtKind::While:
+                block(static_cast<const IfStmt*>(stmt)->body);
+                block(static_cast<const IfStmt*>(stmt)->orelse);
+                break;
+            case StmtKind::For:
+                block(static_cast<const ForStmt*>(stmt)->body);
+                block(static_cast<const ForStmt*>(stmt)->orelse);
+                break;
+            case StmtKind::Try: {
+                auto* tryStmt = static_cast<const TryStmt*>(stmt);
+                block(tryStmt->body);
+                for (const ExceptHandler* handler : tryStmt->handlers) {
+                    block(handler->body);
+                }
+                block(tryStmt->orelse);
+                block(tryStmt->finalbody);
+                break;
+            }
+            case StmtKind::With:
+                block(static_cast<const WithStmt*>(stmt)->body);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // A local first bound inside an if, loop, try or with block is declared at
+    // the top of the function, since Python can read it after the block ends.
+    // Like module variables, one whose type is left to the C++ compiler cannot
+    // be declared without a value and stays where it is first bound.
+    void hoistLocals(const StmtList& body, size_t first, int level, std::string& out) {
+        std::vector<std::string_view> bound;
+        std::vector<std::string_view> names;
+        for (size_t i = first; i < body.size(); ++i) {
+            const Stmt* stmt = body[i];
+            bool simple = stmt->kind == StmtKind::Assign || stmt->kind == StmtKind::AnnAssign;
+            names.clear();
+            boundNames(stmt, names);
+            for (std::string_view id : names) {
+                if (Scope::contains(bound, id) || scope->declared(id)) {
+                    continue;
+                }
+                bound.push_back(id);
+                const Type* type = types.variable(localTypes, id);
+                if (!simple && TypeInference::determined(type)) {
+                    emitLine(out, level, types.cppType(type) + " " + std::string(id) + "{};");
+                    scope->declare(id);
+                }
+            }
+        }
+    }
+
+    // Module variables are declared at namespace scope, without an initializer,
+    // where they are first bound, so functions can use them; main() assigns
+    // them. Declaring them leaves their initializers, and any side effects, to
+    // run in source order. A variable whose type is left to the C++ compiler
+    // cannot be declared without a value and stays local to main(). With
+    // --modules the header gets an extern declaration.
+    void declareGlobals(const Stmt* stmt, ModuleOutput& module) {
+        std::vector<std::string_view> names;
+        boundNames(stmt, names);
+        for (std::string_view id : names) {
+            if (globalScope.declared(id)) {
+                continue;
+            }
+            const Type* type = types.variable(localTypes, id);
+            if (!TypeInference::determined(type)) {
+                continue;
+            }
+            std::string declaration = types.cppType(type) + " " + std::string(id) + ";\n";
+            if (module.afterDefinition) {
+                module.result += '\n';
+                module.afterDefinition = false;
+            }
+            module.result += declaration;
+            if (graph != nullptr) {
+                module.declarations += "extern " + declaration;
+            }
+            globalScope.declare(id);
+            module.mainScope.declare(id);
+        }
+    }
+
+    // --modules: like generateTopLevel, but declarations go to the header and
+    // definitions to the .cpp file. Module-level code becomes initializeModule().
+    void generateModuleLevel(const Stmt* stmt, ModuleOutput& module) {
+        if (stmt->kind == StmtKind::Comment || !isDeclaration(stmt)) {
+            if (isMainGuard(stmt) && currentModule->imported) {
+                // Python skips the block when the module is imported
+                module.pendingComments.clear();
+                emitLine(module.mainChunk, 1, "// if __name__ == \"__main__\": not run, " + currentModule->name +
+                                                  " is imported by another module");
+                return;
+            }
+            generateTopLevel(stmt, module);
+            return;
+        }
+        std::string comments;
+        for (const Stmt* comment : module.pendingComments) {
+            emitStatement(comment, 0, comments);
+        }
+        module.pendingComments.clear();
+        std::string declaration;
+        std::string definition;
+        switch (stmt->kind) {
+            case StmtKind::FunctionDef:
+                convertFunction(static_cast<const FunctionDef*>(stmt), 0, definition, &declaration);
+                if (declaration.empty()) {
+                    declaration.swap(definition);
+                } else {
+                    declaration += '\n';
+                }
+                break;
+            case StmtKind::ClassDef:
+            case StmtKind::Import:
+            case StmtKind::ImportFrom:
+                emitStatement(stmt, 0, declaration);
+                break;
+            default:
+                emitStatement(stmt, 0, definition);
+                break;
+        }
+        if (!declaration.empty()) {
+            module.declarations += comments;
+            module.declarations += declaration;
+        } else {
+            module.result += comments;
+        }
+        module.result += definition;
+    }
+
+    void flushOutput(CodeSink& sink, ModuleOutput& module) {
+        if (module.result.size() >= kFlushSize) {
+            writeOutput(sink, module.result);
+        }
+        if (module.mainChunk.size() >= kFlushSize) {
+            module.mainBody.append(module.mainChunk);
+            module.mainChunk.clear();
+        }
+    }
+
+    void writeOutput(CodeSink& sink, std::string& text) {
+        PY2CPP_PROFILE_SCOPE("write output");
+        sink.write(text);
+        text.clear();
+    }
+
+    void reset() {
+        arena.reset();
+        nameArena.reset();
+        interner.clear();
+        hasClasses = false;
+        definedFunctions.clear();
+        definedClasses.clear();
+        currentBaseClass.clear();
+        currentClass = nullptr;
+        inClassMethod = false;
+        globalScope = Scope();
+        scope = &globalScope;
+        types.clear();
+        types.useStdContainers(options.stdContainers);
+        purity.clear();
+        compileTime.clear();
+        tableLoops.clear();
+        elementAliases.clear();
+        constRefParams.clear();
+        movedNames.clear();
+        refParams.clear();
+        changedNames.clear();
+        references.clear();
+        referenceAnalyses.clear();
+        referenceDefs.clear();
+        viewNames.clear();
+        breakFlags.clear();
+        unsupported.clear();
+        unsupportedExpression = false;
+        graph = nullptr;
+        currentModule = nullptr;
+        moduleAliases.clear();
+        localTypes = types.module();
+        returnTypes = nullptr;
+    }
+
+public:
+    // Part of every cache key; bump whenever the generated code changes
+    static constexpr const char* kVersion = "0.15.17";
+    // Written to the root of a --modules output directory
+    static constexpr const char* kPrecompiledHeader = "py2cpp_pch.hpp";
+
+    // A decompiler for translate(): one instance can be reused for any number of
+    // files, and keeps its arenas, interner and output buffer warm between them
+    explicit PythonToCppDecompiler(const DecompilerOptions& options = DecompilerOptions()) : options(options) {}
+
+    // The decompiler only keeps a view of `code`, which has to outlive it
+    explicit PythonToCppDecompiler(std::string_view code, const DecompilerOptions& options = DecompilerOptions())
+        : pythonCode(code), options(options) {}
+
+    // Translates `code` into a buffer owned by the decompiler. The result stays
+    // valid until the next translate() call; `code` only has to outlive this one.
+    const std::string& translate(std::string_view code) {
+        translation.clear();
+        StringSink sink(translation);
+        decompile(code, sink);
+        return translation;
+    }
+
+    // Like decompile(sink), for the next file handled by a reused instance
+    void decompile(std::string_view code, CodeSink& sink) {
+        pythonCode = code;
+        decompile(sink);
+    }
+
+    // The statements of the last translation that have no C++ counterpart, as
+    // "line N: source"; the output has an #error for each, so it will not compile
+    const std::vector<std::string>& unsupportedStatements() const {
+        return unsupported;
+    }
+
+    // Header every --modules header includes; precompile it once for the project
+    static std::string precompiledHeader() {
+        std::string header = "#pragma once\n\n";
+        emitIncludes(header);
+        return header;
+    }
+
+    // --modules: translates module `index` of `project` into a header with its
+    // declarations and a source file with its definitions, both in the
+    // module's namespace. Top-level code runs in initializeModule(), which
+    // first runs the imported modules' own; modules nothing imports get main().
+    // With `projectTypes`, inferred for the whole project, parameter and member
+    // types also follow the calls other modules make.
+    void decompileModule(std::string_view code, const ModuleGraph& project, size_t index, std::string& header,
+                         std::string& source, const ModuleTypes* projectTypes = nullptr) {
+        pythonCode = code;
+        reset();
+        graph = &project;
+        currentModule = &project.all()[index];
+        ModuleOutput module;
+        PythonParser parser(pythonCode, arena, interner);
+        const Module* parsed = parser.parseModule();
+        collectDefinitions(parsed->body);
+        if (projectTypes != nullptr) {
+            projectTypes->analyze(index, parsed->body, types, interner);
+        } else {
+            types.analyze(parsed->body);
+        }
+        purity.analyze(parsed->body);
+        for (const Stmt* stmt : parsed->body) {
+            generateModuleLevel(stmt, module);
+        }
+        for (const Stmt* comment : module.pendingComments) {
+            emitStatement(comment, 1, module.mainChunk);
+        }
+
+        const ModuleGraph::Module& info = *currentModule;
+        const std::string& name = info.cppNamespace;
+        header += "#pragma once\n\n";
+        header += "#include \"" + ModuleGraph::includePath(info, kPrecompiledHeader) + "\"\n";
+        for (size_t dependency : info.imports) {
+            header += "#include \"" + ModuleGraph::includePath(info, project.all()[dependency].stem + ".hpp") + "\"\n";
+        }
+        header += "\nnamespace " + name + " {\n";
+        header += module.declarations;
+        if (info.imported) {
+            header += "\n// Runs the module's top-level code, once\n";
+            header += "void initializeModule();\n";
+        }
+        header += "}  // namespace " + name + "\n";
+
+        // Compilers only use a precompiled header included first by the .cpp itself
+        source += "#include \"" + ModuleGraph::includePath(info, kPrecompiledHeader) + "\"\n";
+        source += "#include \"" + info.stem.substr(info.stem.rfind('/') + 1) + ".hpp\"\n";
+        source += "\nnamespace " + name + " {\n";
+        source += module.result;
+        source += "\nvoid initializeModule() {\n";
+        if (info.imported) {
+            source += "    static bool initialized = false;\n";
+            source += "    if (initialized) {\n";
+            source += "        return;\n";
+            source += "    }\n";
+            source += "    initialized = true;\n";
+        }
+        for (size_t dependency : info.imports) {
+            source += "    ::" + project.all()[dependency].cppNamespace + "::initializeModule();\n";
+        }
+        source += module.mainChunk;
+        source += "}\n";
+        source += "}  // namespace " + name + "\n";
+        if (!info.imported) {
+            source += "\nint main() {\n";
+            source += "    ::" + name + "::initializeModule();\n";
+            source += "    return 0;\n";
+            source += "}\n";
+        }
+        graph = nullptr;
+        currentModule = nullptr;
+    }
+
+    std::string decompile() {
+        std::string result;
+        result.reserve(pythonCode.size() * 2);
+        StringSink sink(result);
+        decompile(sink);
+        return result;
+    }
+
+    // Generates the translation into `sink`, handing it over in chunks. Modules
+    // up to kWholeModuleLimit are parsed whole and typed before generation;
+    // larger ones are streamed one top-level statement at a time, holding only
+    // that statement's AST, with main() spilled to a temporary file as it grows.
+    void decompile(CodeSink& sink) {
+        reset();
+        ModuleOutput module;
+        PythonParser parser(pythonCode, arena, interner);
+
+        if (pythonCode.size() <= kWholeModuleLimit) {
+            const Module* parsed = parser.parseModule();
+            collectDefinitions(parsed->body);
+            types.analyze(parsed->body);
+            purity.analyze(parsed->body);
+            planReferences(parsed->body);
+            emitIncludes(module.result);
+            for (const Stmt* stmt : parsed->body) {
+#if PY2CPP_PROFILING
+                Profiler* profiler = Profiler::current();
+                uint64_t statementStart = profiler != nullptr ? Profiler::now() : 0;
+#endif
+                generateTopLevel(stmt, module);
+#if PY2CPP_PROFILING
+                if (profiler != nullptr && stmt->kind != StmtKind::Comment) {
+                    profiler->recordLine(stmt->line, Profiler::now() - statementStart);
+                }
+#endif
+                flushOutput(sink, module);
+            }
+        } else {
+            collectDefinitions();
+            emitIncludes(module.result);
+            while (true) {
+                if (module.pendingComments.empty()) {
+                    arena.reset();
+                }
+#if PY2CPP_PROFILING
+                Profiler* profiler = Profiler::current();
+                uint64_t statementStart = profiler != nullptr ? Profiler::now() : 0;
+#endif
+                StmtList statements = parser.parseNextStatements();
+                if (statements.empty()) {
+                    break;
+                }
+                for (const Stmt* stmt : statements) {
+                    if (stmt->kind != StmtKind::Comment) {
+                        types.analyzeStatement(stmt);
+                    }
+                    if (stmt->kind == StmtKind::FunctionDef) {
+                        purity.analyzeFunction(static_cast<const FunctionDef*>(stmt));
+                    }
+                    generateTopLevel(stmt, module);
+                }
+#if PY2CPP_PROFILING
+                if (profiler != nullptr) {
+                    profiler->recordLine(statements[0]->line, Profiler::now() - statementStart);
+                }
+#endif
+                flushOutput(sink, module);
+            }
+        }
+        for (const Stmt* comment : module.pendingComments) {
+            emitStatement(comment, 0, module.result);
+        }
+        module.mainBody.append(module.mainChunk);
+
+        // Add main function with the collected main code
+        std::string& result = module.result;
+        if (!module.mainBody.empty()) {
+            result += "\nint main() {\n";
+            writeOutput(sink, result);
+            PY2CPP_PROFILE_SCOPE("write output");
+            module.mainBody.copyTo(sink);
+            result += "    return 0;\n";
+            result += "}\n";
+        }
+        else if (!hasClasses && definedFunctions.empty()) {
+            result += "\nint main() {\n";
+            result += "    return 0;\n";
+            result += "}\n";
+        }
+        writeOutput(sink, result);
+    }
+};
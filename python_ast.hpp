@@ -0,0 +1,326 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// AST for the Python subset the decompiler understands. Every node lives in an
+// Arena and is trivially destructible; child lists are arena arrays. Names are
+// interned, literal text is a view into the source buffer.
+
+template <typename T>
+struct NodeList {
+    T* items = nullptr;
+    uint32_t count = 0;
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    T& operator[](size_t i) const { return items[i]; }
+    T& front() const { return items[0]; }
+    T& back() const { return items[count - 1]; }
+    T* begin() const { return items; }
+    T* end() const { return items + count; }
+};
+
+enum class ExprKind {
+    Name,
+    Number,
+    String,
+    FString,
+    FormattedValue,
+    Bool,
+    None,
+    Ellipsis,
+    Unary,
+    Binary,
+    BoolOp,
+    Compare,
+    Conditional,
+    Call,
+    Keyword,
+    Starred,
+    Attribute,
+    Subscript,
+    Slice,
+    List,
+    Tuple,
+    Set,
+    Dict,
+    ListComp,
+    SetComp,
+    DictComp,
+    GeneratorExp,
+    Lambda,
+    Raw
+};
+
+struct Expr {
+    ExprKind kind;
+    int line;
+};
+
+struct NameExpr : Expr {
+    std::string_view id;
+};
+
+// Number, String, Bool, None, Ellipsis and Raw (unparsed source text)
+struct ConstantExpr : Expr {
+    std::string_view text;
+};
+
+// String literal split into its prefix and the text between the quotes
+struct StringExpr : Expr {
+    std::string_view prefix;
+    std::string_view body;
+    bool raw;
+};
+
+// f-string: literal parts are StringExpr, placeholders are FormattedValueExpr
+struct FStringExpr : Expr {
+    NodeList<Expr*> parts;
+    bool raw;
+};
+
+struct FormattedValueExpr : Expr {
+    Expr* value;
+    char conversion;             // 'r', 's', 'a' or 0
+    std::string_view formatSpec; // Text after ':' without nested placeholders resolved
+};
+
+struct UnaryExpr : Expr {
+    std::string_view op;  // "-", "+", "~", "not"
+    Expr* operand;
+};
+
+// Arithmetic/bitwise operators (Binary) and and/or (BoolOp)
+struct BinaryExpr : Expr {
+    std::string_view op;
+    Expr* left;
+    Expr* right;
+};
+
+// Chained comparison a < b < c; ops has operands.count - 1 entries
+struct CompareExpr : Expr {
+    NodeList<Expr*> operands;
+    NodeList<std::string_view> ops;  // "is not" and "not in" are single entries
+};
+
+struct ConditionalExpr : Expr {
+    Expr* test;
+    Expr* body;
+    Expr* orelse;
+};
+
+struct CallExpr : Expr {
+    Expr* func;
+    NodeList<Expr*> args;  // Keyword arguments are KeywordExpr nodes
+};
+
+struct KeywordExpr : Expr {
+    std::string_view name;  // Empty for **kwargs
+    Expr* value;
+};
+
+struct StarredExpr : Expr {
+    Expr* value;
+};
+
+struct AttributeExpr : Expr {
+    Expr* value;
+    std::string_view attr;
+};
+
+struct SubscriptExpr : Expr {
+    Expr* value;
+    Expr* index;
+};
+
+struct SliceExpr : Expr {
+    Expr* lower;
+    Expr* upper;
+    Expr* step;
+};
+
+// List, Tuple and Set displays
+struct SequenceExpr : Expr {
+    NodeList<Expr*> elements;
+};
+
+struct DictExpr : Expr {
+    NodeList<Expr*> keys;  // nullptr key for a **spread entry
+    NodeList<Expr*> values;
+};
+
+struct Comprehension {
+    Expr* target;
+    Expr* iter;
+    NodeList<Expr*> ifs;
+};
+
+// ListComp, SetComp, GeneratorExp use element; DictComp uses element as key and value
+struct ComprehensionExpr : Expr {
+    Expr* element;
+    Expr* value;
+    NodeList<Comprehension*> generators;
+};
+
+struct Param {
+    std::string_view name;
+    Expr* annotation;
+    Expr* defaultValue;
+    enum Kind : uint8_t { Normal, VarArgs, KwArgs } kind;
+};
+
+struct LambdaExpr : Expr {
+    NodeList<Param*> params;
+    Expr* body;
+};
+
+enum class StmtKind {
+    Expr,
+    Assign,
+    AugAssign,
+    AnnAssign,
+    Return,
+    Raise,
+    Pass,
+    Break,
+    Continue,
+    Global,
+    Nonlocal,
+    Del,
+    Assert,
+    Import,
+    ImportFrom,
+    If,
+    While,
+    For,
+    FunctionDef,
+    ClassDef,
+    Try,
+    With,
+    Comment,
+    Unsupported
+};
+
+struct Stmt {
+    StmtKind kind;
+    int line;
+    std::string_view comment;  // Trailing comment on the (header) line, without '#'
+};
+
+using StmtList = NodeList<Stmt*>;
+
+struct ExprStmt : Stmt {
+    Expr* value;
+};
+
+// a = b = value
+struct AssignStmt : Stmt {
+    NodeList<Expr*> targets;
+    Expr* value;
+};
+
+struct AugAssignStmt : Stmt {
+    Expr* target;
+    std::string_view op;  // "+=", "//=", ...
+    Expr* value;
+};
+
+struct AnnAssignStmt : Stmt {
+    Expr* target;
+    Expr* annotation;
+    Expr* value;  // May be null
+};
+
+// Return (value) and Raise (value, cause)
+struct ValueStmt : Stmt {
+    Expr* value;
+    Expr* cause;
+};
+
+// Global, Nonlocal
+struct NamesStmt : Stmt {
+    NodeList<std::string_view> names;
+};
+
+// Del, Assert (expressions[0] = test, [1] = message)
+struct ExprListStmt : Stmt {
+    NodeList<Expr*> expressions;
+};
+
+struct Alias {
+    std::string_view name;    // Dotted module or imported name
+    std::string_view asname;  // Empty when not renamed
+};
+
+struct ImportStmt : Stmt {
+    std::string_view module;  // ImportFrom only, without the leading dots
+    int level;                // Number of leading dots for relative imports
+    NodeList<Alias*> names;   // A single "*" alias for star imports
+};
+
+// If and While; an elif chain is an If nested alone in orelse with isElif set
+struct IfStmt : Stmt {
+    Expr* test;
+    StmtList body;
+    StmtList orelse;
+    bool isElif;
+};
+
+struct ForStmt : Stmt {
+    Expr* target;
+    Expr* iter;
+    StmtList body;
+    StmtList orelse;
+};
+
+struct FunctionDef : Stmt {
+    std::string_view name;
+    NodeList<Param*> params;
+    Expr* returns;
+    StmtList body;
+    NodeList<Expr*> decorators;
+};
+
+struct ClassDef : Stmt {
+    std::string_view name;
+    NodeList<Expr*> bases;
+    StmtList body;
+    NodeList<Expr*> decorators;
+};
+
+struct ExceptHandler {
+    Expr* type;  // Null for a bare except
+    std::string_view name;
+    StmtList body;
+    int line;
+    std::string_view comment;
+};
+
+struct TryStmt : Stmt {
+    StmtList body;
+    NodeList<ExceptHandler*> handlers;
+    StmtList orelse;
+    StmtList finalbody;
+};
+
+struct WithItem {
+    Expr* context;
+    Expr* var;  // May be null
+};
+
+struct WithStmt : Stmt {
+    NodeList<WithItem*> items;
+    StmtList body;
+};
+
+// Standalone comment line (text without '#') or an unsupported statement kept
+// verbatim; body holds the indented block of an unsupported compound statement
+struct TextStmt : Stmt {
+    std::string_view text;
+    StmtList body;
+};
+
+struct Module {
+    StmtList body;
+};
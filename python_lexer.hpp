@@ -0,0 +1,382 @@
+#pragma once
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+#include "profiler.hpp"
+
+enum class TokenKind {
+    Name,
+    Keyword,
+    Number,
+    String,
+    FString,
+    Operator,
+    Comment,
+    Newline,
+    Indent,
+    Dedent,
+    EndOfFile
+};
+
+// Tokens never own their text: it is a view into the buffer handed to the lexer,
+// so the buffer has to outlive every token produced from it.
+struct Token {
+    TokenKind kind = TokenKind::EndOfFile;
+    std::string_view text;
+    int line = 0;
+
+    bool isKeyword(std::string_view keyword) const {
+        return kind == TokenKind::Keyword && text == keyword;
+    }
+
+    bool isOp(std::string_view op) const {
+        return kind == TokenKind::Operator && text == op;
+    }
+
+    bool isName(std::string_view name) const {
+        return kind == TokenKind::Name && text == name;
+    }
+};
+
+// Spelling of a Python identifier in generated C++. Names that are C++ keywords, or that
+// would clash with `main`, `std` and `py2cpp` at namespace scope, get a trailing underscore.
+// int, float and bool are left alone: they are the Python builtins of the same name.
+inline std::string_view cppIdentifier(std::string_view name) {
+    // Sorted by the name without its underscore, for binary search
+    static constexpr std::string_view renamed[] = {
+        "NULL_", "alignas_", "alignof_", "asm_", "auto_", "bitand_", "bitor_", "case_",
+        "catch_", "char_", "char16_t_", "char32_t_", "char8_t_", "co_await_", "co_return_",
+        "co_yield_", "compl_", "concept_", "const_", "const_cast_", "consteval_", "constexpr_",
+        "constinit_", "decltype_", "default_", "delete_", "do_", "double_", "dynamic_cast_",
+        "enum_", "explicit_", "export_", "extern_", "false_", "friend_", "goto_", "inline_",
+        "long_", "main_", "mutable_", "namespace_", "new_", "noexcept_", "not_eq_", "nullptr_",
+        "operator_", "or_eq_", "private_", "protected_", "public_", "py2cpp_", "register_",
+        "reinterpret_cast_", "requires_", "short_", "signed_", "sizeof_", "static_",
+        "static_assert_", "static_cast_", "std_", "struct_", "switch_", "template_", "this_",
+        "thread_local_", "throw_", "true_", "typedef_", "typeid_", "typename_", "union_",
+        "unsigned_", "using_", "virtual_", "void_", "volatile_", "wchar_t_", "xor_", "xor_eq_"};
+    auto it = std::lower_bound(std::begin(renamed), std::end(renamed), name,
+                               [](std::string_view entry, std::string_view word) {
+                                   return entry.substr(0, entry.size() - 1) < word;
+                               });
+    if (it != std::end(renamed) && it->substr(0, it->size() - 1) == name) {
+        return *it;
+    }
+    return name;
+}
+
+// Single-pass Python tokenizer. Produces INDENT/DEDENT/NEWLINE tokens the same way
+// CPython's tokenizer does: blank lines are skipped, newlines inside brackets and
+// after a backslash are joined, and comments are reported as their own tokens.
+class PythonLexer {
+private:
+    std::string_view source;
+    size_t pos = 0;
+    int line = 1;
+    int bracketDepth = 0;
+    bool atLineStart = true;
+    bool finished = false;
+    int pendingDedents = 0;
+    std::vector<int> indentStack{0};
+    // Comment-only lines are held back until the indentation of the next code line
+    // is known, so they come out after its INDENT/DEDENT tokens, at the right depth
+    std::vector<Token> pendingComments;
+    size_t nextComment = 0;
+
+    static bool isIdentStart(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+               static_cast<unsigned char>(c) >= 0x80;
+    }
+
+    static bool isIdentChar(char c) {
+        return isIdentStart(c) || (c >= '0' && c <= '9');
+    }
+
+    static bool isDigit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    static bool isStringPrefix(std::string_view prefix) {
+        if (prefix.size() > 2) {
+            return false;
+        }
+        bool raw = false, bytes = false, format = false, unicode = false;
+        for (char c : prefix) {
+            switch (c) {
+                case 'r': case 'R': if (raw) return false; raw = true; break;
+                case 'b': case 'B': if (bytes) return false; bytes = true; break;
+                case 'f': case 'F': if (format) return false; format = true; break;
+                case 'u': case 'U': if (unicode) return false; unicode = true; break;
+                default: return false;
+            }
+        }
+        return !(bytes && format) && !(unicode && prefix.size() > 1);
+    }
+
+    Token make(TokenKind kind, size_t start, size_t end, int tokenLine) const {
+        return Token{kind, source.substr(start, end - start), tokenLine};
+    }
+
+    char peek(size_t offset = 0) const {
+        return pos + offset < source.size() ? source[pos + offset] : '\0';
+    }
+
+    void skipNewline() {
+        if (peek() == '\r' && peek(1) == '\n') {
+            pos += 2;
+        } else {
+            ++pos;
+        }
+        ++line;
+    }
+
+    // Measures the indentation of the next non-blank line and turns changes into
+    // INDENT/DEDENT tokens. Returns false when nothing needs to be emitted.
+    bool handleIndentation(Token& token) {
+        PY2CPP_PROFILE_SCOPE("lexer: indentation");
+        while (pos < source.size()) {
+            int width = 0;
+            while (pos < source.size()) {
+                char c = source[pos];
+                if (c == ' ') {
+                    ++width;
+                } else if (c == '\t') {
+                    width = (width / 8 + 1) * 8;
+                } else if (c == '\f') {
+                    width = 0;
+                } else {
+                    break;
+                }
+                ++pos;
+            }
+
+            char c = peek();
+            if (c == '\n' || c == '\r') {
+                skipNewline();
+                continue;
+            }
+            if (c == '#') {
+                size_t start = pos;
+                while (pos < source.size() && source[pos] != '\n' && source[pos] != '\r') {
+                    ++pos;
+                }
+                pendingComments.push_back(make(TokenKind::Comment, start, pos, line));
+                continue;
+            }
+
+            atLineStart = false;
+            if (width > indentStack.back()) {
+                indentStack.push_back(width);
+                token = make(TokenKind::Indent, pos, pos, line);
+                return true;
+            }
+            while (width < indentStack.back()) {
+                indentStack.pop_back();
+                ++pendingDedents;
+            }
+            if (pendingDedents > 0) {
+                --pendingDedents;
+                token = make(TokenKind::Dedent, pos, pos, line);
+                return true;
+            }
+            return false;
+        }
+        return false;
+    }
+
+    Token scanString(size_t start) {
+        int startLine = line;
+        char quote = source[pos];
+        bool triple = peek(1) == quote && peek(2) == quote;
+        pos += triple ? 3 : 1;
+
+        while (pos < source.size()) {
+            char c = source[pos];
+            if (c == '\\') {
+                if (peek(1) == '\n') {
+                    ++line;
+                }
+                pos += 2;
+                continue;
+            }
+            if (c == '\n') {
+                if (!triple) {
+                    break;  // Unterminated literal, let the caller recover on the next line
+                }
+                ++line;
+            }
+            if (c == quote) {
+                if (!triple) {
+                    ++pos;
+                    break;
+                }
+                if (peek(1) == quote && peek(2) == quote) {
+                    pos += 3;
+                    break;
+                }
+            }
+            ++pos;
+        }
+        pos = std::min(pos, source.size());
+
+        std::string_view prefix = source.substr(start, source.find_first_of("'\"", start) - start);
+        bool isFormat = prefix.find_first_of("fF") != std::string_view::npos;
+        return make(isFormat ? TokenKind::FString : TokenKind::String, start, pos, startLine);
+    }
+
+    Token scanNumber(size_t start) {
+        bool hex = source[pos] == '0' && (peek(1) == 'x' || peek(1) == 'X');
+        while (pos < source.size()) {
+            char c = source[pos];
+            if (isIdentChar(c) || c == '.') {
+                ++pos;
+            } else if ((c == '+' || c == '-') && !hex &&
+                       (source[pos - 1] == 'e' || source[pos - 1] == 'E')) {
+                ++pos;
+            } else {
+                break;
+            }
+        }
+        return make(TokenKind::Number, start, pos, line);
+    }
+
+    Token scanOperator(size_t start) {
+        static constexpr std::string_view threeCharOps[] = {"**=", "//=", ">>=", "<<=", "..."};
+        static constexpr std::string_view twoCharOps[] = {
+            "**", "//", "==", "!=", "<=", ">=", "->", "+=", "-=", "*=", "/=",
+            "%=", "&=", "|=", "^=", "<<", ">>", ":=", "@="};
+
+        std::string_view rest = source.substr(pos);
+        for (std::string_view op : threeCharOps) {
+            if (rest.compare(0, 3, op) == 0) {
+                pos += 3;
+                return make(TokenKind::Operator, start, pos, line);
+            }
+        }
+        for (std::string_view op : twoCharOps) {
+            if (rest.compare(0, 2, op) == 0) {
+                pos += 2;
+                return make(TokenKind::Operator, start, pos, line);
+            }
+        }
+
+        char c = source[pos++];
+        if (c == '(' || c == '[' || c == '{') {
+            ++bracketDepth;
+        } else if ((c == ')' || c == ']' || c == '}') && bracketDepth > 0) {
+            --bracketDepth;
+        }
+        return make(TokenKind::Operator, start, pos, line);
+    }
+
+public:
+    explicit PythonLexer(std::string_view code) : source(code) {
+        // Skip a UTF-8 byte order mark so it does not end up in the first identifier
+        if (source.substr(0, 3) == "\xEF\xBB\xBF") {
+            pos = 3;
+        }
+    }
+
+    static bool isKeyword(std::string_view word) {
+        // Sorted for binary search
+        static constexpr std::string_view keywords[] = {
+            "False", "None", "True", "and", "as", "assert", "async", "await",
+            "break", "class", "continue", "def", "del", "elif", "else", "except",
+            "finally", "for", "from", "global", "if", "import", "in", "is",
+            "lambda", "nonlocal", "not", "or", "pass", "raise", "return", "try",
+            "while", "with", "yield"};
+        return std::binary_search(std::begin(keywords), std::end(keywords), word);
+    }
+
+    Token next() {
+        if (pendingDedents > 0) {
+            --pendingDedents;
+            return make(TokenKind::Dedent, pos, pos, line);
+        }
+
+        Token token;
+        if (atLineStart && bracketDepth == 0 && handleIndentation(token)) {
+            return token;
+        }
+        if (nextComment < pendingComments.size()) {
+            return pendingComments[nextComment++];
+        }
+        pendingComments.clear();
+        nextComment = 0;
+
+        while (pos < source.size()) {
+            char c = source[pos];
+            if (c == ' ' || c == '\t' || c == '\f') {
+                ++pos;
+                continue;
+            }
+            if (c == '\\' && (peek(1) == '\n' || peek(1) == '\r')) {
+                ++pos;
+                skipNewline();
+                continue;
+            }
+
+            size_t start = pos;
+            if (c == '\n' || c == '\r') {
+                int newlineLine = line;
+                skipNewline();
+                if (bracketDepth > 0) {
+                    continue;
+                }
+                atLineStart = true;
+                return make(TokenKind::Newline, start, start + 1, newlineLine);
+            }
+            if (c == '#') {
+                while (pos < source.size() && source[pos] != '\n' && source[pos] != '\r') {
+                    ++pos;
+                }
+                return make(TokenKind::Comment, start, pos, line);
+            }
+            if (isIdentStart(c)) {
+                while (pos < source.size() && isIdentChar(source[pos])) {
+                    ++pos;
+                }
+                std::string_view word = source.substr(start, pos - start);
+                if ((peek() == '"' || peek() == '\'') && isStringPrefix(word)) {
+                    return scanString(start);
+                }
+                return make(isKeyword(word) ? TokenKind::Keyword : TokenKind::Name, start, pos, line);
+            }
+            if (isDigit(c) || (c == '.' && isDigit(peek(1)))) {
+                return scanNumber(start);
+            }
+            if (c == '"' || c == '\'') {
+                return scanString(start);
+            }
+            return scanOperator(start);
+        }
+
+        // End of input: close the last logical line and every open block
+        if (!atLineStart) {
+            atLineStart = true;
+            return make(TokenKind::Newline, pos, pos, line);
+        }
+        if (indentStack.size() > 1) {
+            indentStack.pop_back();
+            return make(TokenKind::Dedent, pos, pos, line);
+        }
+        finished = true;
+        return make(TokenKind::EndOfFile, pos, pos, line);
+    }
+
+    std::vector<Token> tokenize() {
+        std::vector<Token> tokens;
+        // Roughly one token per four source bytes on typical code
+        tokens.reserve(source.size() / 4 + 16);
+        do {
+            tokens.push_back(next());
+        } while (tokens.back().kind != TokenKind::EndOfFile);
+        return tokens;
+    }
+
+    bool done() const {
+        return finished;
+    }
+};
@@ -0,0 +1,1515 @@
+#pragma once
+
+#include <algorithm>
+#include <string_view>
+#include <vector>
+
+#include "arena.hpp"
+#include "python_ast.hpp"
+#include "python_lexer.hpp"
+#include "profiler.hpp"
+
+// Recursive-descent parser turning the token stream of PythonLexer into the AST
+// of python_ast.hpp. Tokens are pulled from the lexer on demand with a few tokens
+// of lookahead, and every node is allocated in the caller's arena. Child lists are
+// gathered on scratch stacks that are reused across the whole file, so building the
+// tree does not touch the heap once the stacks have grown.
+//
+// Statements the parser does not understand are kept as Unsupported text so the
+// generator can still translate the rest of the file; each one becomes an #error
+// in the output, and the translation is reported as failed.
+class PythonParser {
+private:
+    struct ParseError {
+        int line;
+    };
+
+    struct BufferedToken {
+        Token token;
+        std::string_view comment;  // Trailing comment attached to a NEWLINE
+    };
+
+    static constexpr size_t kLookahead = 4;
+
+    PythonLexer lexer;
+    Arena& arena;
+    StringInterner& interner;
+
+    BufferedToken buffer[kLookahead];
+    size_t head = 0;
+    size_t buffered = 0;
+    TokenKind lastPulled = TokenKind::Newline;
+    std::string_view pendingComment;
+    std::string_view lastComment;
+    const char* lastEnd = nullptr;
+
+    // Scratch stacks for child lists; nested lists always finish before their parents
+    std::vector<void*> nodeStack;
+    std::vector<std::string_view> viewStack;
+
+    // Header comment of the block parsed last, and where the comment lines that
+    // followed a compound statement start on the scratch stack
+    static constexpr size_t kNoComments = static_cast<size_t>(-1);
+    std::string_view pendingHeaderComment;
+    size_t trailingComments = kNoComments;
+
+    // Token stream
+
+    // Tallies lexer matches per rule for --profile
+    static void countToken(TokenKind kind) {
+#if PY2CPP_PROFILING
+        if (Profiler* profiler = Profiler::current()) {
+            // Indexed by TokenKind
+            static const int counters[] = {
+                Profiler::registerCounter("lexer: name"),    Profiler::registerCounter("lexer: keyword"),
+                Profiler::registerCounter("lexer: number"),  Profiler::registerCounter("lexer: string"),
+                Profiler::registerCounter("lexer: f-string"), Profiler::registerCounter("lexer: operator"),
+                Profiler::registerCounter("lexer: comment"), Profiler::registerCounter("lexer: newline"),
+                Profiler::registerCounter("lexer: indent"),  Profiler::registerCounter("lexer: dedent"),
+                Profiler::registerCounter("lexer: end of file")};
+            profiler->count(counters[static_cast<int>(kind)]);
+        }
+#else
+        (void)kind;
+#endif
+    }
+
+    BufferedToken pull() {
+        while (true) {
+            Token tok = lexer.next();
+            countToken(tok.kind);
+            if (tok.kind == TokenKind::Comment) {
+                bool standalone = lastPulled == TokenKind::Newline || lastPulled == TokenKind::Indent ||
+                                  lastPulled == TokenKind::Dedent || lastPulled == TokenKind::Comment;
+                if (standalone) {
+                    lastPulled = TokenKind::Comment;
+                    return {tok, {}};
+                }
+                pendingComment = tok.text.substr(1);
+                continue;
+            }
+            lastPulled = tok.kind;
+            if (tok.kind == TokenKind::Newline) {
+                std::string_view comment = pendingComment;
+                pendingComment = {};
+                return {tok, comment};
+            }
+            return {tok, {}};
+        }
+    }
+
+    const Token& peek(size_t n = 0) {
+        while (buffered <= n) {
+            buffer[(head + buffered) % kLookahead] = pull();
+            ++buffered;
+        }
+        return buffer[(head + n) % kLookahead].token;
+    }
+
+    Token advance() {
+        peek();
+        BufferedToken& entry = buffer[head];
+        head = (head + 1) % kLookahead;
+        --buffered;
+        lastComment = entry.comment;
+        if (entry.token.kind != TokenKind::Indent && entry.token.kind != TokenKind::Dedent &&
+            entry.token.kind != TokenKind::Newline) {
+            lastEnd = entry.token.text.data() + entry.token.text.size();
+        }
+        return entry.token;
+    }
+
+    bool acceptOp(std::string_view op) {
+        if (peek().isOp(op)) {
+            advance();
+            return true;
+        }
+        return false;
+    }
+
+    bool acceptKeyword(std::string_view keyword) {
+        if (peek().isKeyword(keyword)) {
+            advance();
+            return true;
+        }
+        return false;
+    }
+
+    Token expectOp(std::string_view op) {
+        if (!peek().isOp(op)) {
+            throw ParseError{peek().line};
+        }
+        return advance();
+    }
+
+    Token expectKeyword(std::string_view keyword) {
+        if (!peek().isKeyword(keyword)) {
+            throw ParseError{peek().line};
+        }
+        return advance();
+    }
+
+    std::string_view expectName() {
+        if (peek().kind != TokenKind::Name) {
+            throw ParseError{peek().line};
+        }
+        return interner.intern(cppIdentifier(advance().text));
+    }
+
+    // Node construction
+
+    template <typename T>
+    T* makeExpr(ExprKind kind, int line) {
+        T* node = arena.make<T>();
+        node->kind = kind;
+        node->line = line;
+        return node;
+    }
+
+    template <typename T>
+    T* makeStmt(StmtKind kind, int line) {
+        T* node = arena.make<T>();
+        node->kind = kind;
+        node->line = line;
+        return node;
+    }
+
+    size_t mark() const {
+        return nodeStack.size();
+    }
+
+    template <typename T>
+    NodeList<T*> finishList(size_t start) {
+        NodeList<T*> list;
+        list.count = static_cast<uint32_t>(nodeStack.size() - start);
+        list.items = reinterpret_cast<T**>(arena.copyArray(nodeStack.data() + start, list.count));
+        nodeStack.resize(start);
+        return list;
+    }
+
+    NodeList<std::string_view> finishViews(size_t start) {
+        NodeList<std::string_view> list;
+        list.count = static_cast<uint32_t>(viewStack.size() - start);
+        list.items = arena.copyArray(viewStack.data() + start, list.count);
+        viewStack.resize(start);
+        return list;
+    }
+
+    // Expressions, lowest precedence first
+
+    bool atExpressionEnd() {
+        const Token& tok = peek();
+        if (tok.kind == TokenKind::Newline || tok.kind == TokenKind::EndOfFile ||
+            tok.kind == TokenKind::Indent || tok.kind == TokenKind::Dedent) {
+            return true;
+        }
+        if (tok.kind == TokenKind::Operator) {
+            static constexpr std::string_view enders[] = {")", "]", "}", "=", ":", ";"};
+            for (std::string_view op : enders) {
+                if (tok.text == op) {
+                    return true;
+                }
+            }
+            // Augmented assignment operators
+            return tok.text.size() >= 2 && tok.text.back() == '=' && tok.text != "==" &&
+                   tok.text != "!=" && tok.text != "<=" && tok.text != ">=";
+        }
+        return tok.isKeyword("for") || tok.isKeyword("in") || tok.isKeyword("if") ||
+               tok.isKeyword("else") || tok.isKeyword("async");
+    }
+
+    Expr* parseTest() {
+        if (peek().isKeyword("lambda")) {
+            return parseLambda();
+        }
+        Expr* expr = parseOr();
+        if (peek().isKeyword("if")) {
+            int line = advance().line;
+            auto* cond = makeExpr<ConditionalExpr>(ExprKind::Conditional, line);
+            cond->body = expr;
+            cond->test = parseOr();
+            expectKeyword("else");
+            cond->orelse = parseTest();
+            return cond;
+        }
+        if (peek().isOp(":=")) {
+            throw ParseError{peek().line};
+        }
+        return expr;
+    }
+
+    Expr* parseTestNoCond() {
+        if (peek().isKeyword("lambda")) {
+            return parseLambda();
+        }
+        return parseOr();
+    }
+
+    Expr* parseLambda() {
+        int line = expectKeyword("lambda").line;
+        auto* lambda = makeExpr<LambdaExpr>(ExprKind::Lambda, line);
+        lambda->params = parseParams(":", false);
+        expectOp(":");
+        lambda->body = parseTest();
+        return lambda;
+    }
+
+    Expr* parseOr() {
+        Expr* left = parseAnd();
+        while (peek().isKeyword("or")) {
+            int line = advance().line;
+            auto* op = makeExpr<BinaryExpr>(ExprKind::BoolOp, line);
+            op->op = "or";
+            op->left = left;
+            op->right = parseAnd();
+            left = op;
+        }
+        return left;
+    }
+
+    Expr* parseAnd() {
+        Expr* left = parseNot();
+        while (peek().isKeyword("and")) {
+            int line = advance().line;
+            auto* op = makeExpr<BinaryExpr>(ExprKind::BoolOp, line);
+            op->op = "and";
+            op->left = left;
+            op->right = parseNot();
+            left = op;
+        }
+        return left;
+    }
+
+    Expr* parseNot() {
+        if (peek().isKeyword("not")) {
+            int line = advance().line;
+            auto* op = makeExpr<UnaryExpr>(ExprKind::Unary, line);
+            op->op = "not";
+            op->operand = parseNot();
+            return op;
+        }
+        return parseComparison();
+    }
+
+    std::string_view comparisonOperator() {
+        const Token& tok = peek();
+        if (tok.kind == TokenKind::Operator) {
+            static constexpr std::string_view ops[] = {"<", ">", "==", ">=", "<=", "!="};
+            for (std::string_view op : ops) {
+                if (tok.text == op) {
+                    return op;
+                }
+            }
+            return {};
+        }
+        if (tok.isKeyword("in")) {
+            return "in";
+        }
+        if (tok.isKeyword("is")) {
+            return peek(1).isKeyword("not") ? "is not" : "is";
+        }
+        if (tok.isKeyword("not") && peek(1).isKeyword("in")) {
+            return "not in";
+        }
+        return {};
+    }
+
+    Expr* parseComparison() {
+        Expr* first = parseBinary(0);
+        std::string_view op = comparisonOperator();
+        if (op.empty()) {
+            return first;
+        }
+
+        auto* cmp = makeExpr<CompareExpr>(ExprKind::Compare, first->line);
+        size_t start = mark();
+        size_t viewStart = viewStack.size();
+        nodeStack.push_back(first);
+        while (!op.empty()) {
+            advance();
+            if (op == "is not" || op == "not in") {
+                advance();
+            }
+            viewStack.push_back(op);
+            nodeStack.push_back(parseBinary(0));
+            op = comparisonOperator();
+        }
+        cmp->operands = finishList<Expr>(start);
+        cmp->ops = finishViews(viewStart);
+        return cmp;
+    }
+
+    // Binary operators from | down to * by precedence level
+    static int binaryPrecedence(const Token& tok) {
+        if (tok.kind != TokenKind::Operator) {
+            return -1;
+        }
+        std::string_view op = tok.text;
+        if (op == "|") return 0;
+        if (op == "^") return 1;
+        if (op == "&") return 2;
+        if (op == "<<" || op == ">>") return 3;
+        if (op == "+" || op == "-") return 4;
+        if (op == "*" || op == "/" || op == "//" || op == "%" || op == "@") return 5;
+        return -1;
+    }
+
+    Expr* parseBinary(int minPrecedence) {
+        Expr* left = parseFactor();
+        while (true) {
+            int prec = binaryPrecedence(peek());
+            if (prec < minPrecedence) {
+                return left;
+            }
+            Token opTok = advance();
+            auto* op = makeExpr<BinaryExpr>(ExprKind::Binary, opTok.line);
+            op->op = opTok.text;
+            op->left = left;
+            op->right = parseBinary(prec + 1);
+            left = op;
+        }
+    }
+
+    Expr* parseFactor() {
+        const Token& tok = peek();
+        if (tok.isOp("-") || tok.isOp("+") || tok.isOp("~")) {
+            Token opTok = advance();
+            auto* op = makeExpr<UnaryExpr>(ExprKind::Unary, opTok.line);
+            op->op = opTok.text;
+            op->operand = parseFactor();
+            return op;
+        }
+        return parsePower();
+    }
+
+    Expr* parsePower() {
+        acceptKeyword("await");
+        Expr* base = parsePrimary();
+        if (peek().isOp("**")) {
+            int line = advance().line;
+            auto* op = makeExpr<BinaryExpr>(ExprKind::Binary, line);
+            op->op = "**";
+            op->left = base;
+            op->right = parseFactor();
+            return op;
+        }
+        return base;
+    }
+
+    Expr* parsePrimary() {
+        Expr* expr = parseAtom();
+        while (true) {
+            if (peek().isOp("(")) {
+                int line = advance().line;
+                auto* call = makeExpr<CallExpr>(ExprKind::Call, line);
+                call->func = expr;
+                call->args = parseCallArguments();
+                expectOp(")");
+                expr = call;
+            } else if (peek().isOp("[")) {
+                int line = advance().line;
+                auto* sub = makeExpr<SubscriptExpr>(ExprKind::Subscript, line);
+                sub->value = expr;
+                sub->index = parseSubscriptList();
+                expectOp("]");
+                expr = sub;
+            } else if (peek().isOp(".")) {
+                int line = advance().line;
+                auto* attr = makeExpr<AttributeExpr>(ExprKind::Attribute, line);
+                attr->value = expr;
+                attr->attr = expectName();
+                expr = attr;
+            } else {
+                return expr;
+            }
+        }
+    }
+
+    NodeList<Expr*> parseCallArguments() {
+        size_t start = mark();
+        while (!peek().isOp(")")) {
+            const Token& tok = peek();
+            if (tok.isOp("*") || tok.isOp("**")) {
+                Token star = advance();
+                if (star.text == "**") {
+                    auto* kw = makeExpr<KeywordExpr>(ExprKind::Keyword, star.line);
+                    kw->value = parseTest();
+                    nodeStack.push_back(kw);
+                } else {
+                    auto* starred = makeExpr<StarredExpr>(ExprKind::Starred, star.line);
+                    starred->value = parseTest();
+                    nodeStack.push_back(starred);
+                }
+            } else if (tok.kind == TokenKind::Name && peek(1).isOp("=")) {
+                auto* kw = makeExpr<KeywordExpr>(ExprKind::Keyword, tok.line);
+                kw->name = expectName();
+                advance();
+                kw->value = parseTest();
+                nodeStack.push_back(kw);
+            } else {
+                Expr* arg = parseTest();
+                if (peek().isKeyword("for") || peek().isKeyword("async")) {
+                    arg = parseComprehension(ExprKind::GeneratorExp, arg, nullptr);
+                }
+                nodeStack.push_back(arg);
+            }
+            if (!acceptOp(",")) {
+                break;
+            }
+        }
+        return finishList<Expr>(start);
+    }
+
+    Expr* parseSubscript() {
+        int line = peek().line;
+        Expr* lower = nullptr;
+        if (!peek().isOp(":")) {
+            lower = parseTest();
+            if (!peek().isOp(":")) {
+                return lower;
+            }
+        }
+        auto* slice = makeExpr<SliceExpr>(ExprKind::Slice, line);
+        slice->lower = lower;
+        expectOp(":");
+        if (!peek().isOp(":") && !peek().isOp("]") && !peek().isOp(",")) {
+            slice->upper = parseTest();
+        }
+        if (acceptOp(":") && !peek().isOp("]") && !peek().isOp(",")) {
+            slice->step = parseTest();
+        }
+        return slice;
+    }
+
+    Expr* parseSubscriptList() {
+        int line = peek().line;
+        Expr* first = parseSubscript();
+        if (!peek().isOp(",")) {
+            return first;
+        }
+        size_t start = mark();
+        nodeStack.push_back(first);
+        while (acceptOp(",") && !peek().isOp("]")) {
+            nodeStack.push_back(parseSubscript());
+        }
+        auto* tuple = makeExpr<SequenceExpr>(ExprKind::Tuple, line);
+        tuple->elements = finishList<Expr>(start);
+        return tuple;
+    }
+
+    Expr* parseStarOrTest() {
+        if (peek().isOp("*")) {
+            int line = advance().line;
+            auto* starred = makeExpr<StarredExpr>(ExprKind::Starred, line);
+            starred->value = parseOr();
+            return starred;
+        }
+        return parseTest();
+    }
+
+    // for target in iter [if cond]... after the element of a comprehension
+    Expr* parseComprehension(ExprKind kind, Expr* element, Expr* value) {
+        auto* comp = makeExpr<ComprehensionExpr>(kind, element->line);
+        comp->element = element;
+        comp->value = value;
+        size_t start = mark();
+        while (peek().isKeyword("for") || peek().isKeyword("async")) {
+            acceptKeyword("async");
+            expectKeyword("for");
+            auto* gen = arena.make<Comprehension>();
+            gen->target = parseTargetList();
+            expectKeyword("in");
+            gen->iter = parseOr();
+            size_t ifStart = mark();
+            while (peek().isKeyword("if")) {
+                advance();
+                nodeStack.push_back(parseTestNoCond());
+            }
+            gen->ifs = finishList<Expr>(ifStart);
+            nodeStack.push_back(gen);
+        }
+        comp->generators = finishList<Comprehension>(start);
+        return comp;
+    }
+
+    Expr* parseAtom() {
+        const Token& tok = peek();
+        int line = tok.line;
+        switch (tok.kind) {
+            case TokenKind::Name: {
+                auto* name = makeExpr<NameExpr>(ExprKind::Name, line);
+                name->id = expectName();
+                return name;
+            }
+            case TokenKind::Number: {
+                auto* num = makeExpr<ConstantExpr>(ExprKind::Number, line);
+                num->text = advance().text;
+                return num;
+            }
+            case TokenKind::String:
+            case TokenKind::FString:
+                return parseStrings();
+            case TokenKind::Keyword:
+                if (tok.text == "True" || tok.text == "False") {
+                    auto* b = makeExpr<ConstantExpr>(ExprKind::Bool, line);
+                    b->text = advance().text;
+                    return b;
+                }
+                if (tok.text == "None") {
+                    auto* none = makeExpr<ConstantExpr>(ExprKind::None, line);
+                    none->text = advance().text;
+                    return none;
+                }
+                break;
+            case TokenKind::Operator:
+                if (tok.text == "(") {
+                    return parseParenthesized();
+                }
+                if (tok.text == "[") {
+                    return parseListDisplay();
+                }
+                if (tok.text == "{") {
+                    return parseDictOrSetDisplay();
+                }
+                if (tok.text == "...") {
+                    auto* ellipsis = makeExpr<ConstantExpr>(ExprKind::Ellipsis, line);
+                    ellipsis->text = advance().text;
+                    return ellipsis;
+                }
+                break;
+            default:
+                break;
+        }
+        throw ParseError{line};
+    }
+
+    Expr* parseParenthesized() {
+        int line = expectOp("(").line;
+        if (acceptOp(")")) {
+            auto* tuple = makeExpr<SequenceExpr>(ExprKind::Tuple, line);
+            return tuple;
+        }
+        if (peek().isKeyword("yield")) {
+            throw ParseError{line};
+        }
+        Expr* first = parseStarOrTest();
+        if (peek().isKeyword("for") || peek().isKeyword("async")) {
+            Expr* gen = parseComprehension(ExprKind::GeneratorExp, first, nullptr);
+            expectOp(")");
+            return gen;
+        }
+        if (acceptOp(")")) {
+            return first;
+        }
+        size_t start = mark();
+        nodeStack.push_back(first);
+        while (acceptOp(",") && !peek().isOp(")")) {
+            nodeStack.push_back(parseStarOrTest());
+        }
+        expectOp(")");
+        auto* tuple = makeExpr<SequenceExpr>(ExprKind::Tuple, line);
+        tuple->elements = finishList<Expr>(start);
+        return tuple;
+    }
+
+    Expr* parseListDisplay() {
+        int line = expectOp("[").line;
+        if (acceptOp("]")) {
+            return makeExpr<SequenceExpr>(ExprKind::List, line);
+        }
+        Expr* first = parseStarOrTest();
+        if (peek().isKeyword("for") || peek().isKeyword("async")) {
+            Expr* comp = parseComprehension(ExprKind::ListComp, first, nullptr);
+            expectOp("]");
+            return comp;
+        }
+        size_t start = mark();
+        nodeStack.push_back(first);
+        while (acceptOp(",") && !peek().isOp("]")) {
+            nodeStack.push_back(parseStarOrTest());
+        }
+        expectOp("]");
+        auto* list = makeExpr<SequenceExpr>(ExprKind::List, line);
+        list->elements = finishList<Expr>(start);
+        return list;
+    }
+
+    Expr* parseDictOrSetDisplay() {
+        int line = expectOp("{").line;
+        if (acceptOp("}")) {
+            return makeExpr<DictExpr>(ExprKind::Dict, line);
+        }
+
+        if (!peek().isOp("**")) {
+            Expr* first = parseStarOrTest();
+            if (!peek().isOp(":")) {
+                // Set display or set comprehension
+                if (peek().isKeyword("for") || peek().isKeyword("async")) {
+                    Expr* comp = parseComprehension(ExprKind::SetComp, first, nullptr);
+                    expectOp("}");
+                    return comp;
+                }
+                size_t start = mark();
+                nodeStack.push_back(first);
+                while (acceptOp(",") && !peek().isOp("}")) {
+                    nodeStack.push_back(parseStarOrTest());
+                }
+                expectOp("}");
+                auto* set = makeExpr<SequenceExpr>(ExprKind::Set, line);
+                set->elements = finishList<Expr>(start);
+                return set;
+            }
+            advance();
+            Expr* value = parseTest();
+            if (peek().isKeyword("for") || peek().isKeyword("async")) {
+                Expr* comp = parseComprehension(ExprKind::DictComp, first, value);
+                expectOp("}");
+                return comp;
+            }
+            return parseDictEntries(line, first, value);
+        }
+        return parseDictEntries(line, nullptr, nullptr);
+    }
+
+    Expr* parseDictEntries(int line, Expr* firstKey, Expr* firstValue) {
+        // Keys and values are interleaved on the scratch stack and split afterwards
+        size_t start = mark();
+        if (firstValue != nullptr) {
+            nodeStack.push_back(firstKey);
+            nodeStack.push_back(firstValue);
+            if (!acceptOp(",")) {
+                expectOp("}");
+                return finishDict(line, start);
+            }
+        }
+        while (!peek().isOp("}")) {
+            if (acceptOp("**")) {
+                nodeStack.push_back(nullptr);
+                nodeStack.push_back(parseOr());
+            } else {
+                nodeStack.push_back(parseTest());
+                expectOp(":");
+                nodeStack.push_back(parseTest());
+            }
+            if (!acceptOp(",")) {
+                break;
+            }
+        }
+        expectOp("}");
+        return finishDict(line, start);
+    }
+
+    Expr* finishDict(int line, size_t start) {
+        auto* dict = makeExpr<DictExpr>(ExprKind::Dict, line);
+        size_t pairs = (nodeStack.size() - start) / 2;
+        for (size_t i = 0; i < pairs; ++i) {
+            nodeStack.push_back(nodeStack[start + 2 * i]);
+        }
+        for (size_t i = 0; i < pairs; ++i) {
+            nodeStack.push_back(nodeStack[start + 2 * i + 1]);
+        }
+        dict->values = finishList<Expr>(start + 3 * pairs);
+        dict->keys = finishList<Expr>(start + 2 * pairs);
+        nodeStack.resize(start);
+        return dict;
+    }
+
+    // Adjacent literals are concatenated; f-strings are split into their parts
+    Expr* parseStrings() {
+        int line = peek().line;
+        size_t start = mark();
+        bool hasFormat = false;
+        bool raw = false;
+        while (peek().kind == TokenKind::String || peek().kind == TokenKind::FString) {
+            Token tok = advance();
+            size_t quotePos = tok.text.find_first_of("'\"");
+            std::string_view prefix = tok.text.substr(0, quotePos);
+            std::string_view rest = tok.text.substr(quotePos);
+            size_t quoteLen = rest.size() >= 6 && rest[1] == rest[0] && rest[2] == rest[0] ? 3 : 1;
+            size_t bodyLen = rest.size() >= 2 * quoteLen ? rest.size() - 2 * quoteLen : 0;
+            std::string_view body = rest.substr(quoteLen, bodyLen);
+            bool isRaw = prefix.find_first_of("rR") != std::string_view::npos;
+            raw = raw || isRaw;
+
+            if (tok.kind == TokenKind::FString) {
+                hasFormat = true;
+                parseFStringBody(body, isRaw, tok.line);
+            } else {
+                auto* str = makeExpr<StringExpr>(ExprKind::String, tok.line);
+                str->prefix = prefix;
+                str->body = body;
+                str->raw = isRaw;
+                nodeStack.push_back(str);
+            }
+        }
+
+        if (!hasFormat && nodeStack.size() - start == 1) {
+            Expr* single = static_cast<Expr*>(nodeStack.back());
+            nodeStack.resize(start);
+            return single;
+        }
+        auto* fstring = makeExpr<FStringExpr>(ExprKind::FString, line);
+        fstring->parts = finishList<Expr>(start);
+        fstring->raw = raw;
+        return fstring;
+    }
+
+    void pushLiteral(std::string_view text, bool raw, int line) {
+        if (text.empty()) {
+            return;
+        }
+        auto* str = makeExpr<StringExpr>(ExprKind::String, line);
+        str->body = text;
+        str->raw = raw;
+        nodeStack.push_back(str);
+    }
+
+    void parseFStringBody(std::string_view body, bool raw, int line) {
+        size_t literalStart = 0;
+        size_t i = 0;
+        while (i < body.size()) {
+            char c = body[i];
+            if ((c == '{' || c == '}') && i + 1 < body.size() && body[i + 1] == c) {
+                // Doubled brace: keep one of them in the literal
+                pushLiteral(body.substr(literalStart, i + 1 - literalStart), raw, line);
+                i += 2;
+                literalStart = i;
+                continue;
+            }
+            if (c != '{') {
+                ++i;
+                continue;
+            }
+            pushLiteral(body.substr(literalStart, i - literalStart), raw, line);
+
+            size_t exprStart = i + 1;
+            size_t exprEnd = std::string_view::npos;
+            size_t specStart = std::string_view::npos;
+            char conversion = 0;
+            int depth = 0;
+            char quote = 0;
+            size_t j = exprStart;
+            for (; j < body.size(); ++j) {
+                char d = body[j];
+                if (quote != 0) {
+                    if (d == quote) {
+                        quote = 0;
+                    }
+                } else if (d == '\'' || d == '"') {
+                    quote = d;
+                } else if (d == '(' || d == '[' || d == '{') {
+                    ++depth;
+                } else if ((d == ')' || d == ']') && depth > 0) {
+                    --depth;
+                } else if (d == '}') {
+                    if (depth == 0) {
+                        break;
+                    }
+                    --depth;
+                } else if (depth == 0 && specStart == std::string_view::npos) {
+                    if (d == '!' && j + 1 < body.size() && body[j + 1] != '=') {
+                        exprEnd = std::min(exprEnd, j);
+                        conversion = j + 1 < body.size() ? body[j + 1] : 0;
+                    } else if (d == ':') {
+                        exprEnd = std::min(exprEnd, j);
+                        specStart = j + 1;
+                    }
+                }
+            }
+            if (exprEnd == std::string_view::npos) {
+                exprEnd = j;
+            }
+
+            std::string_view exprText = body.substr(exprStart, exprEnd - exprStart);
+            size_t last = exprText.find_last_not_of(' ');
+            if (last != std::string_view::npos && last > 0 && exprText[last] == '=' &&
+                std::string_view("=!<>").find(exprText[last - 1]) == std::string_view::npos) {
+                // Self-documenting f"{x=}" writes its own text, then the value's repr() unless told otherwise
+                pushLiteral(exprText, raw, line);
+                exprText = exprText.substr(0, last);
+                if (conversion == 0 && specStart == std::string_view::npos) {
+                    conversion = 'r';
+                }
+            }
+            while (!exprText.empty() && exprText.back() == ' ') {
+                exprText.remove_suffix(1);
+            }
+            while (!exprText.empty() && exprText.front() == ' ') {
+                exprText.remove_prefix(1);
+            }
+            auto* value = makeExpr<FormattedValueExpr>(ExprKind::FormattedValue, line);
+            value->value = parseEmbeddedExpression(exprText, line);
+            value->conversion = conversion;
+            if (specStart != std::string_view::npos) {
+                value->formatSpec = body.substr(specStart, j - specStart);
+            }
+            nodeStack.push_back(value);
+
+            i = j + 1;
+            literalStart = i;
+        }
+        pushLiteral(body.substr(std::min(literalStart, body.size())), raw, line);
+    }
+
+    Expr* parseEmbeddedExpression(std::string_view text, int line) {
+        PythonParser nested(text, arena, interner);
+        try {
+            Expr* expr = nested.parseExpressionList();
+            if (nested.peek().kind == TokenKind::Newline || nested.peek().kind == TokenKind::EndOfFile) {
+                return expr;
+            }
+        } catch (const ParseError&) {
+        }
+        auto* rawExpr = makeExpr<ConstantExpr>(ExprKind::Raw, line);
+        rawExpr->text = text;
+        return rawExpr;
+    }
+
+    // Comma-separated expressions; more than one (or a trailing comma) makes a tuple
+    Expr* parseExpressionList() {
+        int line = peek().line;
+        Expr* first = parseStarOrTest();
+        if (!peek().isOp(",")) {
+            return first;
+        }
+        size_t start = mark();
+        nodeStack.push_back(first);
+        while (acceptOp(",") && !atExpressionEnd()) {
+            nodeStack.push_back(parseStarOrTest());
+        }
+        auto* tuple = makeExpr<SequenceExpr>(ExprKind::Tuple, line);
+        tuple->elements = finishList<Expr>(start);
+        return tuple;
+    }
+
+    // Targets of for loops and comprehensions stop before `in`
+    Expr* parseTargetList() {
+        int line = peek().line;
+        auto parseTarget = [&]() -> Expr* {
+            if (peek().isOp("*")) {
+                int starLine = advance().line;
+                auto* starred = makeExpr<StarredExpr>(ExprKind::Starred, starLine);
+                starred->value = parseBinary(0);
+                return starred;
+            }
+            return parseBinary(0);
+        };
+        Expr* first = parseTarget();
+        if (!peek().isOp(",")) {
+            return first;
+        }
+        size_t start = mark();
+        nodeStack.push_back(first);
+        while (acceptOp(",") && !peek().isKeyword("in")) {
+            nodeStack.push_back(parseTarget());
+        }
+        auto* tuple = makeExpr<SequenceExpr>(ExprKind::Tuple, line);
+        tuple->elements = finishList<Expr>(start);
+        return tuple;
+    }
+
+    NodeList<Param*> parseParams(std::string_view closer, bool annotations) {
+        size_t start = mark();
+        while (!peek().isOp(closer)) {
+            auto* param = arena.make<Param>();
+            param->kind = Param::Normal;
+            if (acceptOp("*")) {
+                param->kind = Param::VarArgs;
+                if (peek().isOp(",")) {
+                    // Bare * only marks the start of keyword-only parameters
+                    advance();
+                    continue;
+                }
+            } else if (acceptOp("**")) {
+                param->kind = Param::KwArgs;
+            } else if (acceptOp("/")) {
+                if (!acceptOp(",")) {
+                    break;
+                }
+                continue;
+            }
+            param->name = expectName();
+            if (annotations && acceptOp(":")) {
+                param->annotation = parseTest();
+            }
+            if (acceptOp("=")) {
+                param->defaultValue = parseTest();
+            }
+            nodeStack.push_back(param);
+            if (!acceptOp(",")) {
+                break;
+            }
+        }
+        return finishList<Param>(start);
+    }
+
+    // Statements
+
+    std::string_view sourceFrom(const char* begin) const {
+        if (begin == nullptr || lastEnd == nullptr || lastEnd < begin) {
+            return {};
+        }
+        return std::string_view(begin, static_cast<size_t>(lastEnd - begin));
+    }
+
+    // Consumes the NEWLINE ending a statement and returns its trailing comment
+    std::string_view endOfLine() {
+        if (peek().kind == TokenKind::Newline) {
+            advance();
+            return lastComment;
+        }
+        if (peek().kind == TokenKind::EndOfFile || peek().kind == TokenKind::Dedent) {
+            return {};
+        }
+        throw ParseError{peek().line};
+    }
+
+    // Skips the rest of a broken line; returns its source text
+    std::string_view recover(const char* lineStart) {
+        while (peek().kind != TokenKind::Newline && peek().kind != TokenKind::EndOfFile) {
+            advance();
+        }
+        std::string_view text = sourceFrom(lineStart);
+        if (peek().kind == TokenKind::Newline) {
+            advance();
+        }
+        return text;
+    }
+
+    StmtList parseBlock() {
+        expectOp(":");
+        if (peek().kind != TokenKind::Newline) {
+            // Inline body: `if x: y = 1; z = 2`
+            size_t start = mark();
+            parseSimpleStatements();
+            pendingHeaderComment = {};
+            return finishList<Stmt>(start);
+        }
+        advance();
+        std::string_view headerComment = lastComment;
+        size_t start = mark();
+        if (peek().kind == TokenKind::Indent) {
+            advance();
+            parseStatements(true);
+            if (peek().kind == TokenKind::Dedent) {
+                advance();
+            }
+        }
+        StmtList body = finishList<Stmt>(start);
+        // Nested blocks overwrite this while the body is parsed, so set it last
+        pendingHeaderComment = headerComment;
+        return body;
+    }
+
+    // Comment lines between a block and a possible else/elif/except are pushed on
+    // the scratch stack; returns where they start
+    size_t collectComments() {
+        size_t start = mark();
+        while (peek().kind == TokenKind::Comment) {
+            Token tok = advance();
+            auto* comment = makeStmt<TextStmt>(StmtKind::Comment, tok.line);
+            comment->text = tok.text.substr(1);
+            nodeStack.push_back(comment);
+        }
+        return start;
+    }
+
+    StmtList concat(StmtList first, StmtList second) {
+        if (first.empty()) {
+            return second;
+        }
+        StmtList list;
+        list.count = first.count + second.count;
+        list.items = static_cast<Stmt**>(arena.allocate(sizeof(Stmt*) * list.count, alignof(Stmt*)));
+        std::copy(first.begin(), first.end(), list.items);
+        std::copy(second.begin(), second.end(), list.items + first.count);
+        return list;
+    }
+
+    StmtList single(Stmt* stmt) {
+        StmtList list;
+        list.count = 1;
+        list.items = arena.copyArray(&stmt, 1);
+        return list;
+    }
+
+    Stmt* parseIf(bool isElif) {
+        int line = advance().line;
+        auto* stmt = makeStmt<IfStmt>(StmtKind::If, line);
+        stmt->isElif = isElif;
+        stmt->test = parseTest();
+        stmt->body = parseBlock();
+        stmt->comment = pendingHeaderComment;
+
+        size_t commentMark = collectComments();
+        if (peek().isKeyword("elif")) {
+            StmtList comments = finishList<Stmt>(commentMark);
+            // The innermost elif leaves the comments after the whole chain
+            stmt->orelse = concat(comments, single(parseIf(true)));
+        } else if (peek().isKeyword("else")) {
+            StmtList comments = finishList<Stmt>(commentMark);
+            advance();
+            stmt->orelse = concat(comments, parseBlock());
+            trailingComments = collectComments();
+        } else {
+            trailingComments = commentMark;
+        }
+        return stmt;
+    }
+
+    Stmt* parseWhile() {
+        int line = advance().line;
+        auto* stmt = makeStmt<IfStmt>(StmtKind::While, line);
+        stmt->test = parseTest();
+        stmt->body = parseBlock();
+        stmt->comment = pendingHeaderComment;
+        stmt->orelse = parseLoopElse();
+        return stmt;
+    }
+
+    Stmt* parseFor() {
+        int line = advance().line;
+        auto* stmt = makeStmt<ForStmt>(StmtKind::For, line);
+        stmt->target = parseTargetList();
+        expectKeyword("in");
+        stmt->iter = parseExpressionList();
+        stmt->body = parseBlock();
+        stmt->comment = pendingHeaderComment;
+        stmt->orelse = parseLoopElse();
+        return stmt;
+    }
+
+    StmtList parseLoopElse() {
+        size_t commentMark = collectComments();
+        if (!peek().isKeyword("else")) {
+            trailingComments = commentMark;
+            return {};
+        }
+        StmtList comments = finishList<Stmt>(commentMark);
+        advance();
+        StmtList orelse = concat(comments, parseBlock());
+        trailingComments = collectComments();
+        return orelse;
+    }
+
+    Stmt* parseTry() {
+        int line = advance().line;
+        auto* stmt = makeStmt<TryStmt>(StmtKind::Try, line);
+        stmt->body = parseBlock();
+        stmt->comment = pendingHeaderComment;
+
+        size_t handlerStart = mark();
+        size_t commentMark = collectComments();
+        while (peek().isKeyword("except")) {
+            StmtList comments = finishList<Stmt>(commentMark);
+            auto* handler = arena.make<ExceptHandler>();
+            handler->line = advance().line;
+            acceptOp("*");
+            if (!peek().isOp(":")) {
+                handler->type = parseTest();
+                if (acceptKeyword("as") || acceptOp(",")) {
+                    handler->name = expectName();
+                }
+            }
+            handler->body = concat(comments, parseBlock());
+            handler->comment = pendingHeaderComment;
+            nodeStack.push_back(handler);
+            commentMark = collectComments();
+        }
+        for (std::string_view clause : {std::string_view("else"), std::string_view("finally")}) {
+            if (peek().isKeyword(clause)) {
+                StmtList comments = finishList<Stmt>(commentMark);
+                advance();
+                (clause == "else" ? stmt->orelse : stmt->finalbody) = concat(comments, parseBlock());
+                commentMark = collectComments();
+            }
+        }
+
+        StmtList trailing = finishList<Stmt>(commentMark);
+        stmt->handlers = finishList<ExceptHandler>(handlerStart);
+        trailingComments = mark();
+        for (Stmt* comment : trailing) {
+            nodeStack.push_back(comment);
+        }
+        return stmt;
+    }
+
+    Stmt* parseWith() {
+        int line = advance().line;
+        auto* stmt = makeStmt<WithStmt>(StmtKind::With, line);
+        size_t start = mark();
+        do {
+            auto* item = arena.make<WithItem>();
+            item->context = parseTest();
+            if (acceptKeyword("as")) {
+                item->var = parseTargetList();
+            }
+            nodeStack.push_back(item);
+        } while (acceptOp(","));
+        stmt->items = finishList<WithItem>(start);
+        stmt->body = parseBlock();
+        stmt->comment = pendingHeaderComment;
+        return stmt;
+    }
+
+    Stmt* parseFunctionDef(NodeList<Expr*> decorators) {
+        int line = expectKeyword("def").line;
+        auto* def = makeStmt<FunctionDef>(StmtKind::FunctionDef, line);
+        def->decorators = decorators;
+        def->name = expectName();
+        expectOp("(");
+        def->params = parseParams(")", true);
+        expectOp(")");
+        if (acceptOp("->")) {
+            def->returns = parseTest();
+        }
+        def->body = parseBlock();
+        def->comment = pendingHeaderComment;
+        return def;
+    }
+
+    Stmt* parseClassDef(NodeList<Expr*> decorators) {
+        int line = advance().line;
+        auto* cls = makeStmt<ClassDef>(StmtKind::ClassDef, line);
+        cls->decorators = decorators;
+        cls->name = expectName();
+        if (acceptOp("(")) {
+            size_t start = mark();
+            for (Expr* arg : parseCallArguments()) {
+                // Keyword arguments such as metaclass= are not base classes
+                if (arg->kind != ExprKind::Keyword) {
+                    nodeStack.push_back(arg);
+                }
+            }
+            cls->bases = finishList<Expr>(start);
+            expectOp(")");
+        }
+        cls->body = parseBlock();
+        cls->comment = pendingHeaderComment;
+        return cls;
+    }
+
+    std::string_view parseDottedName() {
+        const char* begin = peek().text.data();
+        expectName();
+        while (acceptOp(".")) {
+            expectName();
+        }
+        return interner.intern(sourceFrom(begin));
+    }
+
+    Stmt* parseImport() {
+        int line = peek().line;
+        auto* stmt = makeStmt<ImportStmt>(StmtKind::Import, line);
+        advance();
+        size_t start = mark();
+        do {
+            auto* alias = arena.make<Alias>();
+            alias->name = parseDottedName();
+            if (acceptKeyword("as")) {
+                alias->asname = expectName();
+            }
+            nodeStack.push_back(alias);
+        } while (acceptOp(","));
+        stmt->names = finishList<Alias>(start);
+        return stmt;
+    }
+
+    Stmt* parseImportFrom() {
+        int line = advance().line;
+        auto* stmt = makeStmt<ImportStmt>(StmtKind::ImportFrom, line);
+        while (peek().isOp(".") || peek().isOp("...")) {
+            stmt->level += static_cast<int>(advance().text.size());
+        }
+        if (!peek().isKeyword("import")) {
+            stmt->module = parseDottedName();
+        }
+        expectKeyword("import");
+        size_t start = mark();
+        bool parenthesized = acceptOp("(");
+        if (peek().isOp("*")) {
+            auto* alias = arena.make<Alias>();
+            alias->name = advance().text;
+            nodeStack.push_back(alias);
+        } else {
+            do {
+                if (parenthesized && peek().isOp(")")) {
+                    break;
+                }
+                auto* alias = arena.make<Alias>();
+                alias->name = expectName();
+                if (acceptKeyword("as")) {
+                    alias->asname = expectName();
+                }
+                nodeStack.push_back(alias);
+            } while (acceptOp(","));
+        }
+        if (parenthesized) {
+            expectOp(")");
+        }
+        stmt->names = finishList<Alias>(start);
+        return stmt;
+    }
+
+    Stmt* parseSmallStatement() {
+        const Token& tok = peek();
+        int line = tok.line;
+        if (tok.kind == TokenKind::Keyword) {
+            if (tok.text == "pass" || tok.text == "break" || tok.text == "continue") {
+                StmtKind kind = tok.text == "pass" ? StmtKind::Pass
+                              : tok.text == "break" ? StmtKind::Break : StmtKind::Continue;
+                advance();
+                return makeStmt<Stmt>(kind, line);
+            }
+            if (tok.text == "return") {
+                advance();
+                auto* ret = makeStmt<ValueStmt>(StmtKind::Return, line);
+                if (!atExpressionEnd()) {
+                    ret->value = parseExpressionList();
+                }
+                return ret;
+            }
+            if (tok.text == "raise") {
+                advance();
+                auto* raise = makeStmt<ValueStmt>(StmtKind::Raise, line);
+                if (!atExpressionEnd()) {
+                    raise->value = parseTest();
+                    if (acceptKeyword("from")) {
+                        raise->cause = parseTest();
+                    }
+                }
+                return raise;
+            }
+            if (tok.text == "global" || tok.text == "nonlocal") {
+                auto* names = makeStmt<NamesStmt>(tok.text == "global" ? StmtKind::Global : StmtKind::Nonlocal, line);
+                advance();
+                size_t start = viewStack.size();
+                do {
+                    viewStack.push_back(expectName());
+                } while (acceptOp(","));
+                names->names = finishViews(start);
+                return names;
+            }
+            if (tok.text == "del") {
+                advance();
+                auto* del = makeStmt<ExprListStmt>(StmtKind::Del, line);
+                size_t start = mark();
+                do {
+                    nodeStack.push_back(parseOr());
+                } while (acceptOp(",") && !atExpressionEnd());
+                del->expressions = finishList<Expr>(start);
+                return del;
+            }
+            if (tok.text == "assert") {
+                advance();
+                auto* assert = makeStmt<ExprListStmt>(StmtKind::Assert, line);
+                size_t start = mark();
+                nodeStack.push_back(parseTest());
+                if (acceptOp(",")) {
+                    nodeStack.push_back(parseTest());
+                }
+                assert->expressions = finishList<Expr>(start);
+                return assert;
+            }
+            if (tok.text == "import") {
+                return parseImport();
+            }
+            if (tok.text == "from") {
+                return parseImportFrom();
+            }
+        }
+
+        Expr* first = parseExpressionList();
+        if (peek().isOp("=")) {
+            auto* assign = makeStmt<AssignStmt>(StmtKind::Assign, line);
+            size_t start = mark();
+            nodeStack.push_back(first);
+            Expr* value = nullptr;
+            while (acceptOp("=")) {
+                if (peek().isKeyword("yield")) {
+                    throw ParseError{line};
+                }
+                value = parseExpressionList();
+                nodeStack.push_back(value);
+            }
+            nodeStack.pop_back();
+            assign->targets = finishList<Expr>(start);
+            assign->value = value;
+            return assign;
+        }
+        if (peek().isOp(":")) {
+            advance();
+            auto* ann = makeStmt<AnnAssignStmt>(StmtKind::AnnAssign, line);
+            ann->target = first;
+            ann->annotation = parseTest();
+            if (acceptOp("=")) {
+                ann->value = parseExpressionList();
+            }
+            return ann;
+        }
+        const Token& opTok = peek();
+        if (opTok.kind == TokenKind::Operator && opTok.text.size() >= 2 && opTok.text.back() == '=' &&
+            opTok.text != "==" && opTok.text != "!=" && opTok.text != "<=" && opTok.text != ">=") {
+            auto* aug = makeStmt<AugAssignStmt>(StmtKind::AugAssign, line);
+            aug->target = first;
+            aug->op = advance().text;
+            aug->value = parseExpressionList();
+            return aug;
+        }
+        auto* stmt = makeStmt<ExprStmt>(StmtKind::Expr, line);
+        stmt->value = first;
+        return stmt;
+    }
+
+    // small_stmt (';' small_stmt)* NEWLINE, each pushed as its own statement
+    void parseSimpleStatements() {
+        size_t start = mark();
+        while (true) {
+            nodeStack.push_back(parseSmallStatement());
+            if (!acceptOp(";") || peek().kind == TokenKind::Newline || peek().kind == TokenKind::EndOfFile) {
+                break;
+            }
+        }
+        std::string_view comment = endOfLine();
+        if (nodeStack.size() > start) {
+            static_cast<Stmt*>(nodeStack.back())->comment = comment;
+        }
+    }
+
+    void parseStatement() {
+        const char* lineStart = peek().text.data();
+        int line = peek().line;
+        size_t start = mark();
+        try {
+            const Token& tok = peek();
+            if (tok.kind == TokenKind::Keyword) {
+                Stmt* stmt = nullptr;
+                trailingComments = kNoComments;
+                if (tok.text == "if") {
+                    stmt = parseIf(false);
+                } else if (tok.text == "while") {
+                    stmt = parseWhile();
+                } else if (tok.text == "for") {
+                    stmt = parseFor();
+                } else if (tok.text == "try") {
+                    stmt = parseTry();
+                } else if (tok.text == "with") {
+                    stmt = parseWith();
+                } else if (tok.text == "def") {
+                    stmt = parseFunctionDef({});
+                } else if (tok.text == "class") {
+                    stmt = parseClassDef({});
+                } else if (tok.text == "async" && (peek(1).isKeyword("def") || peek(1).isKeyword("for") ||
+                                                   peek(1).isKeyword("with"))) {
+                    advance();
+                    parseStatement();
+                    return;
+                }
+                if (stmt != nullptr) {
+                    insertBeforeTrailingComments(stmt);
+                    return;
+                }
+            }
+            if (tok.isOp("@")) {
+                size_t decoratorStart = mark();
+                while (acceptOp("@")) {
+                    nodeStack.push_back(parseTest());
+                    endOfLine();
+                }
+                NodeList<Expr*> decorators = finishList<Expr>(decoratorStart);
+                trailingComments = kNoComments;
+                if (peek().isKeyword("async") && peek(1).isKeyword("def")) {
+                    advance();
+                }
+                Stmt* stmt = peek().isKeyword("class") ? parseClassDef(decorators) : parseFunctionDef(decorators);
+                insertBeforeTrailingComments(stmt);
+                return;
+            }
+            parseSimpleStatements();
+        } catch (const ParseError&) {
+            nodeStack.resize(start);
+            viewStack.clear();
+            auto* unsupported = makeStmt<TextStmt>(StmtKind::Unsupported, line);
+            unsupported->text = recover(lineStart);
+            if (peek().kind == TokenKind::Indent) {
+                advance();
+                size_t bodyStart = mark();
+                parseStatements(true);
+                if (peek().kind == TokenKind::Dedent) {
+                    advance();
+                }
+                unsupported->body = finishList<Stmt>(bodyStart);
+            }
+            nodeStack.push_back(unsupported);
+        }
+    }
+
+    // Compound statements leave the comments that followed them on the scratch
+    // stack (above `trailingComments`); the statement itself has to come first
+    void insertBeforeTrailingComments(Stmt* stmt) {
+        if (trailingComments == kNoComments || trailingComments >= nodeStack.size()) {
+            nodeStack.push_back(stmt);
+            return;
+        }
+        nodeStack.insert(nodeStack.begin() + static_cast<std::ptrdiff_t>(trailingComments), stmt);
+    }
+
+    // Parses one statement (or skips layout tokens); false once the block or file ends
+    bool parseStatementStep(bool untilDedent) {
+        const Token& tok = peek();
+        if (tok.kind == TokenKind::EndOfFile || (untilDedent && tok.kind == TokenKind::Dedent)) {
+            return false;
+        }
+        if (tok.kind == TokenKind::Newline || tok.kind == TokenKind::Dedent) {
+            advance();
+            return true;
+        }
+        if (tok.kind == TokenKind::Indent) {
+            // Unexpected indentation: keep the statements, flattened into this block
+            advance();
+            parseStatements(true);
+            if (peek().kind == TokenKind::Dedent) {
+                advance();
+            }
+            return true;
+        }
+        if (tok.kind == TokenKind::Comment) {
+            Token comment = advance();
+            auto* stmt = makeStmt<TextStmt>(StmtKind::Comment, comment.line);
+            stmt->text = comment.text.substr(1);
+            nodeStack.push_back(stmt);
+            return true;
+        }
+        parseStatement();
+        return true;
+    }
+
+    void parseStatements(bool untilDedent) {
+        while (parseStatementStep(untilDedent)) {
+        }
+    }
+
+public:
+    PythonParser(std::string_view code, Arena& nodeArena, StringInterner& names)
+        : lexer(code), arena(nodeArena), interner(names) {}
+
+    Module* parseModule() {
+        PY2CPP_PROFILE_SCOPE("parse");
+        auto* module = arena.make<Module>();
+        size_t start = mark();
+        parseStatements(false);
+        module->body = finishList<Stmt>(start);
+        return module;
+    }
+
+    // Streaming alternative to parseModule(): returns the next top-level statement,
+    // followed by any comment lines that trailed it, or an empty list at the end of
+    // the file. The caller may reset the arena between calls.
+    StmtList parseNextStatements() {
+        PY2CPP_PROFILE_SCOPE("parse");
+        size_t start = mark();
+        while (nodeStack.size() == start && parseStatementStep(false)) {
+        }
+        return finishList<Stmt>(start);
+    }
+};
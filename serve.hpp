@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Framing for `py2cpp --serve`. Every request and response is one header line
+// holding a word and a decimal byte count, followed by exactly that many bytes:
+//
+//     translate 42\n<42 bytes of Python>   ->   ok 1234\n<1234 bytes of C++>
+//     file 20\n<input path>\n<output path> ->   ok 0\n
+//                                               error 27\n<27 bytes of message>
+//
+// Payloads are raw bytes, so sources and paths need no escaping.
+#ifndef _WIN32
+class FrameChannel {
+private:
+    static constexpr size_t kBufferSize = 64 * 1024;
+    // Longest header accepted; anything longer is not a frame
+    static constexpr size_t kMaxHeader = 256;
+
+    int input;
+    int output;
+    char buffer[kBufferSize];
+    size_t begin = 0;
+    size_t end = 0;
+    std::string failure;
+
+    // False once the peer has closed its end or the read failed
+    bool fill() {
+        if (begin == end) {
+            begin = end = 0;
+        }
+        while (true) {
+            ssize_t count = ::read(input, buffer + end, kBufferSize - end);
+            if (count > 0) {
+                end += static_cast<size_t>(count);
+                return true;
+            }
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count < 0) {
+                failure = std::string("read failed: ") + std::strerror(errno);
+            }
+            return false;
+        }
+    }
+
+    bool writeAll(const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t count = ::write(output, data, size);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                failure = std::string("write failed: ") + std::strerror(errno);
+                return false;
+            }
+            data += count;
+            size -= static_cast<size_t>(count);
+        }
+        return true;
+    }
+
+public:
+    FrameChannel(int inputFd, int outputFd) : input(inputFd), output(outputFd) {}
+
+    FrameChannel(const FrameChannel&) = delete;
+    FrameChannel& operator=(const FrameChannel&) = delete;
+
+    // Reads the next request into `command` and `payload`. Returns false at
+    // the end of the stream, and also on a malformed frame, with error() set.
+    bool readFrame(std::string& command, std::string& payload) {
+        std::string header;
+        while (true) {
+            const char* newline = static_cast<const char*>(std::memchr(buffer + begin, '\n', end - begin));
+            size_t available = newline != nullptr ? static_cast<size_t>(newline - (buffer + begin)) : end - begin;
+            header.append(buffer + begin, available);
+            begin += available;
+            if (newline != nullptr) {
+                ++begin;
+                break;
+            }
+            if (header.size() > kMaxHeader) {
+                failure = "frame header too long";
+                return false;
+            }
+            if (!fill()) {
+                if (!header.empty() && failure.empty()) {
+                    failure = "stream ended inside a frame header";
+                }
+                return false;
+            }
+        }
+        size_t space = header.find(' ');
+        char* last = nullptr;
+        unsigned long long size = space != std::string::npos ? std::strtoull(header.c_str() + space + 1, &last, 10) : 0;
+        if (space == std::string::npos || space == 0 || last == header.c_str() + space + 1 || *last != '\0') {
+            failure = "malformed frame header '" + header + "'";
+            return false;
+        }
+        command.assign(header, 0, space);
+        payload.clear();
+        // The count is untrusted, so memory grows with the bytes that really arrive
+        payload.reserve(static_cast<size_t>(std::min<unsigned long long>(size, 16 * kBufferSize)));
+        while (payload.size() < size) {
+            if (begin == end && !fill()) {
+                if (failure.empty()) {
+                    failure = "stream ended inside a frame";
+                }
+                return false;
+            }
+            size_t take = std::min(end - begin, static_cast<size_t>(size) - payload.size());
+            payload.append(buffer + begin, take);
+            begin += take;
+        }
+        return true;
+    }
+
+    bool writeFrame(std::string_view status, std::string_view payload) {
+        std::string header(status);
+        header += ' ';
+        header += std::to_string(payload.size());
+        header += '\n';
+        return writeAll(header.data(), header.size()) && writeAll(payload.data(), payload.size());
+    }
+
+    const std::string& error() const {
+        return failure;
+    }
+};
+
+// Listening Unix domain socket; the socket file is removed again on destruction
+class UnixListener {
+private:
+    int fd = -1;
+    std::string path;
+
+public:
+    UnixListener() = default;
+    UnixListener(const UnixListener&) = delete;
+    UnixListener& operator=(const UnixListener&) = delete;
+
+    ~UnixListener() {
+        if (fd >= 0) {
+            ::close(fd);
+            ::unlink(path.c_str());
+        }
+    }
+
+    bool listen(const std::string& socketPath, std::string& error) {
+        sockaddr_un address{};
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            error = "Socket path too long: " + socketPath;
+            return false;
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            error = std::string("Could not create socket: ") + std::strerror(errno);
+            return false;
+        }
+        // A socket file left behind by an earlier server would make bind() fail
+        ::unlink(socketPath.c_str());
+        if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0 || ::listen(fd, 16) < 0) {
+            error = "Could not listen on " + socketPath + ": " + std::strerror(errno);
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+        path = socketPath;
+        return true;
+    }
+
+    // Blocks for the next client; -1 when accepting failed
+    int accept() {
+        while (true) {
+            int client = ::accept(fd, nullptr, nullptr);
+            if (client >= 0 || errno != EINTR) {
+                return client;
+            }
+        }
+    }
+};
+#endif
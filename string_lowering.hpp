@@ -0,0 +1,337 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "python_ast.hpp"
+
+// Analysis behind the lowering of string building and splitting. It splits
+// the value of `text += a + str(n) + ","` into its parts, and checks whether a
+// loop variable is only ever read as text (measured, printed, compared,
+// formatted, converted or appended to a string), so `for field in
+// line.split(",")` can walk std::string_view slices of line instead of
+// copying every field into its own std::string.
+class TextUses {
+private:
+    std::string_view name;
+    bool textOnly = true;
+    bool seen = false;
+    std::vector<std::string_view> stored;   // Names rebound in the body
+    std::vector<std::string_view> targets;  // Names the variable is appended to
+
+    static bool sameName(std::string_view a, std::string_view b) {
+        return a.data() == b.data() && a.size() == b.size();
+    }
+
+    static bool isName(const Expr* expr, std::string_view id) {
+        return expr != nullptr && expr->kind == ExprKind::Name && static_cast<const NameExpr*>(expr)->id == id;
+    }
+
+    void store(std::string_view id) {
+        stored.push_back(id);
+        if (sameName(id, name)) {
+            seen = true;
+            textOnly = false;
+        }
+    }
+
+    void expressions(const NodeList<Expr*>& list, bool text = false) {
+        for (const Expr* e : list) {
+            expression(e, text);
+        }
+    }
+
+    // `text` is set where a string_view reads the same as a std::string
+    void expression(const Expr* expr, bool text = false) {
+        if (expr == nullptr) {
+            return;
+        }
+        switch (expr->kind) {
+            case ExprKind::Name:
+                if (sameName(static_cast<const NameExpr*>(expr)->id, name)) {
+                    seen = true;
+                    textOnly = textOnly && text;
+                }
+                break;
+            case ExprKind::Call: {
+                auto* call = static_cast<const CallExpr*>(expr);
+                bool reads = false;
+                if (call->func->kind == ExprKind::Name) {
+                    std::string_view func = static_cast<const NameExpr*>(call->func)->id;
+                    reads = func == "print" ||
+                            (call->args.size() == 1 &&
+                             (func == "len" || func == "str" || func == "int" || func == "float"));
+                }
+                expression(call->func);
+                for (const Expr* arg : call->args) {
+                    expression(arg, reads && arg->kind != ExprKind::Keyword && arg->kind != ExprKind::Starred);
+                }
+                break;
+            }
+            case ExprKind::FString:
+                expressions(static_cast<const FStringExpr*>(expr)->parts);
+                break;
+            case ExprKind::FormattedValue:
+                expression(static_cast<const FormattedValueExpr*>(expr)->value, true);
+                break;
+            case ExprKind::Compare: {
+                auto* cmp = static_cast<const CompareExpr*>(expr);
+                bool reads = true;
+                for (std::string_view op : cmp->ops) {
+                    // `x is None` would compare a view with a null pointer
+                    reads = reads && op != "in" && op != "not in" && op != "is" && op != "is not";
+                }
+                expressions(cmp->operands, reads);
+                break;
+            }
+            case ExprKind::Attribute:
+                expression(static_cast<const AttributeExpr*>(expr)->value);
+                break;
+            case ExprKind::Subscript: {
+                auto* sub = static_cast<const SubscriptExpr*>(expr);
+                expression(sub->value);
+                expression(sub->index);
+                break;
+            }
+            case ExprKind::Unary:
+                expression(static_cast<const UnaryExpr*>(expr)->operand);
+                break;
+            case ExprKind::Binary:
+            case ExprKind::BoolOp: {
+                auto* op = static_cast<const BinaryExpr*>(expr);
+                expression(op->left);
+                expression(op->right);
+                break;
+            }
+            case ExprKind::Conditional: {
+                auto* cond = static_cast<const ConditionalExpr*>(expr);
+                expression(cond->test);
+                expression(cond->body);
+                expression(cond->orelse);
+                break;
+            }
+            case ExprKind::Keyword:
+                expression(static_cast<const KeywordExpr*>(expr)->value);
+                break;
+            case ExprKind::Starred:
+                expression(static_cast<const StarredExpr*>(expr)->value);
+                break;
+            case ExprKind::Slice: {
+                auto* slice = static_cast<const SliceExpr*>(expr);
+                expression(slice->lower);
+                expression(slice->upper);
+                expression(slice->step);
+                break;
+            }
+            case ExprKind::List:
+            case ExprKind::Tuple:
+            case ExprKind::Set:
+                expressions(static_cast<const SequenceExpr*>(expr)->elements);
+                break;
+            case ExprKind::Dict: {
+                auto* dict = static_cast<const DictExpr*>(expr);
+                expressions(dict->keys);
+                expressions(dict->values);
+                break;
+            }
+            case ExprKind::ListComp:
+            case ExprKind::SetComp:
+            case ExprKind::DictComp:
+            case ExprKind::GeneratorExp: {
+                auto* comp = static_cast<const ComprehensionExpr*>(expr);
+                for (const Comprehension* gen : comp->generators) {
+                    target(gen->target);
+                    expression(gen->iter);
+                    expressions(gen->ifs);
+                }
+                expression(comp->element);
+                expression(comp->value);
+                break;
+            }
+            case ExprKind::Lambda:
+                // Captures are not tracked
+                textOnly = false;
+                expression(static_cast<const LambdaExpr*>(expr)->body);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Names bound by an assignment target; anything else is written into
+    void target(const Expr* expr) {
+        if (expr == nullptr) {
+            return;
+        }
+        if (expr->kind == ExprKind::Name) {
+            store(static_cast<const NameExpr*>(expr)->id);
+        } else if (expr->kind == ExprKind::Tuple || expr->kind == ExprKind::List) {
+            for (const Expr* element : static_cast<const SequenceExpr*>(expr)->elements) {
+                target(element);
+            }
+        } else if (expr->kind == ExprKind::Starred) {
+            target(static_cast<const StarredExpr*>(expr)->value);
+        } else {
+            expression(expr);
+        }
+    }
+
+    void block(const StmtList& body) {
+        for (const Stmt* stmt : body) {
+            statement(stmt);
+        }
+    }
+
+    void statement(const Stmt* stmt) {
+        switch (stmt->kind) {
+            case StmtKind::Expr:
+                expression(static_cast<const ExprStmt*>(stmt)->value);
+                break;
+            case StmtKind::Assign: {
+                auto* assign = static_cast<const AssignStmt*>(stmt);
+                for (const Expr* t : assign->targets) {
+                    target(t);
+                }
+                expression(assign->value);
+                break;
+            }
+            case StmtKind::AugAssign: {
+                auto* assign = static_cast<const AugAssignStmt*>(stmt);
+                target(assign->target);
+                if (assign->op == "+=" && assign->target->kind == ExprKind::Name) {
+                    // Appending to a string reads each part as text
+                    std::vector<const Expr*> parts;
+                    concatParts(assign->value, parts);
+                    for (const Expr* part : parts) {
+                        if (isName(part, name)) {
+                            targets.push_back(static_cast<const NameExpr*>(assign->target)->id);
+                        }
+                        expression(part, true);
+                    }
+                } else {
+                    expression(assign->value);
+                }
+                break;
+            }
+            case StmtKind::AnnAssign: {
+                auto* assign = static_cast<const AnnAssignStmt*>(stmt);
+                target(assign->target);
+                expression(assign->value);
+                break;
+            }
+            case StmtKind::Return:
+            case StmtKind::Raise: {
+                auto* value = static_cast<const ValueStmt*>(stmt);
+                expression(value->value);
+                expression(value->cause);
+                break;
+            }
+            case StmtKind::Del:
+                for (const Expr* e : static_cast<const ExprListStmt*>(stmt)->expressions) {
+                    target(e);
+                }
+                break;
+            case StmtKind::Assert:
+                expressions(static_cast<const ExprListStmt*>(stmt)->expressions);
+                break;
+            case StmtKind::If:
+            case StmtKind::While: {
+                auto* ifStmt = static_cast<const IfStmt*>(stmt);
+                expression(ifStmt->test);
+                block(ifStmt->body);
+                block(ifStmt->orelse);
+                break;
+            }
+            case StmtKind::For: {
+                auto* forStmt = static_cast<const ForStmt*>(stmt);
+                target(forStmt->target);
+                expression(forStmt->iter);
+                block(forStmt->body);
+                block(forStmt->orelse);
+                break;
+            }
+            case StmtKind::Try: {
+                auto* tryStmt = static_cast<const TryStmt*>(stmt);
+                block(tryStmt->body);
+                for (const ExceptHandler* handler : tryStmt->handlers) {
+                    expression(handler->type);
+                    if (!handler->name.empty()) {
+                        store(handler->name);
+                    }
+                    block(handler->body);
+                }
+                block(tryStmt->orelse);
+                block(tryStmt->finalbody);
+                break;
+            }
+            case StmtKind::With: {
+                auto* with = static_cast<const WithStmt*>(stmt);
+                for (const WithItem* item : with->items) {
+                    expression(item->context);
+                    target(item->var);
+                }
+                block(with->body);
+                break;
+            }
+            case StmtKind::Global:
+            case StmtKind::Nonlocal:
+                for (std::string_view id : static_cast<const NamesStmt*>(stmt)->names) {
+                    store(id);
+                }
+                break;
+            case StmtKind::FunctionDef:
+            case StmtKind::ClassDef:
+            case StmtKind::Unsupported:
+                textOnly = false;
+                break;
+            default:
+                break;
+        }
+    }
+
+public:
+    explicit TextUses(std::string_view variable) : name(variable) {}
+
+    // The operands of a chain of `+`, left to right. On the right of `+=` to a
+    // str every one of them is a str, so the chain can be appended piecewise.
+    static void concatParts(const Expr* value, std::vector<const Expr*>& parts) {
+        if (value->kind == ExprKind::Binary && static_cast<const BinaryExpr*>(value)->op == "+") {
+            auto* op = static_cast<const BinaryExpr*>(value);
+            concatParts(op->left, parts);
+            concatParts(op->right, parts);
+            return;
+        }
+        parts.push_back(value);
+    }
+
+    void analyzeBody(const StmtList& body) {
+        block(body);
+    }
+
+    void analyzeExpression(const Expr* expr) {
+        expression(expr);
+    }
+
+    bool mentioned() const {
+        return seen;
+    }
+
+    bool onlyText() const {
+        return textOnly;
+    }
+
+    bool rebinds(std::string_view id) const {
+        for (std::string_view n : stored) {
+            if (sameName(n, id)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Names `name` is appended to with +=, which have to be strings for the
+    // slices to append
+    const std::vector<std::string_view>& appendTargets() const {
+        return targets;
+    }
+};
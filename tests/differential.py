@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""Differential test against CPython.
+
+Every program is run under python3, translated with py2cpp, compiled at -O2
+and run again. The test fails when the two runs print different output, when
+translation or compilation fails, or when the C++ build is slower than
+CPython. Arguments are .py files, directories of them, and --readme, whose
+"## Example" Python block is tested as well. Each --project is a directory of
+modules run as app.py and translated with py2cpp --modules. With --sanitize the
+programs are built with AddressSanitizer and UBSan instead, and only their
+output is compared. --std-containers is passed on to py2cpp.
+"""
+
+import argparse
+import difflib
+import os
+import re
+import shutil
+import subprocess
+import sys
+import time
+
+# Fastest of this many runs on each side
+RUNS = 3
+
+# Any invalid access or undefined behaviour aborts the program
+SANITIZE = ["-O1", "-g", "-fno-omit-frame-pointer", "-fsanitize=address,undefined", "-fno-sanitize-recover=all"]
+
+
+def readme_example(path):
+    with open(path, encoding="utf-8") as f:
+        text = f.read()
+    match = re.search(r"^## Example\s*$.*?^```python\n(.*?)^```", text, re.M | re.S)
+    if match is None:
+        raise SystemExit(f"{path}: no ```python block under ## Example")
+    return match.group(1)
+
+
+def collect(paths, readme):
+    programs = []
+    for path in paths:
+        if os.path.isdir(path):
+            for name in sorted(os.listdir(path)):
+                if name.endswith(".py"):
+                    programs.append((name[:-3], os.path.join(path, name), None))
+        else:
+            programs.append((os.path.splitext(os.path.basename(path))[0], path, None))
+    if readme:
+        programs.append(("readme_example", None, readme_example(readme)))
+    return programs
+
+
+def timed(command, cwd):
+    best = None
+    result = None
+    for _ in range(RUNS):
+        start = time.perf_counter()
+        result = subprocess.run(command, cwd=cwd, capture_output=True, text=True)
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+        if result.returncode != 0:
+            break
+    return result, best
+
+
+def check(name, source, args, work):
+    directory = os.path.join(work, name)
+    shutil.rmtree(directory, ignore_errors=True)
+    os.makedirs(directory)
+    script = os.path.join(directory, name + ".py")
+    cpp = os.path.join(directory, name + ".cpp")
+    with open(script, "w", encoding="utf-8") as f:
+        f.write(source)
+    return compare(name, script, [script, cpp], [cpp], directory, args)
+
+
+def check_project(name, project, args, work):
+    directory = os.path.join(work, name)
+    shutil.rmtree(directory, ignore_errors=True)
+    output = os.path.join(directory, "cpp")
+    shutil.copytree(project, directory)
+    sources = []
+    for root, _, files in os.walk(directory):
+        sources += [os.path.join(output, os.path.relpath(root, directory), f[:-3] + ".cpp")
+                    for f in files if f.endswith(".py")]
+    return compare(name, os.path.join(directory, "app.py"), ["--modules", directory, output], sorted(sources),
+                   output, args)
+
+
+def compare(name, script, translate_args, sources, directory, args):
+    binary = os.path.join(directory, name)
+    expected, python_time = timed([args.python, script], os.path.dirname(script))
+    if expected.returncode != 0:
+        return f"python3 exited with {expected.returncode}:\n{expected.stderr}"
+
+    options = ["--std-containers"] if args.std_containers else []
+    translate = subprocess.run([args.py2cpp, *options, *translate_args], capture_output=True, text=True)
+    if translate.returncode != 0:
+        return f"py2cpp exited with {translate.returncode}:\n{translate.stdout}{translate.stderr}"
+
+    flags = SANITIZE if args.sanitize else ["-O2"]
+    compile_command = [args.cxx, "-std=c++17", "-pedantic-errors", *flags, "-I", directory, *sources, "-o", binary]
+    compiled = subprocess.run(compile_command, capture_output=True, text=True)
+    if compiled.returncode != 0:
+        return f"{' '.join(compile_command)} failed:\n{compiled.stderr}"
+
+    actual, cpp_time = timed([binary], directory)
+    if actual.returncode != 0:
+        return f"{binary} exited with {actual.returncode}:\n{actual.stderr}"
+    if actual.stdout != expected.stdout:
+        diff = difflib.unified_diff(expected.stdout.splitlines(True), actual.stdout.splitlines(True),
+                                    "python3", "py2cpp")
+        return "output differs:\n" + "".join(diff)
+
+    if args.sanitize:
+        print(f"{name:<24} clean under AddressSanitizer and UBSan")
+        return None
+    speedup = python_time / cpp_time
+    print(f"{name:<24} python3 {python_time * 1000:9.1f} ms   c++ {cpp_time * 1000:9.1f} ms   "
+          f"speedup {speedup:7.1f}x")
+    if speedup < 1.0:
+        return f"the C++ build is slower than CPython ({speedup:.2f}x)"
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--py2cpp", required=True, help="py2cpp executable")
+    parser.add_argument("--cxx", default="c++", help="C++ compiler for the translated programs")
+    parser.add_argument("--python", default=sys.executable, help="Python interpreter to compare against")
+    parser.add_argument("--work", default="differential", help="Directory for translated programs and binaries")
+    parser.add_argument("--readme", help="Also test the ## Example block of this README")
+    parser.add_argument("--sanitize", action="store_true", help="Build with -fsanitize=address,undefined; skip timing")
+    parser.add_argument("--std-containers", action="store_true", help="Translate with py2cpp --std-containers")
+    parser.add_argument("--project", action="append", default=[],
+                        help="Directory of modules whose entry point is app.py; may be repeated")
+    parser.add_argument("paths", nargs="*", help=".py files and directories of them")
+    args = parser.parse_args()
+
+    programs = collect(args.paths, args.readme)
+    if not programs and not args.project:
+        parser.error("no programs to test")
+    work = os.path.abspath(args.work)
+    failures = 0
+    for name, path, source in programs:
+        if source is None:
+            with open(path, encoding="utf-8") as f:
+                source = f.read()
+        error = check(name, source, args, work)
+        if error is not None:
+            failures += 1
+            print(f"{name}: FAILED: {error}")
+    for project in args.project:
+        name = os.path.basename(os.path.normpath(project))
+        error = check_project(name, os.path.abspath(project), args, work)
+        if error is not None:
+            failures += 1
+            print(f"{name}: FAILED: {error}")
+    total = len(programs) + len(args.project)
+    print(f"{total - failures}/{total} programs match CPython")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,52 @@
+# Names bound inside if, try and for/else blocks are read after the block ends
+
+
+def sign(x):
+    if x > 0:
+        y = "pos"
+    else:
+        y = "neg"
+    return y
+
+
+def parse(text):
+    try:
+        value = int(text)
+    except ValueError:
+        value = -1
+    return value
+
+
+def first_even(xs):
+    for x in xs:
+        if x % 2 == 0:
+            found = x
+            break
+    else:
+        found = -1
+    return found
+
+
+def pair(flag):
+    if flag:
+        a, b = 1, 2
+    else:
+        a, b = 3, 4
+    return a + b
+
+
+class Box:
+    def __init__(self, v):
+        if v > 1:
+            size = "big"
+        else:
+            size = "small"
+        self.size = size
+
+
+def run():
+    print(sign(3), sign(-1), parse("12"), parse("x"), first_even([1, 3, 4]), first_even([1]))
+    print(pair(True), pair(False), Box(3).size)
+
+
+run()
@@ -0,0 +1,24 @@
+def inv(a):
+    return 100 // (3 - a)
+
+
+def square(a):
+    return a * a
+
+
+def run():
+    total = 0
+    for i in range(10):
+        if i == 3:
+            break
+        total += inv(i)
+    print(total)
+    for i in range(10):
+        if i != 3:
+            total += inv(i)
+    print(total)
+    for i in range(6):
+        print(square(i), square(i) + inv(i % 3))
+
+
+run()
@@ -0,0 +1,49 @@
+def lists():
+    xs = [3, 1, 2]
+    xs.append(5)
+    xs.extend([7, 8])
+    xs.insert(0, 9)
+    last = xs.pop()
+    first = xs.pop(0)
+    print(xs, last, first)
+    xs.remove(1)
+    print(xs.index(5), xs.count(2))
+    xs.sort()
+    print(xs)
+    xs.reverse()
+    print(xs)
+    ys = xs.copy()
+    ys.clear()
+    print(len(ys), len(xs))
+
+
+def sets():
+    s = {1, 2}
+    s.add(3)
+    s.discard(1)
+    s.discard(10)
+    s.remove(2)
+    s.update([4, 5])
+    print(len(s), 3 in s, 1 in s)
+
+
+def dicts():
+    d = {"a": 1}
+    d["b"] = 2
+    print(d.get("a"), d.get("z", 0))
+    print(d.setdefault("c", 3), d.setdefault("a", 7))
+    print(d.pop("b"), d.pop("q", -1))
+    d.update({"e": 5})
+    total = 0
+    for k in d.keys():
+        total += len(k)
+    for v in d.values():
+        total += v
+    for k, v in d.items():
+        total += v
+    print(total, len(d))
+
+
+lists()
+sets()
+dicts()
@@ -0,0 +1,36 @@
+def count_words(words):
+    counts = {}
+    for w in words:
+        counts[w] = counts.get(w, 0) + 1
+    return counts
+
+
+def unique_mod(limit, k):
+    seen = {0}
+    for i in range(limit):
+        seen.add(i % k)
+    return len(seen)
+
+
+def evens(limit):
+    out = []
+    for i in range(limit):
+        if i % 2 == 0:
+            out.append(i)
+    return out
+
+
+def main_program():
+    words = ["a", "b", "a", "c", "b", "a"]
+    print(count_words(words))
+    print(unique_mod(1000, 17))
+    values = evens(10)
+    print(values)
+    print(len(values))
+    print(values[2])
+    squares = {n: n * n for n in range(5)}
+    print(squares)
+    print(3 in squares)
+
+
+main_program()
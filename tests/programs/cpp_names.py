@@ -0,0 +1,29 @@
+# Python names that are C++ keywords, and the usual main() entry point
+
+
+class new:
+    def __init__(self, long, default=2):
+        self.long = long
+        self.default = default
+
+    def delete(self):
+        return self.long * self.default
+
+
+def switch(case, this=1):
+    auto = case + this
+    total = 0
+    for char in range(auto):
+        total += char
+    return total
+
+
+def main():
+    obj = new(3, default=4)
+    double = obj.delete()
+    std = [double, switch(5, this=2)]
+    print(std, obj.long, switch(case=1))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,25 @@
+# Decorated methods, async ones included, are parsed as ordinary definitions
+
+
+class Scale:
+    def __init__(self, factor):
+        self.factor = factor
+
+    @staticmethod
+    def double(x):
+        return x * 2
+
+    @staticmethod
+    async def fetch(x):
+        return None
+
+    def apply(self, x):
+        return self.double(x) * self.factor
+
+
+def run():
+    scale = Scale(3)
+    print(scale.apply(4), scale.double(5))
+
+
+run()
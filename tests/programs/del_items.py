@@ -0,0 +1,39 @@
+# del of dict entries and list items removes them; a missing key raises KeyError
+
+
+def drop_short(words):
+    counts = {}
+    for word in words:
+        counts[word] = len(word)
+    for word in words:
+        if word in counts and counts[word] < 4:
+            del counts[word]
+    return counts
+
+
+def trim(values):
+    del values[0]
+    del values[-1]
+    return values
+
+
+def run():
+    counts = drop_short(["apple", "fig", "kiwi", "pear", "plum", "melon", "fig"])
+    print(counts)
+    print(len(counts))
+    values = trim([1, 2, 3, 4, 5])
+    print(values)
+    stock = {"apples": 3, "pears": 5}
+    del stock["apples"]
+    print(stock)
+    try:
+        del stock["apples"]
+    except KeyError:
+        print("missing")
+    scratch = [1, 2]
+    del scratch
+    print(len(values))
+
+
+if __name__ == "__main__":
+    run()
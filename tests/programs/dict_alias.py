@@ -0,0 +1,30 @@
+def chain(n):
+    m = {}
+    m[0] = [1, 2]
+    for i in range(1, n):
+        m[i] = m[i - 1]
+    return m
+
+
+def grow(n):
+    counts = {}
+    counts["a"] = 1
+    for i in range(n):
+        counts[str(i)] = counts["a"] + i
+    return counts
+
+
+def run():
+    m = chain(60)
+    print(len(m))
+    print(m[59])
+    counts = grow(100)
+    print(counts["99"])
+    print(len(counts))
+    total = 0
+    for k, v in m.items():
+        total += v[1]
+    print(total)
+
+
+run()
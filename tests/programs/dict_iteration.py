@@ -0,0 +1,17 @@
+# Iterating a dict yields its keys, in loops and comprehensions alike
+
+
+def run():
+    prices = {"apple": 3, "pear": 5, "plum": 2}
+    total = 0
+    for name in prices:
+        total += prices[name]
+        print(name, prices[name])
+    print(total)
+    print([len(name) for name in prices])
+    print({name: prices[name] * 2 for name in prices if prices[name] > 2})
+    for name, price in prices.items():
+        print(name, price)
+
+
+run()
@@ -0,0 +1,29 @@
+# // and % round towards negative infinity, whether folded, computed at run
+# time or tabulated at compile time
+
+
+def bucket(i, width):
+    return (i - 5) // width + (i - 5) % width
+
+
+def split(total, parts):
+    return total // parts, total % parts
+
+
+def run():
+    print(7 // 2, (0 - 5) // 2, 7 // -2, (0 - 7) % 3, 7 % -3)
+    for a, b in [(7, 2), (-5, 2), (7, -2), (-7, -2), (-6, 3)]:
+        print(a // b, a % b, split(a, b))
+    print(7.5 // 2, -7.5 // 2, 7.5 % -2, -7.5 % 2.0)
+    n = -17
+    n //= 5
+    m = -17
+    m %= 5
+    x = 9.0
+    x %= -4
+    print(n, m, x)
+    for i in range(10):
+        print(bucket(i, 3))
+
+
+run()
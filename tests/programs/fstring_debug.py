@@ -0,0 +1,11 @@
+def run():
+    x = 42
+    name = "py2cpp"
+    ratio = 2.5
+    print(f"{x=}")
+    print(f"{x = }, {name=}")
+    print(f"{name=!s} {ratio=:.2f} {x + 1=}")
+    print(f"{x == 42}")
+
+
+run()
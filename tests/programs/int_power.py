@@ -0,0 +1,35 @@
+# int ** int stays an int while the exponent cannot be negative
+
+
+def powers(base, count):
+    result = []
+    for n in range(count):
+        result.append(base ** n)
+    return result
+
+
+def cube(x):
+    return x ** 3
+
+
+def run():
+    z = 2 ** 10
+    print(z, 3 ** 0, (0 - 2) ** 3)
+    print(powers(2, 8))
+    print(powers(-3, 5))
+    word = "abc"
+    n = len(word)
+    print(2 ** n, 10 ** (n + 1))
+    print(cube(4), cube(-2))
+    total = 1
+    for i in range(5):
+        total *= 2 ** i
+    print(total)
+    k = 3
+    k **= 2
+    print(k)
+    e = 0 - 2
+    print(2 ** e, 2 ** 0.5 > 1.41, 4 ** -1)
+
+
+run()
@@ -0,0 +1,71 @@
+def find(values, wanted):
+    for i in range(len(values)):
+        if values[i] == wanted:
+            print("found at", i)
+            break
+    else:
+        print("not found")
+
+
+def search_nested(rows):
+    for row in rows:
+        for x in row:
+            if x < 0:
+                break
+        else:
+            print("row ok", row)
+            continue
+        print("row has negative", row)
+
+
+def countdown(n):
+    while n > 0:
+        n -= 1
+        if n == 3:
+            print("stopped at 3")
+            break
+    else:
+        print("ran out")
+
+
+def always(n):
+    total = 0
+    for i in range(n):
+        total += i
+    else:
+        print("done", total)
+
+
+for i in range(5):
+    if i == 2:
+        break
+else:
+    print("no break")
+
+for i in range(3):
+    pass
+else:
+    print("completed")
+
+find([4, 5, 6], 5)
+find([4, 5, 6], 7)
+search_nested([[1, 2], [3, -1], [5]])
+countdown(6)
+countdown(2)
+always(4)
+
+
+def twice(values):
+    for v in values:
+        if v > 2:
+            break
+    else:
+        print("none above 2")
+    for v in values:
+        if v > 10:
+            break
+    else:
+        print("none above 10")
+
+
+twice([1, 2, 3])
@@ -0,0 +1,37 @@
+def f():
+    print("in f")
+    return 3
+
+
+class Counter:
+    def __init__(self, start):
+        self.count = start
+
+    def bump(self):
+        self.count += 1
+        return self.count
+
+
+print("start")
+x = f()
+print(x)
+x = 10
+print(x)
+limit: int = 5
+names = ["a", "b"]
+names.append("c")
+counter = Counter(limit)
+if x > 5:
+    mode = "big"
+else:
+    mode = "small"
+
+
+def report():
+    return mode + " " + str(x) + " " + str(len(names)) + " " + str(counter.bump())
+
+
+a, b = 1, 2
+a, b = b, a
+print(report())
+print(a, b, limit)
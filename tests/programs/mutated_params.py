@@ -0,0 +1,90 @@
+# Lists, dicts, sets and objects a function changes in place are changed for
+# the caller too, as they are shared in Python
+
+
+class Person:
+    def __init__(self, name, age):
+        self.name = name
+        self.age = age
+
+    def birthday(self):
+        self.age += 1
+
+
+def age(p):
+    p.age += 1
+
+
+def celebrate(p):
+    p.birthday()
+
+
+def add_all(xs, values):
+    for v in values:
+        xs.append(v)
+
+
+def forward(xs, v):
+    add_all(xs, [v, v])
+
+
+def count(counts, word):
+    counts[word] = counts.get(word, 0) + 1
+
+
+def remember(seen, item):
+    seen.add(item)
+
+
+def age_all(people):
+    for p in people:
+        age(p)
+
+
+def rebinds(xs):
+    xs = [0]
+    xs.append(1)
+    return xs
+
+
+def total(xs):
+    result = 0
+    for x in xs:
+        result += x
+    return result
+
+
+def run():
+    bob = Person("bob", 30)
+    age(bob)
+    celebrate(bob)
+    print(bob.age)
+
+    xs = [1]
+    add_all(xs, [2, 3])
+    forward(xs, 4)
+    add_all([9], [10])
+    print(xs, total(xs))
+
+    counts = {"z": 0}
+    for word in "a b a c a".split():
+        count(counts, word)
+    print(counts)
+
+    seen = {0}
+    remember(seen, 5)
+    remember(seen, 5)
+    print(len(seen))
+
+    people = [Person("ann", 1), Person("cy", 2)]
+    age_all(people)
+    for p in people:
+        celebrate(p)
+    print([p.age for p in people])
+
+    ys = [7]
+    print(rebinds(ys), ys)
+    celebrate(Person("dee", 40))
+
+
+run()
@@ -0,0 +1,23 @@
+def last(xs):
+    return xs[-1]
+
+
+def run():
+    xs = [3, 1, 4, 1, 5, 9, 2, 6]
+    print(xs[-1], xs[-2], last(xs))
+    xs[-1] = 7
+    xs[-3] += 10
+    print(xs)
+    k = 0
+    for i in range(len(xs)):
+        k = i - len(xs)
+        print(xs[k], xs[i])
+    grid = [[1, 2], [3, 4]]
+    print(grid[-1][-2])
+    try:
+        print(xs[-9])
+    except IndexError:
+        print("IndexError")
+
+
+run()
@@ -0,0 +1,26 @@
+# A number or string that may be None keeps None, and mixed displays keep each
+# element's own type
+
+
+def maybe(flag):
+    if flag:
+        return 1
+    return None
+
+
+def label(r):
+    name = None
+    if r is None:
+        name = "none"
+    return name
+
+
+def run():
+    r = maybe(False)
+    print(maybe(True), r)
+    print(r is None, maybe(True) is not None)
+    print(label(r), label(maybe(True)))
+    print([1, 2.5], [True, 1], {"a": 1, "b": 0.5})
+
+
+run()
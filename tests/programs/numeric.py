@@ -0,0 +1,34 @@
+def collatz_steps(n):
+    steps = 0
+    while n != 1:
+        if n % 2 == 0:
+            n = n // 2
+        else:
+            n = 3 * n + 1
+        steps += 1
+    return steps
+
+
+def weighted_sum(limit):
+    total = 0
+    for i in range(limit):
+        total += i * i % 7
+    return total
+
+
+def longest_chain(limit):
+    best = 0
+    best_start = 1
+    for start in range(1, limit):
+        steps = collatz_steps(start)
+        if steps > best:
+            best = steps
+            best_start = start
+    return best_start, best
+
+
+print(weighted_sum(2000000))
+print(longest_chain(100000))
+ratio = 7 / 2
+print(ratio)
+print(2.5 * 4)
@@ -0,0 +1,12 @@
+import sys
+
+
+def run():
+    print("to stdout")
+    print("to stderr", file=sys.stderr)
+    print("a", "b", sep="-", file=sys.stdout)
+    print("warning:", 3, sep=" ", end="!\n", file=sys.stderr)
+    print("done", flush=True)
+
+
+run()
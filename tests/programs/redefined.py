@@ -0,0 +1,31 @@
+# A later def replaces an earlier one of the same name, even with fewer parameters
+
+
+def area(width, height=1):
+    return width * height
+
+
+
+def area(side):
+    return side * side
+
+
+class Counter:
+    def __init__(self):
+        self.count = 0
+
+    def bump(self, step, times=1):
+        self.count += step * times
+
+    def bump(self, step):
+        self.count += step
+
+
+def run():
+    counter = Counter()
+    counter.bump(5)
+    counter.bump(2)
+    print(area(6), counter.count)
+
+
+run()
@@ -0,0 +1,36 @@
+def build(numbers):
+    d = {str(n): n for n in numbers}
+    return d
+
+def concat(words):
+    s = ""
+    for w in words:
+        s += w
+        s += ","
+    return s
+
+def joined(words):
+    return "-".join(words)
+
+def fields(line):
+    parts = line.split(",")
+    return len(parts)
+
+def fields2(line):
+    total = 0
+    for p in line.split():
+        total += len(p)
+    return total
+
+def run():
+    nums = [1, 2, 30, -4]
+    print(build(nums))
+    print(concat(["a", "b", "c"]))
+    print(joined(["x", "y"]))
+    print(fields("a,b,,c"))
+    print(fields2("  ab  cd e "))
+    print(str(42) + "!")
+    labels = [str(i) for i in range(5)]
+    print(", ".join(labels))
+
+run()
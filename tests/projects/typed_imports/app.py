@@ -0,0 +1,25 @@
+# Parameter and member types of pkg.util come from the calls made here
+import pkg.util
+import pkg.util as u
+from pkg import util
+from pkg.util import Square as Sq
+from pkg.util import greet, scale
+
+
+def make(n):
+    return util.Square(n)
+
+
+def total(first, second):
+    return first.area() + second.area()
+
+
+print(greet("bob"))
+print(pkg.util.greet("ann") + "!")
+print(scale(4))
+print(u.scale(7))
+print(u.power(2, 5))
+square = make(4)
+print(square.area())
+print(square.side * 2)
+print(total(square, Sq(5)))
@@ -0,0 +1,26 @@
+# Nothing here says what these parameters are; the calls in app.py do
+
+
+def scale(x):
+    return x * 3
+
+
+def power(base, exponent):
+    return base ** exponent
+
+
+def greet(name):
+    return "hello " + name
+
+
+class Square:
+    def __init__(self, side):
+        self.side = side
+
+    def area(self):
+        return self.side * self.side
+
+
+# Nothing calls this, so its parameter is left to the C++ compiler
+def twice(value):
+    return value + value
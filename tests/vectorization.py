@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""Check that GCC still vectorizes a translated range() loop.
+
+The program is translated with py2cpp and compiled with -O3 -fopt-info-vec.
+The test fails unless GCC reports "loop vectorized" for the C++ loop whose
+body contains the marker statement (by default the `total += numbers[i]`
+loop of test.py).
+"""
+
+import argparse
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+
+def loop_line(cpp, marker):
+    with open(cpp, encoding="utf-8") as f:
+        lines = f.read().splitlines()
+    for index, line in enumerate(lines):
+        if marker in line:
+            for start in range(index, -1, -1):
+                if lines[start].lstrip().startswith("for ("):
+                    return start + 1, lines[start].strip()
+    return None, None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--py2cpp", required=True, help="py2cpp executable")
+    parser.add_argument("--cxx", default="g++", help="GCC to compile the translated program with")
+    parser.add_argument("--work", default="vectorization", help="Directory for the translated program")
+    parser.add_argument("--marker", default="total += ", help="Text in the body of the loop to check")
+    parser.add_argument("program", help="Python program to translate")
+    args = parser.parse_args()
+
+    work = os.path.abspath(args.work)
+    shutil.rmtree(work, ignore_errors=True)
+    os.makedirs(work)
+    name = os.path.splitext(os.path.basename(args.program))[0]
+    cpp = os.path.join(work, name + ".cpp")
+    shutil.copy(args.program, os.path.join(work, name + ".py"))
+
+    translate = subprocess.run([args.py2cpp, os.path.join(work, name + ".py"), cpp], capture_output=True, text=True)
+    if translate.returncode != 0:
+        print(f"py2cpp exited with {translate.returncode}:\n{translate.stdout}{translate.stderr}")
+        return 1
+
+    line, loop = loop_line(cpp, args.marker)
+    if line is None:
+        print(f"{cpp}: no for loop around '{args.marker}'")
+        return 1
+
+    command = [args.cxx, "-std=c++17", "-O3", "-fopt-info-vec", "-I", work, "-c", cpp,
+               "-o", os.path.join(work, name + ".o")]
+    compiled = subprocess.run(command, capture_output=True, text=True)
+    if compiled.returncode != 0:
+        print(f"{' '.join(command)} failed:\n{compiled.stderr}")
+        return 1
+
+    remark = re.compile(re.escape(os.path.basename(cpp)) + rf":{line}:\d+: optimized: loop vectorized")
+    for message in compiled.stderr.splitlines():
+        if remark.search(message):
+            print(f"{name}.cpp:{line} `{loop}`: {message.split('optimized: ', 1)[1]}")
+            return 0
+    print(f"{name}.cpp:{line} `{loop}` is no longer vectorized; -fopt-info-vec reported:")
+    print(compiled.stderr or "(nothing)")
+    return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size thread pool with one task deque per worker. A worker runs its own
+// tasks newest first and, when it runs dry, steals the oldest task from another
+// worker, so uneven file sizes do not leave cores idle at the end of a batch.
+class WorkStealingPool {
+public:
+    struct WorkerStats {
+        double busySeconds;
+        size_t tasks;
+        size_t stolen;
+    };
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+        std::chrono::steady_clock::duration busy{0};
+        size_t executed = 0;
+        size_t stolen = 0;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::mutex stateMutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::atomic<size_t> queued{0};
+    size_t pending = 0;
+    size_t nextWorker = 0;
+    bool stopping = false;
+
+    bool popLocal(size_t index, std::function<void()>& task) {
+        Worker& worker = *workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.tasks.empty()) {
+            return false;
+        }
+        task = std::move(worker.tasks.back());
+        worker.tasks.pop_back();
+        return true;
+    }
+
+    bool steal(size_t thief, std::function<void()>& task) {
+        for (size_t offset = 1; offset < workers.size(); ++offset) {
+            Worker& victim = *workers[(thief + offset) % workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(size_t index) {
+        Worker& self = *workers[index];
+        std::function<void()> task;
+        while (true) {
+            bool local = popLocal(index, task);
+            if (local || steal(index, task)) {
+                --queued;
+                auto start = std::chrono::steady_clock::now();
+                task();
+                task = nullptr;
+                self.busy += std::chrono::steady_clock::now() - start;
+                ++self.executed;
+                if (!local) {
+                    ++self.stolen;
+                }
+
+                std::lock_guard<std::mutex> lock(stateMutex);
+                if (--pending == 0) {
+                    idle.notify_all();
+                }
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(stateMutex);
+            wake.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping && queued == 0) {
+                return;
+            }
+        }
+    }
+
+public:
+    explicit WorkStealingPool(size_t threadCount) {
+        if (threadCount == 0) {
+            threadCount = 1;
+        }
+        for (size_t i = 0; i < threadCount; ++i) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+        for (size_t i = 0; i < threadCount; ++i) {
+            threads.emplace_back([this, i] { run(i); });
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Queues a task on the workers round-robin; idle workers steal the rest
+    void submit(std::function<void()> task) {
+        size_t index;
+        {
+            // Counted under the state lock so a worker about to sleep cannot miss it
+            std::lock_guard<std::mutex> lock(stateMutex);
+            index = nextWorker;
+            nextWorker = (nextWorker + 1) % workers.size();
+            ++pending;
+            ++queued;
+        }
+        {
+            std::lock_guard<std::mutex> lock(workers[index]->mutex);
+            workers[index]->tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+    // Blocks until every submitted task has finished
+    void wait() {
+        std::unique_lock<std::mutex> lock(stateMutex);
+        idle.wait(lock, [this] { return pending == 0; });
+    }
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    // Only meaningful after wait() returned
+    std::vector<WorkerStats> stats() const {
+        std::vector<WorkerStats> result;
+        for (const auto& worker : workers) {
+            result.push_back({std::chrono::duration<double>(worker->busy).count(), worker->executed, worker->stolen});
+        }
+        return result;
+    }
+};
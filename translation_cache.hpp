@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+
+#include "file_io.hpp"
+
+// On-disk cache of translated files. Entries are keyed by a hash of the input
+// bytes together with the translator version and options, so a file whose
+// content did not change is never decompiled again. Entries are written to a
+// temporary name and renamed into place, which keeps concurrent workers (or
+// concurrent py2cpp processes sharing the directory) from seeing partial files.
+class TranslationCache {
+private:
+    std::filesystem::path directory;
+    std::string salt;
+    std::atomic<size_t> hitCount{0};
+    std::atomic<size_t> missCount{0};
+
+    static uint64_t fnv1a(std::string_view data, uint64_t h) {
+        for (char c : data) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    std::filesystem::path temporaryPath(const std::string& cacheKey, const std::string& source) const {
+        std::ostringstream suffix;
+        suffix << ".tmp" << std::this_thread::get_id() << '-' << std::hash<std::string>{}(source);
+        return directory / (cacheKey + suffix.str());
+    }
+
+    // Renames a fully written temporary entry into place, or drops it after `ec`
+    void commit(const std::string& cacheKey, const std::filesystem::path& temporary, std::error_code ec) {
+        if (!ec) {
+            std::filesystem::rename(temporary, directory / (cacheKey + ".cpp"), ec);
+        }
+        if (ec) {
+            std::filesystem::remove(temporary, ec);
+        }
+    }
+
+public:
+    TranslationCache(std::filesystem::path dir, std::string_view version, std::string_view options)
+        : directory(std::move(dir)) {
+        salt = std::string(version) + '\0' + std::string(options) + '\0';
+    }
+
+    bool open(std::string& error) {
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec) {
+            error = "Could not create cache directory " + directory.string() + ": " + ec.message();
+            return false;
+        }
+        return true;
+    }
+
+    // Two independent 64-bit hashes plus the length; collisions are not a practical concern
+    std::string key(std::string_view input) const {
+        uint64_t first = fnv1a(input, fnv1a(salt, 1469598103934665603ull));
+        uint64_t second = fnv1a(salt, fnv1a(input, 0x84222325cbf29ce4ull));
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "%016llx%016llx-%zx", static_cast<unsigned long long>(first),
+                      static_cast<unsigned long long>(second), input.size());
+        return buffer;
+    }
+
+    // Places the cached translation at outputPath, hard-linking when the file
+    // system allows it and copying otherwise. Returns false on a miss.
+    bool fetch(const std::string& cacheKey, const std::filesystem::path& outputPath, size_t& outputSize) {
+        std::filesystem::path entry = directory / (cacheKey + ".cpp");
+        std::error_code ec;
+        outputSize = static_cast<size_t>(std::filesystem::file_size(entry, ec));
+        if (ec) {
+            ++missCount;
+            return false;
+        }
+        std::filesystem::remove(outputPath, ec);
+        std::filesystem::create_hard_link(entry, outputPath, ec);
+        if (ec) {
+            ec.clear();
+            std::filesystem::copy_file(entry, outputPath, std::filesystem::copy_options::overwrite_existing, ec);
+        }
+        if (ec) {
+            ++missCount;
+            return false;
+        }
+        ++hitCount;
+        return true;
+    }
+
+    // Replaces `text` with the cached translation. Returns false on a miss.
+    bool load(const std::string& cacheKey, std::string& text) {
+        MappedFile entry;
+        if (!entry.open((directory / (cacheKey + ".cpp")).string())) {
+            ++missCount;
+            return false;
+        }
+        text.assign(entry.view());
+        ++hitCount;
+        return true;
+    }
+
+    // Copies a finished translation into the cache. Best effort: a failed store
+    // only costs a later retranslation.
+    void store(const std::string& cacheKey, const std::filesystem::path& translatedFile) {
+        std::filesystem::path temporary = temporaryPath(cacheKey, translatedFile.string());
+        std::error_code ec;
+        std::filesystem::copy_file(translatedFile, temporary, std::filesystem::copy_options::overwrite_existing, ec);
+        commit(cacheKey, temporary, ec);
+    }
+
+    // Same for a translation that only exists in memory
+    void storeText(const std::string& cacheKey, std::string_view text) {
+        std::filesystem::path temporary = temporaryPath(cacheKey, "memory");
+        FileSink entry;
+        std::error_code ec;
+        if (entry.open(temporary.string())) {
+            entry.write(text);
+            if (!entry.close()) {
+                ec = std::make_error_code(std::errc::io_error);
+            }
+        } else {
+            ec = std::make_error_code(std::errc::io_error);
+        }
+        commit(cacheKey, temporary, ec);
+    }
+
+    size_t hits() const {
+        return hitCount;
+    }
+
+    size_t misses() const {
+        return missCount;
+    }
+};
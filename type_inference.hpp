@@ -0,0 +1,1502 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "profiler.hpp"
+#include "python_ast.hpp"
+
+enum class TypeKind : uint8_t {
+    Unknown,  // Nothing observed yet
+    Auto,     // Left to C++ type deduction, e.g. the result of a call into a module we do not model
+    None,
+    Bool,
+    Int,
+    Float,
+    Str,
+    List,
+    Set,
+    Dict,
+    Tuple,
+    Class,
+    Dynamic   // Holds values of unrelated types; lowered to the tagged value type
+};
+
+struct Type {
+    TypeKind kind;
+    std::string_view name;          // Class name, or kNonNegative on an int
+    std::vector<const Type*> args;  // Element, key and value, or tuple member types
+    int depth;
+};
+
+// Owns every Type and hands out one instance per distinct type, so types can
+// be compared by pointer.
+class TypeTable {
+private:
+    static constexpr int kMaxDepth = 4;
+
+    std::deque<Type> storage;
+    std::unordered_map<std::string, const Type*> index;
+    const Type* scalars[static_cast<int>(TypeKind::Dynamic) + 1] = {};
+
+public:
+    TypeTable() {
+        for (int kind = 0; kind <= static_cast<int>(TypeKind::Dynamic); ++kind) {
+            storage.push_back(Type{static_cast<TypeKind>(kind), {}, {}, 0});
+            scalars[kind] = &storage.back();
+        }
+    }
+
+    TypeTable(const TypeTable&) = delete;
+    TypeTable& operator=(const TypeTable&) = delete;
+
+    const Type* get(TypeKind kind) const {
+        return scalars[static_cast<int>(kind)];
+    }
+
+    // Nesting is capped so self-referential containers (x = [x]) still converge
+    const Type* get(TypeKind kind, std::vector<const Type*> args, std::string_view name = {}) {
+        int depth = 0;
+        for (const Type* arg : args) {
+            depth = std::max(depth, arg->depth + 1);
+        }
+        if (depth > kMaxDepth) {
+            return get(TypeKind::Dynamic);
+        }
+        std::string key(1, static_cast<char>(kind));
+        key += name;
+        key += '\0';
+        key.append(reinterpret_cast<const char*>(args.data()), args.size() * sizeof(const Type*));
+        auto it = index.find(key);
+        if (it != index.end()) {
+            return it->second;
+        }
+        storage.push_back(Type{kind, name, std::move(args), depth});
+        index.emplace(std::move(key), &storage.back());
+        return &storage.back();
+    }
+};
+
+// Whole-module type inference. Types flow from literals, annotations and
+// container operations into variables, from call sites into parameters and
+// from return statements into results; the module is walked repeatedly until
+// nothing changes. The decompiler then asks for the C++ spelling of each
+// declaration instead of writing `auto`.
+class TypeInference {
+public:
+    // Spelling of the tagged value type used where a type is truly dynamic
+    static constexpr const char* kValueType = "PyValue";
+    // Marks the int type of values known not to be negative (literals, len(),
+    // range() indices), which keep int ** int an int
+    static constexpr std::string_view kNonNegative = "+";
+
+    enum class TypeUse { Variable, Return, Parameter, Element };
+
+    // Variables of one scope in first-assignment order. Names come from the
+    // parser's interner, so they are looked up by their data pointer.
+    struct VarTypes {
+        std::vector<std::pair<std::string_view, const Type*>> entries;
+        std::unordered_map<const char*, size_t> index;
+
+        const Type* find(std::string_view name) const {
+            auto it = index.find(name.data());
+            return it != index.end() ? entries[it->second].second : nullptr;
+        }
+
+        const Type*& slot(std::string_view name, const Type* initial) {
+            auto it = index.find(name.data());
+            if (it != index.end()) {
+                return entries[it->second].second;
+            }
+            index.emplace(name.data(), entries.size());
+            entries.emplace_back(name, initial);
+            return entries.back().second;
+        }
+
+        void erase(std::string_view name) {
+            auto it = index.find(name.data());
+            if (it == index.end()) {
+                return;
+            }
+            entries.erase(entries.begin() + static_cast<std::ptrdiff_t>(it->second));
+            index.clear();
+            for (size_t i = 0; i < entries.size(); ++i) {
+                index.emplace(entries[i].first.data(), i);
+            }
+        }
+    };
+
+    struct ClassTypes;
+
+    struct FunctionTypes {
+        std::vector<std::string_view> paramNames;
+        std::vector<const Type*> params;
+        std::vector<char> pinned;  // Fully annotated parameters keep their declared type
+        const Type* returns = nullptr;
+        bool returnsPinned = false;
+        bool returnsValue = false;
+        bool isStatic = false;
+        bool isClassMethod = false;
+        // Already generated in streaming mode; later call sites cannot change it
+        bool sealed = false;
+        VarTypes locals;
+        ClassTypes* owner = nullptr;
+        const FunctionDef* def = nullptr;  // Null for functions imported from another module
+    };
+
+    struct ClassTypes {
+        std::string_view name;
+        std::string_view baseName;
+        ClassTypes* base = nullptr;
+        VarTypes fields;
+        FunctionTypes statics;  // Class-level attributes
+        std::unordered_map<std::string_view, FunctionTypes> methods;
+    };
+
+private:
+    static constexpr int kMaxPasses = 8;
+
+    bool stdContainers = false;  // Spell containers as std::vector/set/map instead of the runtime's
+
+    // Annotation names; Optional[T] is T, since None has no C++ value of its own
+    static inline const std::map<std::string, TypeKind, std::less<>> typeMap = {
+        {"int", TypeKind::Int},
+        {"str", TypeKind::Str},
+        {"float", TypeKind::Float},
+        {"bool", TypeKind::Bool},
+        {"list", TypeKind::List},
+        {"List", TypeKind::List},
+        {"dict", TypeKind::Dict},
+        {"Dict", TypeKind::Dict},
+        {"set", TypeKind::Set},
+        {"Set", TypeKind::Set},
+        {"tuple", TypeKind::Tuple},
+        {"Tuple", TypeKind::Tuple},
+        {"None", TypeKind::None},
+        {"Any", TypeKind::Dynamic},
+        {"object", TypeKind::Dynamic}
+    };
+
+    TypeTable table;
+    std::unordered_map<std::string_view, FunctionTypes> functions;
+    std::unordered_map<std::string_view, ClassTypes> classes;
+    // --modules: `util.f` as written at a call site, to the key of the import
+    // it calls in `functions` or `classes`
+    std::unordered_map<std::string, std::string_view> importedCalls;
+    FunctionTypes moduleTypes;
+    FunctionTypes* fn = &moduleTypes;
+    // Walking a nested def, whose returns belong to the lambda it becomes
+    int nestedDepth = 0;
+    // Only the analysis passes record what they see; lookups from the code
+    // generator leave every table as it is
+    bool recording = false;
+    bool changed = false;
+
+    const Type* get(TypeKind kind) const {
+        return table.get(kind);
+    }
+
+    const Type* classType(std::string_view name) {
+        return table.get(TypeKind::Class, {}, name);
+    }
+
+    static bool isNumeric(const Type* t) {
+        return t->kind == TypeKind::Bool || t->kind == TypeKind::Int || t->kind == TypeKind::Float;
+    }
+
+    const Type* nonNegativeInt() {
+        return table.get(TypeKind::Int, {}, kNonNegative);
+    }
+
+    static bool isNonNegative(const Type* t) {
+        return t->kind == TypeKind::Bool || (t->kind == TypeKind::Int && t->name == kNonNegative);
+    }
+
+    static bool isIntegral(const Type* t) {
+        return t->kind == TypeKind::Bool || t->kind == TypeKind::Int;
+    }
+
+    static bool isContainer(TypeKind kind) {
+        return kind == TypeKind::List || kind == TypeKind::Set || kind == TypeKind::Dict || kind == TypeKind::Tuple;
+    }
+
+    // True once nothing inside the type is still waiting to be observed
+    static bool complete(const Type* t) {
+        if (t->kind == TypeKind::Unknown) {
+            return false;
+        }
+        return std::all_of(t->args.begin(), t->args.end(), complete);
+    }
+
+    const Type* join(const Type* a, const Type* b) {
+        if (a == b || b->kind == TypeKind::Unknown) {
+            return a;
+        }
+        if (a->kind == TypeKind::Unknown) {
+            return b;
+        }
+        if (a->kind == TypeKind::Dynamic || b->kind == TypeKind::Dynamic) {
+            return get(TypeKind::Dynamic);
+        }
+        if (a->kind == TypeKind::Auto || b->kind == TypeKind::Auto) {
+            return get(TypeKind::Auto);
+        }
+        if (a->kind == TypeKind::None || b->kind == TypeKind::None) {
+            // A scalar that may be None needs the tagged value type; containers
+            // and objects cannot be held there and take None as their empty value
+            const Type* other = a->kind == TypeKind::None ? b : a;
+            return isNumeric(other) || other->kind == TypeKind::Str ? get(TypeKind::Dynamic) : other;
+        }
+        if (isNumeric(a) && isNumeric(b)) {
+            return get(std::max(a->kind, b->kind));
+        }
+        if (a->kind == b->kind && isContainer(a->kind) && a->args.size() == b->args.size()) {
+            std::vector<const Type*> args(a->args.size());
+            for (size_t i = 0; i < args.size(); ++i) {
+                args[i] = join(a->args[i], b->args[i]);
+            }
+            return table.get(a->kind, std::move(args));
+        }
+        return get(TypeKind::Dynamic);
+    }
+
+    void update(const Type*& slot, const Type* t) {
+        const Type* joined = join(slot, t);
+        if (joined != slot) {
+            slot = joined;
+            changed = true;
+        }
+    }
+
+    void update(VarTypes& vars, std::string_view name, const Type* t) {
+        if (!recording) {
+            return;
+        }
+        update(vars.slot(name, get(TypeKind::Unknown)), t);
+    }
+
+    // Elements of one display keep their own types: an int stored next to a
+    // float or a bool would print as one once converted
+    const Type* joinElements(const Type* a, const Type* b) {
+        if (isNumeric(a) && isNumeric(b) && a->kind != b->kind) {
+            return get(TypeKind::Dynamic);
+        }
+        return join(a, b);
+    }
+
+    const Type* elementOf(const Type* t) {
+        switch (t->kind) {
+            case TypeKind::List:
+            case TypeKind::Set:
+            case TypeKind::Dict:
+                return t->args[0];
+            case TypeKind::Str:
+                return t;
+            case TypeKind::Tuple: {
+                const Type* element = get(TypeKind::Unknown);
+                for (const Type* arg : t->args) {
+                    element = join(element, arg);
+                }
+                return element;
+            }
+            case TypeKind::Unknown:
+                return t;
+            default:
+                return get(TypeKind::Auto);
+        }
+    }
+
+    // `latest`, the entry for def's name, unless a later def replaced def
+    static FunctionTypes* ownTypes(FunctionTypes* latest, const FunctionDef* def) {
+        return latest != nullptr && latest->def == def ? latest : nullptr;
+    }
+
+    ClassTypes* findClass(const Type* t) {
+        if (t->kind != TypeKind::Class) {
+            return nullptr;
+        }
+        auto it = classes.find(t->name);
+        return it != classes.end() ? &it->second : nullptr;
+    }
+
+    FunctionTypes* findMethod(ClassTypes* cls, std::string_view name) {
+        for (; cls != nullptr; cls = cls->base) {
+            auto it = cls->methods.find(name);
+            if (it != cls->methods.end()) {
+                return &it->second;
+            }
+        }
+        return nullptr;
+    }
+
+    const Type* fieldType(ClassTypes* cls, std::string_view name) {
+        for (; cls != nullptr; cls = cls->base) {
+            if (const Type* t = cls->fields.find(name)) {
+                return t;
+            }
+            if (const Type* t = cls->statics.locals.find(name)) {
+                return t;
+            }
+        }
+        return get(TypeKind::Unknown);
+    }
+
+    const Type* lookup(std::string_view name) {
+        if (const Type* t = fn->locals.find(name)) {
+            return t;
+        }
+        if (const Type* t = moduleTypes.locals.find(name)) {
+            return t;
+        }
+        return get(TypeKind::Auto);
+    }
+
+    const Type* numberType(std::string_view text) {
+        if (text.size() > 1 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+            return get(TypeKind::Int);
+        }
+        if (text.find_first_of("jJ") != std::string_view::npos) {
+            return get(TypeKind::Auto);
+        }
+        return text.find_first_of(".eE") != std::string_view::npos ? get(TypeKind::Float) : nonNegativeInt();
+    }
+
+    // Result type of the C++ the decompiler emits for `left op right`
+    const Type* binaryType(std::string_view op, const Type* left, const Type* right) {
+        if (left->kind == TypeKind::Unknown || right->kind == TypeKind::Unknown) {
+            return get(TypeKind::Unknown);
+        }
+        if (left->kind == TypeKind::Dynamic || right->kind == TypeKind::Dynamic) {
+            return get(TypeKind::Dynamic);
+        }
+        bool numeric = isNumeric(left) && isNumeric(right);
+        bool integral = isIntegral(left) && isIntegral(right);
+        if (op == "**" && integral && isNonNegative(right)) {
+            return isNonNegative(left) ? nonNegativeInt() : get(TypeKind::Int);
+        }
+        if (op == "/" || op == "**") {
+            return numeric ? get(TypeKind::Float) : get(TypeKind::Auto);
+        }
+        if (integral && isNonNegative(right) && (op == "%" || ((op == "+" || op == "*" || op == "//") &&
+                                                               isNonNegative(left)))) {
+            return nonNegativeInt();
+        }
+        if (numeric) {
+            if (op == "&" || op == "|" || op == "^") {
+                return left->kind == TypeKind::Bool && right->kind == TypeKind::Bool ? left : get(TypeKind::Int);
+            }
+            if (op == "<<" || op == ">>") {
+                return get(TypeKind::Int);
+            }
+            return get(std::max({TypeKind::Int, left->kind, right->kind}));
+        }
+        if (op == "+" && left->kind == right->kind && (left->kind == TypeKind::Str || left->kind == TypeKind::List)) {
+            return join(left, right);
+        }
+        if (op == "*" && (left->kind == TypeKind::Str || left->kind == TypeKind::List) && isNumeric(right)) {
+            return left;
+        }
+        if (op == "*" && (right->kind == TypeKind::Str || right->kind == TypeKind::List) && isNumeric(left)) {
+            return right;
+        }
+        if (op == "%" && left->kind == TypeKind::Str) {
+            return left;
+        }
+        if ((op == "|" || op == "&" || op == "-" || op == "^") && left->kind == TypeKind::Set &&
+            right->kind == TypeKind::Set) {
+            return join(left, right);
+        }
+        return get(TypeKind::Auto);
+    }
+
+    // Records `t` flowing into an assignable expression
+    void assign(const Expr* target, const Type* t) {
+        switch (target->kind) {
+            case ExprKind::Name:
+                update(fn->locals, static_cast<const NameExpr*>(target)->id, t);
+                break;
+            case ExprKind::Tuple:
+            case ExprKind::List: {
+                const NodeList<Expr*>& elements = static_cast<const SequenceExpr*>(target)->elements;
+                bool unpacked = t->kind == TypeKind::Tuple && t->args.size() == elements.size();
+                const Type* element = unpacked ? nullptr : elementOf(t);
+                for (size_t i = 0; i < elements.size(); ++i) {
+                    if (elements[i]->kind == ExprKind::Starred) {
+                        assign(static_cast<const StarredExpr*>(elements[i])->value, get(TypeKind::Auto));
+                    } else {
+                        assign(elements[i], unpacked ? t->args[i] : element);
+                    }
+                }
+                break;
+            }
+            case ExprKind::Attribute: {
+                auto* attr = static_cast<const AttributeExpr*>(target);
+                if (attr->value->kind != ExprKind::Name || static_cast<const NameExpr*>(attr->value)->id != "self" ||
+                    fn->owner == nullptr) {
+                    typeOf(attr->value);
+                    break;
+                }
+                // An attribute first set in a base class stays a member of the base
+                ClassTypes* holder = fn->owner;
+                for (ClassTypes* cls = fn->owner; cls != nullptr; cls = cls->base) {
+                    if (cls->fields.find(attr->attr) != nullptr) {
+                        holder = cls;
+                        break;
+                    }
+                }
+                update(holder->fields, attr->attr, t);
+                break;
+            }
+            case ExprKind::Subscript: {
+                auto* sub = static_cast<const SubscriptExpr*>(target);
+                const Type* container = typeOf(sub->value);
+                const Type* key = typeOf(sub->index);
+                if (container->kind == TypeKind::List) {
+                    assign(sub->value, table.get(TypeKind::List, {t}));
+                } else if (container->kind == TypeKind::Dict || container->kind == TypeKind::Unknown) {
+                    assign(sub->value, table.get(TypeKind::Dict, {key, t}));
+                }
+                break;
+            }
+            default:
+                typeOf(target);
+                break;
+        }
+    }
+
+    // Joins the argument types of a call into the callee's parameters
+    void propagate(FunctionTypes* callee, const CallExpr* call, const std::vector<const Type*>& argTypes,
+                   size_t offset) {
+        if (callee == nullptr || callee->sealed || !recording) {
+            return;
+        }
+        size_t position = offset;
+        for (size_t i = 0; i < call->args.size(); ++i) {
+            const Expr* arg = call->args[i];
+            if (arg->kind == ExprKind::Starred) {
+                break;
+            }
+            size_t param = position;
+            if (arg->kind == ExprKind::Keyword) {
+                std::string_view name = static_cast<const KeywordExpr*>(arg)->name;
+                auto it = std::find(callee->paramNames.begin(), callee->paramNames.end(), name);
+                param = it != callee->paramNames.end() ? static_cast<size_t>(it - callee->paramNames.begin())
+                                                       : callee->params.size();
+            } else {
+                ++position;
+            }
+            if (param < callee->params.size() && !callee->pinned[param]) {
+                update(callee->params[param], argTypes[i]);
+            }
+        }
+    }
+
+    const Type* builtinCallType(std::string_view name, const std::vector<const Type*>& args, bool& known) {
+        known = true;
+        const Type* first = args.empty() ? get(TypeKind::Unknown) : args[0];
+        if (name == "print") {
+            return get(TypeKind::None);
+        }
+        if (name == "len" || name == "ord") {
+            return nonNegativeInt();
+        }
+        if (name == "hash" || name == "int") {
+            return get(TypeKind::Int);
+        }
+        if (name == "float") {
+            return get(TypeKind::Float);
+        }
+        if (name == "str" || name == "repr" || name == "input" || name == "chr" || name == "hex" || name == "bin") {
+            return get(TypeKind::Str);
+        }
+        if (name == "bool" || name == "isinstance" || name == "any" || name == "all" || name == "callable" ||
+            name == "hasattr") {
+            return get(TypeKind::Bool);
+        }
+        if (name == "abs") {
+            return isIntegral(first) ? nonNegativeInt() : first;
+        }
+        if (name == "round") {
+            return get(args.size() > 1 ? TypeKind::Float : TypeKind::Int);
+        }
+        if (name == "range") {
+            // Counting up from a non-negative start, or down to a non-negative stop
+            bool nonNegative = args.size() < 2 ||
+                               (isNonNegative(args[0]) &&
+                                (args.size() < 3 || isNonNegative(args[1]) || isNonNegative(args[2])));
+            return table.get(TypeKind::List, {nonNegative ? nonNegativeInt() : get(TypeKind::Int)});
+        }
+        if (name == "list" || name == "sorted" || name == "reversed") {
+            return table.get(TypeKind::List, {args.empty() ? get(TypeKind::Unknown) : elementOf(first)});
+        }
+        if (name == "set") {
+            return table.get(TypeKind::Set, {args.empty() ? get(TypeKind::Unknown) : elementOf(first)});
+        }
+        if (name == "dict" && args.empty()) {
+            return table.get(TypeKind::Dict, {get(TypeKind::Unknown), get(TypeKind::Unknown)});
+        }
+        if (name == "sum") {
+            const Type* element = args.empty() ? get(TypeKind::Int) : elementOf(first);
+            return element->kind == TypeKind::Bool ? get(TypeKind::Int) : element;
+        }
+        if ((name == "min" || name == "max") && !args.empty()) {
+            if (args.size() == 1) {
+                return elementOf(first);
+            }
+            const Type* result = get(TypeKind::Unknown);
+            for (const Type* arg : args) {
+                result = join(result, arg);
+            }
+            return result;
+        }
+        if (name == "enumerate" && !args.empty()) {
+            return table.get(TypeKind::List, {table.get(TypeKind::Tuple, {nonNegativeInt(), elementOf(first)})});
+        }
+        if (name == "zip" && !args.empty()) {
+            std::vector<const Type*> members;
+            for (const Type* arg : args) {
+                members.push_back(elementOf(arg));
+            }
+            return table.get(TypeKind::List, {table.get(TypeKind::Tuple, std::move(members))});
+        }
+        known = false;
+        return get(TypeKind::Auto);
+    }
+
+    // Methods of the built-in containers and str; `receiver` is refined in place
+    const Type* builtinMethodType(const Expr* receiver, const Type* self, std::string_view name,
+                                  const std::vector<const Type*>& args) {
+        const Type* first = args.empty() ? get(TypeKind::Unknown) : args[0];
+        switch (self->kind) {
+            case TypeKind::List:
+                if (name == "append" && args.size() == 1) {
+                    assign(receiver, table.get(TypeKind::List, {first}));
+                    return get(TypeKind::None);
+                }
+                if (name == "insert" && args.size() == 2) {
+                    assign(receiver, table.get(TypeKind::List, {args[1]}));
+                    return get(TypeKind::None);
+                }
+                if (name == "extend" && args.size() == 1) {
+                    assign(receiver, table.get(TypeKind::List, {elementOf(first)}));
+                    return get(TypeKind::None);
+                }
+                if (name == "pop") {
+                    return self->args[0];
+                }
+                if (name == "index" || name == "count") {
+                    return get(TypeKind::Int);
+                }
+                if (name == "copy") {
+                    return self;
+                }
+                if (name == "sort" || name == "reverse" || name == "clear" || name == "remove") {
+                    return get(TypeKind::None);
+                }
+                break;
+            case TypeKind::Set:
+                if (name == "add" && args.size() == 1) {
+                    assign(receiver, table.get(TypeKind::Set, {first}));
+                    return get(TypeKind::None);
+                }
+                if (name == "update" && args.size() == 1) {
+                    assign(receiver, table.get(TypeKind::Set, {elementOf(first)}));
+                    return get(TypeKind::None);
+                }
+                if (name == "union" || name == "intersection" || name == "difference" || name == "copy") {
+                    return self;
+                }
+                if (name == "issubset" || name == "issuperset" || name == "isdisjoint") {
+                    return get(TypeKind::Bool);
+                }
+                if (name == "discard" || name == "remove" || name == "clear") {
+                    return get(TypeKind::None);
+                }
+                break;
+            case TypeKind::Dict:
+                if (name == "get") {
+                    return args.size() > 1 ? join(self->args[1], args[1]) : self->args[1];
+                }
+                if (name == "setdefault" && args.size() == 2) {
+                    assign(receiver, table.get(TypeKind::Dict, {args[0], args[1]}));
+                    return self->args[1];
+                }
+                if (name == "keys") {
+                    return table.get(TypeKind::List, {self->args[0]});
+                }
+                if (name == "values") {
+                    return table.get(TypeKind::List, {self->args[1]});
+                }
+                if (name == "items") {
+                    return table.get(TypeKind::List, {table.get(TypeKind::Tuple, {self->args[0], self->args[1]})});
+                }
+                if (name == "pop") {
+                    return self->args[1];
+                }
+                if (name == "copy") {
+                    return self;
+                }
+                if (name == "update" || name == "clear") {
+                    return get(TypeKind::None);
+                }
+                break;
+            case TypeKind::Str:
+                if (name == "split" || name == "rsplit" || name == "splitlines") {
+                    return table.get(TypeKind::List, {self});
+                }
+                if (name == "find" || name == "rfind" || name == "index" || name == "count") {
+                    return get(TypeKind::Int);
+                }
+                if (name.substr(0, 2) == "is" || name == "startswith" || name == "endswith") {
+                    return get(TypeKind::Bool);
+                }
+                if (name == "encode") {
+                    return get(TypeKind::Auto);
+                }
+                return self;
+            case TypeKind::Unknown:
+                return self;
+            default:
+                break;
+        }
+        return get(TypeKind::Auto);
+    }
+
+    // Call of a function or class defined in the module, or imported into it;
+    // nullptr for any other name
+    const Type* definitionCallType(std::string_view name, const CallExpr* call,
+                                   const std::vector<const Type*>& argTypes) {
+        auto function = functions.find(name);
+        if (function != functions.end()) {
+            propagate(&function->second, call, argTypes, 0);
+            return function->second.returns;
+        }
+        auto cls = classes.find(name);
+        if (cls != classes.end()) {
+            propagate(findMethod(&cls->second, "__init__"), call, argTypes, 1);
+            return classType(cls->second.name);
+        }
+        return nullptr;
+    }
+
+    // `a.b.c` as written, for names and attributes only
+    static bool dottedName(const Expr* expr, std::string& dotted) {
+        if (expr->kind == ExprKind::Name) {
+            dotted = static_cast<const NameExpr*>(expr)->id;
+            return true;
+        }
+        if (expr->kind != ExprKind::Attribute || !dottedName(static_cast<const AttributeExpr*>(expr)->value, dotted)) {
+            return false;
+        }
+        dotted += '.';
+        dotted += static_cast<const AttributeExpr*>(expr)->attr;
+        return true;
+    }
+
+    const Type* callType(const CallExpr* call) {
+        std::vector<const Type*> argTypes;
+        std::vector<const Type*> positional;
+        argTypes.reserve(call->args.size());
+        for (const Expr* arg : call->args) {
+            argTypes.push_back(typeOf(arg));
+            if (arg->kind != ExprKind::Keyword && arg->kind != ExprKind::Starred) {
+                positional.push_back(argTypes.back());
+            }
+        }
+
+        if (call->func->kind == ExprKind::Name) {
+            if (const Type* result = definitionCallType(static_cast<const NameExpr*>(call->func)->id, call, argTypes)) {
+                return result;
+            }
+            std::string_view name = static_cast<const NameExpr*>(call->func)->id;
+            bool known = false;
+            const Type* result = builtinCallType(name, positional, known);
+            return known ? result : get(TypeKind::Auto);
+        }
+        if (call->func->kind != ExprKind::Attribute) {
+            typeOf(call->func);
+            return get(TypeKind::Auto);
+        }
+
+        auto* attr = static_cast<const AttributeExpr*>(call->func);
+        // --modules: util.f(...) calls a function of an imported module
+        if (!importedCalls.empty()) {
+            std::string dotted;
+            auto imported = dottedName(attr, dotted) ? importedCalls.find(dotted) : importedCalls.end();
+            if (imported != importedCalls.end()) {
+                if (const Type* result = definitionCallType(imported->second, call, argTypes)) {
+                    return result;
+                }
+            }
+        }
+        // super().method(...) resolves against the base of the enclosing class
+        if (attr->value->kind == ExprKind::Call &&
+            static_cast<const CallExpr*>(attr->value)->func->kind == ExprKind::Name &&
+            static_cast<const NameExpr*>(static_cast<const CallExpr*>(attr->value)->func)->id == "super") {
+            ClassTypes* base = fn->owner != nullptr ? fn->owner->base : nullptr;
+            FunctionTypes* method = findMethod(base, attr->attr);
+            propagate(method, call, argTypes, 1);
+            return method != nullptr ? method->returns : get(TypeKind::Auto);
+        }
+        // Base.__init__(self, ...) and Class.static_method(...) pass every argument explicitly
+        if (attr->value->kind == ExprKind::Name) {
+            auto cls = classes.find(static_cast<const NameExpr*>(attr->value)->id);
+            if (cls != classes.end() && fn->locals.find(static_cast<const NameExpr*>(attr->value)->id) == nullptr) {
+                FunctionTypes* method = findMethod(&cls->second, attr->attr);
+                propagate(method, call, argTypes, method != nullptr && method->isClassMethod ? 1 : 0);
+                return method != nullptr ? method->returns : get(TypeKind::Auto);
+            }
+        }
+        const Type* self = typeOf(attr->value);
+        if (ClassTypes* cls = findClass(self)) {
+            FunctionTypes* method = findMethod(cls, attr->attr);
+            if (method == nullptr) {
+                return get(TypeKind::Auto);
+            }
+            propagate(method, call, argTypes, method->isStatic ? 0 : 1);
+            return method->returns;
+        }
+        return builtinMethodType(attr->value, self, attr->attr, positional);
+    }
+
+    void bindGenerators(const ComprehensionExpr* comp) {
+        for (const Comprehension* gen : comp->generators) {
+            assign(gen->target, elementOf(typeOf(gen->iter)));
+            for (const Expr* cond : gen->ifs) {
+                typeOf(cond);
+            }
+        }
+    }
+
+
+    const Type* typeOf(const Expr* expr) {
+        switch (expr->kind) {
+            case ExprKind::Name: {
+                std::string_view id = static_cast<const NameExpr*>(expr)->id;
+                if (id == "self" && fn->owner != nullptr) {
+                    return classType(fn->owner->name);
+                }
+                return lookup(id);
+            }
+            case ExprKind::Number:
+                return numberType(static_cast<const ConstantExpr*>(expr)->text);
+            case ExprKind::String:
+                return get(TypeKind::Str);
+            case ExprKind::FString:
+                for (const Expr* part : static_cast<const FStringExpr*>(expr)->parts) {
+                    typeOf(part);
+                }
+                return get(TypeKind::Str);
+            case ExprKind::FormattedValue:
+                typeOf(static_cast<const FormattedValueExpr*>(expr)->value);
+                return get(TypeKind::Str);
+            case ExprKind::Bool:
+                return get(TypeKind::Bool);
+            case ExprKind::None:
+                return get(TypeKind::None);
+            case ExprKind::Unary: {
+                auto* unary = static_cast<const UnaryExpr*>(expr);
+                const Type* operand = typeOf(unary->operand);
+                if (unary->op == "not") {
+                    return get(TypeKind::Bool);
+                }
+                if (unary->op == "~" || operand->kind == TypeKind::Bool || (unary->op == "-" && isNonNegative(operand))) {
+                    return isNumeric(operand) ? get(TypeKind::Int) : operand;
+                }
+                return operand;
+            }
+            case ExprKind::BoolOp: {
+                // Lowered to && and ||, which yield bool in C++
+                auto* op = static_cast<const BinaryExpr*>(expr);
+                typeOf(op->left);
+                typeOf(op->right);
+                return get(TypeKind::Bool);
+            }
+            case ExprKind::Binary: {
+                auto* op = static_cast<const BinaryExpr*>(expr);
+                const Type* left = typeOf(op->left);
+                const Type* right = typeOf(op->right);
+                return binaryType(op->op, left, right);
+            }
+            case ExprKind::Compare:
+                for (const Expr* operand : static_cast<const CompareExpr*>(expr)->operands) {
+                    typeOf(operand);
+                }
+                return get(TypeKind::Bool);
+            case ExprKind::Conditional: {
+                auto* cond = static_cast<const ConditionalExpr*>(expr);
+                typeOf(cond->test);
+                const Type* body = typeOf(cond->body);
+                return join(body, typeOf(cond->orelse));
+            }
+            case ExprKind::Call:
+                return callType(static_cast<const CallExpr*>(expr));
+            case ExprKind::Keyword:
+                return typeOf(static_cast<const KeywordExpr*>(expr)->value);
+            case ExprKind::Starred:
+                return typeOf(static_cast<const StarredExpr*>(expr)->value);
+            case ExprKind::Attribute: {
+                auto* attr = static_cast<const AttributeExpr*>(expr);
+                const Type* self = typeOf(attr->value);
+                if (ClassTypes* cls = findClass(self)) {
+                    return fieldType(cls, attr->attr);
+                }
+                return get(TypeKind::Auto);
+            }
+            case ExprKind::Subscript: {
+                auto* sub = static_cast<const SubscriptExpr*>(expr);
+                const Type* container = typeOf(sub->value);
+                typeOf(sub->index);
+                if (sub->index->kind == ExprKind::Slice) {
+                    return container->kind == TypeKind::List || container->kind == TypeKind::Str
+                        ? container : get(TypeKind::Auto);
+                }
+                switch (container->kind) {
+                    case TypeKind::List:
+                        return container->args[0];
+                    case TypeKind::Dict:
+                        return container->args[1];
+                    case TypeKind::Str:
+                    case TypeKind::Unknown:
+                        return container;
+                    case TypeKind::Tuple:
+                        if (sub->index->kind == ExprKind::Number) {
+                            std::string_view text = static_cast<const ConstantExpr*>(sub->index)->text;
+                            size_t i = 0;
+                            for (char c : text) {
+                                i = c >= '0' && c <= '9' ? i * 10 + static_cast<size_t>(c - '0') : container->args.size();
+                            }
+                            if (i < container->args.size()) {
+                                return container->args[i];
+                            }
+                        }
+                        return elementOf(container);
+                    default:
+                        return get(TypeKind::Auto);
+                }
+            }
+            case ExprKind::Slice: {
+                auto* slice = static_cast<const SliceExpr*>(expr);
+                for (const Expr* part : {slice->lower, slice->upper, slice->step}) {
+                    if (part != nullptr) {
+                        typeOf(part);
+                    }
+                }
+                return get(TypeKind::Auto);
+            }
+            case ExprKind::List:
+            case ExprKind::Set: {
+                const Type* element = get(TypeKind::Unknown);
+                for (const Expr* e : static_cast<const SequenceExpr*>(expr)->elements) {
+                    const Type* t = typeOf(e);
+                    element = joinElements(element, e->kind == ExprKind::Starred ? elementOf(t) : t);
+                }
+                return table.get(expr->kind == ExprKind::List ? TypeKind::List : TypeKind::Set, {element});
+            }
+            case ExprKind::Tuple: {
+                std::vector<const Type*> members;
+                bool starred = false;
+                for (const Expr* e : static_cast<const SequenceExpr*>(expr)->elements) {
+                    members.push_back(typeOf(e));
+                    starred = starred || e->kind == ExprKind::Starred;
+                }
+                return starred ? get(TypeKind::Auto) : table.get(TypeKind::Tuple, std::move(members));
+            }
+            case ExprKind::Dict: {
+                auto* dict = static_cast<const DictExpr*>(expr);
+                const Type* key = get(TypeKind::Unknown);
+                const Type* value = get(TypeKind::Unknown);
+                for (size_t i = 0; i < dict->keys.size(); ++i) {
+                    const Type* t = typeOf(dict->values[i]);
+                    if (dict->keys[i] == nullptr) {
+                        // **spread merges another dict's entries
+                        if (t->kind == TypeKind::Dict) {
+                            key = join(key, t->args[0]);
+                            value = join(value, t->args[1]);
+                        }
+                        continue;
+                    }
+                    key = joinElements(key, typeOf(dict->keys[i]));
+                    value = joinElements(value, t);
+                }
+                return table.get(TypeKind::Dict, {key, value});
+            }
+            case ExprKind::ListComp:
+            case ExprKind::SetComp:
+            case ExprKind::GeneratorExp: {
+                auto* comp = static_cast<const ComprehensionExpr*>(expr);
+                bindGenerators(comp);
+                const Type* element = typeOf(comp->element);
+                return table.get(expr->kind == ExprKind::SetComp ? TypeKind::Set : TypeKind::List, {element});
+            }
+            case ExprKind::DictComp: {
+                auto* comp = static_cast<const ComprehensionExpr*>(expr);
+                bindGenerators(comp);
+                const Type* key = typeOf(comp->element);
+                return table.get(TypeKind::Dict, {key, typeOf(comp->value)});
+            }
+            case ExprKind::Lambda: {
+                auto* lambda = static_cast<const LambdaExpr*>(expr);
+                for (const Param* param : lambda->params) {
+                    update(fn->locals, param->name, get(TypeKind::Auto));
+                }
+                typeOf(lambda->body);
+                return get(TypeKind::Auto);
+            }
+            default:
+                return get(TypeKind::Auto);
+        }
+    }
+
+    void walkBlock(const StmtList& body) {
+        for (const Stmt* stmt : body) {
+            walkStatement(stmt);
+        }
+    }
+
+    void walkStatement(const Stmt* stmt) {
+        switch (stmt->kind) {
+            case StmtKind::Expr:
+                typeOf(static_cast<const ExprStmt*>(stmt)->value);
+                break;
+            case StmtKind::Assign: {
+                auto* assignStmt = static_cast<const AssignStmt*>(stmt);
+                const Type* t = typeOf(assignStmt->value);
+                for (const Expr* target : assignStmt->targets) {
+                    assign(target, t);
+                }
+                break;
+            }
+            case StmtKind::AugAssign: {
+                auto* aug = static_cast<const AugAssignStmt*>(stmt);
+                const Type* current = typeOf(aug->target);
+                const Type* value = typeOf(aug->value);
+                std::string_view op = aug->op.substr(0, aug->op.size() - 1);
+                assign(aug->target, binaryType(op, current, value));
+                break;
+            }
+            case StmtKind::AnnAssign: {
+                auto* ann = static_cast<const AnnAssignStmt*>(stmt);
+                const Type* t = fromAnnotation(ann->annotation);
+                if (ann->value != nullptr) {
+                    const Type* value = typeOf(ann->value);
+                    t = t->kind == TypeKind::Auto ? value : join(t, value);
+                }
+                assign(ann->target, t);
+                break;
+            }
+            case StmtKind::Return: {
+                auto* ret = static_cast<const ValueStmt*>(stmt);
+                const Type* t = ret->value != nullptr ? typeOf(ret->value) : get(TypeKind::None);
+                if (t->kind == TypeKind::None && ret->value != nullptr && ret->value->kind != ExprKind::None) {
+                    t = get(TypeKind::Auto);  // Only ever seen holding None, e.g. an unused default
+                }
+                if (nestedDepth == 0 && recording) {
+                    fn->returnsValue = fn->returnsValue || ret->value != nullptr;
+                    if (!fn->returnsPinned) {
+                        update(fn->returns, t);
+                    }
+                }
+                break;
+            }
+            case StmtKind::Raise:
+                if (static_cast<const ValueStmt*>(stmt)->value != nullptr) {
+                    typeOf(static_cast<const ValueStmt*>(stmt)->value);
+                }
+                break;
+            case StmtKind::Assert:
+                for (const Expr* e : static_cast<const ExprListStmt*>(stmt)->expressions) {
+                    typeOf(e);
+                }
+                break;
+            case StmtKind::If:
+            case StmtKind::While: {
+                auto* ifStmt = static_cast<const IfStmt*>(stmt);
+                typeOf(ifStmt->test);
+                walkBlock(ifStmt->body);
+                walkBlock(ifStmt->orelse);
+                break;
+            }
+            case StmtKind::For: {
+                auto* forStmt = static_cast<const ForStmt*>(stmt);
+                assign(forStmt->target, elementOf(typeOf(forStmt->iter)));
+                walkBlock(forStmt->body);
+                walkBlock(forStmt->orelse);
+                break;
+            }
+            case StmtKind::FunctionDef: {
+                // Nested functions become lambdas with generic parameters
+                auto* def = static_cast<const FunctionDef*>(stmt);
+                ++nestedDepth;
+                for (const Param* param : def->params) {
+                    update(fn->locals, param->name, param->annotation != nullptr ? fromAnnotation(param->annotation)
+                                                                                 : get(TypeKind::Auto));
+                }
+                walkBlock(def->body);
+                --nestedDepth;
+                break;
+            }
+            case StmtKind::Try: {
+                auto* tryStmt = static_cast<const TryStmt*>(stmt);
+                walkBlock(tryStmt->body);
+                for (const ExceptHandler* handler : tryStmt->handlers) {
+                    walkBlock(handler->body);
+                }
+                walkBlock(tryStmt->orelse);
+                walkBlock(tryStmt->finalbody);
+                break;
+            }
+            case StmtKind::With:
+                for (const WithItem* item : static_cast<const WithStmt*>(stmt)->items) {
+                    typeOf(item->context);
+                    if (item->var != nullptr) {
+                        assign(item->var, get(TypeKind::Auto));
+                    }
+                }
+                walkBlock(static_cast<const WithStmt*>(stmt)->body);
+                break;
+            case StmtKind::Unsupported:
+                walkBlock(static_cast<const TextStmt*>(stmt)->body);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void walkFunction(FunctionTypes* function, const FunctionDef* def) {
+        if (function != nullptr) {
+            walkFunction(*function, def);
+        }
+    }
+
+    void walkFunction(FunctionTypes& function, const FunctionDef* def) {
+        FunctionTypes* outer = fn;
+        fn = &function;
+        for (size_t i = 0; i < def->params.size(); ++i) {
+            const Param* param = def->params[i];
+            if (param->defaultValue != nullptr && !function.pinned[i]) {
+                update(function.params[i], typeOf(param->defaultValue));
+            }
+            update(function.locals, param->name, function.params[i]);
+        }
+        walkBlock(def->body);
+        fn = outer;
+    }
+
+    void registerFunction(FunctionTypes& function, const FunctionDef* def, ClassTypes* owner) {
+        function = FunctionTypes();
+        function.owner = owner;
+        function.def = def;
+        for (const Expr* decorator : def->decorators) {
+            if (decorator->kind != ExprKind::Name) {
+                continue;
+            }
+            std::string_view name = static_cast<const NameExpr*>(decorator)->id;
+            function.isStatic = function.isStatic || name == "staticmethod";
+            function.isClassMethod = function.isClassMethod || name == "classmethod";
+        }
+        if (function.isClassMethod) {
+            function.isStatic = false;
+        }
+        for (size_t i = 0; i < def->params.size(); ++i) {
+            const Param* param = def->params[i];
+            const Type* t = fromAnnotation(param->annotation);
+            bool pinned = param->annotation != nullptr && complete(t);
+            if (param->kind != Param::Normal || (i == 0 && function.isClassMethod)) {
+                t = get(TypeKind::Auto);
+                pinned = true;
+            } else if (owner != nullptr && i == 0 && !function.isStatic) {
+                t = classType(owner->name);
+                pinned = true;
+            }
+            function.paramNames.push_back(param->name);
+            function.params.push_back(t);
+            function.pinned.push_back(pinned);
+        }
+        function.returns = fromAnnotation(def->returns);
+        function.returnsPinned = def->returns != nullptr && complete(function.returns);
+        function.returnsValue = function.returnsPinned && function.returns->kind != TypeKind::None;
+    }
+
+    void registerClass(const ClassDef* cls) {
+        ClassTypes& types = classes[cls->name];
+        types = ClassTypes();
+        types.name = cls->name;
+        for (const Expr* base : cls->bases) {
+            if (base->kind == ExprKind::Name && static_cast<const NameExpr*>(base)->id != "object") {
+                types.baseName = static_cast<const NameExpr*>(base)->id;
+                break;
+            }
+        }
+        for (const Stmt* stmt : cls->body) {
+            if (stmt->kind == StmtKind::FunctionDef) {
+                auto* def = static_cast<const FunctionDef*>(stmt);
+                registerFunction(types.methods[def->name], def, &types);
+            }
+        }
+        types.statics.owner = &types;
+        types.statics.returns = get(TypeKind::Unknown);  // A stray `return` in the class body joins into this
+    }
+
+    void registerDefinition(const Stmt* stmt) {
+        if (stmt->kind == StmtKind::FunctionDef) {
+            auto* def = static_cast<const FunctionDef*>(stmt);
+            registerFunction(functions[def->name], def, nullptr);
+        } else if (stmt->kind == StmtKind::ClassDef) {
+            registerClass(static_cast<const ClassDef*>(stmt));
+        }
+    }
+
+    void resolveBase(ClassTypes& cls) {
+        auto base = classes.find(cls.baseName);
+        cls.base = base != classes.end() && &base->second != &cls ? &base->second : nullptr;
+    }
+
+    void walkTopLevel(const Stmt* stmt) {
+        if (stmt->kind == StmtKind::FunctionDef) {
+            auto* def = static_cast<const FunctionDef*>(stmt);
+            walkFunction(definition(def), def);
+            return;
+        }
+        if (stmt->kind == StmtKind::ClassDef) {
+            auto* cls = static_cast<const ClassDef*>(stmt);
+            ClassTypes& types = classes[cls->name];
+            for (const Stmt* member : cls->body) {
+                if (member->kind == StmtKind::FunctionDef) {
+                    auto* def = static_cast<const FunctionDef*>(member);
+                    walkFunction(method(&types, def), def);
+                } else if (member->kind != StmtKind::ClassDef) {
+                    fn = &types.statics;
+                    walkStatement(member);
+                    fn = &moduleTypes;
+                }
+            }
+            return;
+        }
+        walkStatement(stmt);
+    }
+
+    // Repeats the walk until no table changes
+    template <typename Walk>
+    void solve(Walk walk) {
+        PY2CPP_PROFILE_SCOPE("type inference");
+        recording = true;
+        fn = &moduleTypes;
+        for (int pass = 0; pass < kMaxPasses; ++pass) {
+            changed = false;
+            walk();
+            if (!changed) {
+                break;
+            }
+        }
+        recording = false;
+    }
+
+    // An attribute assigned in both a class and its base is one member of the base
+    void settleFields(ClassTypes& cls) {
+        for (size_t i = cls.fields.entries.size(); i-- > 0;) {
+            std::string_view name = cls.fields.entries[i].first;
+            const Type* t = cls.fields.entries[i].second;
+            for (ClassTypes* ancestor = &cls; ancestor != nullptr; ancestor = ancestor->base) {
+                if (ancestor->statics.locals.find(name) != nullptr) {
+                    cls.fields.erase(name);
+                    break;
+                }
+                if (ancestor != &cls && ancestor->fields.find(name) != nullptr) {
+                    const Type*& inherited = ancestor->fields.slot(name, t);
+                    inherited = join(inherited, t);
+                    cls.fields.erase(name);
+                    break;
+                }
+            }
+        }
+    }
+
+public:
+    TypeInference() {
+        clear();
+    }
+
+    void clear() {
+        functions.clear();
+        classes.clear();
+        importedCalls.clear();
+        moduleTypes = FunctionTypes();
+        moduleTypes.returns = get(TypeKind::Unknown);
+        fn = &moduleTypes;
+        nestedDepth = 0;
+        recording = false;
+    }
+
+    // Infers types for a whole module before any of it is generated
+    void analyze(const StmtList& body) {
+        analyze(body, [] {});
+    }
+
+    // Like analyze(body); `seed` runs once the definitions are registered, to
+    // add parameter types observed outside the module with seed(function, ...)
+    template <typename Seed>
+    void analyze(const StmtList& body, Seed seed) {
+        for (const Stmt* stmt : body) {
+            registerDefinition(stmt);
+        }
+        for (auto& entry : classes) {
+            resolveBase(entry.second);
+        }
+        seed();
+        solve([&]() {
+            for (const Stmt* stmt : body) {
+                walkTopLevel(stmt);
+            }
+        });
+        for (auto& entry : classes) {
+            settleFields(entry.second);
+        }
+    }
+
+    // Streaming mode: infers one top-level statement from what it contains and
+    // what was seen before it. Definitions are sealed once analysed, since
+    // their code is generated before any later call site is read.
+    void analyzeStatement(const Stmt* stmt) {
+        registerDefinition(stmt);
+        ClassTypes* cls = nullptr;
+        if (stmt->kind == StmtKind::ClassDef) {
+            cls = &classes[static_cast<const ClassDef*>(stmt)->name];
+            resolveBase(*cls);
+        }
+        solve([&]() { walkTopLevel(stmt); });
+        if (stmt->kind == StmtKind::FunctionDef) {
+            functions[static_cast<const FunctionDef*>(stmt)->name].sealed = true;
+        } else if (cls != nullptr) {
+            settleFields(*cls);
+            for (auto& method : cls->methods) {
+                method.second.sealed = true;
+            }
+        }
+    }
+
+    FunctionTypes* module() {
+        return &moduleTypes;
+    }
+
+    // --modules: a function or class another project module defines, under the
+    // name this module spells it with. Register imports before analyze(); the
+    // caller fills in what the defining module found, and the parameters
+    // collect the argument types of the calls made here.
+    FunctionTypes& importFunction(std::string_view name) {
+        FunctionTypes& function = functions[name];
+        function = FunctionTypes();
+        function.returns = get(TypeKind::Unknown);
+        return function;
+    }
+
+    ClassTypes& importClass(std::string_view name) {
+        ClassTypes& cls = classes[name];
+        cls = ClassTypes();
+        cls.name = name;
+        cls.statics.owner = &cls;
+        return cls;
+    }
+
+    // Calls written as `dotted` (util.f) call the import registered as `name`
+    void importCall(std::string dotted, std::string_view name) {
+        importedCalls[std::move(dotted)] = name;
+    }
+
+    // Joins `t` into parameter `index` of `function`, unless an annotation fixed it
+    void seed(FunctionTypes& function, size_t index, const Type* t) {
+        if (index < function.params.size() && !function.pinned[index]) {
+            update(function.params[index], t);
+        }
+    }
+
+    // The type of `kind` with these element types, or the class called `name`,
+    // which has to outlive the inference, or the int marked kNonNegative
+    const Type* type(TypeKind kind, std::vector<const Type*> args = {}, std::string_view name = {}) {
+        return isContainer(kind) || kind == TypeKind::Class || !name.empty() ? table.get(kind, std::move(args), name)
+                                                                             : get(kind);
+    }
+
+    FunctionTypes* function(std::string_view name) {
+        auto it = functions.find(name);
+        return it != functions.end() ? &it->second : nullptr;
+    }
+
+    // The types of this def; null once a later def of the same name replaced
+    // it, since that is the one every call reaches
+    FunctionTypes* definition(const FunctionDef* def) {
+        return ownTypes(function(def->name), def);
+    }
+
+    FunctionTypes* method(ClassTypes* cls, const FunctionDef* def) {
+        return ownTypes(method(cls, def->name), def);
+    }
+
+    ClassTypes* findClass(std::string_view name) {
+        auto it = classes.find(name);
+        return it != classes.end() ? &it->second : nullptr;
+    }
+
+    FunctionTypes* method(ClassTypes* cls, std::string_view name) {
+        if (cls == nullptr) {
+            return nullptr;
+        }
+        auto it = cls->methods.find(name);
+        return it != cls->methods.end() ? &it->second : nullptr;
+    }
+
+    // Type of `expr` evaluated in `scope`; does not change any table
+    const Type* typeOf(const Expr* expr, FunctionTypes* scope) {
+        FunctionTypes* outer = fn;
+        fn = scope != nullptr ? scope : &moduleTypes;
+        const Type* t = typeOf(expr);
+        fn = outer;
+        return t;
+    }
+
+    const Type* variable(const FunctionTypes* scope, std::string_view name) const {
+        const Type* t = scope != nullptr ? scope->locals.find(name) : nullptr;
+        return t != nullptr ? t : get(TypeKind::Unknown);
+    }
+
+    const Type* fromAnnotation(const Expr* annotation) {
+        if (annotation == nullptr) {
+            return get(TypeKind::Unknown);
+        }
+        if (annotation->kind == ExprKind::None) {
+            return get(TypeKind::None);
+        }
+        std::string_view name;
+        if (annotation->kind == ExprKind::Name) {
+            name = static_cast<const NameExpr*>(annotation)->id;
+        } else if (annotation->kind == ExprKind::String) {
+            name = static_cast<const StringExpr*>(annotation)->body;  // Forward reference
+        } else if (annotation->kind == ExprKind::Subscript &&
+                   static_cast<const SubscriptExpr*>(annotation)->value->kind == ExprKind::Name) {
+            auto* sub = static_cast<const SubscriptExpr*>(annotation);
+            std::string_view base = static_cast<const NameExpr*>(sub->value)->id;
+            std::vector<const Type*> args;
+            if (sub->index->kind == ExprKind::Tuple) {
+                for (const Expr* arg : static_cast<const SequenceExpr*>(sub->index)->elements) {
+                    args.push_back(fromAnnotation(arg));
+                }
+            } else {
+                args.push_back(fromAnnotation(sub->index));
+            }
+            if (base == "Optional" && args.size() == 1) {
+                return args[0];
+            }
+            auto it = typeMap.find(base);
+            if (it == typeMap.end()) {
+                return get(TypeKind::Auto);
+            }
+            size_t arity = it->second == TypeKind::Dict ? 2 : it->second == TypeKind::Tuple ? args.size() : 1;
+            if (!isContainer(it->second) || args.size() != arity) {
+                return get(TypeKind::Auto);
+            }
+            return table.get(it->second, std::move(args));
+        } else {
+            return get(TypeKind::Auto);
+        }
+        auto it = typeMap.find(name);
+        if (it != typeMap.end()) {
+            switch (it->second) {
+                case TypeKind::List:
+                case TypeKind::Set:
+                    return table.get(it->second, {get(TypeKind::Unknown)});
+                case TypeKind::Dict:
+                    return table.get(it->second, {get(TypeKind::Unknown), get(TypeKind::Unknown)});
+                case TypeKind::Tuple:
+                    return get(TypeKind::Auto);
+                default:
+                    return get(it->second);
+            }
+        }
+        auto cls = classes.find(name);
+        return cls != classes.end() ? classType(cls->second.name) : get(TypeKind::Auto);
+    }
+
+    // Generated containers: the runtime's flat List/Dict/Set, or the std ones
+    void useStdContainers(bool enabled) {
+        stdContainers = enabled;
+    }
+
+    // Class template a List, Set or Dict value is spelled with
+    std::string_view containerTemplate(TypeKind kind) const {
+        switch (kind) {
+            case TypeKind::List:
+                return stdContainers ? "std::vector" : "py2cpp::List";
+            case TypeKind::Set:
+                return stdContainers ? "std::set" : "py2cpp::Set";
+            default:
+                return stdContainers ? "std::map" : "py2cpp::Dict";
+        }
+    }
+
+    // C++ spelling of `type`. Where C++ can deduce the type, `auto` stands in
+    // for what was not inferred; inside containers and members it cannot, and
+    // the tagged value type is used instead.
+    std::string cppType(const Type* type, TypeUse use = TypeUse::Variable) const {
+        switch (type->kind) {
+            case TypeKind::Unknown:
+            case TypeKind::Auto:
+                return use == TypeUse::Element ? kValueType : "auto";
+            case TypeKind::None:
+                return use == TypeUse::Return ? "void" : use == TypeUse::Element ? kValueType : "auto";
+            case TypeKind::Bool:
+                return "bool";
+            case TypeKind::Int:
+                return "int64_t";
+            case TypeKind::Float:
+                return "double";
+            case TypeKind::Str:
+                return "std::string";
+            case TypeKind::List:
+            case TypeKind::Set:
+                return std::string(containerTemplate(type->kind)) + "<" + cppType(type->args[0], TypeUse::Element) +
+                       ">";
+            case TypeKind::Dict:
+                return std::string(containerTemplate(type->kind)) + "<" + cppType(type->args[0], TypeUse::Element) +
+                       ", " + cppType(type->args[1], TypeUse::Element) + ">";
+            case TypeKind::Tuple: {
+                std::string result = "std::tuple<";
+                for (size_t i = 0; i < type->args.size(); ++i) {
+                    if (i > 0) {
+                        result += ", ";
+                    }
+                    result += cppType(type->args[i], TypeUse::Element);
+                }
+                return result + ">";
+            }
+            case TypeKind::Class:
+                return std::string(type->name);
+            case TypeKind::Dynamic:
+                return kValueType;
+        }
+        return "auto";
+    }
+
+    // True when every part of the type is known, so it can be spelled without `auto`
+    static bool determined(const Type* t) {
+        if (t->kind == TypeKind::Unknown || t->kind == TypeKind::Auto || t->kind == TypeKind::None) {
+            return false;
+        }
+        return std::all_of(t->args.begin(), t->args.end(), determined);
+    }
+
+    static bool returnsVoid(const FunctionTypes& function) {
+        return !function.returnsValue || function.returns->kind == TypeKind::None;
+    }
+
+    // Return type of a function; one that never returns a value is void
+    std::string returnType(const FunctionTypes& function) const {
+        return returnsVoid(function) ? "void" : cppType(function.returns, TypeUse::Return);
+    }
+};